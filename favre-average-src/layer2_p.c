@@ -4,151 +4,392 @@
 *  of computed DNS or LES data  *
 *    for mixing layer flow      *
 *                               *
-*  v. 0.2, 23.11.2000           *
+*  v. 0.3                       *
 *                               *
 \*******************************/
 
+/*
+*  Usage: layer2_p [-s stepStart] [-e stepEnd] [-t threads] [-o prefix] [file ...]
+*
+*  Averages the probe time series of mpi-layer2 (see probefile.h) over the steps
+*  stepStart..stepEnd (default all). The files are "probes.bin" or the per-process
+*  "probes.<id>.bin", by default whichever of them are found.
+*
+*  Every file is mapped into memory; its records, in increasing steps, are found by
+*  bisection, so only the pages of the window are ever read. The window is cut into
+*  pieces averaged by a pool of threads (default: one per processor), the pieces
+*  then merged after Chan et al.
+*
+*  For every probe "<prefix><name>.dat" lists its points: index, x, y, z, then for
+*  every variable its mean and r.m.s.; with rho sampled as well, Favre means of u,
+*  v, w, T and the Favre velocities <rhou>/<rho> etc. are added.
+*/
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <glob.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-float *ArrayAllocMem( unsigned size )
+#include "probefile.h"
+
+/* running moments of one value: Reynolds, and weighted by rho */
+typedef struct {
+   double n, mean, M2;
+   double W, wmean, wM2;
+} Moments;
+
+typedef struct {
+   const char *name;
+   const unsigned char *map;          /* the whole file */
+   size_t size;
+   const ProbeFileHeader *h;
+   const ProbeFileProbe *prb;
+   const ProbeFilePoint *pt;
+   int *rhoCol;                       /* column of rho of the same point, -1 if none */
+   long first, last;                  /* records of the window */
+   Moments *m;                        /* merged moments [nValues] */
+} ProbeFile;
+
+typedef struct {
+   ProbeFile *f;
+   long first, last;
+   Moments *m;
+} Task;
+
+static Task *tasks;
+static int nTasks, nextTask = 0;
+static pthread_mutex_t taskLock = PTHREAD_MUTEX_INITIALIZER;
+
+
+static void *AllocMem( size_t size )
 {
-float *x;
+void *x;
 
-   if( ( x = (float *)malloc( sizeof(float)*size ) ) == NULL ) {
+   if( ( x = calloc( size, 1 ) ) == NULL ) {
 	  puts( "Cannot allocate memory" );
 	  exit( -1 );
    }
    return x;
 
-} /* end ArrayAllocMem() */
+} /* end AllocMem() */
 
 
-int main( void )
+static int stepOf( const ProbeFile *f, long r )
 {
-unsigned HIG, step, stepStart, stepEnd, i, j;
-float *probeR, *probeRU, *R1, *RU1, *R2, *RU2, *R3, *RU3;
-FILE *pFprobes, *pFprofile;
+int s;
+   memcpy( &s, f->map + f->h->headerSize + (size_t)r * f->h->recordSize + 8, sizeof(s) );
+   return s;
+}
 
-   /*--- get some parameters ---*/
-   printf( "stepStart = " ); scanf( "%d", &stepStart );
-   printf( "stepEnd = " );   scanf( "%d", &stepEnd );
-   printf( "HIG = " );       scanf( "%d", &HIG );
-
-   /*--- allocate memory ---*/
-   probeR  = ArrayAllocMem( HIG );
-   probeRU = ArrayAllocMem( HIG );
-   R1 = ArrayAllocMem( HIG );
-   R2 = ArrayAllocMem( HIG );
-   R3 = ArrayAllocMem( HIG );
-   RU1 = ArrayAllocMem( HIG );
-   RU2 = ArrayAllocMem( HIG );
-   RU3 = ArrayAllocMem( HIG );
-   for( i = 0; i < HIG; i++ ) {
-      R1[i] = R2[i] = R3[i] =0.;
-      RU1[i] = RU2[i] = RU3[i] = 0.;
-   }
-
-   /*--- opens probes file ---*/
-   if( ( pFprobes = fopen( "probes.dat", "rb" ) ) == NULL ) {
-      puts( "Cannot open file \"probes.dat\"" );
-      exit( -1 );
-   }
-
-   /*--- read ... ---*/
-   for( i = 0;; i++ ) {
-   
-      /* read step */
-	  fread( &step, sizeof( step ), 1, pFprobes );
-
-	  if( step > stepEnd ) break;
-
-	  if( step < stepStart ) { /* simple read, not add */
-		 /* 1st probe - idle */
-		 fread( probeR,  sizeof(float)*HIG, 1, pFprobes );
-		 fread( probeRU, sizeof(float)*HIG, 1, pFprobes );
-		 /* 2nd probe - idle */
-		 fread( probeR,  sizeof(float)*HIG, 1, pFprobes );
-		 fread( probeRU, sizeof(float)*HIG, 1, pFprobes );
-		 /* 3rd probe - idle */
-		 fread( probeR,  sizeof(float)*HIG, 1, pFprobes );
-		 fread( probeRU, sizeof(float)*HIG, 1, pFprobes );
-	  } /* end if() */
-	  else{
-		 /* prints it out */
-		 printf( "step = %d\n", step );
-		 /* 1st probe */
-		 fread( probeR,  sizeof(float)*HIG, 1, pFprobes );
-		 fread( probeRU, sizeof(float)*HIG, 1, pFprobes );
-		 for( j = 0; j < HIG; j++ ) {
-			R1[j] += probeR[j];
-			RU1[j] += probeRU[j];
+/*
+* FirstRecord - First record of the file with a step not below s.
+*/
+static long FirstRecord( const ProbeFile *f, long nRec, int s )
+{
+long lo = 0, hi = nRec, mid;
+
+   while( lo < hi ) {
+	  mid = ( lo + hi ) / 2;
+	  if( stepOf( f, mid ) < s ) lo = mid + 1;
+	  else hi = mid;
+   }
+   return lo;
+
+} /* end FirstRecord() */
+
+
+/*
+* OpenProbeFile - Maps the file and finds the window stepStart..stepEnd; returns 0 on success.
+*/
+static int OpenProbeFile( ProbeFile *f, const char *name, int stepStart, int stepEnd )
+{
+struct stat st;
+long nRec;
+int fd, p, q, c, l;
+const unsigned char *base;
+
+   f->name = name;
+   if( ( fd = open( name, O_RDONLY ) ) < 0 || fstat( fd, &st ) != 0 ) {
+	  printf( "Cannot open file \"%s\"\n", name );
+	  return 1;
+   }
+   f->size = st.st_size;
+   if( f->size < sizeof(ProbeFileHeader) ||
+       ( f->map = mmap( NULL, f->size, PROT_READ, MAP_SHARED, fd, 0 ) ) == MAP_FAILED ) {
+	  printf( "Cannot map file \"%s\"\n", name );
+	  close( fd );
+	  return 1;
+   }
+   close( fd );
+
+   f->h = (const ProbeFileHeader *)f->map;
+   if( memcmp( f->h->magic, PRB_MAGIC, 8 ) != 0 || f->h->version != PRB_VERSION ||
+       f->size < (size_t)f->h->headerSize ) {
+	  printf( "\"%s\" is not a probe file\n", name );
+	  return 1;
+   }
+   base   = f->map + sizeof(ProbeFileHeader);
+   f->prb = (const ProbeFileProbe *)base;
+   f->pt  = (const ProbeFilePoint *)( base + f->h->nProbes * sizeof(ProbeFileProbe) );
+
+   //--- column of rho of every value
+   f->rhoCol = (int *)AllocMem( ( f->h->nValues + 1 ) * sizeof(int) );
+   for( c = 0, q = 0; q < f->h->nPoints; q++ ) {
+	  const ProbeFileProbe *e = &f->prb[f->pt[q].probe];
+	  int r = -1;
+	  for( l = 0; l < e->nv; l++ ) if( strcmp( e->var[l], "rho" ) == 0 ) r = c + l;
+	  for( l = 0; l < e->nv; l++ ) f->rhoCol[c++] = r;
+   }
+
+   //--- the window, by bisection over the steps
+   nRec = ( f->size - f->h->headerSize ) / f->h->recordSize;
+   f->first = FirstRecord( f, nRec, stepStart );
+   f->last  = stepEnd < 0 ? nRec : FirstRecord( f, nRec, stepEnd + 1 );
+   if( f->last > f->first )
+	  madvise( (void *)( ( (size_t)( f->map + f->h->headerSize + f->first * f->h->recordSize ) ) & ~(size_t)( getpagesize() - 1 ) ),
+	           ( f->last - f->first ) * f->h->recordSize + getpagesize(), MADV_SEQUENTIAL );
+
+   f->m = (Moments *)AllocMem( ( f->h->nValues + 1 ) * sizeof(Moments) );
+   p = f->h->nProbes;
+   printf( "%s: %d probes, %d points, records %ld..%ld of %ld", name, p, f->h->nPoints, f->first, f->last - 1, nRec );
+   if( f->last > f->first ) printf( " (steps %d..%d)", stepOf( f, f->first ), stepOf( f, f->last - 1 ) );
+   printf( "\n" );
+   return 0;
+
+} /* end OpenProbeFile() */
+
+
+/*
+* Average - Moments of the records first..last-1 of a file, after Welford.
+*/
+static void Average( const ProbeFile *f, long first, long last, Moments *m )
+{
+const unsigned char *rec;
+const float *v;
+double x, d, w;
+long r;
+int c, nv = f->h->nValues;
+
+   for( r = first; r < last; r++ ) {
+	  rec = f->map + f->h->headerSize + (size_t)r * f->h->recordSize;
+	  v = (const float *)( rec + PRB_RECHEAD );
+	  for( c = 0; c < nv; c++ ) {
+		 x = v[c];
+		 m[c].n++;
+		 d = x - m[c].mean;
+		 m[c].mean += d / m[c].n;
+		 m[c].M2 += d * ( x - m[c].mean );
+		 if( f->rhoCol[c] >= 0 ) {
+			w = v[f->rhoCol[c]];
+			m[c].W += w;
+			d = x - m[c].wmean;
+			m[c].wmean += w / m[c].W * d;
+			m[c].wM2 += w * d * ( x - m[c].wmean );
 		 }
-		 /* 2nd probe */
-		 fread( probeR,  sizeof(float)*HIG, 1, pFprobes );
-		 fread( probeRU, sizeof(float)*HIG, 1, pFprobes );
-		 for( j = 0; j < HIG; j++ ) {
-			R2[j] += probeR[j];
-			RU2[j] += probeRU[j];
+	  }
+   }
+} /* end Average() */
+
+
+/*
+* Merge - Adds the moments b to a (Chan et al.).
+*/
+static void Merge( Moments *a, const Moments *b, int n )
+{
+double d, N;
+int c;
+
+   for( c = 0; c < n; c++ ) {
+	  if( b[c].n > 0. ) {
+		 N = a[c].n + b[c].n;
+		 d = b[c].mean - a[c].mean;
+		 a[c].M2  += b[c].M2 + d * d * a[c].n * b[c].n / N;
+		 a[c].mean += d * b[c].n / N;
+		 a[c].n = N;
+	  }
+	  if( b[c].W > 0. ) {
+		 N = a[c].W + b[c].W;
+		 d = b[c].wmean - a[c].wmean;
+		 a[c].wM2  += b[c].wM2 + d * d * a[c].W * b[c].W / N;
+		 a[c].wmean += d * b[c].W / N;
+		 a[c].W = N;
+	  }
+   }
+} /* end Merge() */
+
+
+static void *Worker( void *arg )
+{
+Task *t;
+
+   (void)arg;
+   while( 1 ) {
+	  pthread_mutex_lock( &taskLock );
+	  t = nextTask < nTasks ? &tasks[nextTask++] : NULL;
+	  pthread_mutex_unlock( &taskLock );
+	  if( t == NULL ) break;
+	  Average( t->f, t->first, t->last, t->m );
+   }
+   return NULL;
+
+} /* end Worker() */
+
+
+/*
+* WriteProfiles - One file per probe, its points gathered from all files.
+*/
+static int WriteProfiles( ProbeFile *f, int nFiles, const char *prefix )
+{
+const ProbeFileProbe *e;
+const Moments **at;
+const ProbeFilePoint **pa;
+char name[256];
+FILE *pF;
+int p, q, c, l, n, a, found, fav;
+double rec;
+const char *vel[3] = { "rhou", "rhov", "rhow" };
+
+   for( p = 0; p < f[0].h->nProbes; p++ ) {
+	  e = &f[0].prb[p];
+	  n = e->n[0] * e->n[1] * e->n[2];
+	  at = (const Moments **)AllocMem( n * sizeof(*at) );
+	  pa = (const ProbeFilePoint **)AllocMem( n * sizeof(*pa) );
+
+	  // the moments of every point, from whichever file holds it
+	  for( a = 0; a < nFiles; a++ ) {
+		 for( c = 0, q = 0; q < f[a].h->nPoints; q++ ) {
+			const ProbeFilePoint *pt = &f[a].pt[q];
+			if( pt->probe == p && pt->index < n ) { at[pt->index] = &f[a].m[c]; pa[pt->index] = pt; }
+			c += f[a].prb[pt->probe].nv;
 		 }
-		 /* 3rd probe */
-		 fread( probeR,  sizeof(float)*HIG, 1, pFprobes );
-		 fread( probeRU, sizeof(float)*HIG, 1, pFprobes );
-		 for( j = 0; j < HIG; j++ ) {
-			R3[j] += probeR[j];
-			RU3[j] += probeRU[j];
+	  }
+	  for( found = 0, rec = 0., q = 0; q < n; q++ )
+		 if( at[q] != NULL ) { if( found++ == 0 ) rec = at[q]->n; }
+	  for( fav = -1, l = 0; l < e->nv; l++ ) if( strcmp( e->var[l], "rho" ) == 0 ) fav = l;
+
+	  snprintf( name, sizeof(name), "%s%s.dat", prefix, e->name );
+	  if( ( pF = fopen( name, "w" ) ) == NULL ) {
+		 printf( "Cannot open file \"%s\"\n", name );
+		 return 1;
+	  }
+	  fprintf( pF, "# probe %s, %d x %d x %d points (%d found), %s interpolation, %.0f records\n",
+	           e->name, e->n[0], e->n[1], e->n[2], found, e->linear ? "linear" : "cell", rec );
+	  fprintf( pF, "# index x y z" );
+	  for( l = 0; l < e->nv; l++ ) {
+		 fprintf( pF, " %s %s_rms", e->var[l], e->var[l] );
+		 if( fav >= 0 && strchr( "uvwT", e->var[l][0] ) != NULL && e->var[l][1] == '\0' )
+			fprintf( pF, " %s_f %s_f_rms", e->var[l], e->var[l] );
+		 for( a = 0; a < 3; a++ )
+			if( fav >= 0 && strcmp( e->var[l], vel[a] ) == 0 ) fprintf( pF, " %s/rho", vel[a] );
+	  }
+	  fprintf( pF, "\n" );
+
+	  for( q = 0; q < n; q++ ) {
+		 const Moments *m = at[q];
+		 if( m == NULL ) continue;
+		 fprintf( pF, "%d %g %g %g", q, pa[q]->x[0], pa[q]->x[1], pa[q]->x[2] );
+		 for( l = 0; l < e->nv; l++ ) {
+			fprintf( pF, " %.7g %.7g", m[l].mean, m[l].n > 0. ? sqrt( m[l].M2 / m[l].n ) : 0. );
+			if( fav >= 0 && strchr( "uvwT", e->var[l][0] ) != NULL && e->var[l][1] == '\0' )
+			   fprintf( pF, " %.7g %.7g", m[l].wmean, m[l].W > 0. ? sqrt( m[l].wM2 / m[l].W ) : 0. );
+			for( a = 0; a < 3; a++ )
+			   if( fav >= 0 && strcmp( e->var[l], vel[a] ) == 0 ) fprintf( pF, " %.7g", m[l].mean / m[fav].mean );
 		 }
-	  } /* end else */
-   } /* end for() */
+		 fprintf( pF, "\n" );
+	  }
+	  fclose( pF );
+	  printf( "%s: %d points\n", name, found );
+	  free( at ); free( pa );
+   }
+   return 0;
 
-   /*--- close probes file ---*/
-   fclose( pFprobes );
+} /* end WriteProfiles() */
 
-   /*--- determine Favre averaged (here RU means F.av. U) ---*/
-   for( j = 0; j < HIG; j++ ) {
-	  RU1[j] /= R1[j];
-	  RU2[j] /= R2[j];
-	  RU3[j] /= R3[j];
+
+int main( int argc, char *argv[] )
+{
+int stepStart = 0, stepEnd = -1, nThreads = 0, nFiles, a, t, c;
+const char *prefix = "";
+char **names;
+glob_t g;
+ProbeFile *f;
+pthread_t *th;
+long piece, r;
+
+   /*--- get some parameters ---*/
+   while( ( c = getopt( argc, argv, "s:e:t:o:h" ) ) != -1 ) {
+	  switch( c ) {
+		 case 's': stepStart = atoi( optarg ); break;
+		 case 'e': stepEnd   = atoi( optarg ); break;
+		 case 't': nThreads  = atoi( optarg ); break;
+		 case 'o': prefix    = optarg;         break;
+		 default:
+			puts( "Usage: layer2_p [-s stepStart] [-e stepEnd] [-t threads] [-o prefix] [file ...]" );
+			return c == 'h' ? 0 : -1;
+	  }
    }
+   if( nThreads <= 0 ) nThreads = sysconf( _SC_NPROCESSORS_ONLN );
+   if( nThreads <= 0 ) nThreads = 1;
 
-   /*--- write profiles ---*/
-	 /* 1st */
-   if( ( pFprofile = fopen( "probe1.dat","w" ) ) == NULL ) {
-	  puts( "Cannot open file ");
-	  exit( -1 );
+   /*--- probe files: given, or "probes.bin", or "probes.<id>.bin" ---*/
+   memset( &g, 0, sizeof(g) );
+   if( optind < argc ) { names = argv + optind; nFiles = argc - optind; }
+   else if( access( "probes.bin", R_OK ) == 0 ) { static char *one[1] = { "probes.bin" }; names = one; nFiles = 1; }
+   else if( glob( "probes.*.bin", 0, NULL, &g ) == 0 ) { names = g.gl_pathv; nFiles = g.gl_pathc; }
+   else {
+	  puts( "No probe files found" );
+	  return -1;
    }
-   fprintf( pFprofile, "%d\n1\n", HIG+2 );
-   fprintf( pFprofile, "%f %3.2f \n", -0.00001, 0. );
-   for( j = 0; j < HIG; j++ )
-	  fprintf( pFprofile, "%d %3.2f \n", j, RU1[j] );
-   fprintf( pFprofile, "%f %3.2f \n", HIG-1+0.00001, 210. );
-   fclose( pFprofile );
-	 /* 2nd */
-   if( ( pFprofile = fopen( "probe2.dat","w" ) ) == NULL ) {
-	  puts( "Cannot open file ");
-	  exit( -1 );
+
+   f = (ProbeFile *)AllocMem( nFiles * sizeof(ProbeFile) );
+   for( a = 0; a < nFiles; a++ ) {
+	  if( OpenProbeFile( &f[a], names[a], stepStart, stepEnd ) ) return -1;
+	  if( f[a].h->nProbes != f[0].h->nProbes ) {
+		 printf( "\"%s\" and \"%s\" are not of the same run\n", names[a], names[0] );
+		 return -1;
+	  }
    }
-   fprintf( pFprofile, "%d\n1\n", HIG+2 );
-   fprintf( pFprofile, "%f %3.2f \n", -0.00001, 0. );
-   for( j = 0; j < HIG; j++ )
-	  fprintf( pFprofile, "%d %3.2f \n", j, RU2[j] );
-   fprintf( pFprofile, "%f %3.2f \n", HIG-1+0.00001, 210. );
-   fclose( pFprofile );
-	 /* 3rd */
-   if( ( pFprofile = fopen( "probe3.dat", "w" ) ) == NULL ) {
-	  puts( "Cannot open file ");
-	  exit( -1 );
+
+   /*--- windows cut into pieces for the threads ---*/
+   tasks = (Task *)AllocMem( (size_t)nFiles * nThreads * sizeof(Task) );
+   for( nTasks = 0, a = 0; a < nFiles; a++ ) {
+	  piece = ( f[a].last - f[a].first + nThreads - 1 ) / nThreads;
+	  if( piece < 1 ) piece = 1;
+	  for( r = f[a].first; r < f[a].last; r += piece, nTasks++ ) {
+		 tasks[nTasks].f = &f[a];
+		 tasks[nTasks].first = r;
+		 tasks[nTasks].last  = r + piece < f[a].last ? r + piece : f[a].last;
+		 tasks[nTasks].m = (Moments *)AllocMem( ( f[a].h->nValues + 1 ) * sizeof(Moments) );
+	  }
+   }
+   th = (pthread_t *)AllocMem( nThreads * sizeof(pthread_t) );
+   for( t = 0; t < nThreads; t++ ) pthread_create( &th[t], NULL, Worker, NULL );
+   for( t = 0; t < nThreads; t++ ) pthread_join( th[t], NULL );
+
+   // pieces merged in order
+   for( t = 0; t < nTasks; t++ ) {
+	  Merge( tasks[t].f->m, tasks[t].m, tasks[t].f->h->nValues );
+	  free( tasks[t].m );
+   }
+
+   /*--- write profiles ---*/
+   if( WriteProfiles( f, nFiles, prefix ) ) return -1;
+
+   for( a = 0; a < nFiles; a++ ) {
+	  munmap( (void *)f[a].map, f[a].size );
+	  free( f[a].rhoCol ); free( f[a].m );
    }
-   fprintf( pFprofile, "%d\n1\n", HIG+2 );
-   fprintf( pFprofile, "%f %3.2f \n", -0.00001, 0. );
-   for( j = 0; j < HIG; j++ )
-	  fprintf( pFprofile, "%d %3.2f \n", j, RU3[j] );
-   fprintf( pFprofile, "%f %3.2f \n", HIG-1+0.00001, 210. );
-   fclose( pFprofile );
+   free( f ); free( tasks ); free( th );
+   globfree( &g );
 
    /*---*/
    return 0;
 
 } /* end main()*/
 
-/* end layer2_p.c */
\ No newline at end of file
+/* end layer2_p.c */
@@ -0,0 +1,40 @@
+#ifndef PROBEFILE_H
+#define PROBEFILE_H
+
+/*
+*  Layout of the probe files "probes.bin" and "probes.<id>.bin" (native byte order):
+*
+*      ProbeFileHeader
+*      ProbeFileProbe  x nProbes
+*      ProbeFilePoint  x nPoints, zero padding up to headerSize
+*      records of recordSize bytes: time (double), step (int), 4 spare bytes,
+*      nValues floats, point after point, the variables of its probe in turn
+*
+*  The same file is used by layer2_p (favre-average-src).
+*/
+
+#define PRB_MAGIC   "LAYER2PR"
+#define PRB_VERSION 1
+#define PRB_NVARS   9          /* rho, u, v, w, p, T, rhou, rhov, rhow */
+#define PRB_RECHEAD 16         /* time, step and spare bytes of a record */
+
+typedef struct {
+	char magic[8];
+	int  version, headerSize, recordSize;
+	int  nProbes, nPoints, nValues;
+	int  NX, HIG, DEP;
+	double deltaX, deltaY, deltaZ;
+} ProbeFileHeader;
+
+typedef struct {
+	char name[32];
+	int  nv, linear, n[3];
+	char var[PRB_NVARS][8];
+} ProbeFileProbe;
+
+typedef struct {
+	int   probe, index;
+	float x[3];
+} ProbeFilePoint;
+
+#endif
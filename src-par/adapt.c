@@ -0,0 +1,208 @@
+/*
+*  ADAPT
+*
+*  Rows that follow the mixing layer. Every a_every steps the indicator of the
+*  layer, the vorticity magnitude (a_ind = 0) or the Q criterion (a_ind = 1), is
+*  taken at its largest over x and z in every row. Above and below the face HIG/2,
+*  where the streams meet, the layer reaches to the farthest row in which the
+*  indicator exceeds a_thresh of its peak; AD_MARGIN times these distances are the
+*  half-widths of the band. When one of them has changed by more than AD_TOL, the
+*  rows are laid out anew (GridBandY): a_frac of the rows of each half share its
+*  band equally and the rest grow towards the wall, by no more than a_growth from
+*  row to row (the band is widened where they would have to). The solution, the
+*  outflow state and the sponge average are remapped conservatively, the probes
+*  and spectra lines located again; frames still staged are written first.
+*
+*  So the cells are spent on the layer instead of on the free streams: with the
+*  defaults and HIG = 200 a layer over a tenth of the height gets rows about three
+*  times finer than the uniform ones, at the same memory.
+*
+*  The running statistics are kept by row, so the rows stay where they are once
+*  they sample (s_start). Precursor planes are kept by row as well; recording or
+*  replaying them does not go with the adaptation. The band is written into the
+*  checkpoint (b_format = 2 only), and a continued run starts on the rows it left.
+*
+*/
+#include "mpi.h"
+#include <stdio.h>     /* printf() etc.*/
+#include <stdlib.h>    /* malloc()     */
+#include <math.h>      /* pow()        */
+
+#include "type.h"
+#include "def.h"      /* Definitions, parameters */
+#include "global.h"   /* global variables */
+#include "config.h"
+#include "grid.h"     /* GridBandY(), GridRemapY() */
+#include "output.h"   /* CellValues(), OutputFlush() */
+#include "outflow.h"  /* OutflowRegrid() */
+#include "probes.h"   /* ProbesRegrid() */
+#include "spectra.h"  /* SpectraRegrid() */
+
+#include "adapt.h"
+
+#define AD_MARGIN 1.5   /* band over the extent of the layer */
+#define AD_TOL    0.1   /* relative change of the band that lays the rows out anew */
+
+static int on = 0, frozen = 0, nFine;
+static double *loc = NULL, *glob = NULL;   /* indicator of the rows [HIG] */
+static double *from = NULL, *col = NULL, *out = NULL;   /* faces [HIG+1], columns [HIG] */
+
+
+void AdaptInit( int myid )
+{
+	on = ( config.a_every > 0 );
+	if( !on ) return;
+
+	if( HIG % 2 != 0 ) {
+		if( 0 == myid ) fprintf( stderr, "mpi_layer2: a_every needs an even HIG, the rows are laid out about HIG/2.\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	if( config.i_mode == 1 || config.i_record >= 0. ) {
+		if( 0 == myid ) fprintf( stderr, "mpi_layer2: the precursor planes are kept by row, a_every can't go with i_mode = 1 or i_record.\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+
+	nFine = (int)( config.a_frac * HIG / 2 + 0.5 );
+	if( nFine < 1 ) nFine = 1;
+
+	loc  = (double *)malloc( HIG * sizeof(double) );
+	glob = (double *)malloc( HIG * sizeof(double) );
+	from = (double *)malloc( ( HIG + 1 ) * sizeof(double) );
+	col  = (double *)malloc( HIG * sizeof(double) );
+	out  = (double *)malloc( HIG * sizeof(double) );
+	if( loc == NULL || glob == NULL || from == NULL || col == NULL || out == NULL ) {
+		fprintf( stderr, "mpi_layer2: can't allocate memory for the adaptation.\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+
+	if( 0 == myid )
+		fprintf( stdout, "Adapt: every %d steps %d of the %d rows of each half follow the %s of the layer.\n",
+		         config.a_every, nFine, HIG / 2, config.a_ind ? "Q criterion" : "vorticity" );
+
+} /* end AdaptInit() */
+
+
+/*
+* indicator - The indicator of the layer at its largest over x and z, in every row.
+*/
+static void indicator( int myid )
+{
+Frame now;
+real v[OUT_NVARS];
+unsigned i, j, k;
+
+	CurrentFrame( &now );
+	for( j = 1; j < HIGG; j++ ) {
+		loc[j-1] = -HUGE_VAL;
+		for( i = 1; i < LENN; i++ )
+			for( k = 1; k < DEPP; k++ ) {
+				CellValues( &now, i, j, k, myid, v );
+				if( v[9 + config.a_ind] > loc[j-1] ) loc[j-1] = v[9 + config.a_ind];
+			}
+	}
+	MPI_Allreduce( loc, glob, HIG, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD );
+
+} /* end indicator() */
+
+
+/*
+* widths - Half-widths of the band below and above the centre from the indicator;
+* returns 0 if the layer can't be told from the streams.
+*/
+static int widths( double w[2] )
+{
+int n = HIG / 2, J, m = n - nFine;
+double peak = 0., yc = GridFace( 1, n ), L = 0.5 * HIG * (double)deltaY, G, r = config.a_growth;
+
+	for( J = 0; J < (int)HIG; J++ ) if( glob[J] > peak ) peak = glob[J];
+	if( peak <= 0. ) return 0;
+
+	//--- farthest rows of the layer, at least the one next to the centre
+	for( J = HIG - 1; J > n && glob[J] <= config.a_thresh * peak; J-- );
+	w[1] = GridFace( 1, J + 1 ) - yc;
+	for( J = 0; J < n - 1 && glob[J] <= config.a_thresh * peak; J++ );
+	w[0] = yc - GridFace( 1, J );
+
+	//--- no wider than the uniform rows, no narrower than the growth allows
+	G = r > 1. ? r * ( pow( r, m ) - 1. ) / ( r - 1. ) : m;
+	for( J = 0; J < 2; J++ ) {
+		w[J] *= AD_MARGIN;
+		if( w[J] < L / ( 1. + G / nFine ) ) w[J] = L / ( 1. + G / nFine );
+		if( w[J] > L * nFine / n ) w[J] = L * nFine / n;
+	}
+	return 1;
+
+} /* end widths() */
+
+
+/*
+* remap - Carries the conservative variables over from the rows between the faces from.
+*/
+static void remap( void )
+{
+real ***U[5];
+unsigned i, j, k;
+int n;
+
+	U[0] = U1; U[1] = U2; U[2] = U3; U[3] = U4; U[4] = U5;
+	for( n = 0; n < 5; n++ )
+		for( i = 1; i < LENN; i++ )
+			for( k = 1; k < DEPP; k++ ) {
+				for( j = 1; j < HIGG; j++ ) col[j-1] = U[n][i][j][k];
+				GridRemapY( from, col, out );
+				for( j = 1; j < HIGG; j++ ) U[n][i][j][k] = out[j-1];
+			}
+
+} /* end remap() */
+
+
+/**********
+*  ADAPT  *   Rows laid out anew about the layer, every a_every steps
+**********/
+void Adapt( int myid )
+{
+double w[2], cur[2], lo, hi;
+int J;
+
+	if( !on || frozen || step % config.a_every != 0 ) return;
+
+	if( config.s_every > 0 && (int)step >= config.s_start ) {
+		frozen = 1;
+		if( 0 == myid ) fprintf( stdout, "Adapt: the rows stay as they are while the statistics sample.\n" );
+		return;
+	}
+
+	indicator( myid );
+	if( !widths( w ) ) return;
+	if( GridBand( cur ) == nFine && fabs( w[0] - cur[0] ) <= AD_TOL * cur[0] && fabs( w[1] - cur[1] ) <= AD_TOL * cur[1] )
+		return;
+
+	//--- frames staged on the old rows are written on them
+	OutputFlush( );
+
+	for( J = 0; J <= (int)HIG; J++ ) from[J] = GridFace( 1, J );
+	GridBandY( w, nFine );
+	remap( );
+	OutflowRegrid( from );
+	ProbesRegrid( myid );
+	SpectraRegrid( );
+
+	if( 0 == myid ) {
+		lo = GridFace( 1, HIG / 2 + 1 ) - GridFace( 1, HIG / 2 );
+		if( GridFace( 1, HIG / 2 ) - GridFace( 1, HIG / 2 - 1 ) < lo ) lo = GridFace( 1, HIG / 2 ) - GridFace( 1, HIG / 2 - 1 );
+		hi = GridFace( 1, 1 ) - GridFace( 1, 0 );
+		if( GridFace( 1, HIG ) - GridFace( 1, HIG - 1 ) > hi ) hi = GridFace( 1, HIG ) - GridFace( 1, HIG - 1 );
+		fprintf( stdout, "Adapt: step %d, band %g m below and %g m above the centre, rows %g..%g m.\n",
+		         step, w[0], w[1], lo, hi );
+	}
+
+} /* end Adapt() */
+
+
+void AdaptFinalize( int myid )
+{
+	free( loc ); free( glob ); free( from ); free( col ); free( out );
+	loc = glob = from = col = out = NULL;
+	(void)myid;
+
+} /* end AdaptFinalize() */
@@ -0,0 +1,18 @@
+#ifndef ADAPT_H
+#define ADAPT_H
+
+/*
+* AdaptInit - Checks that the rows may follow the layer (a_every > 0): HIG even, no
+* precursor planes recorded or replayed.
+*/
+void AdaptInit( int myid );
+
+/*
+* Adapt - Called every step after the stages: every a_every steps lays the rows out anew
+* about the layer when its extent has changed, and remaps the solution onto them.
+*/
+void Adapt( int myid );
+
+void AdaptFinalize( int myid );
+
+#endif
@@ -0,0 +1,1011 @@
+/*
+*  AMR
+*
+*  Blocks of cells twice as fine about the mixing layer. The base grid is tiled
+*  by a lattice of blocks of r_block^3 cells. Every r_every steps the blocks in
+*  which the vorticity magnitude (r_ind = 0) or the Q criterion (r_ind = 1)
+*  reaches r_thresh of its peak are refined together with their neighbours, at
+*  most r_max of them per process (the strongest first); blocks next to the
+*  inflow, the outflow, the walls or in the sponge zone stay on the base grid.
+*  A refined block holds NB^3 cells, NB = 2 r_block, and two layers of ghosts.
+*  The blocks are dealt out in the order of x equally over the processes,
+*  whichever slab they lie in, so the work stays balanced as the layer grows.
+*
+*  The blocks advance with the time step of the base grid (the Courant number
+*  takes their cells in) through the same stages, by the kernels of the solver:
+*  Reconstruction(), Fluxes() and Evolution() run on a block once its arrays and
+*  spacing are swapped in for those of the slab (Kernel). Every stage, after the
+*  fluxes of the slab (AmrStage):
+*    - the ghosts of a block are interpolated from the base cells about it, limited
+*      linear and conservative, those inside a neighbouring block are copied from
+*      it. The first layer of ghosts is advanced along with the block, so both
+*      sides of its faces are reconstructed; the second one is held;
+*    - the blocks advance through the stage;
+*    - the fluxes through the faces of the base cells a block covers, its own faces
+*      included, are replaced by the averages of the fluxes of the block over them
+*      before the slab advances. So a base cell next to a block takes exactly what
+*      the block gives off (the coarse/fine flux correction) and the covered cells
+*      advance to the averages of the block;
+*  after the last stage (Amr) the covered cells take the averages of the block.
+*
+*  The frames, statistics, probes and checkpoints see the base grid, with the
+*  averages of the blocks where it is refined; every frame also writes the blocks
+*  themselves into "<step>.blocks" described by "<step>-blocks.xmf". The blocks are
+*  not kept in the checkpoint, a continued run refines them anew from the base grid.
+*
+*/
+#include "mpi.h"
+#include <stdio.h>     /* printf() etc.*/
+#include <stdlib.h>    /* malloc(), qsort() */
+#include <math.h>      /* pow()        */
+
+#include "type.h"
+#include "def.h"      /* Definitions, parameters */
+#include "global.h"   /* global variables */
+#include "config.h"
+#include "helpers.h"  /* Array2D(), Array3D() */
+#include "grid.h"     /* GridFace(), GridCentre() */
+#include "output.h"   /* CellValues() */
+#include "reconstruction.h"
+#include "fluxes.h"
+#include "evolution.h"
+#include "bounCondInGhostCells.h"
+
+#include "amr.h"
+
+enum { COUNT, PACK, UNPACK };
+
+/*
+* Kernel - What the kernels of the solver read of the grid they advance, the slab or a
+* block: arrays, spacing and sizes, swapped into the globals by use().
+*/
+typedef struct {
+	real ***U[5], ***Up[5], ***U_[5];
+	real ***xU[5], ***Ux[5], ***yU[5], ***Uy[5], ***zU[5], ***Uz[5];
+	real *sx[7], *sy[7];      /* dX, _dX, _2dX, _4dX, dtX, fX, bX and the same in y */
+	real **DD;
+	unsigned len, hig, dep;
+	real dz, _dz, _2dz, _4dz, dtz;
+} Kernel;
+
+/*
+* Block - A refined block, its cells 2..NB+1 in the arrays [NB+4]^3.
+*/
+typedef struct Block {
+	int C[3];                 /* its first base cell in x, y, z */
+	real ***U[5], ***Up[5];   /* conservative variables */
+	real *sx[7], *sy[7];      /* spacing like the slab's */
+	real **DD;
+	real *pf[3], *pb[3];      /* forward and backward slopes of the base cells about it to a quarter of their widths */
+	real *patch;              /* the base cells about it [5][nb+4]^3 */
+	real *flux;               /* averaged fluxes through the faces of the base cells [3][5][nb+1][nb][nb] */
+	struct Block *next;       /* in the pool */
+} Block;
+
+/*
+* Layout - The refined blocks, in the order of their lattice index.
+*/
+typedef struct {
+	int n;
+	int *tile;      /* lattice index */
+	int *owner;     /* process */
+	int *first;     /* first block of each process [numprocs+1] */
+	int *where;     /* lattice index -> number of the block, -1 */
+	Block **mine;   /* number -> block of _this_ process, NULL */
+} Layout;
+
+#define PATCH(v,p,q,r) ( ( ( (v) * PS + (p) ) * PS + (q) ) * PS + (r) )
+#define FLUX(a,v,m,p,q) ( ( ( ( (a) * 5 + (v) ) * ( nb + 1 ) + (m) ) * nb + (p) ) * nb + (q) )
+
+static int on = 0, me, np;
+static int nb, NB, G, PS;         /* base cells along a block, its cells, its arrays, its patch */
+static int NF[3], NL;             /* blocks of the lattice along x, y, z, all of them */
+static Layout lay[2], *at = &lay[0], *prev = &lay[1];
+static Block *pool = NULL;
+static real ***xS[5], ***Sx[5], ***yS[5], ***Sy[5], ***zS[5], ***Sz[5];   /* faces of a block while it advances */
+static real ***baseV[5];          /* base cells sent or received by the walks */
+static double *loc = NULL, *ind = NULL;   /* indicator of the lattice [NL] */
+static int *mark = NULL, *rank = NULL;
+static real *sbuf = NULL, *rbuf = NULL;
+static int sSize = 0, rSize = 0, *scnt, *sdsp, *rcnt, *rdsp;
+
+
+/*
+* keep, use - The kernel of the globals, and the globals of a kernel.
+*/
+static void keep( Kernel *g )
+{
+	g->U[0]  = U1;  g->U[1]  = U2;  g->U[2]  = U3;  g->U[3]  = U4;  g->U[4]  = U5;
+	g->Up[0] = U1p; g->Up[1] = U2p; g->Up[2] = U3p; g->Up[3] = U4p; g->Up[4] = U5p;
+	g->U_[0] = U1_; g->U_[1] = U2_; g->U_[2] = U3_; g->U_[3] = U4_; g->U_[4] = U5_;
+	g->xU[0] = xU1; g->xU[1] = xU2; g->xU[2] = xU3; g->xU[3] = xU4; g->xU[4] = xU5;
+	g->Ux[0] = U1x; g->Ux[1] = U2x; g->Ux[2] = U3x; g->Ux[3] = U4x; g->Ux[4] = U5x;
+	g->yU[0] = yU1; g->yU[1] = yU2; g->yU[2] = yU3; g->yU[3] = yU4; g->yU[4] = yU5;
+	g->Uy[0] = U1y; g->Uy[1] = U2y; g->Uy[2] = U3y; g->Uy[3] = U4y; g->Uy[4] = U5y;
+	g->zU[0] = zU1; g->zU[1] = zU2; g->zU[2] = zU3; g->zU[3] = zU4; g->zU[4] = zU5;
+	g->Uz[0] = U1z; g->Uz[1] = U2z; g->Uz[2] = U3z; g->Uz[3] = U4z; g->Uz[4] = U5z;
+	g->sx[0] = dX; g->sx[1] = _dX; g->sx[2] = _2dX; g->sx[3] = _4dX; g->sx[4] = dtX; g->sx[5] = fX; g->sx[6] = bX;
+	g->sy[0] = dY; g->sy[1] = _dY; g->sy[2] = _2dY; g->sy[3] = _4dY; g->sy[4] = dtY; g->sy[5] = fY; g->sy[6] = bY;
+	g->DD = DDxy;
+	g->len = LEN; g->hig = HIG; g->dep = DEP;
+	g->dz = deltaZ; g->_dz = _deltaZ; g->_2dz = _2deltaZ; g->_4dz = _4deltaZ; g->dtz = deltaT_Z;
+
+} /* end keep() */
+
+static void use( const Kernel *g )
+{
+	U1  = g->U[0];  U2  = g->U[1];  U3  = g->U[2];  U4  = g->U[3];  U5  = g->U[4];
+	U1p = g->Up[0]; U2p = g->Up[1]; U3p = g->Up[2]; U4p = g->Up[3]; U5p = g->Up[4];
+	U1_ = g->U_[0]; U2_ = g->U_[1]; U3_ = g->U_[2]; U4_ = g->U_[3]; U5_ = g->U_[4];
+	xU1 = g->xU[0]; xU2 = g->xU[1]; xU3 = g->xU[2]; xU4 = g->xU[3]; xU5 = g->xU[4];
+	U1x = g->Ux[0]; U2x = g->Ux[1]; U3x = g->Ux[2]; U4x = g->Ux[3]; U5x = g->Ux[4];
+	yU1 = g->yU[0]; yU2 = g->yU[1]; yU3 = g->yU[2]; yU4 = g->yU[3]; yU5 = g->yU[4];
+	U1y = g->Uy[0]; U2y = g->Uy[1]; U3y = g->Uy[2]; U4y = g->Uy[3]; U5y = g->Uy[4];
+	zU1 = g->zU[0]; zU2 = g->zU[1]; zU3 = g->zU[2]; zU4 = g->zU[3]; zU5 = g->zU[4];
+	U1z = g->Uz[0]; U2z = g->Uz[1]; U3z = g->Uz[2]; U4z = g->Uz[3]; U5z = g->Uz[4];
+	dX = g->sx[0]; _dX = g->sx[1]; _2dX = g->sx[2]; _4dX = g->sx[3]; dtX = g->sx[4]; fX = g->sx[5]; bX = g->sx[6];
+	dY = g->sy[0]; _dY = g->sy[1]; _2dY = g->sy[2]; _4dY = g->sy[3]; dtY = g->sy[4]; fY = g->sy[5]; bY = g->sy[6];
+	DDxy = g->DD;
+	LEN = g->len; HIG = g->hig; DEP = g->dep;
+	LENN = LEN + 1; HIGG = HIG + 1; DEPP = DEP + 1;
+	deltaZ = g->dz; _deltaZ = g->_dz; _2deltaZ = g->_2dz; _4deltaZ = g->_4dz; deltaT_Z = g->dtz;
+
+} /* end use() */
+
+
+/*
+* blockKernel - The kernel of block b, on its U (cur = 0) or Up (cur = 1), inside the base kernel.
+*/
+static void blockKernel( Block *b, int cur, const Kernel *base, Kernel *g )
+{
+int v, i;
+
+	for( v = 0; v < 5; v++ ) {
+		g->U[v] = b->U[v]; g->Up[v] = b->Up[v]; g->U_[v] = cur ? b->Up[v] : b->U[v];
+		g->xU[v] = xS[v]; g->Ux[v] = Sx[v];
+		g->yU[v] = yS[v]; g->Uy[v] = Sy[v];
+		g->zU[v] = zS[v]; g->Uz[v] = Sz[v];
+	}
+	for( i = 0; i < G; i++ ) {
+		b->sx[4][i] = deltaT / b->sx[0][i];
+		b->sy[4][i] = deltaT / b->sy[0][i];
+	}
+	for( v = 0; v < 7; v++ ) { g->sx[v] = b->sx[v]; g->sy[v] = b->sy[v]; }
+	g->DD = b->DD;
+	g->len = g->hig = g->dep = NB + 2;
+	g->dz = 0.5 * base->dz;
+	g->_dz = 1. / g->dz;
+	g->_4dz = 1. / ( 4 * g->dz );
+	g->_2dz = g->_4dz + g->_4dz;
+	g->dtz = deltaT / g->dz;
+
+} /* end blockKernel() */
+
+
+/*
+* corner - The first base cell of the lattice block t.
+*/
+static void corner( int t, int C[3] )
+{
+	C[0] = t / ( NF[1] * NF[2] ) * nb;
+	C[1] = t / NF[2] % NF[1] * nb;
+	C[2] = t % NF[2] * nb;
+}
+
+/*
+* neighbour - Number of the refined block next to the lattice block t by e (z periodic), -1 if none.
+*/
+static int neighbour( const Layout *l, int t, const int e[3] )
+{
+int f[3];
+
+	f[0] = t / ( NF[1] * NF[2] ) + e[0];
+	f[1] = t / NF[2] % NF[1] + e[1];
+	f[2] = ( t % NF[2] + e[2] + NF[2] ) % NF[2];
+	return l->where[( f[0] * NF[1] + f[1] ) * NF[2] + f[2]];
+}
+
+/*
+* eligible - 1 if the lattice block t may be refined: away from the inflow, the outflow
+* and the walls by a block, and with the base cells about it out of the sponge zone.
+*/
+static int eligible( int t )
+{
+int f[2];
+
+	f[0] = t / ( NF[1] * NF[2] );
+	f[1] = t / NF[2] % NF[1];
+	if( f[0] < 1 || f[0] > NF[0] - 2 || f[1] < 1 || f[1] > NF[1] - 2 ) return 0;
+	if( config.o_sponge > 0. &&
+	    GridFace( 0, ( f[0] + 1 ) * nb + 1 ) > GridFace( 0, GridCells( 0 ) ) - config.o_sponge ) return 0;
+	return 1;
+}
+
+
+/*
+* fineWidth - Width of the fine cell F along the axis 0-x, 1-y (half of the base cell's).
+*/
+static double fineWidth( int a, int F )
+{
+	return 0.5 * ( GridFace( a, F / 2 + 1 ) - GridFace( a, F / 2 ) );
+}
+
+/*
+* place - Spacing of block b at the lattice block t, like that of the slab (grid.c).
+*/
+static void place( Block *b, int t )
+{
+int a, i, j, F, Q;
+double u, w, c;
+real **s;
+
+	corner( t, b->C );
+	for( a = 0; a < 2; a++ ) {
+		s = a == 0 ? b->sx : b->sy;
+		for( i = 0; i < G; i++ ) {
+			F = 2 * b->C[a] + i - 2;
+			u = fineWidth( a, F - 1 ); w = fineWidth( a, F ); c = fineWidth( a, F + 1 );
+			s[0][i] = w;
+			s[1][i] = 1. / ( 0.5 * w + 0.5 * c );
+			s[2][i] = 1. / ( 0.5 * u + w + 0.5 * c );
+			s[3][i] = 0.5 * s[2][i];
+			s[5][i] = 2. * w / ( w + c );
+			s[6][i] = 2. * w / ( u + w );
+		}
+		//--- base cells about it: a quarter of the width over the distances of the centres
+		for( i = 1; i < PS - 1; i++ ) {
+			Q = b->C[a] + i - 2;
+			w = 0.25 * ( GridFace( a, Q + 1 ) - GridFace( a, Q ) );
+			b->pf[a][i] = w / ( GridCentre( a, Q + 1 ) - GridCentre( a, Q ) );
+			b->pb[a][i] = w / ( GridCentre( a, Q ) - GridCentre( a, Q - 1 ) );
+		}
+	}
+	for( i = 1; i < PS - 1; i++ ) b->pf[2][i] = b->pb[2][i] = 0.25;
+
+	for( i = 0; i < G; i++ )
+		for( j = 0; j < G; j++ )
+			b->DD[i][j] = pow( b->sx[0][i] * b->sy[0][j] * 0.5 * deltaZ, twoThirds );
+
+} /* end place() */
+
+
+/*
+* alloc - n reals for the blocks.
+*/
+static real *alloc( unsigned n )
+{
+real *a;
+
+	if( ( a = (real *)malloc( n * sizeof(real) ) ) == NULL ) {
+		fprintf( stderr, "mpi_layer2: can't allocate memory for the refined blocks.\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	return a;
+}
+
+/*
+* newBlock - A block at the lattice block t, from the pool (they are all of a size).
+*/
+static Block *newBlock( int t )
+{
+Block *b;
+int v, a;
+
+	if( ( b = pool ) != NULL ) pool = b->next;
+	else {
+		if( ( b = (Block *)malloc( sizeof(Block) ) ) == NULL ) {
+			fprintf( stderr, "mpi_layer2: can't allocate memory for the refined blocks.\n" );
+			MPI_Abort( MPI_COMM_WORLD, 1 );
+		}
+		for( v = 0; v < 5; v++ ) {
+			b->U[v]  = Array3D( G, G, G );
+			b->Up[v] = Array3D( G, G, G );
+		}
+		for( v = 0; v < 7; v++ ) { b->sx[v] = alloc( G ); b->sy[v] = alloc( G ); }
+		b->DD = Array2D( G, G );
+		for( a = 0; a < 3; a++ ) { b->pf[a] = alloc( PS ); b->pb[a] = alloc( PS ); }
+		b->patch = alloc( 5 * PS * PS * PS );
+		b->flux  = alloc( 15 * ( nb + 1 ) * nb * nb );
+	}
+	place( b, t );
+	return b;
+
+} /* end newBlock() */
+
+static void freeBlock( Block *b )
+{
+	b->next = pool;
+	pool = b;
+}
+
+
+/*
+* lim - minmod of two slopes.
+*/
+static real lim( real a, real b )
+{
+	if( a * b <= 0. ) return 0.;
+	if( a > 0. ) return a < b ? a : b;
+	return a > b ? a : b;
+}
+
+/*
+* prolong - Cells of block b in V from its patch of base cells, limited linear: the ghosts,
+* or all of them (all = 1). The two halves of a base cell take it plus and minus its slope.
+*/
+static void prolong( Block *b, real ***V[5], int all )
+{
+int i, j, k, p, q, r, v, in;
+real Q, si, sj, sk, *u = b->patch;
+
+	for( i = 0; i < G; i++ )
+		for( j = 0; j < G; j++ )
+			for( k = 0; k < G; k++ ) {
+				in = i >= 2 && i < NB + 2 && j >= 2 && j < NB + 2 && k >= 2 && k < NB + 2;
+				if( in && !all ) continue;
+				p = i / 2 + 1; q = j / 2 + 1; r = k / 2 + 1;
+				si = i & 1 ? 1. : -1.; sj = j & 1 ? 1. : -1.; sk = k & 1 ? 1. : -1.;
+				for( v = 0; v < 5; v++ ) {
+					Q = u[PATCH( v, p, q, r )];
+					V[v][i][j][k] = Q
+						+ si * lim( b->pf[0][p] * ( u[PATCH( v, p + 1, q, r )] - Q ), b->pb[0][p] * ( Q - u[PATCH( v, p - 1, q, r )] ) )
+						+ sj * lim( b->pf[1][q] * ( u[PATCH( v, p, q + 1, r )] - Q ), b->pb[1][q] * ( Q - u[PATCH( v, p, q - 1, r )] ) )
+						+ sk * lim( b->pf[2][r] * ( u[PATCH( v, p, q, r + 1 )] - Q ), b->pb[2][r] * ( Q - u[PATCH( v, p, q, r - 1 )] ) );
+				}
+			}
+
+} /* end prolong() */
+
+
+/*
+* cells - The cells lo..hi-1 of V, packed into buf or unpacked from it; returns the number of values.
+*/
+static int cells( int mode, real *buf, real ***V[5], const int lo[3], const int hi[3] )
+{
+int i, j, k, v, c = 0;
+
+	if( mode == COUNT ) return 5 * ( hi[0] - lo[0] ) * ( hi[1] - lo[1] ) * ( hi[2] - lo[2] );
+	for( i = lo[0]; i < hi[0]; i++ )
+		for( j = lo[1]; j < hi[1]; j++ )
+			for( k = lo[2]; k < hi[2]; k++ )
+				for( v = 0; v < 5; v++, c++ )
+					if( mode == PACK ) buf[c] = V[v][i][j][k];
+					else V[v][i][j][k] = buf[c];
+	return c;
+
+} /* end cells() */
+
+/*
+* baseCells - The base cells of process s (baseV) about the lattice block t, packed or
+* unpacked into the patch of a block.
+*/
+static int baseCells( int s, int t, int mode, real *buf, real *patch )
+{
+int C[3], I, I0, I1, q, r, J, Z, v, c = 0, lo = s * (int)LEN;
+
+	corner( t, C );
+	I0 = C[0] - 2 > lo ? C[0] - 2 : lo;
+	I1 = C[0] + nb + 2 < lo + (int)LEN ? C[0] + nb + 2 : lo + (int)LEN;
+	if( I0 >= I1 ) return 0;
+	if( mode == COUNT ) return 5 * ( I1 - I0 ) * PS * PS;
+	for( I = I0; I < I1; I++ )
+		for( q = 0; q < PS; q++ )
+			for( r = 0; r < PS; r++ ) {
+				J = C[1] - 2 + q;
+				Z = ( C[2] - 2 + r + (int)DEP ) % (int)DEP;
+				for( v = 0; v < 5; v++, c++ )
+					if( mode == PACK ) buf[c] = baseV[v][I - lo + 1][J + 1][Z + 1];
+					else patch[PATCH( v, I - C[0] + 2, q, r )] = buf[c];
+			}
+	return c;
+
+} /* end baseCells() */
+
+
+/*
+* walkGhosts - What s sends d to fill the ghosts of the blocks of d: part 0 the base cells
+* about them, part 1 the cells of their neighbours; of the blocks' U (cur = 0) or Up (cur = 1).
+*/
+static int walkGhosts( int s, int d, int part, int mode, real *buf, int cur )
+{
+int n, m, o, a, e[3], lo[3], hi[3], c = 0;
+Block *b;
+
+	for( n = at->first[d]; n < at->first[d+1]; n++ ) {
+		if( part == 0 ) {
+			c += baseCells( s, at->tile[n], mode, mode == COUNT ? NULL : buf + c, mode == UNPACK ? at->mine[n]->patch : NULL );
+			continue;
+		}
+		for( o = 0; o < 27; o++ ) {
+			if( o == 13 ) continue;
+			e[0] = o / 9 - 1; e[1] = o / 3 % 3 - 1; e[2] = o % 3 - 1;
+			if( ( m = neighbour( at, at->tile[n], e ) ) < 0 || at->owner[m] != s ) continue;
+			//--- the ghosts of n inside m, in the cells of m when packed
+			for( a = 0; a < 3; a++ ) {
+				lo[a] = e[a] < 0 ? 0 : e[a] > 0 ? NB + 2 : 2;
+				hi[a] = e[a] < 0 ? 2 : e[a] > 0 ? NB + 4 : NB + 2;
+				if( mode == PACK ) { lo[a] -= e[a] * NB; hi[a] -= e[a] * NB; }
+			}
+			b = mode == PACK ? at->mine[m] : mode == UNPACK ? at->mine[n] : NULL;
+			c += cells( mode, mode == COUNT ? NULL : buf + c, b == NULL ? NULL : cur ? b->Up : b->U, lo, hi );
+		}
+	}
+	return c;
+
+} /* end walkGhosts() */
+
+/*
+* walkFluxes - What s sends d of its blocks over the slab of d: part 0 the averaged fluxes
+* through the faces of the covered base cells, put into the fluxes of the slab; part 1 the
+* averages of the cells, put into U1..U5.
+*/
+static int walkFluxes( int s, int d, int part, int mode, real *buf, int arg )
+{
+real ***FX[5] = { xU1, xU2, xU3, xU4, xU5 }, ***FY[5] = { yU1, yU2, yU3, yU4, yU5 },
+     ***FZ[5] = { zU1, zU2, zU3, zU4, zU5 }, ***UU[5] = { U1, U2, U3, U4, U5 };
+int n, C[3], I, I0, I1, J, Z, v, i, j, k, c = 0, lo = d * (int)LEN;
+real *f, ***V;
+Block *b;
+
+	for( n = at->first[s]; n < at->first[s+1]; n++ ) {
+		corner( at->tile[n], C );
+		I0 = C[0] > lo ? C[0] : lo;
+		I1 = C[0] + nb < lo + (int)LEN ? C[0] + nb : lo + (int)LEN;   /* the cells I0..I1-1, the x-faces I0..I1 */
+		if( I0 > I1 || ( I0 == I1 && part == 1 ) ) continue;
+		if( mode == COUNT ) {
+			c += part == 0 ? 5 * nb * ( ( I1 - I0 + 1 ) * nb + 2 * ( I1 - I0 ) * ( nb + 1 ) )
+			               : 5 * ( I1 - I0 ) * nb * nb;
+			continue;
+		}
+		b = at->mine[n];
+		f = mode == PACK ? b->flux : NULL;
+		if( part == 1 ) {
+			for( I = I0; I < I1; I++ )
+				for( J = C[1]; J < C[1] + nb; J++ )
+					for( Z = C[2]; Z < C[2] + nb; Z++ )
+						for( v = 0; v < 5; v++, c++ )
+							if( mode == PACK ) {
+								V = b->U[v]; i = 2 * ( I - C[0] ) + 2; j = 2 * ( J - C[1] ) + 2; k = 2 * ( Z - C[2] ) + 2;
+								buf[c] = 0.125 * ( V[i][j][k]   + V[i+1][j][k]   + V[i][j+1][k]   + V[i+1][j+1][k]
+								                 + V[i][j][k+1] + V[i+1][j][k+1] + V[i][j+1][k+1] + V[i+1][j+1][k+1] );
+							}
+							else UU[v][I - lo + 1][J + 1][Z + 1] = buf[c];
+			continue;
+		}
+		//--- x-faces
+		for( I = I0; I <= I1; I++ )
+			for( J = C[1]; J < C[1] + nb; J++ )
+				for( Z = C[2]; Z < C[2] + nb; Z++ )
+					for( v = 0; v < 5; v++, c++ )
+						if( mode == PACK ) buf[c] = f[FLUX( 0, v, I - C[0], J - C[1], Z - C[2] )];
+						else FX[v][I - lo][J][Z] = buf[c];
+		//--- y-faces
+		for( I = I0; I < I1; I++ )
+			for( J = C[1]; J <= C[1] + nb; J++ )
+				for( Z = C[2]; Z < C[2] + nb; Z++ )
+					for( v = 0; v < 5; v++, c++ )
+						if( mode == PACK ) buf[c] = f[FLUX( 1, v, J - C[1], I - C[0], Z - C[2] )];
+						else FY[v][I - lo][J][Z] = buf[c];
+		//--- z-faces, the first and the last one are the same
+		for( I = I0; I < I1; I++ )
+			for( J = C[1]; J < C[1] + nb; J++ )
+				for( Z = C[2]; Z <= C[2] + nb; Z++ )
+					for( v = 0; v < 5; v++, c++ )
+						if( mode == PACK ) buf[c] = f[FLUX( 2, v, Z - C[2], I - C[0], J - C[1] )];
+						else {
+							FZ[v][I - lo][J][Z] = buf[c];
+							if( Z == 0 )          FZ[v][I - lo][J][DEP] = buf[c];
+							if( Z == (int)DEP )   FZ[v][I - lo][J][0] = buf[c];
+						}
+	}
+	(void)arg;
+	return c;
+
+} /* end walkFluxes() */
+
+/*
+* walkMove - What s sends d for the blocks of d once they are laid out anew: part 0 the base
+* cells about those just refined, part 1 the cells of those refined before on another process.
+*/
+static int walkMove( int s, int d, int part, int mode, real *buf, int arg )
+{
+int n, o, lo[3], hi[3], c = 0;
+
+	lo[0] = lo[1] = lo[2] = 2;
+	hi[0] = hi[1] = hi[2] = NB + 2;
+	for( n = at->first[d]; n < at->first[d+1]; n++ ) {
+		o = prev->where[at->tile[n]];
+		if( part == 0 && o < 0 )
+			c += baseCells( s, at->tile[n], mode, mode == COUNT ? NULL : buf + c, mode == UNPACK ? at->mine[n]->patch : NULL );
+		else if( part == 1 && o >= 0 && prev->owner[o] == s && s != d )
+			c += cells( mode, mode == COUNT ? NULL : buf + c,
+			            mode == PACK ? prev->mine[o]->U : mode == UNPACK ? at->mine[n]->U : NULL, lo, hi );
+	}
+	(void)arg;
+	return c;
+
+} /* end walkMove() */
+
+
+typedef int (*Walk)( int s, int d, int part, int mode, real *buf, int arg );
+
+/*
+* exchange - Parts p0..p1 of a walk, from every process to every other in one MPI_Alltoallv;
+* after() runs once a part is unpacked from all of them, before the next one.
+*/
+static void exchange( Walk walk, int p0, int p1, int arg, void (*after)( int arg ) )
+{
+static int *roff = NULL;
+int p, part, ns = 0, nr = 0, c;
+
+	if( roff == NULL ) roff = (int *)malloc( np * sizeof(int) );
+	for( p = 0; p < np; p++ ) {
+		scnt[p] = rcnt[p] = 0;
+		for( part = p0; part <= p1; part++ ) {
+			scnt[p] += walk( me, p, part, COUNT, NULL, arg );
+			rcnt[p] += walk( p, me, part, COUNT, NULL, arg );
+		}
+		sdsp[p] = ns; ns += scnt[p];
+		rdsp[p] = nr; nr += rcnt[p];
+	}
+	if( ns > sSize ) { free( sbuf ); sbuf = alloc( sSize = ns ); }
+	if( nr > rSize ) { free( rbuf ); rbuf = alloc( rSize = nr ); }
+
+	for( p = 0; p < np; p++ )
+		for( part = p0, c = sdsp[p]; part <= p1; part++ )
+			if( scnt[p] > 0 ) c += walk( me, p, part, PACK, sbuf + c, arg );
+
+	MPI_Alltoallv( sbuf, scnt, sdsp, MPI_FLOAT, rbuf, rcnt, rdsp, MPI_FLOAT, MPI_COMM_WORLD );
+
+	for( p = 0; p < np; p++ ) roff[p] = rdsp[p];
+	for( part = p0; part <= p1; part++ ) {
+		for( p = 0; p < np; p++ )
+			if( rcnt[p] > 0 ) roff[p] += walk( p, me, part, UNPACK, rbuf + roff[p], arg );
+		if( after != NULL && part < p1 ) after( arg );
+	}
+
+} /* end exchange() */
+
+/*
+* shell - The ghosts of the blocks of _this_ process from the base cells, before those of
+* their neighbours are copied in.
+*/
+static void shell( int cur )
+{
+int n;
+
+	for( n = at->first[me]; n < at->first[me+1]; n++ )
+		prolong( at->mine[n], cur ? at->mine[n]->Up : at->mine[n]->U, 0 );
+}
+
+/*
+* fresh - The blocks of _this_ process just refined, all of their cells from the base cells.
+*/
+static void fresh( int arg )
+{
+int n;
+
+	for( n = at->first[me]; n < at->first[me+1]; n++ )
+		if( prev->where[at->tile[n]] < 0 ) prolong( at->mine[n], at->mine[n]->U, 1 );
+	(void)arg;
+}
+
+
+/*
+* outerFaces - States on the outer faces of the first layer of ghosts, which the reconstruction
+* leaves: those of the second layer. Only the first layer advances by them, to be thrown away.
+*/
+static void outerFaces( void )
+{
+real ***V[5]  = { U1_, U2_, U3_, U4_, U5_ },
+     ***XL[5] = { xU1, xU2, xU3, xU4, xU5 }, ***XR[5] = { U1x, U2x, U3x, U4x, U5x },
+     ***YL[5] = { yU1, yU2, yU3, yU4, yU5 }, ***YR[5] = { U1y, U2y, U3y, U4y, U5y },
+     ***ZL[5] = { zU1, zU2, zU3, zU4, zU5 }, ***ZR[5] = { U1z, U2z, U3z, U4z, U5z };
+unsigned v, a, c;
+
+	for( v = 0; v < 5; v++ )
+		for( a = 0; a < LEN; a++ )
+			for( c = 0; c < LEN; c++ ) {
+				XL[v][0][a][c] = V[v][0][a+1][c+1]; XR[v][LEN][a][c] = V[v][LENN][a+1][c+1];
+				YL[v][a][0][c] = V[v][a+1][0][c+1]; YR[v][a][HIG][c] = V[v][a+1][HIGG][c+1];
+				ZL[v][a][c][0] = V[v][a+1][c+1][0]; ZR[v][a][c][DEP] = V[v][a+1][c+1][DEPP];
+			}
+
+} /* end outerFaces() */
+
+/*
+* average - Fluxes of block b averaged over the faces of the base cells it covers.
+*/
+static void average( Block *b )
+{
+real ***FX[5] = { xU1, xU2, xU3, xU4, xU5 }, ***FY[5] = { yU1, yU2, yU3, yU4, yU5 },
+     ***FZ[5] = { zU1, zU2, zU3, zU4, zU5 };
+int v, m, p, q, i, j, k;
+
+	for( v = 0; v < 5; v++ )
+		for( m = 0; m <= nb; m++ )
+			for( p = 0; p < nb; p++ )
+				for( q = 0; q < nb; q++ ) {
+					i = 1 + 2 * m; j = 1 + 2 * p; k = 1 + 2 * q;
+					b->flux[FLUX( 0, v, m, p, q )] = 0.25 * ( FX[v][i][j][k] + FX[v][i][j+1][k] + FX[v][i][j][k+1] + FX[v][i][j+1][k+1] );
+					b->flux[FLUX( 1, v, m, p, q )] = 0.25 * ( FY[v][j][i][k] + FY[v][j+1][i][k] + FY[v][j][i][k+1] + FY[v][j+1][i][k+1] );
+					b->flux[FLUX( 2, v, m, p, q )] = 0.25 * ( FZ[v][j][k][i] + FZ[v][j+1][k][i] + FZ[v][j][k+1][i] + FZ[v][j+1][k+1][i] );
+				}
+
+} /* end average() */
+
+
+/*
+* byIndicator - Lattice blocks by the indicator, the strongest first.
+*/
+static int byIndicator( const void *a, const void *b )
+{
+int s = *(const int *)a, t = *(const int *)b;
+
+	if( ind[s] != ind[t] ) return ind[s] < ind[t] ? 1 : -1;
+	return s - t;
+}
+
+/*
+* regrid - Refines the blocks of the lattice about the layer and deals them out.
+*/
+static void regrid( int myid )
+{
+Frame now;
+real v[OUT_NVARS];
+unsigned i, j, k;
+int t, n, o, f[3], cnt, same, most;
+double peak = 0.;
+Layout *l;
+
+	//--- indicator at its largest in every block of the lattice
+	CurrentFrame( &now );
+	for( t = 0; t < NL; t++ ) loc[t] = -HUGE_VAL;
+	for( i = 1; i < LENN; i++ )
+		for( j = 1; j < HIGG; j++ )
+			for( k = 1; k < DEPP; k++ ) {
+				t = ( (int)( myid * LEN + i - 1 ) / nb * NF[1] + (int)( j - 1 ) / nb ) * NF[2] + (int)( k - 1 ) / nb;
+				CellValues( &now, i, j, k, myid, v );
+				if( v[9 + config.r_ind] > loc[t] ) loc[t] = v[9 + config.r_ind];
+			}
+	MPI_Allreduce( loc, ind, NL, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD );
+	for( t = 0; t < NL; t++ ) if( ind[t] > peak ) peak = ind[t];
+
+	//--- the blocks over the threshold and their neighbours
+	for( t = 0; t < NL; t++ ) mark[t] = 0;
+	for( t = 0; peak > 0. && t < NL; t++ ) {
+		if( ind[t] < config.r_thresh * peak ) continue;
+		for( o = 0; o < 27; o++ ) {
+			f[0] = t / ( NF[1] * NF[2] ) + o / 9 - 1;
+			f[1] = t / NF[2] % NF[1] + o / 3 % 3 - 1;
+			f[2] = ( t % NF[2] + o % 3 - 1 + NF[2] ) % NF[2];
+			if( f[0] < 0 || f[0] >= NF[0] || f[1] < 0 || f[1] >= NF[1] ) continue;
+			n = ( f[0] * NF[1] + f[1] ) * NF[2] + f[2];
+			if( eligible( n ) ) mark[n] = 1;
+		}
+	}
+
+	//--- no more than r_max per process, the strongest
+	for( t = cnt = 0; t < NL; t++ ) if( mark[t] ) rank[cnt++] = t;
+	if( config.r_max > 0 && cnt > config.r_max * np ) {
+		qsort( rank, cnt, sizeof(int), byIndicator );
+		for( n = config.r_max * np; n < cnt; n++ ) mark[rank[n]] = 0;
+		cnt = config.r_max * np;
+	}
+
+	same = ( cnt == at->n );
+	for( n = 0; same && n < at->n; n++ ) same = mark[at->tile[n]];
+	if( same ) return;
+
+	//--- the new layout, dealt out equally in the order of x
+	l = prev; prev = at; at = l;
+	for( n = 0; n < at->n; n++ ) at->where[at->tile[n]] = -1;
+	for( t = n = 0; t < NL; t++ )
+		if( mark[t] ) {
+			at->tile[n] = t;
+			at->owner[n] = (int)( (long)n * np / cnt );
+			at->where[t] = n++;
+		}
+	at->n = cnt;
+	for( o = 0, n = 0; o <= np; o++ ) {
+		while( n < cnt && at->owner[n] < o ) n++;
+		at->first[o] = n;
+	}
+
+	//--- blocks kept on _this_ process stay where they are
+	for( n = 0; n < cnt; n++ ) {
+		at->mine[n] = NULL;
+		if( at->owner[n] != myid ) continue;
+		o = prev->where[at->tile[n]];
+		if( o >= 0 && prev->owner[o] == myid ) { at->mine[n] = prev->mine[o]; prev->mine[o] = NULL; }
+		else at->mine[n] = newBlock( at->tile[n] );
+	}
+	baseV[0] = U1; baseV[1] = U2; baseV[2] = U3; baseV[3] = U4; baseV[4] = U5;
+	exchange( walkMove, 0, 1, 0, fresh );
+	for( n = 0; n < prev->n; n++ )
+		if( prev->mine[n] != NULL ) { freeBlock( prev->mine[n] ); prev->mine[n] = NULL; }
+
+	if( 0 == myid ) {
+		for( o = 0, most = 0; o < np; o++ )
+			if( at->first[o+1] - at->first[o] > most ) most = at->first[o+1] - at->first[o];
+		fprintf( stdout, "Amr: step %d, %d blocks refined (%.1f%% of the domain), at most %d per process.\n",
+		         step, cnt, 100. * cnt / NL, most );
+	}
+
+} /* end regrid() */
+
+
+void AmrStage( int myid, int numprocs )
+{
+Kernel base, g;
+int n, v, cur;
+Block *b;
+
+	if( !on ) return;
+	keep( &base );
+	cur = ( U1_ == U1p );
+
+	//--- ghosts of the blocks from the base cells and their neighbours
+	for( v = 0; v < 5; v++ ) baseV[v] = base.U_[v];
+	exchange( walkGhosts, 0, 1, cur, shell );
+
+	//--- the blocks through the stage, by the kernels of the slab
+	for( n = at->first[me]; n < at->first[me+1]; n++ ) {
+		b = at->mine[n];
+		blockKernel( b, cur, &base, &g );
+		use( &g );
+		Reconstruction( );
+		outerFaces( );
+		Fluxes( myid, numprocs );
+		average( b );
+		Evolution( nStages, Stage );
+		use( &base );
+	}
+
+	//--- their fluxes through the faces of the base cells into those of the slab
+	exchange( walkFluxes, 0, 0, 0, NULL );
+
+} /* end AmrStage() */
+
+
+void Amr( int myid )
+{
+	if( !on ) return;
+
+	//--- the covered base cells take the averages of the blocks
+	exchange( walkFluxes, 1, 1, 0, NULL );
+
+	if( step % config.r_every == 0 ) regrid( myid );
+
+} /* end Amr() */
+
+
+real AmrCoNum( void )
+{
+real maxCo = 0., CoNum, r, u, w;
+int n, i, j, k;
+Block *b;
+
+	if( !on ) return 0.;
+	for( n = at->first[me]; n < at->first[me+1]; n++ ) {
+		b = at->mine[n];
+		for( i = 2; i < NB + 2; i++ )
+			for( j = 2; j < NB + 2; j++ )
+				for( k = 2; k < NB + 2; k++ ) {
+					r = b->U[0][i][j][k];
+					u = b->U[1][i][j][k] / r;
+					w = b->U[2][i][j][k] / r;
+					maxCo = ( ( CoNum = u * deltaT / b->sx[0][i] ) > maxCo ) ? CoNum : maxCo;
+					maxCo = ( ( CoNum = fabs( w ) * deltaT / b->sy[0][j] ) > maxCo ) ? CoNum : maxCo;
+				}
+	}
+	return maxCo;
+
+} /* end AmrCoNum() */
+
+
+/*
+* fineFace - Coordinate of the face F of the fine cells along the axis a.
+*/
+static double fineFace( int a, int F )
+{
+	return F & 1 ? GridCentre( a, F / 2 ) : GridFace( a, F / 2 );
+}
+
+/*
+* writeXdmf - Root describes "<step>.blocks" in "<step>-blocks.xmf", a collection of the blocks.
+*/
+static void writeXdmf( void )
+{
+FILE *pF;
+char filename[40];
+int n, a, m, C[3];
+unsigned l;
+long size = (long)NB * NB * NB * sizeof(float);
+
+	sprintf( filename, "%d-blocks.xmf", step );
+	if( ( pF = fopen( filename, "w" ) ) == NULL ) {
+		fprintf( stderr, "can't open \"%s\".\n", filename );
+		return;
+	}
+	fprintf( pF, "<?xml version=\"1.0\" ?>\n" );
+	fprintf( pF, "<Xdmf Version=\"2.0\">\n <Domain>\n" );
+	fprintf( pF, "  <Grid Name=\"blocks\" GridType=\"Collection\" CollectionType=\"Spatial\">\n" );
+	fprintf( pF, "   <Time Value=\"%g\"/>\n", totalTime );
+	for( n = 0; n < at->n; n++ ) {
+		corner( at->tile[n], C );
+		fprintf( pF, "   <Grid Name=\"block%d\" GridType=\"Uniform\">\n", n );
+		fprintf( pF, "    <Topology TopologyType=\"3DRectMesh\" Dimensions=\"%d %d %d\"/>\n", NB + 1, NB + 1, NB + 1 );
+		fprintf( pF, "    <Geometry GeometryType=\"VXVYVZ\">\n" );
+		for( a = 0; a < 3; a++ ) {
+			fprintf( pF, "     <DataItem Format=\"XML\" Dimensions=\"%d\">", NB + 1 );
+			for( m = 0; m <= NB; m++ )
+				fprintf( pF, m ? " %.9g" : "%.9g", fineFace( a, 2 * C[a] + m ) );
+			fprintf( pF, "</DataItem>\n" );
+		}
+		fprintf( pF, "    </Geometry>\n" );
+		for( l = 0; l < OUT_NFIELDS; l++ ) {
+			fprintf( pF, "    <Attribute Name=\"%s\" AttributeType=\"Scalar\" Center=\"Cell\">\n", OutputVarNames[l+3] );
+			fprintf( pF, "     <DataItem Format=\"Binary\" NumberType=\"Float\" Precision=\"4\" Endian=\"Native\"" );
+			fprintf( pF, " Seek=\"%ld\" Dimensions=\"%d %d %d\">%d.blocks</DataItem>\n",
+			         ( (long)n * OUT_NFIELDS + l ) * size, NB, NB, NB, step );
+			fprintf( pF, "    </Attribute>\n" );
+		}
+		fprintf( pF, "   </Grid>\n" );
+	}
+	fprintf( pF, "  </Grid>\n </Domain>\n</Xdmf>\n" );
+	fclose( pF );
+
+} /* end writeXdmf() */
+
+void AmrOutput( int myid )
+{
+static float *buf = NULL;
+static int bSize = 0;
+char filename[30];
+MPI_File fh;
+Kernel base, g;
+Frame f;
+real v[OUT_NVARS];
+int n, i, j, k, l, c, per = OUT_NFIELDS * NB * NB * NB;
+Block *b;
+
+	if( !on || at->n == 0 ) return;
+	keep( &base );
+
+	//--- ghosts of the blocks as they are now, the gradients at their edges read them
+	for( l = 0; l < 5; l++ ) baseV[l] = base.U[l];
+	exchange( walkGhosts, 0, 1, 0, shell );
+
+	n = at->first[me+1] - at->first[me];
+	if( n * per > bSize ) {
+		free( buf );
+		if( ( buf = (float *)malloc( ( bSize = n * per ) * sizeof(float) ) ) == NULL ) {
+			fprintf( stderr, "mpi_layer2: can't allocate memory for the output of the blocks.\n" );
+			MPI_Abort( MPI_COMM_WORLD, 1 );
+		}
+	}
+	//--- every block: field-major, then k, j, i
+	for( n = at->first[me], c = 0; n < at->first[me+1]; n++, c += per ) {
+		b = at->mine[n];
+		blockKernel( b, 0, &base, &g );
+		use( &g );
+		f.U1 = b->U[0]; f.U2 = b->U[1]; f.U3 = b->U[2]; f.U4 = b->U[3]; f.U5 = b->U[4]; f.mu_SGS = NULL;
+		for( k = 2; k < NB + 2; k++ )
+			for( j = 2; j < NB + 2; j++ )
+				for( i = 2; i < NB + 2; i++ ) {
+					CellValues( &f, i, j, k, myid, v );
+					for( l = 0; l < OUT_NFIELDS; l++ )
+						buf[c + ( ( l * NB + k - 2 ) * NB + j - 2 ) * NB + i - 2] = v[l+3];
+				}
+		use( &base );
+	}
+
+	sprintf( filename, "%d.blocks", step );
+	MPI_File_open( MPI_COMM_WORLD, filename, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fh );
+	MPI_File_set_size( fh, 0 );
+	MPI_File_write_at_all( fh, (MPI_Offset)at->first[me] * per * sizeof(float), buf,
+	                       ( at->first[me+1] - at->first[me] ) * per, MPI_FLOAT, MPI_STATUS_IGNORE );
+	MPI_File_close( &fh );
+
+	if( 0 == myid ) writeXdmf( );
+
+} /* end AmrOutput() */
+
+
+void AmrInit( int myid )
+{
+int l, t;
+
+	if( config.r_every == 0 ) return;
+	MPI_Comm_size( MPI_COMM_WORLD, &np );
+	me = myid;
+	nb = config.r_block; NB = 2 * nb; G = NB + 4; PS = nb + 4;
+	if( GridCells( 0 ) % nb || HIG % nb || DEP % nb ) {
+		if( 0 == myid )
+			fprintf( stderr, "mpi_layer2: r_block = %d must divide the cells along x (%d), y (%d) and z (%d).\n",
+			         nb, GridCells( 0 ), HIG, DEP );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	NF[0] = GridCells( 0 ) / nb; NF[1] = HIG / nb; NF[2] = DEP / nb;
+	if( NF[0] < 3 || NF[1] < 3 ) {
+		if( 0 == myid )
+			fprintf( stderr, "mpi_layer2: r_block = %d leaves no block away from the boundaries.\n", nb );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	NL = NF[0] * NF[1] * NF[2];
+
+	for( l = 0; l < 2; l++ ) {
+		lay[l].n = 0;
+		lay[l].tile  = (int *)malloc( NL * sizeof(int) );
+		lay[l].owner = (int *)malloc( NL * sizeof(int) );
+		lay[l].where = (int *)malloc( NL * sizeof(int) );
+		lay[l].first = (int *)calloc( np + 1, sizeof(int) );
+		lay[l].mine  = (Block **)calloc( NL, sizeof(Block *) );
+		if( !lay[l].tile || !lay[l].owner || !lay[l].where || !lay[l].first || !lay[l].mine ) {
+			fprintf( stderr, "mpi_layer2: can't allocate memory for the refined blocks.\n" );
+			MPI_Abort( MPI_COMM_WORLD, 1 );
+		}
+		for( t = 0; t < NL; t++ ) lay[l].where[t] = -1;
+	}
+	loc  = (double *)malloc( NL * sizeof(double) );
+	ind  = (double *)malloc( NL * sizeof(double) );
+	mark = (int *)malloc( NL * sizeof(int) );
+	rank = (int *)malloc( NL * sizeof(int) );
+	scnt = (int *)malloc( 4 * np * sizeof(int) );
+	if( !loc || !ind || !mark || !rank || !scnt ) {
+		fprintf( stderr, "mpi_layer2: can't allocate memory for the refined blocks.\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	sdsp = scnt + np; rcnt = sdsp + np; rdsp = rcnt + np;
+	for( l = 0; l < 5; l++ ) {
+		xS[l] = Array3D( G - 1, G - 2, G - 2 ); Sx[l] = Array3D( G - 1, G - 2, G - 2 );
+		yS[l] = Array3D( G - 2, G - 1, G - 2 ); Sy[l] = Array3D( G - 2, G - 1, G - 2 );
+		zS[l] = Array3D( G - 2, G - 2, G - 1 ); Sz[l] = Array3D( G - 2, G - 2, G - 1 );
+	}
+	on = 1;
+
+	if( 0 == myid )
+		fprintf( stdout, "Amr: %d x %d x %d blocks of %d^3 base cells, %d^3 cells and %.2f MB each when refined.\n",
+		         NF[0], NF[1], NF[2], nb, NB, ( 10. * G * G * G + 5. * PS * PS * PS + 15. * ( nb + 1 ) * nb * nb ) * sizeof(real) / 1048576. );
+
+	//--- the base ghosts the indicator reads, before the first stage fills them
+	BounCondInGhostCells( myid, np );
+	regrid( myid );
+
+} /* end AmrInit() */
+
+
+void AmrFinalize( int myid )
+{
+int l, n;
+Block *b;
+
+	if( !on ) return;
+	for( n = 0; n < at->n; n++ )
+		if( at->mine[n] != NULL ) freeBlock( at->mine[n] );
+	while( ( b = pool ) != NULL ) {
+		pool = b->next;
+		for( l = 0; l < 5; l++ ) { free3D( b->U[l], G, G ); free3D( b->Up[l], G, G ); }
+		for( l = 0; l < 7; l++ ) { free( b->sx[l] ); free( b->sy[l] ); }
+		for( l = 0; l < G; l++ ) free( b->DD[l] );
+		free( b->DD );
+		for( l = 0; l < 3; l++ ) { free( b->pf[l] ); free( b->pb[l] ); }
+		free( b->patch );
+		free( b->flux );
+		free( b );
+	}
+	for( l = 0; l < 2; l++ ) {
+		free( lay[l].tile ); free( lay[l].owner ); free( lay[l].where ); free( lay[l].first ); free( lay[l].mine );
+	}
+	for( l = 0; l < 5; l++ ) {
+		free3D( xS[l], G - 1, G - 2 ); free3D( Sx[l], G - 1, G - 2 );
+		free3D( yS[l], G - 2, G - 1 ); free3D( Sy[l], G - 2, G - 1 );
+		free3D( zS[l], G - 2, G - 2 ); free3D( Sz[l], G - 2, G - 2 );
+	}
+	free( loc ); free( ind ); free( mark ); free( rank ); free( scnt );
+	free( sbuf ); free( rbuf );
+	on = 0;
+	(void)myid;
+
+} /* end AmrFinalize() */
@@ -0,0 +1,35 @@
+#ifndef AMR_H
+#define AMR_H
+
+/*
+* AmrInit - Sets up the lattice of blocks (r_every > 0): r_block divides the cells along
+* x, y and z; refines the first blocks about the layer.
+*/
+void AmrInit( int myid );
+
+/*
+* AmrStage - Called every stage between the fluxes and the evolution of the slab: advances
+* the refined blocks through the stage and puts their fluxes into those of the slab.
+*/
+void AmrStage( int myid, int numprocs );
+
+/*
+* Amr - Called every step after the stages: the covered base cells take the averages of
+* the blocks; every r_every steps the blocks are refined anew and dealt out.
+*/
+void Amr( int myid );
+
+/*
+* AmrCoNum - Largest Courant number in the refined cells of _this_ process.
+*/
+real AmrCoNum( void );
+
+/*
+* AmrOutput - Writes the refined blocks of the current step into "<step>.blocks" and
+* root describes them in "<step>-blocks.xmf".
+*/
+void AmrOutput( int myid );
+
+void AmrFinalize( int myid );
+
+#endif
@@ -2,6 +2,8 @@
 #include "type.h"
 #include "def.h"      /* Definitions, parameters */
 #include "global.h"   /* global variables */
+#include "inflow.h"   /* InflowPlane() */
+#include "outflow.h"  /* OutflowPlane() */
 
 #include "bounCondInGhostCells.h"
 
@@ -13,6 +15,7 @@ void BounCondInGhostCells(
 	int numprocs ) // number of processes
 {
 unsigned i, j, k;
+const float *pl;
 
 int next, previous; // processes next/previous to this
 MPI_Status status;
@@ -103,8 +106,20 @@ MPI_Status status;
 
 
 	//-- x
+	// left side - INFLOW planes of a precursor run
+	if(0 == myid && (pl = InflowPlane()) != NULL) {
+		for( j = 1; j < HIGG; j++ ) {
+			for( k = 1; k < DEPP; k++ ) {
+				U1_[0][j][k] = pl[( 0 * HIG + j-1 ) * DEP + k-1];
+				U2_[0][j][k] = pl[( 1 * HIG + j-1 ) * DEP + k-1];
+				U3_[0][j][k] = pl[( 2 * HIG + j-1 ) * DEP + k-1];
+				U4_[0][j][k] = pl[( 3 * HIG + j-1 ) * DEP + k-1];
+				U5_[0][j][k] = pl[( 4 * HIG + j-1 ) * DEP + k-1];
+			}
+		}
+	}
 	// left side inflow
-	if(0 == myid) { /* root process */
+	else if(0 == myid) { /* root process */
 
 		/* left side - INFLOW */
 		P = 100000.;
@@ -132,8 +147,20 @@ MPI_Status status;
 		} 
 	} // end if(0 == myid)
 
+	// right side - characteristic OUTFLOW
+	if(myid == numprocs-1 && (pl = OutflowPlane()) != NULL) {
+		for( j = 1; j < HIGG; j++ ) {
+			for( k = 1; k < DEPP; k++ ) {
+				U1_[LENN][j][k] = pl[( 0 * HIG + j-1 ) * DEP + k-1];
+				U2_[LENN][j][k] = pl[( 1 * HIG + j-1 ) * DEP + k-1];
+				U3_[LENN][j][k] = pl[( 2 * HIG + j-1 ) * DEP + k-1];
+				U4_[LENN][j][k] = pl[( 3 * HIG + j-1 ) * DEP + k-1];
+				U5_[LENN][j][k] = pl[( 4 * HIG + j-1 ) * DEP + k-1];
+			}
+		}
+	}
 	// right side - OUTFLOW
-	if(myid == numprocs-1) { /* last process */
+	else if(myid == numprocs-1) { /* last process */
 		P = 100000.;
 		for( j = 1; j < HIGG; j++ ) {
 			for( k = 1; k < DEPP; k++ ) {
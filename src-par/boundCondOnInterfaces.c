@@ -2,6 +2,8 @@
 #include "type.h"
 #include "def.h"      /* Definitions, parameters */
 #include "global.h"   /* global variables */
+#include "inflow.h"   /* InflowPlane() */
+#include "outflow.h"  /* OutflowPlane() */
 
 #include "bounCondOnInterfaces.h"
 
@@ -14,6 +16,7 @@ void BounCondOnInterfaces(
 {
 int next, previous; // processes next/previous to this
 MPI_Status status;
+const float *pl;
 
 
 
@@ -100,8 +103,20 @@ MPI_Status status;
   
 
 	/*--- x ---*/
+	/*- left side - INFLOW planes of a precursor run */
+	if(myid == 0 && (pl = InflowPlane()) != NULL) {
+		for( j = 0; j < HIG; j++ ) {
+			for( k = 0; k < DEP; k++ ) {
+				xU1[0][j][k] = pl[( 0 * HIG + j ) * DEP + k];
+				xU2[0][j][k] = pl[( 1 * HIG + j ) * DEP + k];
+				xU3[0][j][k] = pl[( 2 * HIG + j ) * DEP + k];
+				xU4[0][j][k] = pl[( 3 * HIG + j ) * DEP + k];
+				xU5[0][j][k] = pl[( 4 * HIG + j ) * DEP + k];
+			}
+		}
+	}
 	/*- left side */
-	if(myid == 0) { /* root process */
+	else if(myid == 0) { /* root process */
 		/*- left side - plain INFLOW */
 		P = 100000.;
 		U = 76.4; /* V = 0.; W = 0.; */
@@ -150,7 +165,19 @@ MPI_Status status;
 
 	} // end if(0 == myid) {
 
-	if(myid == numprocs-1) { /* last process */
+	if(myid == numprocs-1 && (pl = OutflowPlane()) != NULL) {
+		/* right side - characteristic OUTFLOW */
+		for (j = 0; j < HIG; j++) {
+			for (k = 0; k < DEP; k++) {
+				U1x[LEN][j][k] = pl[( 0 * HIG + j ) * DEP + k];
+				U2x[LEN][j][k] = pl[( 1 * HIG + j ) * DEP + k];
+				U3x[LEN][j][k] = pl[( 2 * HIG + j ) * DEP + k];
+				U4x[LEN][j][k] = pl[( 3 * HIG + j ) * DEP + k];
+				U5x[LEN][j][k] = pl[( 4 * HIG + j ) * DEP + k];
+			}
+		}
+	}
+	else if(myid == numprocs-1) { /* last process */
 		/* right side - OUTFLOW */
 		P = 100000.;
 		for (j = 0; j < HIG; j++) {
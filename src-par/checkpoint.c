@@ -0,0 +1,836 @@
+/*
+*  CHECKPOINT
+*
+*  Self-describing checkpoint "backup.chk" shared by all processes (b_format = 2).
+*  A fixed-size header holds the grid, the decomposition it was written with, the
+*  time-stepping state and the state of the random disturbances. The conservative
+*  variables follow as five float arrays [NX][HIG][DEP] over the whole domain, k
+*  running fastest, so the slab of a process is one contiguous piece of each array
+*  whatever the number of processes.
+*
+*  All processes write their slabs in one collective call into "backup.chk.tmp",
+*  which replaces the previous checkpoint only once it is complete. A run continued
+*  (Answer = 1) on another number of processes takes LEN from the checkpoint: the NX
+*  cells of the checkpoint are shared out again, so NX has to divide evenly. The
+*  running statistics, if taken, follow as double arrays [nstats][NX][HIG]. Rows
+*  laid out about the layer are kept by their band.
+*
+*  Periodic checkpoints (c_mtbf or c_every) come at two levels. Every few steps
+*  each process copies its conservative variables into memory and sends a copy to
+*  a partner process half the processes away (on another node as a rule). Every
+*  few of these copies a writer thread drains the latest one to "backup.chk" while
+*  the solver goes on; the next drain waits until the previous one is complete.
+*  The intervals follow Young/Daly, T = sqrt(2 C M) (1 + sqrt(C/2M)/3 + C/18M) - C,
+*  from the mean time between failures M (c_mtbf) and the cost C measured at every
+*  copy (level 1) and every drain (level 2), counted in steps of the measured step
+*  time.
+*
+*  The copies are kept in POSIX shared memory ("/dev/shm", named after the working
+*  directory and the process), so they outlive a process that fails. A run that
+*  continues on as many processes (Answer = 1) looks for them first: the newest
+*  step of which every process finds its own copy, or its partner holds one, is
+*  taken if it is newer than "backup.chk", a process lacking its copy receiving
+*  it from its partner. This needs the processes placed on the same nodes again,
+*  as when the job is started anew within its allocation; otherwise "backup.chk"
+*  is read. A run that ends normally removes the copies.
+*
+*/
+#include "mpi.h"
+#include <stdio.h>     /* printf(), rename() */
+#include <stdlib.h>    /* malloc()     */
+#include <string.h>    /* memcpy()     */
+#include <math.h>      /* sqrt()       */
+#include <pthread.h>   /* the drain runs on a thread of its own */
+#include <fcntl.h>     /* O_CREAT      */
+#include <unistd.h>    /* ftruncate(), getcwd() */
+#include <sys/mman.h>  /* shm_open(), mmap() */
+#include <sys/stat.h>  /* fstat()      */
+
+#include "type.h"
+#include "def.h"      /* Definitions, parameters */
+#include "global.h"   /* global variables */
+#include "config.h"
+#include "grid.h"     /* GridDeltaT(), GridBandY() */
+
+#include "probes.h"
+#include "statistics.h"
+#include "checkpoint.h"
+
+#define CKPT_MAGIC   "LAYER2CK"
+#define CKPT_VERSION 1
+#define CKPT_HEADER  512      /* bytes reserved for the header, the data start there */
+#define CKPT_NVARS   5
+
+typedef struct {
+	char   magic[8];
+	int    version, headerSize, realSize, nvars;
+	int    NX, HIG, DEP;              /* whole grid */
+	int    numprocs, LEN;             /* decomposition it was written with */
+	int    step;
+	int    counter, k_min, k_max;     /* current disturbing block */
+	double time, deltaT;
+	double deltaX, deltaY, deltaZ;
+	double X;                         /* state of the random sequence */
+	double Ud, Vd, Wd;
+	int    nstats, statSamples;       /* running statistics, none if 0 */
+	int    yFine;                     /* rows laid out about the layer (a_every), 0-as configured */
+	double yBand[2];                  /* their band, GridBandY() */
+	int    rank;                      /* process whose slab follows (in-memory copies) */
+} CkptHeader;
+
+static CkptHeader hdr;
+
+#define CKPT_FIRST 10          /* steps timed before the first periodic checkpoint */
+
+/* an in-memory copy: header block, the five arrays, the statistics (at 8 bytes) */
+typedef struct {
+	char       *base;
+	size_t     size;
+	CkptHeader *h;
+	float      *vars;
+	double     *stats;
+} Copy;
+
+/* periodic checkpoints: two own copies, one newest and one drained, and the partner's copy */
+static Copy copyA, copyB, partnerCopy, *own = &copyA, *draining = &copyB;
+static int partnerStep = -1;       /* step of the copy held for the partner */
+static int periodic = 0, nextCopy, copiesLeft, copyEvery, copiesPerDrain;
+static double stepTime = 0., lastTime, costCopy = 0., costDrain = 0.;
+
+static MPI_Comm CkptComm;
+static pthread_t drainer;
+static pthread_mutex_t drainLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t drainCond = PTHREAD_COND_INITIALIZER;
+static int drainBusy = 0, drainStop = 0, drainAsync = 0, drainId;
+static double drainTook = 0.;
+
+/* continued run: copies found in memory, the steps every process has of them */
+static Copy found[3];              /* own a, own b, held for the partner */
+static int *have = NULL;           /* [numprocs][3] steps, -1 none */
+static int fromMemory = 0;
+static double *restoredStats = NULL;
+
+
+/*
+* readHeader - Root process reads and checks the header, all processes get it; aborts
+* if it can't (must != 0), else returns 0.
+*/
+static int readHeader( int myid, int must )
+{
+MPI_File fh;
+int ok = 1;
+
+	if( 0 == myid ) {
+		if( MPI_File_open( MPI_COMM_SELF, "backup.chk", MPI_MODE_RDONLY, MPI_INFO_NULL, &fh ) != MPI_SUCCESS ) {
+			if( must ) fprintf( stderr, "mpi_layer2: can't open \"backup.chk\".\n" );
+			ok = 0;
+		}
+		else {
+			MPI_File_read_at( fh, 0, &hdr, sizeof(hdr), MPI_BYTE, MPI_STATUS_IGNORE );
+			MPI_File_close( &fh );
+			if( memcmp( hdr.magic, CKPT_MAGIC, 8 ) != 0 || hdr.version != CKPT_VERSION ||
+			    hdr.realSize != (int)sizeof(float) || hdr.nvars != CKPT_NVARS ) {
+				if( must ) fprintf( stderr, "mpi_layer2: \"backup.chk\" is not a checkpoint of this version.\n" );
+				ok = 0;
+			}
+		}
+	}
+	MPI_Bcast( &ok, 1, MPI_INT, 0, MPI_COMM_WORLD );
+	if( !ok && must ) MPI_Abort( MPI_COMM_WORLD, 1 );
+	if( ok ) MPI_Bcast( &hdr, sizeof(hdr), MPI_BYTE, 0, MPI_COMM_WORLD );
+	return ok;
+
+} /* end readHeader() */
+
+
+/*
+* copyName - Name of the shared memory of a copy of process rank: own a/b, held p.
+*/
+static void copyName( char *name, int rank, char which )
+{
+char cwd[1024];
+unsigned h = 5381;
+const char *c;
+
+	if( getcwd( cwd, sizeof(cwd) ) == NULL ) strcpy( cwd, "." );
+	for( c = cwd; *c; c++ ) h = 33 * h + (unsigned char)*c;
+	sprintf( name, "/layer2-%08x-%d%c", h, rank, which );
+
+} /* end copyName() */
+
+
+/* statistics of a copy of n cells start at */
+#define COPY_STATS( n ) ( CKPT_HEADER + ( ( CKPT_NVARS * (n) * sizeof(float) + 7 ) & ~(size_t)7 ) )
+
+
+/*
+* copyLayout - Points the parts of a copy of n cells and ns statistics into its memory; returns its size.
+*/
+static size_t copyLayout( Copy *c, size_t n, size_t ns )
+{
+	c->h     = (CkptHeader *)c->base;
+	c->vars  = (float *)( c->base + CKPT_HEADER );
+	c->stats = (double *)( c->base + COPY_STATS( n ) );
+	return COPY_STATS( n ) + ns * sizeof(double);
+
+} /* end copyLayout() */
+
+
+/*
+* mapCopy - Maps the shared memory of a copy, created with the given size (create != 0)
+* or as it is, to be read; returns 0 if there is none.
+*/
+static int mapCopy( Copy *c, int rank, char which, size_t size, int create )
+{
+char name[64];
+struct stat st;
+int fd;
+
+	c->base = NULL;
+	copyName( name, rank, which );
+	if( ( fd = shm_open( name, create ? O_CREAT | O_RDWR : O_RDONLY, 0600 ) ) < 0 ) return 0;
+	if( create ? ftruncate( fd, size ) != 0 : fstat( fd, &st ) != 0 || st.st_size < CKPT_HEADER ) {
+		close( fd );
+		return 0;
+	}
+	if( !create ) size = st.st_size;
+	c->base = (char *)mmap( NULL, size, create ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0 );
+	close( fd );
+	if( c->base == MAP_FAILED ) {
+		c->base = NULL;
+		return 0;
+	}
+	c->size = size;
+	c->h    = (CkptHeader *)c->base;
+	return 1;
+
+} /* end mapCopy() */
+
+
+static void unmapCopy( Copy *c )
+{
+	if( c->base != NULL ) munmap( c->base, c->size );
+	c->base = NULL;
+
+} /* end unmapCopy() */
+
+
+/*
+* copyStep - Step of a complete copy of the slab of process rank for this run, -1 if not one.
+*/
+static int copyStep( Copy *c, int rank, int numprocs )
+{
+const CkptHeader *h = c->h;
+
+	if( c->base == NULL ) return -1;
+	if( memcmp( h->magic, CKPT_MAGIC, 8 ) != 0 || h->version != CKPT_VERSION ||
+	    h->realSize != (int)sizeof(float) || h->nvars != CKPT_NVARS ||
+	    h->numprocs != numprocs || h->rank != rank || h->HIG != (int)HIG || h->DEP != (int)DEP ||
+	    h->LEN * numprocs != h->NX ||
+	    copyLayout( c, (size_t)h->LEN * HIG * DEP, (size_t)h->nstats * h->LEN * HIG ) > c->size ) return -1;
+	return h->step;
+
+} /* end copyStep() */
+
+
+/*
+* holder - Process that holds a copy of step s of the slab of process r, -1 if none does.
+*/
+static int holder( int r, int s, int numprocs )
+{
+int p = ( r + numprocs / 2 ) % numprocs;
+
+	if( have[3*r] == s || have[3*r + 1] == s ) return r;
+	if( p != r && have[3*p + 2] == s ) return p;
+	return -1;
+
+} /* end holder() */
+
+
+/*
+* findCopies - Maps the copies _this_ process finds in memory; returns the newest step
+* of which every process finds its own or its partner copy, -1 if there is none.
+*/
+static int findCopies( int myid, int numprocs )
+{
+int mine[3], c, r, s, best = -1, from = ( myid - numprocs / 2 + numprocs ) % numprocs;
+
+	for( c = 0; c < 3; c++ ) {
+		mine[c] = -1;
+		if( c == 2 && from == myid ) continue;
+		if( mapCopy( &found[c], myid, "abp"[c], 0, 0 ) )
+			mine[c] = copyStep( &found[c], c < 2 ? myid : from, numprocs );
+	}
+	if( ( have = (int *)malloc( 3 * numprocs * sizeof(int) ) ) == NULL ) {
+		fprintf( stderr, "mpi_layer2: can't allocate memory for the checkpoint.\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	MPI_Allgather( mine, 3, MPI_INT, have, 3, MPI_INT, MPI_COMM_WORLD );
+
+	for( c = 0; c < 3 * numprocs; c++ ) {
+		if( ( s = have[c] ) <= best ) continue;
+		for( r = 0; r < numprocs && holder( r, s, numprocs ) >= 0; r++ );
+		if( r == numprocs ) best = s;
+	}
+	return best;
+
+} /* end findCopies() */
+
+
+/*
+* copyOf - The copy of step s of the slab of process r that _this_ process holds.
+*/
+static Copy *copyOf( int myid, int r, int s )
+{
+	if( r != myid ) return &found[2];
+	return have[3*myid] == s ? &found[0] : &found[1];
+
+} /* end copyOf() */
+
+
+/*
+* slabView - File view of the slab of _this_ process in all five arrays.
+*/
+static void slabView( MPI_File fh, int myid, int NX )
+{
+MPI_Datatype slab;
+int sizes[3], subsizes[3], starts[3];
+
+	sizes[0] = CKPT_NVARS; sizes[1] = NX;  sizes[2] = HIG * DEP;
+	subsizes[0] = CKPT_NVARS; subsizes[1] = LEN; subsizes[2] = HIG * DEP;
+	starts[0] = 0; starts[1] = myid * LEN; starts[2] = 0;
+	MPI_Type_create_subarray( 3, sizes, subsizes, starts, MPI_ORDER_C, MPI_FLOAT, &slab );
+	MPI_Type_commit( &slab );
+	MPI_File_set_view( fh, CKPT_HEADER, MPI_FLOAT, slab, "native", MPI_INFO_NULL );
+	MPI_Type_free( &slab );
+
+} /* end slabView() */
+
+
+/*
+* statView - File view of the statistics of _this_ process, after the five arrays.
+*/
+static void statView( MPI_File fh, int myid, const CkptHeader *h )
+{
+MPI_Datatype slab;
+MPI_Offset disp = CKPT_HEADER + (MPI_Offset)CKPT_NVARS * h->NX * h->HIG * h->DEP * sizeof(float);
+int sizes[3], subsizes[3], starts[3];
+
+	sizes[0] = h->nstats; sizes[1] = h->NX; sizes[2] = HIG;
+	subsizes[0] = h->nstats; subsizes[1] = LEN; subsizes[2] = HIG;
+	starts[0] = 0; starts[1] = myid * LEN; starts[2] = 0;
+	MPI_Type_create_subarray( 3, sizes, subsizes, starts, MPI_ORDER_C, MPI_DOUBLE, &slab );
+	MPI_Type_commit( &slab );
+	MPI_File_set_view( fh, disp, MPI_DOUBLE, slab, "native", MPI_INFO_NULL );
+	MPI_Type_free( &slab );
+
+} /* end statView() */
+
+
+void CheckpointGrid( int myid )
+{
+int numprocs, s, src, c;
+
+	MPI_Comm_size( MPI_COMM_WORLD, &numprocs );
+
+	//--- copies in memory newer than "backup.chk" are taken, the header is that of root's
+	if( ( s = findCopies( myid, numprocs ) ) < 0 ) readHeader( myid, 1 );
+	else if( !readHeader( myid, 0 ) || hdr.step < s ) {
+		fromMemory = 1;
+		src = holder( 0, s, numprocs );
+		if( myid == src ) hdr = *copyOf( myid, 0, s )->h;
+		MPI_Bcast( &hdr, sizeof(hdr), MPI_BYTE, src, MPI_COMM_WORLD );
+	}
+	if( !fromMemory ) {
+		for( c = 0; c < 3; c++ ) unmapCopy( &found[c] );
+		free( have ); have = NULL;
+	}
+
+	if( hdr.HIG != (int)HIG || hdr.DEP != (int)DEP ) {
+		if( 0 == myid )
+			fprintf( stderr, "mpi_layer2: \"backup.chk\" holds a %dx%dx%d grid, HIG = %d and DEP = %d are given.\n",
+			         hdr.NX, hdr.HIG, hdr.DEP, HIG, DEP );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	if( hdr.NX % numprocs != 0 ) {
+		if( 0 == myid )
+			fprintf( stderr, "mpi_layer2: the %d cells in x of \"backup.chk\" can't be shared evenly by %d processes.\n",
+			         hdr.NX, numprocs );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	if( (int)LEN != hdr.NX / numprocs ) {
+		LEN = hdr.NX / numprocs;
+		if( 0 == myid )
+			fprintf( stdout, "Checkpoint written by %d processes, continued by %d: LEN = %d.\n",
+			         hdr.numprocs, numprocs, LEN );
+	}
+
+} /* end CheckpointGrid() */
+
+
+/*
+* packSlab - Conservative variables of _this_ process as the five arrays of the file.
+*/
+static void packSlab( float *buf )
+{
+unsigned i, j, k;
+size_t n = (size_t)LEN * HIG * DEP, m;
+
+	for( i = 1; i < LENN; i++ ) {
+		for( j = 1; j < HIGG; j++ ) {
+			for( k = 1; k < DEPP; k++ ) {
+				m = ( (size_t)( i - 1 ) * HIG + j - 1 ) * DEP + k - 1;
+				buf[      m] = U1[i][j][k];
+				buf[  n + m] = U2[i][j][k];
+				buf[2*n + m] = U3[i][j][k];
+				buf[3*n + m] = U4[i][j][k];
+				buf[4*n + m] = U5[i][j][k];
+			}
+		}
+	}
+} /* end packSlab() */
+
+
+/*
+* fillHeader - Header of the current state; the disturbances are those of root.
+*/
+static void fillHeader( CkptHeader *h, int numprocs )
+{
+	memset( h, 0, sizeof(*h) );
+	memcpy( h->magic, CKPT_MAGIC, 8 );
+	h->version    = CKPT_VERSION;
+	h->headerSize = CKPT_HEADER;
+	h->realSize   = sizeof(float);
+	h->nvars      = CKPT_NVARS;
+	h->NX = LEN * numprocs; h->HIG = HIG; h->DEP = DEP;
+	h->numprocs = numprocs; h->LEN = LEN;
+	h->step = step;
+	h->counter = counter; h->k_min = k_min; h->k_max = k_max;
+	h->time = totalTime; h->deltaT = deltaT;
+	h->deltaX = deltaX; h->deltaY = deltaY; h->deltaZ = deltaZ;
+	h->X = X;
+	h->Ud = Ud; h->Vd = Vd; h->Wd = Wd;
+	h->nstats = StatisticsCount( );
+	h->yFine = GridBand( h->yBand );
+
+} /* end fillHeader() */
+
+
+/*
+* writeFile - All processes of comm write their slabs, root the header, into "backup.chk".
+*/
+static void writeFile( MPI_Comm comm, const float *buf, const double *stats, const CkptHeader *h, int myid )
+{
+MPI_File fh;
+size_t n = (size_t)LEN * HIG * DEP;
+
+	MPI_File_open( comm, "backup.chk.tmp", MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fh );
+	MPI_File_set_size( fh, 0 );
+	if( 0 == myid ) {
+		char block[CKPT_HEADER];
+		memset( block, 0, sizeof(block) );
+		memcpy( block, h, sizeof(*h) );
+		MPI_File_write_at( fh, 0, block, CKPT_HEADER, MPI_BYTE, MPI_STATUS_IGNORE );
+	}
+	slabView( fh, myid, h->NX );
+	MPI_File_write_all( fh, (void *)buf, CKPT_NVARS * n, MPI_FLOAT, MPI_STATUS_IGNORE );
+	if( h->nstats > 0 ) {
+		statView( fh, myid, h );
+		MPI_File_write_all( fh, (void *)stats, h->nstats * LEN * HIG, MPI_DOUBLE, MPI_STATUS_IGNORE );
+	}
+	MPI_File_close( &fh );
+
+	//--- the old checkpoint stays until the new one is complete
+	if( 0 == myid ) {
+		if( rename( "backup.chk.tmp", "backup.chk" ) != 0 )
+			fprintf( stderr, "mpi_layer2: can't rename \"backup.chk.tmp\" to \"backup.chk\".\n" );
+		else
+			fprintf( stdout, "Checkpoint of step %d written to \"backup.chk\".\n", h->step );
+	}
+	MPI_Barrier( comm );
+
+} /* end writeFile() */
+
+
+void WriteCheckpoint( int myid )
+{
+int numprocs;
+float *buf;
+double *stats = NULL;
+
+	MPI_Comm_size( MPI_COMM_WORLD, &numprocs );
+
+	//--- a drain still running writes the same file
+	CheckpointFlush( );
+
+	fillHeader( &hdr, numprocs );
+	if( ( buf = (float *)malloc( CKPT_NVARS * (size_t)LEN * HIG * DEP * sizeof(float) ) ) == NULL ||
+	    ( hdr.nstats > 0 && ( stats = (double *)malloc( (size_t)hdr.nstats * LEN * HIG * sizeof(double) ) ) == NULL ) ) {
+		fprintf( stderr, "mpi_layer2: can't allocate memory for the checkpoint.\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	packSlab( buf );
+	if( hdr.nstats > 0 ) hdr.statSamples = StatisticsPack( stats );
+	writeFile( MPI_COMM_WORLD, buf, stats, &hdr, myid );
+	free( buf );
+	free( stats );
+
+} /* end WriteCheckpoint() */
+
+
+/*
+* readCopies - The slab of _this_ process from its copy in memory, or from its partner;
+* the statistics are kept for ReadCheckpointStatistics().
+*/
+static void readCopies( int myid, int numprocs, float *buf )
+{
+size_t n = CKPT_NVARS * (size_t)LEN * HIG * DEP, ns = (size_t)hdr.nstats * LEN * HIG;
+int s = hdr.step, from = ( myid - numprocs / 2 + numprocs ) % numprocs, src = holder( myid, s, numprocs ), nReq = 0, moved, total;
+MPI_Request req[4];
+Copy *c;
+
+	if( ns > 0 && ( restoredStats = (double *)malloc( ns * sizeof(double) ) ) == NULL ) {
+		fprintf( stderr, "mpi_layer2: can't allocate memory for the checkpoint.\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+
+	//--- the copy held for the process before the partner, if it lacks its own
+	if( from != myid && holder( from, s, numprocs ) == myid ) {
+		c = copyOf( myid, from, s );
+		MPI_Isend( c->vars, n, MPI_FLOAT, from, 43, MPI_COMM_WORLD, &req[nReq++] );
+		if( ns > 0 ) MPI_Isend( c->stats, ns, MPI_DOUBLE, from, 44, MPI_COMM_WORLD, &req[nReq++] );
+	}
+	if( src == myid ) {
+		c = copyOf( myid, myid, s );
+		memcpy( buf, c->vars, n * sizeof(float) );
+		if( ns > 0 ) memcpy( restoredStats, c->stats, ns * sizeof(double) );
+	}
+	else {
+		MPI_Irecv( buf, n, MPI_FLOAT, src, 43, MPI_COMM_WORLD, &req[nReq++] );
+		if( ns > 0 ) MPI_Irecv( restoredStats, ns, MPI_DOUBLE, src, 44, MPI_COMM_WORLD, &req[nReq++] );
+	}
+	MPI_Waitall( nReq, req, MPI_STATUSES_IGNORE );
+
+	for( moved = 0; moved < 3; moved++ ) unmapCopy( &found[moved] );
+	free( have ); have = NULL;
+
+	moved = ( src != myid );
+	MPI_Reduce( &moved, &total, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD );
+	if( 0 == myid )
+		fprintf( stdout, "Restored step %d, time %f sec. from the copies in memory, %d of them from partners.\n",
+		         s, hdr.time, total );
+
+} /* end readCopies() */
+
+
+void ReadCheckpoint( int myid )
+{
+MPI_File fh;
+int numprocs;
+unsigned i, j, k;
+size_t n = (size_t)LEN * HIG * DEP, m;
+float *buf;
+
+	MPI_Comm_size( MPI_COMM_WORLD, &numprocs );
+
+	if( ( buf = (float *)malloc( CKPT_NVARS * n * sizeof(float) ) ) == NULL ) {
+		fprintf( stderr, "mpi_layer2: can't allocate memory for the checkpoint.\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	if( fromMemory ) readCopies( myid, numprocs, buf );
+	else {
+		MPI_File_open( MPI_COMM_WORLD, "backup.chk", MPI_MODE_RDONLY, MPI_INFO_NULL, &fh );
+		slabView( fh, myid, hdr.NX );
+		MPI_File_read_all( fh, buf, CKPT_NVARS * n, MPI_FLOAT, MPI_STATUS_IGNORE );
+		MPI_File_close( &fh );
+	}
+
+	for( i = 1; i < LENN; i++ ) {
+		for( j = 1; j < HIGG; j++ ) {
+			for( k = 1; k < DEPP; k++ ) {
+				m = ( (size_t)( i - 1 ) * HIG + j - 1 ) * DEP + k - 1;
+				U1[i][j][k] = buf[      m];
+				U2[i][j][k] = buf[  n + m];
+				U3[i][j][k] = buf[2*n + m];
+				U4[i][j][k] = buf[3*n + m];
+				U5[i][j][k] = buf[4*n + m];
+			}
+		}
+	}
+	free( buf );
+
+	//--- time stepping goes on as if never stopped
+	step      = hdr.step;
+	totalTime = hdr.time;
+	deltaT    = hdr.deltaT;
+	if( hdr.yFine > 0 ) GridBandY( hdr.yBand, hdr.yFine );
+	GridDeltaT( );
+	X         = hdr.X;
+	counter   = hdr.counter;
+	k_min     = hdr.k_min;
+	k_max     = hdr.k_max;
+	Ud = hdr.Ud; Vd = hdr.Vd; Wd = hdr.Wd;
+
+	if( 0 == myid && !fromMemory ) fprintf( stdout, "Restored step %d, time %f sec. from \"backup.chk\".\n", step, totalTime );
+
+} /* end ReadCheckpoint() */
+
+
+int ReadCheckpointStatistics( int myid, double *buf, int n )
+{
+MPI_File fh;
+
+	if( hdr.nstats != n || hdr.statSamples == 0 ) return 0;
+
+	if( fromMemory ) {
+		memcpy( buf, restoredStats, (size_t)n * LEN * HIG * sizeof(double) );
+		free( restoredStats ); restoredStats = NULL;
+		return hdr.statSamples;
+	}
+	MPI_File_open( MPI_COMM_WORLD, "backup.chk", MPI_MODE_RDONLY, MPI_INFO_NULL, &fh );
+	statView( fh, myid, &hdr );
+	MPI_File_read_all( fh, buf, n * LEN * HIG, MPI_DOUBLE, MPI_STATUS_IGNORE );
+	MPI_File_close( &fh );
+	return hdr.statSamples;
+
+} /* end ReadCheckpointStatistics() */
+
+
+/*
+* dalyInterval - Young/Daly optimum time between checkpoints of cost c for the mean time m between failures.
+*/
+static double dalyInterval( double c, double m )
+{
+	if( c >= 2. * m ) return m;
+	return sqrt( 2. * c * m ) * ( 1. + sqrt( c / ( 2. * m ) ) / 3. + c / ( 18. * m ) ) - c;
+
+} /* end dalyInterval() */
+
+
+static void *drainThread( void *arg )
+{
+double t;
+
+	(void)arg;
+	while( 1 ) {
+		pthread_mutex_lock( &drainLock );
+		while( !drainBusy && !drainStop ) pthread_cond_wait( &drainCond, &drainLock );
+		if( !drainBusy ) {
+			pthread_mutex_unlock( &drainLock );
+			break;
+		}
+		pthread_mutex_unlock( &drainLock );
+
+		t = MPI_Wtime( );
+		writeFile( CkptComm, draining->vars, draining->stats, draining->h, drainId );
+
+		pthread_mutex_lock( &drainLock );
+		drainTook = MPI_Wtime( ) - t;
+		drainBusy = 0;
+		pthread_cond_broadcast( &drainCond );
+		pthread_mutex_unlock( &drainLock );
+	}
+	return NULL;
+
+} /* end drainThread() */
+
+
+/*
+* removeCopies - Removes the copies of _this_ process from memory, and those of the processes
+* myid + numprocs, myid + 2 numprocs, ... left by a run on more processes.
+*/
+static void removeCopies( int myid, int numprocs )
+{
+char name[64];
+const char *c;
+int r, gone = 1;
+
+	for( r = myid; gone; r += numprocs ) {
+		for( gone = 0, c = "abp"; *c; c++ ) {
+			copyName( name, r, *c );
+			if( shm_unlink( name ) == 0 ) gone = 1;
+		}
+		if( r == myid ) gone = 1;
+	}
+
+} /* end removeCopies() */
+
+
+void CheckpointInit( int myid )
+{
+int provided, numprocs;
+size_t n = (size_t)LEN * HIG * DEP, ns = (size_t)StatisticsCount( ) * LEN * HIG, size;
+
+	free( restoredStats ); restoredStats = NULL;
+
+	//--- copies of an earlier run, taken or not, are not to be found again
+	MPI_Comm_size( MPI_COMM_WORLD, &numprocs );
+	removeCopies( myid, numprocs );
+	periodic = ( config.c_mtbf > 0. || config.c_every > 0 );
+	if( !periodic ) return;
+
+	size = COPY_STATS( n ) + ns * sizeof(double);
+	if( !mapCopy( &copyA, myid, 'a', size, 1 ) || !mapCopy( &copyB, myid, 'b', size, 1 ) ||
+	    ( numprocs > 1 && !mapCopy( &partnerCopy, myid, 'p', size, 1 ) ) ) {
+		fprintf( stderr, "mpi_layer2: can't set up shared memory for periodic checkpoints.\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	copyLayout( &copyA, n, ns );
+	copyLayout( &copyB, n, ns );
+	if( numprocs > 1 ) copyLayout( &partnerCopy, n, ns );
+	MPI_Comm_dup( MPI_COMM_WORLD, &CkptComm );
+
+	copyEvery      = config.c_every > 0 ? config.c_every : CKPT_FIRST;
+	copiesPerDrain = config.c_disk  > 0 ? config.c_disk  : 1;
+	nextCopy       = step + copyEvery;
+	copiesLeft     = 1;               /* the first copy is drained, to time it */
+	lastTime       = MPI_Wtime( );
+
+	MPI_Query_thread( &provided );
+	if( provided >= MPI_THREAD_MULTIPLE ) {
+		drainId = myid;
+		if( pthread_create( &drainer, NULL, drainThread, NULL ) != 0 ) {
+			fprintf( stderr, "mpi_layer2: can't start the checkpoint thread.\n" );
+			MPI_Abort( MPI_COMM_WORLD, 1 );
+		}
+		drainAsync = 1;
+	}
+	else if( 0 == myid )
+		fprintf( stdout, "Checkpoint: MPI library gives no MPI_THREAD_MULTIPLE, checkpoints are written synchronously.\n" );
+
+} /* end CheckpointInit() */
+
+
+/***********************
+*  CHECKPOINTPERIODIC  *   Copies to memory and drains to disk when due
+***********************/
+void CheckpointPeriodic( int myid, int numprocs )
+{
+double t, now, cost[4], glob[4];
+int partner, from, drain;
+size_t n = CKPT_NVARS * (size_t)LEN * HIG * DEP;
+CkptHeader h;
+Copy *tmp;
+
+	if( !periodic ) return;
+
+	//--- time of a step, averaged over the steps since the last call
+	now = MPI_Wtime( );
+	stepTime = ( stepTime == 0. ) ? now - lastTime : 0.8 * stepTime + 0.2 * ( now - lastTime );
+	lastTime = now;
+	if( (int)step < nextCopy ) return;
+
+	//--- level 1: own copy, and a copy to the partner; a header marks them complete
+	t = MPI_Wtime( );
+	own->h->magic[0] = '\0';
+	packSlab( own->vars );
+	fillHeader( &h, numprocs );
+	h.rank = myid;
+	if( h.nstats > 0 ) h.statSamples = StatisticsPack( own->stats );
+	*own->h = h;
+	partner = ( myid + numprocs / 2 ) % numprocs;
+	from    = ( myid - numprocs / 2 + numprocs ) % numprocs;
+	if( partner != myid ) {
+		partnerCopy.h->magic[0] = '\0';
+		MPI_Sendrecv( own->vars, n, MPI_FLOAT, partner, 41,
+		              partnerCopy.vars, n, MPI_FLOAT, from, 41,
+		              MPI_COMM_WORLD, MPI_STATUS_IGNORE );
+		if( h.nstats > 0 )
+			MPI_Sendrecv( own->stats, h.nstats * LEN * HIG, MPI_DOUBLE, partner, 42,
+			              partnerCopy.stats, h.nstats * LEN * HIG, MPI_DOUBLE, from, 42,
+			              MPI_COMM_WORLD, MPI_STATUS_IGNORE );
+		MPI_Sendrecv( own->h, sizeof(CkptHeader), MPI_BYTE, partner, 43,
+		              partnerCopy.h, sizeof(CkptHeader), MPI_BYTE, from, 43,
+		              MPI_COMM_WORLD, MPI_STATUS_IGNORE );
+		partnerStep = step;
+	}
+	cost[0] = MPI_Wtime( ) - t;
+
+	//--- the schedule is taken from the slowest process, so all processes keep it
+	pthread_mutex_lock( &drainLock );
+	cost[1] = drainTook;
+	cost[2] = drainBusy;
+	pthread_mutex_unlock( &drainLock );
+	cost[3] = stepTime;
+	MPI_Allreduce( cost, glob, 4, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD );
+	costCopy = glob[0];
+	if( glob[1] > 0. ) costDrain = glob[1];
+
+	//--- level 2: the newest copy goes to disk unless the previous drain is still running
+	drain = ( --copiesLeft <= 0 && glob[2] == 0. );
+	if( drain ) {
+		tmp = draining; draining = own; own = tmp;
+		ProbesFlush( );    /* probe records reach the checkpointed step on disk too */
+		if( drainAsync ) {
+			pthread_mutex_lock( &drainLock );
+			drainBusy = 1;
+			pthread_cond_broadcast( &drainCond );
+			pthread_mutex_unlock( &drainLock );
+		}
+		else {
+			t = MPI_Wtime( );
+			writeFile( CkptComm, draining->vars, draining->stats, draining->h, myid );
+			drainTook = MPI_Wtime( ) - t;
+		}
+	}
+
+	//--- next intervals after Young/Daly, unless fixed in the configuration
+	if( config.c_mtbf > 0. && glob[3] > 0. ) {
+		if( config.c_every == 0 ) {
+			copyEvery = (int)( dalyInterval( costCopy, config.c_mtbf ) / glob[3] + 0.5 );
+			if( copyEvery < 1 ) copyEvery = 1;
+		}
+		if( config.c_disk == 0 && costDrain > 0. ) {
+			copiesPerDrain = (int)( dalyInterval( costDrain, config.c_mtbf ) / ( copyEvery * glob[3] ) + 0.5 );
+			if( copiesPerDrain < 1 ) copiesPerDrain = 1;
+		}
+	}
+	if( drain ) {
+		copiesLeft = copiesPerDrain;
+		if( 0 == myid )
+			fprintf( stdout, "Checkpoint: step %d to disk; copies every %d steps (%.3g s), to disk every %d copies (%.3g s), step %.3g s.\n",
+			         step, copyEvery, costCopy, copiesPerDrain, costDrain, glob[3] );
+	}
+	nextCopy = step + copyEvery;
+
+	// the checkpoint is not counted in the step time
+	lastTime = MPI_Wtime( );
+
+} /* end CheckpointPeriodic() */
+
+
+void CheckpointFlush( void )
+{
+	if( !drainAsync ) return;
+
+	pthread_mutex_lock( &drainLock );
+	while( drainBusy ) pthread_cond_wait( &drainCond, &drainLock );
+	pthread_mutex_unlock( &drainLock );
+
+} /* end CheckpointFlush() */
+
+
+void CheckpointFinalize( int myid )
+{
+int numprocs;
+
+	if( !periodic ) return;
+
+	if( drainAsync ) {
+		pthread_mutex_lock( &drainLock );
+		drainStop = 1;
+		pthread_cond_broadcast( &drainCond );
+		pthread_mutex_unlock( &drainLock );
+		pthread_join( drainer, NULL );
+		drainAsync = 0;
+	}
+	if( 0 == myid && partnerStep >= 0 )
+		fprintf( stdout, "Checkpoint: last in-memory copy (own and partner) of step %d.\n", partnerStep );
+	//--- the run ends with "backup.chk", the copies are of no more use
+	unmapCopy( &copyA ); unmapCopy( &copyB ); unmapCopy( &partnerCopy );
+	MPI_Comm_size( MPI_COMM_WORLD, &numprocs );
+	removeCopies( myid, numprocs );
+	MPI_Comm_free( &CkptComm );
+	periodic = 0;
+
+} /* end CheckpointFinalize() */
@@ -0,0 +1,49 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+/*
+* CheckpointGrid - Reads the header of "backup.chk", or of the copies in memory of periodic
+* checkpoints if they are newer, before the arrays are allocated: checks the grid and sets
+* LEN for the current number of processes.
+*/
+void CheckpointGrid( int myid );
+
+/*
+* WriteCheckpoint - All processes write the solution and time-stepping state to "backup.chk".
+*/
+void WriteCheckpoint( int myid );
+
+/*
+* ReadCheckpoint - Reads the slab of _this_ process and the time-stepping state from "backup.chk"
+* or from the copies in memory, its own or its partner's.
+*/
+void ReadCheckpoint( int myid );
+
+/*
+* ReadCheckpointStatistics - Reads the n running statistics per cell of the x-y plane of
+* _this_ process from "backup.chk"; returns the samples they hold, 0 if it has none.
+*/
+int ReadCheckpointStatistics( int myid, double *buf, int n );
+
+/*
+* CheckpointInit - Sets up periodic checkpoints (c_mtbf or c_every) and starts the drain thread.
+*/
+void CheckpointInit( int myid );
+
+/*
+* CheckpointPeriodic - Called every step: in-memory copy with a partner copy when due,
+* and now and then a drain of it to "backup.chk" in the background.
+*/
+void CheckpointPeriodic( int myid, int numprocs );
+
+/*
+* CheckpointFlush - Waits for the drain in progress, if any.
+*/
+void CheckpointFlush( void );
+
+/*
+* CheckpointFinalize - Stops the drain thread and removes the copies from memory.
+*/
+void CheckpointFinalize( int myid );
+
+#endif
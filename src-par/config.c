@@ -0,0 +1,289 @@
+/*
+*  CONFIG
+*
+*  Keyed configuration file reader. Every line holds one "key = value" pair,
+*  everything after '#' is a comment, keys are case-insensitive:
+*
+*      LEN    = 50       # Number of cells in length (per process)
+*      deltaX = 1.6666667
+*
+*  Unknown keys, repeated keys, malformed or out-of-range values and missing
+*  required keys are all reported (with the line number) and stop the run.
+*  Keys left out of the file take their default values. A few keys (CFG_LIST) hold
+*  a line of text and may be repeated, each occurrence adds an item to the list.
+*
+*/
+#include "mpi.h"
+#include <stdio.h>     /* printf() etc.*/
+#include <stdlib.h>    /* strtol(), strtod() */
+#include <stddef.h>    /* offsetof()   */
+#include <string.h>    /* strchr()     */
+#include <strings.h>   /* strcasecmp() */
+#include <ctype.h>     /* isspace()    */
+
+#include "type.h"
+#include "def.h"      /* Definitions, parameters */
+
+#include "config.h"
+
+Config config;
+
+typedef enum { CFG_INT, CFG_REAL, CFG_LIST } cfgType;
+
+typedef struct {
+	const char *key;
+	cfgType     type;
+	size_t      offset;   /* of the field within Config */
+	const char *def;      /* default value, NULL if the key is required */
+	double      min, max; /* admissible range */
+	const char *descr;
+} cfgEntry;
+
+#define CFG_FIELD(f) offsetof(Config, f)
+
+static const cfgEntry cfgTable[] = {
+	{ "LEN",      CFG_INT,  CFG_FIELD(LEN),      NULL,       1, 1e6, "Number of cells in length (per process) [-]" },
+	{ "HIG",      CFG_INT,  CFG_FIELD(HIG),      NULL,       2, 1e6, "Number of cells in height [-]" },
+	{ "DEP",      CFG_INT,  CFG_FIELD(DEP),      NULL,       1, 1e6, "Number of cells in depth [-]" },
+	{ "deltaX",   CFG_REAL, CFG_FIELD(deltaX),   NULL,   1e-12, 1e12, "X-step [m]" },
+	{ "deltaY",   CFG_REAL, CFG_FIELD(deltaY),   NULL,   1e-12, 1e12, "Y-step [m]" },
+	{ "deltaZ",   CFG_REAL, CFG_FIELD(deltaZ),   NULL,   1e-12, 1e12, "Z-step [m]" },
+	{ "g_x",      CFG_REAL, CFG_FIELD(g_x),      "1",      0.5,    2, "Growth of the cell width from column to column, deltaX the first (1-uniform)" },
+	{ "g_y",      CFG_REAL, CFG_FIELD(g_y),      "0",        0,   20, "Clustering of the cells about the centre in y, deltaY the mean height (0-uniform)" },
+	{ "deltaT",   CFG_REAL, CFG_FIELD(deltaT),   NULL,   1e-12, 1e12, "Time step [sec]" },
+	{ "Answer",   CFG_INT,  CFG_FIELD(Answer),   "0",        0,    1, "1-continue, 0-start new [boolean]" },
+	{ "numstep",  CFG_INT,  CFG_FIELD(numstep),  NULL,       0, 2e9, "Number of overall time steps [-]" },
+	{ "mu_L",     CFG_REAL, CFG_FIELD(mu_L),     NULL,       0, 1e12, "Dynamic mol. viscosity [Pa*sec]" },
+	{ "Pr_L",     CFG_REAL, CFG_FIELD(Pr_L),     "0.72",  1e-6, 1e6, "Mol. Prandtl number" },
+	{ "Pr_T",     CFG_REAL, CFG_FIELD(Pr_T),     "0.8",   1e-6, 1e6, "Turb. Prandtl number" },
+	{ "Cs",       CFG_REAL, CFG_FIELD(Cs),       "0.01",     0,    1, "Square of the Smagorinsky constant" },
+	{ "BL_HIG",   CFG_INT,  CFG_FIELD(BL_HIG),   "5",        0, 1e6, "Height of the random disturbing block" },
+	{ "Ua",       CFG_REAL, CFG_FIELD(Ua),       "35.",      0, 1e6, "Amplitude of disturbed U [m/sec]" },
+	{ "Va",       CFG_REAL, CFG_FIELD(Va),       "35.",      0, 1e6, "Amplitude of disturbed V [m/sec]" },
+	{ "Wa",       CFG_REAL, CFG_FIELD(Wa),       "35.",      0, 1e6, "Amplitude of disturbed W [m/sec]" },
+	{ "Ns_min",   CFG_INT,  CFG_FIELD(Ns_min),   "10",       0, 1e9, "Minimal period of disturbing block" },
+	{ "Nst",      CFG_INT,  CFG_FIELD(Nst),      "50",       0, 1e9, "Its max-min" },
+	{ "f_step",   CFG_INT,  CFG_FIELD(f_step),   "100",      1, 2e9, "Frame taking step" },
+	{ "f_format", CFG_INT,  CFG_FIELD(f_format), "0",        0,    4, "Frame format: 0-Tecplot ASCII per process, 1-single binary file + XDMF, 2-HDF5, 3-binary Tecplot, 4-compressed" },
+	{ "b_format", CFG_INT,  CFG_FIELD(b_format), "2",        0,    2, "Backup format: 0-\"backup.myid\" per process, 1-HDF5 \"backup.h5\", 2-checkpoint \"backup.chk\"" },
+	{ "c_mtbf",   CFG_REAL, CFG_FIELD(c_mtbf),   "0",        0, 1e12, "Mean time between failures of the job [sec], sets the checkpoint intervals (0-none)" },
+	{ "c_every",  CFG_INT,  CFG_FIELD(c_every),  "0",        0, 2e9, "Steps between in-memory checkpoint copies (0-from c_mtbf)" },
+	{ "c_disk",   CFG_INT,  CFG_FIELD(c_disk),   "0",        0, 1e6, "In-memory copies per checkpoint written to disk (0-from c_mtbf)" },
+	{ "f_async",  CFG_INT,  CFG_FIELD(f_async),  "0",        0,    1, "1-frames written by a writer thread while the solver goes on" },
+	{ "f_buffers", CFG_INT, CFG_FIELD(f_buffers), "2",       1,   16, "Frames staged for the writer thread before the solver waits" },
+	{ "z_bound",  CFG_LIST, CFG_FIELD(z_bound),  "",         0,    0, "Error bound of compressed frames: <field|all> <abs|rel> <value>, default all rel 1e-3" },
+	{ "h5_deflate", CFG_INT, CFG_FIELD(h5_deflate), "4",     0,    9, "Deflate level of HDF5 datasets (0-no compression)" },
+	{ "nStages",  CFG_INT,  CFG_FIELD(nStages),  "3",        2,    3, "Number of stages (2,3) of TVD Runge-Kutta algorithm" },
+	{ "maxCoNum", CFG_REAL, CFG_FIELD(maxCoNum), "0.1",   1e-6,    1, "Maximum Courant number for timestepping stability" },
+	{ "extract",  CFG_LIST, CFG_FIELD(extract),  "",         0,    0, "Plane, box or coarsened volume written in-situ (see extract.c)" },
+	{ "iso",      CFG_LIST, CFG_FIELD(iso),      "",         0,    0, "Isosurface written in-situ (see isosurface.c)" },
+	{ "image",    CFG_LIST, CFG_FIELD(image),    "",         0,    0, "Image of a plane rendered in-situ (see render.c)" },
+	{ "probe",    CFG_LIST, CFG_FIELD(probe),    "",         0,    0, "Point, line or plane sampled in time (see probes.c)" },
+	{ "p_every",  CFG_INT,  CFG_FIELD(p_every),  "1",        1, 2e9, "Steps between probe samples" },
+	{ "p_buffer", CFG_INT,  CFG_FIELD(p_buffer), "256",      1, 1e6, "Probe records buffered between writes" },
+	{ "p_gather", CFG_INT,  CFG_FIELD(p_gather), "1",        0,    1, "1-all probes in \"probes.bin\", 0-\"probes.<id>.bin\" per process" },
+	{ "s_every",  CFG_INT,  CFG_FIELD(s_every),  "0",        0, 2e9, "Steps between samples of the running statistics (0-none)" },
+	{ "s_start",  CFG_INT,  CFG_FIELD(s_start),  "0",        0, 2e9, "First step sampled by the running statistics" },
+	{ "s_write",  CFG_INT,  CFG_FIELD(s_write),  "0",        0, 2e9, "Steps between writes of \"stats-<step>.snap\" (0-f_step)" },
+	{ "d_every",  CFG_INT,  CFG_FIELD(d_every),  "0",        0, 2e9, "Steps between thickness diagnostics to \"thickness.dat\" (0-none)" },
+	{ "station",  CFG_LIST, CFG_FIELD(station),  "",         0,    0, "x [m] of a station of the thickness diagnostics" },
+	{ "sp_every", CFG_INT,  CFG_FIELD(sp_every), "0",        0, 2e9, "Steps between samples of the spanwise spectra (0-none)" },
+	{ "sp_write", CFG_INT,  CFG_FIELD(sp_write), "0",        0, 2e9, "Steps between writes of \"spectra.dat\" (0-f_step)" },
+	{ "spectrum", CFG_LIST, CFG_FIELD(spectrum), "",         0,    0, "z-line of the spanwise spectra (see spectra.c)" },
+	{ "h_every",  CFG_INT,  CFG_FIELD(h_every),  "0",        0, 2e9, "Steps between samples of the histograms (0-none)" },
+	{ "h_write",  CFG_INT,  CFG_FIELD(h_write),  "0",        0, 2e9, "Steps between writes of \"<name>.hist\" (0-f_step)" },
+	{ "histogram",CFG_LIST, CFG_FIELD(histogram),"",         0,    0, "Histogram or joint PDF accumulated in-situ (see histograms.c)" },
+	{ "e_every",  CFG_INT,  CFG_FIELD(e_every),  "0",        0, 2e9, "Steps between evaluations of the snapshot triggers (0-none)" },
+	{ "e_vort",   CFG_REAL, CFG_FIELD(e_vort),   "0",        0, 1e30, "Frame when the maximum vorticity exceeds it [1/s] (0-off)" },
+	{ "e_kerate", CFG_REAL, CFG_FIELD(e_kerate), "0",        0, 1e30, "Frame when |dE/dt|/E of the kinetic energy exceeds it [1/s] (0-off)" },
+	{ "e_rhomin", CFG_REAL, CFG_FIELD(e_rhomin), "0",        0, 1e30, "Frame when the minimum density falls below it [kg/m3] (0-off)" },
+	{ "e_window", CFG_LIST, CFG_FIELD(e_window), "",         0,    0, "Time window t0:t1 [s] with a frame at every evaluation" },
+	{ "e_cooldown",CFG_INT, CFG_FIELD(e_cooldown),"10",      0, 2e9, "Least steps between two triggered frames" },
+	{ "v_every",  CFG_INT,  CFG_FIELD(v_every),  "0",        0, 2e9, "Steps between convergence checks of the statistics (0-none)" },
+	{ "v_checks", CFG_INT,  CFG_FIELD(v_checks), "3",        1, 1e6, "Checks in a row meeting all criteria to stop the run" },
+	{ "converge", CFG_LIST, CFG_FIELD(converge), "",         0,    0, "Convergence criterion of an averaged quantity (see convergence.c)" },
+	{ "i_mode",   CFG_INT,  CFG_FIELD(i_mode),   "0",        0,    1, "Inflow: 0-two streams with the random block, 1-planes of \"precursor.bin\"" },
+	{ "i_offset", CFG_REAL, CFG_FIELD(i_offset), "0",    -1e12, 1e12, "Time of the precursor at time 0 of the run [sec]" },
+	{ "i_loop",   CFG_INT,  CFG_FIELD(i_loop),   "1",        0,    1, "Past the last plane: 1-replay the planes, 0-hold the last one" },
+	{ "i_prefetch",CFG_INT, CFG_FIELD(i_prefetch),"8",       3, 1e5, "Planes read ahead by the reader thread" },
+	{ "i_record", CFG_REAL, CFG_FIELD(i_record), "-1",      -1, 1e12, "x [m] of the plane recorded to \"precursor.bin\" (<0-none)" },
+	{ "i_rec_every",CFG_INT,CFG_FIELD(i_rec_every),"1",      1, 2e9, "Steps between recorded planes" },
+	{ "o_mode",   CFG_INT,  CFG_FIELD(o_mode),   "0",        0,    1, "Outflow: 0-pressure fixed at 100000 Pa, 1-non-reflecting characteristic (LODI)" },
+	{ "o_pinf",   CFG_REAL, CFG_FIELD(o_pinf),   "100000.",  1, 1e12, "Pressure the characteristic outflow relaxes to [Pa]" },
+	{ "o_sigma",  CFG_REAL, CFG_FIELD(o_sigma),  "0.25",     0,  100, "Relaxation of the outflow pressure (0-perfectly non-reflecting)" },
+	{ "o_sponge", CFG_REAL, CFG_FIELD(o_sponge), "0",        0, 1e12, "Length [m] of the sponge zone before the outflow (0-none)" },
+	{ "o_damp",   CFG_REAL, CFG_FIELD(o_damp),   "6.",       0,  1e6, "Strength of the sponge: e-foldings of a sound wave crossing it" },
+	{ "o_tavg",   CFG_REAL, CFG_FIELD(o_tavg),   "0",        0, 1e12, "Time scale [sec] of the average the sponge relaxes to (0-20 passages of the sponge)" },
+	{ "a_every",  CFG_INT,  CFG_FIELD(a_every),  "0",        0, 2e9, "Steps between adaptations of the rows to the layer (0-fixed grid)" },
+	{ "a_ind",    CFG_INT,  CFG_FIELD(a_ind),    "0",        0,    1, "Indicator of the layer: 0-vorticity magnitude, 1-Q criterion" },
+	{ "a_thresh", CFG_REAL, CFG_FIELD(a_thresh), "0.05",  1e-6,    1, "Edge of the layer: fraction of the peak of the indicator" },
+	{ "a_frac",   CFG_REAL, CFG_FIELD(a_frac),   "0.5",   0.05,    1, "Fraction of the rows of each half in the band of the layer" },
+	{ "a_growth", CFG_REAL, CFG_FIELD(a_growth), "1.1",      1,    2, "Largest ratio of the heights of neighbouring rows outside the band" },
+	{ "r_every",  CFG_INT,  CFG_FIELD(r_every),  "0",        0, 2e9, "Steps between refinements of the blocks about the layer (0-none)" },
+	{ "r_block",  CFG_INT,  CFG_FIELD(r_block),  "4",        2,  64, "Base cells along a refined block" },
+	{ "r_ind",    CFG_INT,  CFG_FIELD(r_ind),    "0",        0,    1, "Indicator of the refinement: 0-vorticity magnitude, 1-Q criterion" },
+	{ "r_thresh", CFG_REAL, CFG_FIELD(r_thresh), "0.1",   1e-6,    1, "Blocks refined: fraction of the peak of the indicator" },
+	{ "r_max",    CFG_INT,  CFG_FIELD(r_max),    "0",        0, 2e9, "Most refined blocks per process, the strongest first (0-no limit)" },
+	{ NULL }
+};
+
+
+/*
+* cfgSet - Converts the text value and stores it in its field; returns 0 on success.
+*/
+static int cfgSet( const cfgEntry *e, const char *val, Config *c )
+{
+char *end;
+double v;
+
+	if( e->type == CFG_LIST ) {
+		CfgList *L = (CfgList *)( (char *)c + e->offset );
+		if( *val == '\0' ) return 0;                    /* empty default */
+		if( L->n == CFG_LIST_MAX || strlen( val ) >= CFG_LIST_LEN ) return 2;
+		strcpy( L->item[L->n++], val );
+		return 0;
+	}
+
+	if( e->type == CFG_INT ) v = (double)strtol( val, &end, 10 );
+	else                     v = strtod( val, &end );
+
+	while( isspace( (unsigned char)*end ) ) end++;
+	if( end == val || *end != '\0' ) return 1;         /* not a number or trailing text */
+	if( v < e->min || v > e->max )   return 2;         /* out of range */
+
+	if( e->type == CFG_INT ) *(int  *)( (char *)c + e->offset ) = (int)v;
+	else                     *(real *)( (char *)c + e->offset ) = (real)v;
+
+	return 0;
+} /* end cfgSet() */
+
+
+/*
+* cfgParse - Reads the file into Config; returns the number of errors found.
+*/
+static int cfgParse( const char *filename, Config *c )
+{
+FILE *pF;
+char line[256], *key, *val, *p;
+char seen[sizeof(cfgTable)/sizeof(cfgTable[0])];
+const cfgEntry *e;
+int nLine = 0, nErr = 0, rc;
+
+	if( ( pF = fopen( filename, "r" ) ) == NULL ) {
+		fprintf( stderr, "can't open \"%s\".\n", filename );
+		return 1;
+	}
+	memset( seen, 0, sizeof(seen) );
+
+	while( fgets( line, sizeof(line), pF ) != NULL ) {
+		nLine++;
+		// strip comment and trailing blanks
+		if( ( p = strchr( line, '#' ) ) != NULL ) *p = '\0';
+		for( p = line + strlen( line ); p > line && isspace( (unsigned char)p[-1] ); ) *--p = '\0';
+		for( key = line; isspace( (unsigned char)*key ); key++ );
+		if( *key == '\0' ) continue;
+
+		// split "key = value" (the '=' is optional)
+		for( p = key; *p && *p != '=' && !isspace( (unsigned char)*p ); p++ );
+		val = p;
+		while( isspace( (unsigned char)*val ) ) val++;
+		if( *val == '=' ) val++;
+		while( isspace( (unsigned char)*val ) ) val++;
+		*p = '\0';
+
+		for( e = cfgTable; e->key != NULL; e++ )
+			if( strcasecmp( e->key, key ) == 0 ) break;
+
+		if( e->key == NULL ) {
+			fprintf( stderr, "%s:%d: unknown key \"%s\".\n", filename, nLine, key );
+			nErr++; continue;
+		}
+		if( seen[e - cfgTable]++ && e->type != CFG_LIST ) {
+			fprintf( stderr, "%s:%d: \"%s\" is given more than once.\n", filename, nLine, e->key );
+			nErr++; continue;
+		}
+		if( ( rc = cfgSet( e, val, c ) ) == 2 && e->type == CFG_LIST ) {
+			fprintf( stderr, "%s:%d: more than %d \"%s\" keys or longer than %d characters.\n", filename, nLine,
+			         CFG_LIST_MAX, e->key, CFG_LIST_LEN - 1 );
+			nErr++;
+		}
+		else if( rc == 1 ) {
+			fprintf( stderr, "%s:%d: \"%s\" is not a valid %s for \"%s\".\n", filename, nLine,
+			         val, e->type == CFG_INT ? "integer" : "number", e->key );
+			nErr++;
+		}
+		else if( rc == 2 ) {
+			fprintf( stderr, "%s:%d: %s = %s is out of range [%g, %g].\n", filename, nLine,
+			         e->key, val, e->min, e->max );
+			nErr++;
+		}
+	}
+	fclose( pF );
+
+	// defaults for the keys left out
+	for( e = cfgTable; e->key != NULL; e++ ) {
+		if( seen[e - cfgTable] ) continue;
+		if( e->def == NULL ) {
+			fprintf( stderr, "%s: required key \"%s\" (%s) is missing.\n", filename, e->key, e->descr );
+			nErr++;
+		}
+		else cfgSet( e, e->def, c );
+	}
+
+	// checks involving several keys
+	if( nErr == 0 && c->BL_HIG > c->HIG/2 ) {
+		fprintf( stderr, "%s: BL_HIG = %d exceeds the upper half of the domain, HIG/2 = %d.\n",
+		         filename, c->BL_HIG, c->HIG/2 );
+		nErr++;
+	}
+	if( nErr == 0 && ( c->c_mtbf > 0. || c->c_every > 0 ) && c->b_format != 2 ) {
+		fprintf( stderr, "%s: periodic checkpoints (c_mtbf, c_every) are written as \"backup.chk\", set b_format = 2.\n", filename );
+		nErr++;
+	}
+	if( nErr == 0 && c->a_every > 0 && c->b_format != 2 ) {
+		fprintf( stderr, "%s: only \"backup.chk\" keeps the rows laid out by a_every, set b_format = 2.\n", filename );
+		nErr++;
+	}
+	if( nErr == 0 && c->r_every > 0 && c->a_every > 0 ) {
+		fprintf( stderr, "%s: the blocks refined by r_every can't go with the rows adapted by a_every.\n", filename );
+		nErr++;
+	}
+#ifndef USE_HDF5
+	if( c->f_format == 2 || c->b_format == 1 ) {
+		fprintf( stderr, "%s: HDF5 output requested, but mpi_layer2 is built without HDF5.\n", filename );
+		nErr++;
+	}
+#endif
+
+	return nErr;
+} /* end cfgParse() */
+
+
+void ReadConfig( const char *filename, int myid )
+{
+const cfgEntry *e;
+
+	if( 0 == myid ) {
+		memset( &config, 0, sizeof(config) );
+		if( cfgParse( filename, &config ) != 0 ) {
+			fprintf( stderr, "mpi_layer2: errors in \"%s\", terminating.\n", filename );
+			MPI_Abort( MPI_COMM_WORLD, 1 );
+		}
+		// report what the run is going to use
+		for( e = cfgTable; e->key != NULL; e++ ) {
+			if( e->type == CFG_LIST ) {
+				const CfgList *L = (const CfgList *)( (char *)&config + e->offset );
+				int n;
+				for( n = 0; n < L->n; n++ ) fprintf( stdout, "%-9s= %s\n", e->key, L->item[n] );
+			}
+			else if( e->type == CFG_INT )
+				fprintf( stdout, "%-9s= %d\n", e->key, *(int *)( (char *)&config + e->offset ) );
+			else
+				fprintf( stdout, "%-9s= %g\n", e->key, *(real *)( (char *)&config + e->offset ) );
+		}
+	}
+
+	//--- one broadcast for the whole set of parameters
+	MPI_Bcast( &config, sizeof(config), MPI_BYTE, 0, MPI_COMM_WORLD );
+
+} /* end ReadConfig() */
@@ -0,0 +1,103 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#define CFG_LIST_MAX 16   /* items of a repeatable key */
+#define CFG_LIST_LEN 160  /* characters of an item     */
+
+/*
+* CfgList - Values of a key that may be given several times, in file order.
+*/
+typedef struct {
+	int  n;
+	char item[CFG_LIST_MAX][CFG_LIST_LEN];
+} CfgList;
+
+/*
+* Config - All run parameters read from the keyed configuration file.
+* Plain data only: the root process fills it and sends it to all others
+* in a single broadcast.
+*/
+typedef struct {
+	int  LEN, HIG, DEP;             /* cell numbers in x-, y-, z-directions (LEN per process) */
+	real deltaX, deltaY, deltaZ;    /* cell spacings */
+	real g_x;                       /* growth of the cells downstream */
+	real g_y;                       /* clustering of the cells about the centre in y */
+	real deltaT;                    /* initial time step */
+	int  Answer;                    /* 1-continue, 0-start new */
+	int  numstep;                   /* overall number of time steps */
+	real mu_L, Pr_L, Pr_T, Cs;      /* transport coefficients */
+	int  BL_HIG;                    /* height of the random disturbing block */
+	real Ua, Va, Wa;                /* amplitudes of disturbed velocities */
+	int  Ns_min, Nst;               /* minimal period of disturbing block and its max-min */
+	int  f_step;                    /* frame taking step */
+	int  f_format;                  /* frame format: 0-Tecplot ASCII, 1-MPI-IO binary + XDMF, 2-HDF5, 3-binary Tecplot, 4-compressed */
+	int  b_format;                  /* backup format: 0-"backup.myid" files, 1-HDF5, 2-"backup.chk" */
+	real c_mtbf;                    /* mean time between failures, sets the checkpoint intervals */
+	int  c_every;                   /* steps between in-memory checkpoint copies, 0-automatic */
+	int  c_disk;                    /* in-memory copies per checkpoint on disk, 0-automatic */
+	int  f_async;                   /* 1-frames are written by a writer thread */
+	int  f_buffers;                 /* number of frames staged for the writer thread */
+	CfgList z_bound;                /* error bounds of compressed frames */
+	int  h5_deflate;                /* deflate level of HDF5 datasets, 0-no compression */
+	int  nStages;                   /* number of stages of Runge-Kutta algorithm */
+	real maxCoNum;                  /* maximum Courant number */
+	CfgList extract;                /* slices, boxes and coarsened volumes written in-situ */
+	CfgList iso;                    /* isosurfaces written in-situ */
+	CfgList image;                  /* colour-mapped images of planes rendered in-situ */
+	CfgList probe;                  /* points, lines and planes sampled in time */
+	int  p_every;                   /* steps between probe samples */
+	int  p_buffer;                  /* probe records buffered between writes */
+	int  p_gather;                  /* 1-single "probes.bin", 0-"probes.<id>.bin" per process */
+	int  s_every;                   /* steps between samples of the running statistics, 0-none */
+	int  s_start;                   /* first step sampled */
+	int  s_write;                   /* steps between writes of the statistics, 0-f_step */
+	int  d_every;                   /* steps between thickness diagnostics, 0-none */
+	CfgList station;                /* x-stations of the diagnostics */
+	int  sp_every;                  /* steps between samples of the spanwise spectra, 0-none */
+	int  sp_write;                  /* steps between writes of the spectra, 0-f_step */
+	CfgList spectrum;               /* z-lines of the spectra */
+	int  h_every;                   /* steps between samples of the histograms, 0-none */
+	int  h_write;                   /* steps between writes of the histograms, 0-f_step */
+	CfgList histogram;              /* histograms and joint PDFs */
+	int  e_every;                   /* steps between evaluations of the snapshot triggers, 0-none */
+	real e_vort;                    /* trigger: maximum vorticity magnitude above, 0-off */
+	real e_kerate;                  /* trigger: relative rate of the kinetic energy above, 0-off */
+	real e_rhomin;                  /* trigger: minimum density below, 0-off */
+	CfgList e_window;               /* trigger: time windows t0:t1 */
+	int  e_cooldown;                /* least steps between triggered frames */
+	int  v_every;                   /* steps between convergence checks, 0-none */
+	int  v_checks;                  /* checks in a row meeting the criteria to stop */
+	CfgList converge;               /* convergence criteria */
+	int  i_mode;                    /* inflow: 0-built-in streams, 1-planes of a precursor run */
+	real i_offset;                  /* time of the precursor at time 0 */
+	int  i_loop;                    /* 1-replay the planes periodically, 0-hold the last one */
+	int  i_prefetch;                /* planes read ahead */
+	real i_record;                  /* x of the recorded plane, <0-none */
+	int  i_rec_every;               /* steps between recorded planes */
+	int  o_mode;                    /* outflow: 0-fixed pressure, 1-non-reflecting characteristic */
+	real o_pinf;                    /* pressure the characteristic outflow relaxes to */
+	real o_sigma;                   /* relaxation of that pressure */
+	real o_sponge;                  /* length of the sponge zone, 0-none */
+	real o_damp;                    /* strength of the sponge */
+	real o_tavg;                    /* time scale of the average the sponge relaxes to, 0-automatic */
+	int  a_every;                   /* steps between adaptations of the rows, 0-fixed grid */
+	int  a_ind;                     /* indicator of the layer: 0-vorticity, 1-Q */
+	real a_thresh;                  /* edge of the layer, fraction of the peak of the indicator */
+	real a_frac;                    /* fraction of the rows in the band of the layer */
+	real a_growth;                  /* largest ratio of neighbouring rows outside the band */
+	int  r_every;                   /* steps between refinements of the blocks, 0-none */
+	int  r_block;                   /* base cells along a block */
+	int  r_ind;                     /* indicator of the layer: 0-vorticity, 1-Q */
+	real r_thresh;                  /* blocks refined, fraction of the peak of the indicator */
+	int  r_max;                     /* most refined blocks per process, 0-no limit */
+} Config;
+
+extern Config config;
+
+/*
+* ReadConfig - Root process parses and validates the keyed configuration file,
+* then the whole Config is broadcast at once. Any error aborts the run.
+*/
+void ReadConfig( const char *filename, int myid );
+
+#endif
@@ -0,0 +1,190 @@
+/*
+*  CONTROL
+*
+*  Run-control channel: stop, checkpoint-now and dump-now commands.
+*
+*  Commands reach the root process either as signals
+*      SIGINT, SIGTERM - stop,   SIGUSR1 - checkpoint,   SIGUSR2 - dump,
+*  or as characters written to "stopfile" ('s' - stop, 'c' - checkpoint, 'd' - dump,
+*  'g' - go on). The file is not polled every step: on Linux an inotify watch on the
+*  run directory tells the root process when "stopfile" was rewritten, elsewhere it
+*  is looked at only every CTRL_POLL_STEPS steps.
+*
+*  The decision is carried to all processes by a non-blocking broadcast started one
+*  step ahead, so it overlaps with the computation of a whole step and the step loop
+*  never waits on the root process or on the file system.
+*
+*/
+#include "mpi.h"
+#include <stdio.h>     /* printf() etc.*/
+#include <string.h>    /* strcmp()     */
+#include <signal.h>    /* signal()     */
+
+#ifdef __linux__
+#include <unistd.h>       /* read(), close() */
+#include <sys/inotify.h>  /* inotify_init1() */
+#endif
+
+#include "type.h"
+#include "def.h"      /* Definitions, parameters */
+#include "global.h"   /* global variables */
+
+#include "control.h"
+
+/* flags raised by the signal handler, consumed by the root process */
+static volatile sig_atomic_t sigStop, sigCheckpoint, sigDump;
+
+/* buffer and handle of the broadcast in flight */
+static int ctrlBuf;
+static MPI_Request ctrlReq = MPI_REQUEST_NULL;
+
+/* inotify descriptor, -1 if "stopfile" has to be polled */
+static int watchFd = -1;
+
+/* events on "stopfile" raised by its own resets, to be skipped */
+static int ownResets = 0;
+
+
+void termHandler( int sigType )
+{
+	switch( sigType ) {
+		case SIGUSR1: sigCheckpoint = 1; break;
+		case SIGUSR2: sigDump = 1;       break;
+		default:      sigStop = 1;       break;
+	}
+}
+
+
+/*
+* readStopfile - Reads the commands written to "stopfile" and resets it to "g".
+*/
+static int readStopfile( void )
+{
+FILE *pF;
+char a[8];
+int n, cmd = 0;
+
+	// opened for reading only, closing it raises no IN_CLOSE_WRITE
+	if( ( pF = fopen( "stopfile", "r" ) ) == NULL ) return 0;
+
+	n = fread( a, 1, sizeof(a), pF );
+	while( n-- > 0 ) {
+		switch( a[n] ) {
+			case 's': cmd |= CTRL_STOP;       break;
+			case 'c': cmd |= CTRL_CHECKPOINT; break;
+			case 'd': cmd |= CTRL_DUMP;       break;
+			default: break;
+		}
+	}
+	fclose( pF );
+
+	// the command is consumed, the whole file becomes "g"; the watch reports this write too
+	if( cmd && ( pF = fopen( "stopfile", "w" ) ) != NULL ) {
+		fputs( "g\n", pF );
+		fclose( pF );
+		if( watchFd >= 0 ) ownResets++;
+	}
+
+	return cmd;
+} /* end readStopfile() */
+
+
+/*
+* pollCommands - Root process gathers the commands pending since the last step.
+*/
+static int pollCommands( void )
+{
+int cmd = 0;
+
+	if( sigStop )       { sigStop = 0;       cmd |= CTRL_STOP; }
+	if( sigCheckpoint ) { sigCheckpoint = 0; cmd |= CTRL_CHECKPOINT; }
+	if( sigDump )       { sigDump = 0;       cmd |= CTRL_DUMP; }
+
+#ifdef __linux__
+	if( watchFd >= 0 ) {
+		char buf[4096];
+		struct inotify_event *ev;
+		ssize_t len, off;
+		int touched = 0;
+
+		// non-blocking: returns at once if nothing happened in the run directory
+		while( ( len = read( watchFd, buf, sizeof(buf) ) ) > 0 ) {
+			for( off = 0; off < len; off += sizeof(struct inotify_event) + ev->len ) {
+				ev = (struct inotify_event *)( buf + off );
+				if( ev->len && strcmp( ev->name, "stopfile" ) == 0 ) {
+					if( ownResets > 0 ) ownResets--;
+					else touched = 1;
+				}
+			}
+		}
+		if( touched ) cmd |= readStopfile();
+	}
+	else
+#endif
+	if( step % CTRL_POLL_STEPS == 0 ) cmd |= readStopfile();
+
+	if( cmd & CTRL_STOP )       fprintf( stdout, "Run control: stop requested.\n" );
+	if( cmd & CTRL_CHECKPOINT ) fprintf( stdout, "Run control: checkpoint requested.\n" );
+	if( cmd & CTRL_DUMP )       fprintf( stdout, "Run control: dump requested.\n" );
+
+	return cmd;
+} /* end pollCommands() */
+
+
+void RunControlInit( int myid )
+{
+	/*--- Every process handles the signals, mpirun may forward them to all ---*/
+	signal( SIGINT,  termHandler );
+	signal( SIGTERM, termHandler );
+	signal( SIGUSR1, termHandler );
+	signal( SIGUSR2, termHandler );
+
+	ctrlBuf = 0;
+	if( 0 == myid ) {
+		// a command left in "stopfile" before the start is honoured at the first step
+		ctrlBuf = readStopfile( );
+#ifdef __linux__
+		if( ( watchFd = inotify_init1( IN_NONBLOCK ) ) >= 0 &&
+		    inotify_add_watch( watchFd, ".", IN_CLOSE_WRITE | IN_MOVED_TO ) < 0 ) {
+			close( watchFd );
+			watchFd = -1;
+		}
+#endif
+		if( watchFd < 0 )
+			fprintf( stdout, "Run control: polling \"stopfile\" every %d steps.\n", CTRL_POLL_STEPS );
+	}
+
+	/*--- First broadcast ---*/
+	MPI_Ibcast( &ctrlBuf, 1, MPI_INT, 0, MPI_COMM_WORLD, &ctrlReq );
+
+} /* end RunControlInit() */
+
+
+int RunControlComplete( int myid )
+{
+int cmd;
+
+	/*--- Decision taken one step ago ---*/
+	MPI_Wait( &ctrlReq, MPI_STATUS_IGNORE );
+	cmd = ctrlBuf;
+
+	/*--- Start carrying the next one ---*/
+	if( 0 == myid ) ctrlBuf = pollCommands( );
+	MPI_Ibcast( &ctrlBuf, 1, MPI_INT, 0, MPI_COMM_WORLD, &ctrlReq );
+
+	if( cmd & CTRL_STOP ) continFlag = 0;
+
+	return cmd;
+} /* end RunControlComplete() */
+
+
+void RunControlFinalize( int myid )
+{
+	MPI_Wait( &ctrlReq, MPI_STATUS_IGNORE );
+
+#ifdef __linux__
+	if( watchFd >= 0 ) close( watchFd );
+	watchFd = -1;
+#endif
+
+} /* end RunControlFinalize() */
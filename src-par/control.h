@@ -0,0 +1,29 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+
+/*--- Run-control commands, combined as bit flags ---*/
+#define CTRL_STOP       1 /* finish the run after the current step     */
+#define CTRL_CHECKPOINT 2 /* write the backup now and keep on stepping */
+#define CTRL_DUMP       4 /* write a flowfield frame now               */
+
+/*--- Fallback polling period of "stopfile" (in steps) where inotify is unavailable ---*/
+#define CTRL_POLL_STEPS 100
+
+/*
+* RunControlInit - Installs signal handlers, sets up the "stopfile" watch on
+* the root process and starts the first non-blocking broadcast of commands.
+*/
+void RunControlInit( int myid );
+
+/*
+* RunControlComplete - Completes the broadcast started a step ahead, starts the
+* next one and returns the commands every process has to act upon now.
+*/
+int RunControlComplete( int myid );
+
+/*
+* RunControlFinalize - Completes the outstanding broadcast and releases the watch.
+*/
+void RunControlFinalize( int myid );
+
+#endif
@@ -0,0 +1,319 @@
+/*
+*  CONVERGENCE
+*
+*  Stops an averaging run once its statistics have converged. Every v_every steps
+*  each "converge" key of the configuration file is checked against its tolerance:
+*
+*      converge = u_f   tol=1e-3             change of a mean field per check,
+*      converge = Ruv   tol=5e-3
+*      converge = theta tol=0.02 batches=10  batch-means confidence interval.
+*
+*  A field of the running statistics (one of "rho" ... "k" of statistics.c)
+*  converges by its relative L2 change since the previous check, over the whole
+*  x-y plane. "theta" and "delta_w" take the samples of the thickness diagnostics
+*  since the start of the run, split into "batches" batches: the half-width of the
+*  95% confidence interval of their mean (Student t of the batch means), relative
+*  to the largest mean, the worst over the stations.
+*
+*  When all criteria are met at v_checks checks in a row, the run stops as if 's'
+*  was written to "stopfile", so the end of the run checkpoints it. Root appends a
+*  line per check to "convergence.dat" (step, time and the measure of every
+*  criterion) and the reason of the stop. The monitor keeps no history in the
+*  checkpoint: a continued run starts its checks afresh.
+*
+*/
+#include "mpi.h"
+#include <stdio.h>     /* printf() etc.*/
+#include <stdlib.h>    /* malloc()     */
+#include <string.h>    /* strtok_r()   */
+#include <math.h>      /* sqrt()       */
+
+#include "type.h"
+#include "def.h"      /* Definitions, parameters */
+#include "global.h"   /* global variables */
+#include "config.h"
+#include "statistics.h"  /* StatisticsField() */
+#include "diagnostics.h" /* DiagnosticsLatest() */
+
+#include "convergence.h"
+
+typedef struct {
+	char   name[32];
+	int    thick;          /* 0-field of the statistics, 1-theta, 2-delta_w */
+	double tol;
+	int    batches;
+	double *prev;          /* the field at the previous check [LEN][HIG] */
+	int    havePrev;
+	double measure;
+} Criterion;
+
+static Criterion cr[CFG_LIST_MAX];
+static int on = 0, nCr = 0, passed = 0;
+static double *field = NULL, *sums = NULL, *gsums = NULL;
+
+/* root: thickness samples [nSamp][nSt][2] */
+static double *series = NULL;
+static int nSamp = 0, maxSamp = 0, nSt = 0, lastTaken = -1;
+static FILE *pF = NULL;
+
+/* two-sided 97.5% quantiles of Student t, 1..30 degrees of freedom */
+static const double tq[30] = {
+	12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+	2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+	2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+
+
+/*
+* parseCriterion - Fills c from the text of a "converge" key; returns 0 on success.
+*/
+static int parseCriterion( const char *text, Criterion *c, int myid )
+{
+char line[CFG_LIST_LEN], *tok, *val, *end, *save;
+
+	c->tol = 0.; c->batches = 10; c->havePrev = 0; c->prev = NULL;
+	strcpy( line, text );
+	if( ( tok = strtok_r( line, " \t", &save ) ) == NULL || strchr( tok, '=' ) != NULL || strlen( tok ) >= sizeof(c->name) ) {
+		if( 0 == myid ) fprintf( stderr, "converge \"%s\": the quantity must come first.\n", text );
+		return 1;
+	}
+	strcpy( c->name, tok );
+	c->thick = strcmp( tok, "theta" ) == 0 ? 1 : strcmp( tok, "delta_w" ) == 0 ? 2 : 0;
+
+	while( ( tok = strtok_r( NULL, " \t", &save ) ) != NULL ) {
+		if( ( val = strchr( tok, '=' ) ) == NULL ) goto bad;
+		*val++ = '\0';
+		if( strcmp( tok, "tol" ) == 0 ) {
+			if( ( c->tol = strtod( val, &end ) ) <= 0. || *end != '\0' ) goto bad;
+		}
+		else if( strcmp( tok, "batches" ) == 0 && c->thick ) {
+			if( ( c->batches = strtol( val, &end, 10 ) ) < 2 || *end != '\0' ) goto bad;
+		}
+		else goto bad;
+	}
+	if( c->tol <= 0. ) {
+		if( 0 == myid ) fprintf( stderr, "converge \"%s\": needs tol.\n", text );
+		return 1;
+	}
+	if( c->thick && config.d_every <= 0 ) {
+		if( 0 == myid ) fprintf( stderr, "converge \"%s\": needs the thickness diagnostics, d_every > 0.\n", text );
+		return 1;
+	}
+	if( !c->thick && ( StatisticsCount( ) == 0 || StatisticsField( c->name, field ) < 0 ) ) {
+		if( 0 == myid ) fprintf( stderr, "converge \"%s\": not a field of the running statistics (s_every > 0).\n", text );
+		return 1;
+	}
+	return 0;
+
+bad:
+	if( 0 == myid ) fprintf( stderr, "converge \"%s\": bad \"%s\".\n", text, tok );
+	return 1;
+} /* end parseCriterion() */
+
+
+/*
+* keepLines - Rewrites "convergence.dat" with the lines up to the current step.
+*/
+static void keepLines( void )
+{
+FILE *in, *out;
+char line[1024];
+long s;
+
+	if( ( in = fopen( "convergence.dat", "r" ) ) == NULL ) return;
+	if( ( out = fopen( "convergence.dat.tmp", "w" ) ) == NULL ) { fclose( in ); return; }
+	while( fgets( line, sizeof(line), in ) != NULL ) {
+		if( line[0] != '#' && sscanf( line, "%ld", &s ) == 1 && s > (long)step ) break;
+		fputs( line, out );
+	}
+	fclose( in ); fclose( out );
+	if( rename( "convergence.dat.tmp", "convergence.dat" ) != 0 )
+		fprintf( stderr, "can't rename \"convergence.dat.tmp\".\n" );
+
+} /* end keepLines() */
+
+
+void ConvergenceInit( int myid )
+{
+int n, nErr = 0;
+
+	on = ( config.v_every > 0 && config.converge.n > 0 );
+	if( !on ) return;
+
+	field = (double *)malloc( (size_t)LEN * HIG * sizeof(double) );
+	sums  = (double *)malloc( 2 * CFG_LIST_MAX * sizeof(double) );
+	gsums = (double *)malloc( 2 * CFG_LIST_MAX * sizeof(double) );
+	if( field == NULL || sums == NULL || gsums == NULL ) {
+		fprintf( stderr, "mpi_layer2: can't allocate memory for the convergence checks.\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+
+	// every process parses the same broadcast text
+	for( n = 0; n < config.converge.n; n++ )
+		nErr += parseCriterion( config.converge.item[n], &cr[n], myid );
+	if( nErr ) MPI_Abort( MPI_COMM_WORLD, 1 );
+	nCr = config.converge.n;
+
+	for( n = 0; n < nCr; n++ )
+		if( !cr[n].thick && ( cr[n].prev = (double *)malloc( (size_t)LEN * HIG * sizeof(double) ) ) == NULL ) {
+			fprintf( stderr, "mpi_layer2: can't allocate memory for the convergence checks.\n" );
+			MPI_Abort( MPI_COMM_WORLD, 1 );
+		}
+
+	if( 0 == myid ) {
+		if( Answer ) keepLines( );
+		if( ( pF = fopen( "convergence.dat", Answer ? "a" : "w" ) ) == NULL ) {
+			fprintf( stderr, "mpi_layer2: can't open \"convergence.dat\".\n" );
+			MPI_Abort( MPI_COMM_WORLD, 1 );
+		}
+		if( ftell( pF ) == 0 ) {
+			fprintf( pF, "# step time, then the measure of" );
+			for( n = 0; n < nCr; n++ ) fprintf( pF, " %s (tol %g)", cr[n].name, cr[n].tol );
+			fprintf( pF, "\n" );
+		}
+		fprintf( stdout, "Convergence: %d criteria checked every %d steps, stop after %d checks in a row.\n",
+		         nCr, config.v_every, config.v_checks );
+	}
+
+} /* end ConvergenceInit() */
+
+
+/*
+* takeSample - Root appends the thicknesses of the diagnostics sampled at this step.
+*/
+static void takeSample( void )
+{
+const double *q;
+int n, s;
+
+	if( ( s = DiagnosticsLatest( &q, &n ) ) != (int)step || s == lastTaken ) return;
+	lastTaken = s;
+	if( nSamp == maxSamp ) {
+		maxSamp = maxSamp ? 2 * maxSamp : 256;
+		if( ( series = (double *)realloc( series, (size_t)maxSamp * n * 2 * sizeof(double) ) ) == NULL ) {
+			fprintf( stderr, "mpi_layer2: can't allocate memory for the convergence checks.\n" );
+			MPI_Abort( MPI_COMM_WORLD, 1 );
+		}
+	}
+	nSt = n;
+	for( s = 0; s < n; s++ ) {
+		series[( (size_t)nSamp * n + s ) * 2]     = q[3*s];
+		series[( (size_t)nSamp * n + s ) * 2 + 1] = q[3*s+1];
+	}
+	nSamp++;
+
+} /* end takeSample() */
+
+
+/*
+* batchMeans - Relative half-width of the 95% confidence interval of the mean of quantity q
+* (0-theta, 1-delta_w) by nb batch means, the worst of the stations; HUGE_VAL if too few samples.
+*/
+static double batchMeans( int q, int nb )
+{
+int len = nSamp / nb, first = nSamp - nb * len, b, s, m;
+double hw = 0., big = 0., mean, var, bm, d;
+
+	if( len < 1 || nSt == 0 ) return HUGE_VAL;
+	for( s = 0; s < nSt; s++ ) {
+		mean = var = 0.;
+		for( b = 0; b < nb; b++ ) {
+			for( bm = 0., m = 0; m < len; m++ )
+				bm += series[( (size_t)( first + b * len + m ) * nSt + s ) * 2 + q];
+			bm /= len;
+			// Welford over the batch means
+			d = bm - mean;
+			mean += d / ( b + 1 );
+			var += d * ( bm - mean );
+		}
+		var /= nb - 1;
+		bm = ( nb - 1 <= 30 ? tq[nb-2] : 1.96 ) * sqrt( var / nb );
+		if( bm > hw ) hw = bm;
+		if( fabs( mean ) > big ) big = fabs( mean );
+	}
+	return big > 0. ? hw / big : HUGE_VAL;
+
+} /* end batchMeans() */
+
+
+/****************
+*  CONVERGENCE  *   Checks the criteria every v_every steps; 1 on every process when the run has to stop
+****************/
+int Convergence( int myid )
+{
+size_t LH = (size_t)LEN * HIG, c;
+int n, np = 0, all, stop = 0;
+double d;
+
+	if( !on ) return 0;
+
+	if( 0 == myid ) takeSample( );
+	if( step % config.v_every ) return 0;
+
+	//--- changes of the mean fields, all sums in one reduction
+	for( n = 0; n < nCr; n++ ) {
+		if( cr[n].thick ) continue;
+		sums[2*np] = sums[2*np+1] = 0.;
+		if( StatisticsField( cr[n].name, field ) > 0 ) {
+			for( c = 0; c < LH; c++ ) {
+				d = field[c] - cr[n].prev[c];
+				sums[2*np]   += d * d;
+				sums[2*np+1] += field[c] * field[c];
+			}
+			if( !cr[n].havePrev ) sums[2*np] = HUGE_VAL;
+			memcpy( cr[n].prev, field, LH * sizeof(double) );
+			cr[n].havePrev = 1;
+		}
+		else sums[2*np] = HUGE_VAL;
+		np++;
+	}
+	if( np ) MPI_Reduce( sums, gsums, 2 * np, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD );
+
+	//--- root decides for all
+	if( 0 == myid ) {
+		for( all = 1, np = 0, n = 0; n < nCr; n++ ) {
+			if( cr[n].thick ) cr[n].measure = batchMeans( cr[n].thick - 1, cr[n].batches );
+			else {
+				cr[n].measure = gsums[2*np+1] > 0. ? sqrt( gsums[2*np] / gsums[2*np+1] ) : HUGE_VAL;
+				np++;
+			}
+			if( !( cr[n].measure < cr[n].tol ) ) all = 0;
+		}
+		passed = all ? passed + 1 : 0;
+		stop = ( passed >= config.v_checks );
+
+		fprintf( pF, "%d %.9g", step, totalTime );
+		for( n = 0; n < nCr; n++ ) fprintf( pF, " %.6g", cr[n].measure );
+		fprintf( pF, "\n" );
+		if( stop ) {
+			fprintf( pF, "# stopped at step %d, all criteria met at %d checks in a row:", step, passed );
+			for( n = 0; n < nCr; n++ ) fprintf( pF, " %s %.3g < %g", cr[n].name, cr[n].measure, cr[n].tol );
+			fprintf( pF, "\n" );
+			fflush( pF );
+			fprintf( stdout, "Convergence: all criteria met at %d checks in a row, the run stops at step %d.\n", passed, step );
+		}
+	}
+	MPI_Bcast( &stop, 1, MPI_INT, 0, MPI_COMM_WORLD );
+	return stop;
+
+} /* end Convergence() */
+
+
+void ConvergenceFlush( void )
+{
+	if( pF != NULL ) fflush( pF );
+}
+
+
+void ConvergenceFinalize( int myid )
+{
+int n;
+
+	if( !on ) return;
+
+	if( pF != NULL ) fclose( pF );
+	pF = NULL;
+	for( n = 0; n < nCr; n++ ) free( cr[n].prev );
+	free( field ); free( sums ); free( gsums ); free( series );
+	field = sums = gsums = series = NULL;
+
+} /* end ConvergenceFinalize() */
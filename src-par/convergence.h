@@ -0,0 +1,23 @@
+#ifndef CONVERGENCE_H
+#define CONVERGENCE_H
+
+/*
+* ConvergenceInit - Parses the "converge" keys (v_every > 0), root opens "convergence.dat".
+* Called after StatisticsInit() and DiagnosticsInit().
+*/
+void ConvergenceInit( int myid );
+
+/*
+* Convergence - Called every step, after Statistics() and Diagnostics(): checks the criteria
+* every v_every steps; returns 1 on every process when they are met and the run has to stop.
+*/
+int Convergence( int myid );
+
+/*
+* ConvergenceFlush - Writes out the lines of "convergence.dat" still buffered.
+*/
+void ConvergenceFlush( void );
+
+void ConvergenceFinalize( int myid );
+
+#endif
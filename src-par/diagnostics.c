@@ -0,0 +1,211 @@
+/*
+*  DIAGNOSTICS
+*
+*  Integral thicknesses of the shear layer at x-stations, every d_every steps. Each
+*  "station" key of the configuration file gives one station x [m] (by default ten,
+*  evenly along the length); the process owning its column of cells averages rho
+*  and rho*u over z into the Favre profile u(y) = <rho u>/<rho>, with the free
+*  streams U1, U2 taken at the upper and lower boundary, dU = U1 - U2, and reduces
+*  it to
+*
+*      theta   = int <rho> (U1 - u)(u - U2) dy / ( rho0 dU^2 ),  momentum thickness,
+*                rho0 the mean of the free-stream densities,
+*      delta_w = |dU| / max |du/dy|,                         vorticity thickness,
+*
+*  and the growth rate d(theta)/dt since the previous sample. The root process
+*  appends a line per sample to "thickness.dat": step, time, then theta, delta_w
+*  and d(theta)/dt of every station. A continued run (Answer = 1) keeps the lines
+*  up to the step it starts from.
+*
+*/
+#include "mpi.h"
+#include <stdio.h>     /* printf() etc.*/
+#include <stdlib.h>    /* malloc()     */
+#include <string.h>    /* strtod()     */
+#include <math.h>      /* fabs()       */
+
+#include "type.h"
+#include "def.h"      /* Definitions, parameters */
+#include "global.h"   /* global variables */
+#include "config.h"
+#include "grid.h"     /* GridCell(), spacing */
+
+#include "diagnostics.h"
+
+#define DG_DEFAULT 10      /* stations without "station" keys */
+#define DG_NQ 3            /* theta, delta_w, d(theta)/dt */
+
+static int on = 0, nSt = 0;
+static double xSt[CFG_LIST_MAX > DG_DEFAULT ? CFG_LIST_MAX : DG_DEFAULT];
+static int iSt[CFG_LIST_MAX > DG_DEFAULT ? CFG_LIST_MAX : DG_DEFAULT];   /* local column, 0 if not here */
+static double *loc = NULL, *glob = NULL, *prof = NULL;
+static double prevTheta[CFG_LIST_MAX > DG_DEFAULT ? CFG_LIST_MAX : DG_DEFAULT], prevTime = -1.;
+static int lastStep = -1;
+static FILE *pF = NULL;
+
+
+/*
+* keepLines - Rewrites "thickness.dat" with the lines up to the current step.
+*/
+static void keepLines( void )
+{
+FILE *in, *out;
+char line[4096];
+long s;
+
+	if( ( in = fopen( "thickness.dat", "r" ) ) == NULL ) return;
+	if( ( out = fopen( "thickness.dat.tmp", "w" ) ) == NULL ) { fclose( in ); return; }
+	while( fgets( line, sizeof(line), in ) != NULL ) {
+		if( line[0] != '#' && sscanf( line, "%ld", &s ) == 1 && s > (long)step ) break;
+		fputs( line, out );
+	}
+	fclose( in ); fclose( out );
+	if( rename( "thickness.dat.tmp", "thickness.dat" ) != 0 )
+		fprintf( stderr, "can't rename \"thickness.dat.tmp\".\n" );
+
+} /* end keepLines() */
+
+
+void DiagnosticsInit( int myid )
+{
+int numprocs, n, I, nErr = 0;
+char *end;
+double len;
+
+	on = ( config.d_every > 0 );
+	if( !on ) return;
+
+	MPI_Comm_size( MPI_COMM_WORLD, &numprocs );
+	len = GridFace( 0, LEN * numprocs );
+
+	if( config.station.n > 0 ) {
+		for( n = 0; n < config.station.n; n++ ) {
+			xSt[n] = strtod( config.station.item[n], &end );
+			if( *end != '\0' || xSt[n] < 0. || xSt[n] > len ) {
+				if( 0 == myid ) fprintf( stderr, "station \"%s\": not an x within 0..%g m.\n", config.station.item[n], len );
+				nErr++;
+			}
+		}
+		if( nErr ) MPI_Abort( MPI_COMM_WORLD, 1 );
+		nSt = config.station.n;
+	}
+	else {
+		for( n = 0; n < DG_DEFAULT; n++ ) xSt[n] = ( n + 0.5 ) * len / DG_DEFAULT;
+		nSt = DG_DEFAULT;
+	}
+
+	//--- columns of the stations on _this_ process
+	for( n = 0; n < nSt; n++ ) {
+		I = GridCell( 0, xSt[n] );
+		iSt[n] = ( I / (int)LEN == myid ) ? I - myid * LEN + 1 : 0;
+		prevTheta[n] = 0.;
+	}
+
+	loc  = (double *)malloc( DG_NQ * nSt * sizeof(double) );
+	glob = (double *)malloc( DG_NQ * nSt * sizeof(double) );
+	prof = (double *)malloc( 2 * HIG * sizeof(double) );
+	if( loc == NULL || glob == NULL || prof == NULL ) {
+		fprintf( stderr, "mpi_layer2: can't allocate memory for diagnostics.\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+
+	if( 0 == myid ) {
+		if( Answer ) keepLines( );
+		if( ( pF = fopen( "thickness.dat", Answer ? "a" : "w" ) ) == NULL ) {
+			fprintf( stderr, "mpi_layer2: can't open \"thickness.dat\".\n" );
+			MPI_Abort( MPI_COMM_WORLD, 1 );
+		}
+		if( ftell( pF ) == 0 ) {
+			fprintf( pF, "# step time, then theta delta_w dtheta/dt [m, m, m/s] at x =" );
+			for( n = 0; n < nSt; n++ ) fprintf( pF, " %g", xSt[n] );
+			fprintf( pF, "\n" );
+		}
+		fprintf( stdout, "Diagnostics: thicknesses at %d stations every %d steps to \"thickness.dat\".\n", nSt, config.d_every );
+	}
+
+} /* end DiagnosticsInit() */
+
+
+/*
+* station - Thicknesses of the layer at the local column i.
+*/
+static void station( unsigned i, double *theta, double *deltaW )
+{
+double *rho = prof, *u = prof + HIG, Uhi, Ulo, dU, rho0, g, gmax = 0.;
+unsigned j, k;
+
+	for( j = 1; j < HIGG; j++ ) {
+		double r = 0., ru = 0.;
+		for( k = 1; k < DEPP; k++ ) { r += U1[i][j][k]; ru += U2[i][j][k]; }
+		rho[j-1] = r / DEP;
+		u[j-1]   = ru / r;
+	}
+	Uhi = u[HIG-1]; Ulo = u[0]; dU = Uhi - Ulo;
+	rho0 = 0.5 * ( rho[0] + rho[HIG-1] );
+
+	*theta = 0.;
+	for( j = 0; j < HIG; j++ ) *theta += rho[j] * ( Uhi - u[j] ) * ( u[j] - Ulo ) * dY[j+1];
+	*theta = dU != 0. ? *theta / ( rho0 * dU * dU ) : 0.;
+
+	for( j = 0; j + 1 < HIG; j++ ) {
+		g = fabs( u[j+1] - u[j] ) * _dY[j+1];
+		if( g > gmax ) gmax = g;
+	}
+	*deltaW = gmax > 0. ? fabs( dU ) / gmax : 0.;
+
+} /* end station() */
+
+
+/****************
+*  DIAGNOSTICS  *   Thicknesses of the layer at the stations, every d_every steps
+****************/
+void Diagnostics( int myid )
+{
+int n;
+
+	if( !on || step % config.d_every ) return;
+
+	memset( loc, 0, DG_NQ * nSt * sizeof(double) );
+	for( n = 0; n < nSt; n++ )
+		if( iSt[n] ) station( iSt[n], &loc[DG_NQ*n], &loc[DG_NQ*n+1] );
+	MPI_Reduce( loc, glob, DG_NQ * nSt, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD );
+
+	if( 0 == myid ) {
+		fprintf( pF, "%d %.9g", step, totalTime );
+		for( n = 0; n < nSt; n++ ) {
+			glob[DG_NQ*n+2] = prevTime >= 0. && totalTime > prevTime ?
+			                  ( glob[DG_NQ*n] - prevTheta[n] ) / ( totalTime - prevTime ) : 0.;
+			prevTheta[n] = glob[DG_NQ*n];
+			fprintf( pF, " %.6g %.6g %.6g", glob[DG_NQ*n], glob[DG_NQ*n+1], glob[DG_NQ*n+2] );
+		}
+		fprintf( pF, "\n" );
+		prevTime = totalTime;
+	}
+	lastStep = step;
+
+} /* end Diagnostics() */
+
+
+int DiagnosticsLatest( const double **q, int *n )
+{
+	*q = glob; *n = nSt;
+	return on ? lastStep : -1;
+}
+
+
+void DiagnosticsFlush( void )
+{
+	if( pF != NULL ) fflush( pF );
+}
+
+
+void DiagnosticsFinalize( int myid )
+{
+	if( !on ) return;
+
+	if( pF != NULL ) fclose( pF );
+	pF = NULL;
+	free( loc ); free( glob ); free( prof );
+	loc = glob = prof = NULL;
+
+} /* end DiagnosticsFinalize() */
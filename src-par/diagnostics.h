@@ -0,0 +1,27 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+/*
+* DiagnosticsInit - Resolves the stations (d_every > 0), root opens "thickness.dat".
+*/
+void DiagnosticsInit( int myid );
+
+/*
+* Diagnostics - Thicknesses of the layer at the stations every d_every steps, a line of "thickness.dat".
+*/
+void Diagnostics( int myid );
+
+/*
+* DiagnosticsLatest - theta, delta_w and d(theta)/dt [n][3] of the last sample, valid on root;
+* returns its step, -1 if there is none.
+*/
+int DiagnosticsLatest( const double **q, int *n );
+
+/*
+* DiagnosticsFlush - Writes out the lines of "thickness.dat" still buffered.
+*/
+void DiagnosticsFlush( void );
+
+void DiagnosticsFinalize( int myid );
+
+#endif
@@ -0,0 +1,196 @@
+/*
+*  EVENTS
+*
+*  Event-triggered snapshots. Every e_every steps three global quantities are
+*  reduced at once (a single MPI_Allreduce with an operation of its own): the
+*  maximum vorticity magnitude, the minimum density and the kinetic energy of the
+*  whole domain. A frame is taken, besides the periodic ones of f_step, when
+*
+*      e_vort   > 0  and the maximum vorticity exceeds it          [1/s],
+*      e_kerate > 0  and |dE/dt| / E since the previous evaluation  [1/s] exceeds it,
+*      e_rhomin > 0  and the minimum density falls below it        [kg/m3],
+*      the time is within one of the "e_window = t0:t1" keys        [s],
+*
+*  but never sooner than e_cooldown steps after the previous triggered one. Root
+*  appends a line per triggered frame to "events.dat": step, time, the reason and
+*  the three quantities. A continued run (Answer = 1) keeps the lines up to the
+*  step it starts from.
+*
+*/
+#include "mpi.h"
+#include <stdio.h>     /* printf() etc.*/
+#include <stdlib.h>    /* strtod()     */
+#include <string.h>    /* strcat()     */
+#include <math.h>      /* fabs()       */
+
+#include "type.h"
+#include "def.h"      /* Definitions, parameters */
+#include "global.h"   /* global variables */
+#include "config.h"
+#include "output.h"   /* CellValues() */
+
+#include "events.h"
+
+#define EV_NQ 3      /* max vorticity, max of -rho, kinetic energy */
+
+static int on = 0, nWin = 0, last = -1;
+static double win[CFG_LIST_MAX][2];
+static double prevKE = 0., prevTime = -1.;
+static MPI_Datatype evType;
+static MPI_Op evOp;
+static FILE *pF = NULL;
+
+
+/*
+* evReduce - Maxima of the first two quantities and sum of the kinetic energy, element-wise.
+*/
+static void evReduce( void *in, void *inout, int *len, MPI_Datatype *type )
+{
+double *a = (double *)in, *b = (double *)inout;
+int n;
+
+	(void)type;
+	for( n = 0; n < *len; n++, a += EV_NQ, b += EV_NQ ) {
+		if( a[0] > b[0] ) b[0] = a[0];
+		if( a[1] > b[1] ) b[1] = a[1];
+		b[2] += a[2];
+	}
+} /* end evReduce() */
+
+
+/*
+* keepLines - Rewrites "events.dat" with the lines up to the current step.
+*/
+static void keepLines( void )
+{
+FILE *in, *out;
+char line[512];
+long s;
+
+	if( ( in = fopen( "events.dat", "r" ) ) == NULL ) return;
+	if( ( out = fopen( "events.dat.tmp", "w" ) ) == NULL ) { fclose( in ); return; }
+	while( fgets( line, sizeof(line), in ) != NULL ) {
+		if( line[0] != '#' && sscanf( line, "%ld", &s ) == 1 && s > (long)step ) break;
+		fputs( line, out );
+	}
+	fclose( in ); fclose( out );
+	if( rename( "events.dat.tmp", "events.dat" ) != 0 )
+		fprintf( stderr, "can't rename \"events.dat.tmp\".\n" );
+
+} /* end keepLines() */
+
+
+void EventsInit( int myid )
+{
+int n, nErr = 0;
+char *end;
+
+	on = ( config.e_every > 0 );
+	if( !on ) return;
+
+	for( n = 0; n < config.e_window.n; n++ ) {
+		win[n][0] = strtod( config.e_window.item[n], &end );
+		win[n][1] = *end == ':' ? strtod( end + 1, &end ) : -HUGE_VAL;
+		if( *end != '\0' || win[n][1] < win[n][0] ) {
+			if( 0 == myid ) fprintf( stderr, "e_window \"%s\": not a t0:t1 window.\n", config.e_window.item[n] );
+			nErr++;
+		}
+	}
+	if( nErr ) MPI_Abort( MPI_COMM_WORLD, 1 );
+	nWin = config.e_window.n;
+
+	MPI_Type_contiguous( EV_NQ, MPI_DOUBLE, &evType );
+	MPI_Type_commit( &evType );
+	MPI_Op_create( evReduce, 1, &evOp );
+
+	if( 0 == myid ) {
+		if( Answer ) keepLines( );
+		if( ( pF = fopen( "events.dat", Answer ? "a" : "w" ) ) == NULL ) {
+			fprintf( stderr, "mpi_layer2: can't open \"events.dat\".\n" );
+			MPI_Abort( MPI_COMM_WORLD, 1 );
+		}
+		if( ftell( pF ) == 0 )
+			fprintf( pF, "# step time reason max_vorticity[1/s] min_rho[kg/m3] kinetic_energy[J]\n" );
+		fprintf( stdout, "Events: evaluated every %d steps, %d time windows, cooldown %d steps.\n",
+		         config.e_every, nWin, config.e_cooldown );
+	}
+
+} /* end EventsInit() */
+
+
+/***********
+*  EVENTS  *   Evaluates the triggers every e_every steps; 1 if a frame is due
+***********/
+int Events( int myid )
+{
+Frame now;
+real v[OUT_NVARS];
+double q[EV_NQ], g[EV_NQ], rate = 0.;
+char reason[64];
+unsigned i, j, k;
+int n;
+
+	if( !on || step % config.e_every ) return 0;
+
+	//--- local part of the three quantities
+	q[0] = 0.; q[1] = -HUGE_VAL; q[2] = 0.;
+	if( config.e_vort > 0. ) CurrentFrame( &now );
+	for( i = 1; i < LENN; i++ )
+		for( j = 1; j < HIGG; j++ )
+			for( k = 1; k < DEPP; k++ ) {
+				if( -U1[i][j][k] > q[1] ) q[1] = -U1[i][j][k];
+				q[2] += 0.5 * ( U2[i][j][k] * U2[i][j][k] + U3[i][j][k] * U3[i][j][k]
+				              + U4[i][j][k] * U4[i][j][k] ) / U1[i][j][k] * dX[i] * dY[j];
+				if( config.e_vort > 0. ) {
+					CellValues( &now, i, j, k, myid, v );
+					if( v[9] > q[0] ) q[0] = v[9];
+				}
+			}
+	q[2] *= deltaZ;
+
+	MPI_Allreduce( q, g, 1, evType, evOp, MPI_COMM_WORLD );
+	g[1] = -g[1];
+
+	if( prevTime >= 0. && totalTime > prevTime && g[2] > 0. )
+		rate = fabs( g[2] - prevKE ) / ( totalTime - prevTime ) / g[2];
+	prevKE = g[2]; prevTime = totalTime;
+
+	//--- the same decision on every process
+	reason[0] = '\0';
+	if( config.e_vort   > 0. && g[0] > config.e_vort )   strcat( reason, "vorticity," );
+	if( config.e_kerate > 0. && rate > config.e_kerate ) strcat( reason, "ke_rate," );
+	if( config.e_rhomin > 0. && g[1] < config.e_rhomin ) strcat( reason, "rho_min," );
+	for( n = 0; n < nWin; n++ )
+		if( totalTime >= win[n][0] && totalTime <= win[n][1] ) { strcat( reason, "window," ); break; }
+	if( reason[0] == '\0' || ( last >= 0 && (int)step - last < config.e_cooldown ) ) return 0;
+
+	last = step;
+	reason[strlen( reason ) - 1] = '\0';
+	if( 0 == myid ) {
+		fprintf( pF, "%d %.9g %s ", step, totalTime, reason );
+		if( config.e_vort > 0. ) fprintf( pF, "%.6g", g[0] );
+		else fprintf( pF, "-" );   /* not evaluated */
+		fprintf( pF, " %.6g %.6g\n", g[1], g[2] );
+		fprintf( stdout, "Event (%s) at step %d: frame taken.\n", reason, step );
+	}
+	return 1;
+
+} /* end Events() */
+
+
+void EventsFlush( void )
+{
+	if( pF != NULL ) fflush( pF );
+}
+
+
+void EventsFinalize( int myid )
+{
+	if( !on ) return;
+
+	if( pF != NULL ) fclose( pF );
+	pF = NULL;
+	MPI_Op_free( &evOp );
+	MPI_Type_free( &evType );
+
+} /* end EventsFinalize() */
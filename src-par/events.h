@@ -0,0 +1,21 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+/*
+* EventsInit - Parses the time windows (e_every > 0), root opens "events.dat".
+*/
+void EventsInit( int myid );
+
+/*
+* Events - Evaluates the triggers every e_every steps; returns 1 on every process when a frame is due.
+*/
+int Events( int myid );
+
+/*
+* EventsFlush - Writes out the lines of "events.dat" still buffered.
+*/
+void EventsFlush( void );
+
+void EventsFinalize( int myid );
+
+#endif
@@ -42,24 +42,24 @@ void Evolution_threeStage_TVD_RK( int Stage ){
 			for( k = 1, _k = 0; k < DEPP; k++, _k++ ) {
 
 				U1p[i][j][k] = U1[i][j][k] 
-				               + deltaT_X * ( Fx1[_i][_j][_k] - Fx1[i][_j][_k] )
-							   + deltaT_Y * ( Fy1[_i][_j][_k] - Fy1[_i][j][_k] )
+				               + dtX[i] * ( Fx1[_i][_j][_k] - Fx1[i][_j][_k] )
+							   + dtY[j] * ( Fy1[_i][_j][_k] - Fy1[_i][j][_k] )
 							   + deltaT_Z * ( Fz1[_i][_j][_k] - Fz1[_i][_j][k] );
 				U2p[i][j][k] = U2[i][j][k] 
-				               + deltaT_X * ( Fx2[_i][_j][_k] - Fx2[i][_j][_k] )
-							   + deltaT_Y * ( Fy2[_i][_j][_k] - Fy2[_i][j][_k] )
+				               + dtX[i] * ( Fx2[_i][_j][_k] - Fx2[i][_j][_k] )
+							   + dtY[j] * ( Fy2[_i][_j][_k] - Fy2[_i][j][_k] )
 							   + deltaT_Z * ( Fz2[_i][_j][_k] - Fz2[_i][_j][k] );
 				U3p[i][j][k] = U3[i][j][k] 
-				               + deltaT_X * ( Fx3[_i][_j][_k] - Fx3[i][_j][_k] )
-							   + deltaT_Y * ( Fy3[_i][_j][_k] - Fy3[_i][j][_k] )
+				               + dtX[i] * ( Fx3[_i][_j][_k] - Fx3[i][_j][_k] )
+							   + dtY[j] * ( Fy3[_i][_j][_k] - Fy3[_i][j][_k] )
 							   + deltaT_Z * ( Fz3[_i][_j][_k] - Fz3[_i][_j][k] );
 				U4p[i][j][k] = U4[i][j][k] 
-				               + deltaT_X * ( Fx4[_i][_j][_k] - Fx4[i][_j][_k] )
-							   + deltaT_Y * ( Fy4[_i][_j][_k] - Fy4[_i][j][_k] )
+				               + dtX[i] * ( Fx4[_i][_j][_k] - Fx4[i][_j][_k] )
+							   + dtY[j] * ( Fy4[_i][_j][_k] - Fy4[_i][j][_k] )
 							   + deltaT_Z * ( Fz4[_i][_j][_k] - Fz4[_i][_j][k] );
 				U5p[i][j][k] = U5[i][j][k] 
-				               + deltaT_X * ( Fx5[_i][_j][_k] - Fx5[i][_j][_k] )
-							   + deltaT_Y * ( Fy5[_i][_j][_k] - Fy5[_i][j][_k] )
+				               + dtX[i] * ( Fx5[_i][_j][_k] - Fx5[i][_j][_k] )
+							   + dtY[j] * ( Fy5[_i][_j][_k] - Fy5[_i][j][_k] )
 							   + deltaT_Z * ( Fz5[_i][_j][_k] - Fz5[_i][_j][k] );
 
 			 }
@@ -79,28 +79,28 @@ void Evolution_threeStage_TVD_RK( int Stage ){
 			for( k = 1, _k = 0; k < DEPP; k++, _k++ ) {
 
 				U1p[i][j][k] = 0.75 * U1[i][j][k] + 0.25 * (U1p[i][j][k]
-							 + deltaT_X * ( Fx1[_i][_j][_k] - Fx1[i][_j][_k] )
-							 + deltaT_Y * ( Fy1[_i][_j][_k] - Fy1[_i][j][_k] )
+							 + dtX[i] * ( Fx1[_i][_j][_k] - Fx1[i][_j][_k] )
+							 + dtY[j] * ( Fy1[_i][_j][_k] - Fy1[_i][j][_k] )
 							 + deltaT_Z * ( Fz1[_i][_j][_k] - Fz1[_i][_j][k] )
 							);
 				U2p[i][j][k] = 0.75 * U2[i][j][k] + 0.25 * (U2p[i][j][k]
-							 + deltaT_X * ( Fx2[_i][_j][_k] - Fx2[i][_j][_k] )
-							 + deltaT_Y * ( Fy2[_i][_j][_k] - Fy2[_i][j][_k] )
+							 + dtX[i] * ( Fx2[_i][_j][_k] - Fx2[i][_j][_k] )
+							 + dtY[j] * ( Fy2[_i][_j][_k] - Fy2[_i][j][_k] )
 							 + deltaT_Z * ( Fz2[_i][_j][_k] - Fz2[_i][_j][k] )
 							);
 				U3p[i][j][k] = 0.75 * U3[i][j][k] + 0.25 * (U3p[i][j][k]
-							 + deltaT_X * ( Fx3[_i][_j][_k] - Fx3[i][_j][_k] )
-							 + deltaT_Y * ( Fy3[_i][_j][_k] - Fy3[_i][j][_k] )
+							 + dtX[i] * ( Fx3[_i][_j][_k] - Fx3[i][_j][_k] )
+							 + dtY[j] * ( Fy3[_i][_j][_k] - Fy3[_i][j][_k] )
 							 + deltaT_Z * ( Fz3[_i][_j][_k] - Fz3[_i][_j][k] )
 							);
 				U4p[i][j][k] = 0.75 * U4[i][j][k] + 0.25 * (U4p[i][j][k]
-							 + deltaT_X * ( Fx4[_i][_j][_k] - Fx4[i][_j][_k] )
-							 + deltaT_Y * ( Fy4[_i][_j][_k] - Fy4[_i][j][_k] )
+							 + dtX[i] * ( Fx4[_i][_j][_k] - Fx4[i][_j][_k] )
+							 + dtY[j] * ( Fy4[_i][_j][_k] - Fy4[_i][j][_k] )
 							 + deltaT_Z * ( Fz4[_i][_j][_k] - Fz4[_i][_j][k] )
 							);
 				U5p[i][j][k] = 0.75 * U5[i][j][k] + 0.25 * (U5p[i][j][k]
-							 + deltaT_X * ( Fx5[_i][_j][_k] - Fx5[i][_j][_k] )
-							 + deltaT_Y * ( Fy5[_i][_j][_k] - Fy5[_i][j][_k] )
+							 + dtX[i] * ( Fx5[_i][_j][_k] - Fx5[i][_j][_k] )
+							 + dtY[j] * ( Fy5[_i][_j][_k] - Fy5[_i][j][_k] )
 							 + deltaT_Z * ( Fz5[_i][_j][_k] - Fz5[_i][_j][k] )
 							);
 
@@ -121,28 +121,28 @@ void Evolution_threeStage_TVD_RK( int Stage ){
 			for( k = 1, _k = 0; k < DEPP; k++, _k++ ) {
 
 				U1[i][j][k] = one_third * U1[i][j][k] + two_thirds * ( U1p[i][j][k]
-							 + deltaT_X * ( Fx1[_i][_j][_k] - Fx1[i][_j][_k] )
-							 + deltaT_Y * ( Fy1[_i][_j][_k] - Fy1[_i][j][_k] )
+							 + dtX[i] * ( Fx1[_i][_j][_k] - Fx1[i][_j][_k] )
+							 + dtY[j] * ( Fy1[_i][_j][_k] - Fy1[_i][j][_k] )
 							 + deltaT_Z * ( Fz1[_i][_j][_k] - Fz1[_i][_j][k] )
 							);
 				U2[i][j][k] = one_third * U2[i][j][k] + two_thirds * ( U2p[i][j][k]
-							 + deltaT_X * ( Fx2[_i][_j][_k] - Fx2[i][_j][_k] )
-							 + deltaT_Y * ( Fy2[_i][_j][_k] - Fy2[_i][j][_k] )
+							 + dtX[i] * ( Fx2[_i][_j][_k] - Fx2[i][_j][_k] )
+							 + dtY[j] * ( Fy2[_i][_j][_k] - Fy2[_i][j][_k] )
 							 + deltaT_Z * ( Fz2[_i][_j][_k] - Fz2[_i][_j][k] )
 							);
 				U3[i][j][k] = one_third * U3[i][j][k] + two_thirds * ( U3p[i][j][k]
-							 + deltaT_X * ( Fx3[_i][_j][_k] - Fx3[i][_j][_k] )
-							 + deltaT_Y * ( Fy3[_i][_j][_k] - Fy3[_i][j][_k] )
+							 + dtX[i] * ( Fx3[_i][_j][_k] - Fx3[i][_j][_k] )
+							 + dtY[j] * ( Fy3[_i][_j][_k] - Fy3[_i][j][_k] )
 							 + deltaT_Z * ( Fz3[_i][_j][_k] - Fz3[_i][_j][k] )
 							);
 				U4[i][j][k] = one_third * U4[i][j][k] + two_thirds * ( U4p[i][j][k]
-							 + deltaT_X * ( Fx4[_i][_j][_k] - Fx4[i][_j][_k] )
-							 + deltaT_Y * ( Fy4[_i][_j][_k] - Fy4[_i][j][_k] )
+							 + dtX[i] * ( Fx4[_i][_j][_k] - Fx4[i][_j][_k] )
+							 + dtY[j] * ( Fy4[_i][_j][_k] - Fy4[_i][j][_k] )
 							 + deltaT_Z * ( Fz4[_i][_j][_k] - Fz4[_i][_j][k] )
 							);
 				U5[i][j][k] = one_third * U5[i][j][k] + two_thirds * ( U5p[i][j][k]
-							 + deltaT_X * ( Fx5[_i][_j][_k] - Fx5[i][_j][_k] )
-							 + deltaT_Y * ( Fy5[_i][_j][_k] - Fy5[_i][j][_k] )
+							 + dtX[i] * ( Fx5[_i][_j][_k] - Fx5[i][_j][_k] )
+							 + dtY[j] * ( Fy5[_i][_j][_k] - Fy5[_i][j][_k] )
 							 + deltaT_Z * ( Fz5[_i][_j][_k] - Fz5[_i][_j][k] )
 							);
 				
@@ -172,24 +172,24 @@ unsigned i, j, k, _i, _j, _k;
 				for (k = 1, _k = 0; k < DEPP; k++, _k++) {
 
 					U1p[i][j][k] = U1[i][j][k]
-									+ deltaT_X * ( Fx1[_i][_j][_k] - Fx1[i][_j][_k] )
-									+ deltaT_Y * ( Fy1[_i][_j][_k] - Fy1[_i][j][_k] )
+									+ dtX[i] * ( Fx1[_i][_j][_k] - Fx1[i][_j][_k] )
+									+ dtY[j] * ( Fy1[_i][_j][_k] - Fy1[_i][j][_k] )
 									+ deltaT_Z * ( Fz1[_i][_j][_k] - Fz1[_i][_j][k] );
 					U2p[i][j][k] = U2[i][j][k]
-									+ deltaT_X * ( Fx2[_i][_j][_k] - Fx2[i][_j][_k] )
-									+ deltaT_Y * ( Fy2[_i][_j][_k] - Fy2[_i][j][_k] )
+									+ dtX[i] * ( Fx2[_i][_j][_k] - Fx2[i][_j][_k] )
+									+ dtY[j] * ( Fy2[_i][_j][_k] - Fy2[_i][j][_k] )
 									+ deltaT_Z * ( Fz2[_i][_j][_k] - Fz2[_i][_j][k] );
 					U3p[i][j][k] = U3[i][j][k]
-									+ deltaT_X * ( Fx3[_i][_j][_k] - Fx3[i][_j][_k] )
-									+ deltaT_Y * ( Fy3[_i][_j][_k] - Fy3[_i][j][_k] )
+									+ dtX[i] * ( Fx3[_i][_j][_k] - Fx3[i][_j][_k] )
+									+ dtY[j] * ( Fy3[_i][_j][_k] - Fy3[_i][j][_k] )
 									+ deltaT_Z * ( Fz3[_i][_j][_k] - Fz3[_i][_j][k] );
 					U4p[i][j][k] = U4[i][j][k]
-									+ deltaT_X * ( Fx4[_i][_j][_k] - Fx4[i][_j][_k] )
-									+ deltaT_Y * ( Fy4[_i][_j][_k] - Fy4[_i][j][_k] )
+									+ dtX[i] * ( Fx4[_i][_j][_k] - Fx4[i][_j][_k] )
+									+ dtY[j] * ( Fy4[_i][_j][_k] - Fy4[_i][j][_k] )
 									+ deltaT_Z * ( Fz4[_i][_j][_k] - Fz4[_i][_j][k] );
 					U5p[i][j][k] = U5[i][j][k]
-									+ deltaT_X * ( Fx5[_i][_j][_k] - Fx5[i][_j][_k] )
-									+ deltaT_Y * ( Fy5[_i][_j][_k] - Fy5[_i][j][_k] )
+									+ dtX[i] * ( Fx5[_i][_j][_k] - Fx5[i][_j][_k] )
+									+ dtY[j] * ( Fy5[_i][_j][_k] - Fy5[_i][j][_k] )
 									+ deltaT_Z * ( Fz5[_i][_j][_k] - Fz5[_i][_j][k] );
 
 				 }
@@ -208,28 +208,28 @@ unsigned i, j, k, _i, _j, _k;
 				for ( k = 1, _k = 0; k < DEPP; k++, _k++) {
 
 					U1[i][j][k] = 0.5 * ( U1[i][j][k] + U1p[i][j][k]
-								 + deltaT_X * ( Fx1[_i][_j][_k] - Fx1[i][_j][_k] )
-								 + deltaT_Y * ( Fy1[_i][_j][_k] - Fy1[_i][j][_k] )
+								 + dtX[i] * ( Fx1[_i][_j][_k] - Fx1[i][_j][_k] )
+								 + dtY[j] * ( Fy1[_i][_j][_k] - Fy1[_i][j][_k] )
 								 + deltaT_Z * ( Fz1[_i][_j][_k] - Fz1[_i][_j][k] )
 								);
 					U2[i][j][k] = 0.5 * ( U2[i][j][k] + U2p[i][j][k]
-								 + deltaT_X * ( Fx2[_i][_j][_k] - Fx2[i][_j][_k] )
-								 + deltaT_Y * ( Fy2[_i][_j][_k] - Fy2[_i][j][_k] )
+								 + dtX[i] * ( Fx2[_i][_j][_k] - Fx2[i][_j][_k] )
+								 + dtY[j] * ( Fy2[_i][_j][_k] - Fy2[_i][j][_k] )
 								 + deltaT_Z * ( Fz2[_i][_j][_k] - Fz2[_i][_j][k] )
 								);
 					U3[i][j][k] = 0.5 * ( U3[i][j][k] + U3p[i][j][k]
-								 + deltaT_X * ( Fx3[_i][_j][_k] - Fx3[i][_j][_k] )
-								 + deltaT_Y * ( Fy3[_i][_j][_k] - Fy3[_i][j][_k] )
+								 + dtX[i] * ( Fx3[_i][_j][_k] - Fx3[i][_j][_k] )
+								 + dtY[j] * ( Fy3[_i][_j][_k] - Fy3[_i][j][_k] )
 								 + deltaT_Z * ( Fz3[_i][_j][_k] - Fz3[_i][_j][k] )
 								);
 					U4[i][j][k] = 0.5 * ( U4[i][j][k] + U4p[i][j][k]
-								 + deltaT_X * ( Fx4[_i][_j][_k] - Fx4[i][_j][_k] )
-								 + deltaT_Y * ( Fy4[_i][_j][_k] - Fy4[_i][j][_k] )
+								 + dtX[i] * ( Fx4[_i][_j][_k] - Fx4[i][_j][_k] )
+								 + dtY[j] * ( Fy4[_i][_j][_k] - Fy4[_i][j][_k] )
 								 + deltaT_Z * ( Fz4[_i][_j][_k] - Fz4[_i][_j][k] )
 								);
 					U5[i][j][k] = 0.5 * ( U5[i][j][k] + U5p[i][j][k]
-								 + deltaT_X * ( Fx5[_i][_j][_k] - Fx5[i][_j][_k] )
-								 + deltaT_Y * ( Fy5[_i][_j][_k] - Fy5[_i][j][_k] )
+								 + dtX[i] * ( Fx5[_i][_j][_k] - Fx5[i][_j][_k] )
+								 + dtY[j] * ( Fy5[_i][_j][_k] - Fy5[_i][j][_k] )
 								 + deltaT_Z * ( Fz5[_i][_j][_k] - Fz5[_i][_j][k] )
 								);
 
@@ -0,0 +1,256 @@
+/*
+*  EXTRACT
+*
+*  In-situ extracts: planes, boxes and coarsened volumes of chosen fields, each
+*  written at its own cadence. Every "extract" key of the configuration file
+*  defines one of them:
+*
+*      extract = zmid   every=50  k=18                 vars=rho,u,vorticity
+*      extract = x100   every=10  i=100                vars=u,v,w
+*      extract = movie  every=200 i=1:400:4 j=1:80:4 k=1:35:4 vars=Q
+*      extract = box    every=100 i=50:150 j=20:60
+*
+*  i, j, k take "first[:last[:stride]]" in global cell indices starting from 1
+*  (i runs over all processes); a direction left out is taken whole. "vars" is a
+*  comma-separated list of OutputFieldNames[] or "all" (the default), "every"
+*  defaults to f_step.
+*
+*  An extract is written as "<name>-<step>.snap": the fields one after another,
+*  each a float array [nk][nj][ni] with i running fastest, and "<name>-<step>.xmf"
+*  describing it. Every process writes only its own part of the x-range, all of
+*  them in a single collective call.
+*
+*/
+#include "mpi.h"
+#include <stdio.h>     /* printf() etc.*/
+#include <stdlib.h>    /* strtol()     */
+#include <string.h>    /* strtok_r()   */
+
+#include "type.h"
+#include "def.h"      /* Definitions, parameters */
+#include "global.h"   /* global variables */
+#include "config.h"
+#include "output.h"   /* CellValues() */
+#include "grid.h"     /* GridXdmf() */
+
+#include "extract.h"
+
+typedef struct {
+	char name[32];
+	int  every;
+	int  lo[3], hi[3], st[3]; /* global cells first..last (from 1) and stride in x, y, z */
+	int  n[3];                /* number of samples in x, y, z */
+	int  nv, var[OUT_NFIELDS]; /* fields, indices into OutputFieldNames[] */
+} Extract;
+
+static Extract ex[CFG_LIST_MAX];
+static int nEx = 0;
+
+static float *exBuf = NULL;
+static size_t exBufSize = 0;
+
+
+/*
+* parseRange - "a", "a:b" or "a:b:s" within 1..nmax; returns 0 on success.
+*/
+static int parseRange( const char *s, int nmax, int *lo, int *hi, int *st )
+{
+char *end;
+
+	*lo = strtol( s, &end, 10 ); *hi = *lo; *st = 1;
+	if( *end == ':' ) {
+		*hi = strtol( end + 1, &end, 10 );
+		if( *end == ':' ) *st = strtol( end + 1, &end, 10 );
+	}
+	if( *end != '\0' || *lo < 1 || *hi < *lo || *hi > nmax || *st < 1 ) return 1;
+	return 0;
+} /* end parseRange() */
+
+
+/*
+* parseExtract - Fills e from the text of an "extract" key; returns 0 on success.
+*/
+static int parseExtract( const char *text, Extract *e, int numprocs, int myid )
+{
+char line[CFG_LIST_LEN], *tok, *val, *name, *save1, *save2;
+int d, l, nmax[3];
+
+	nmax[0] = LEN * numprocs; nmax[1] = HIG; nmax[2] = DEP;
+	for( d = 0; d < 3; d++ ) { e->lo[d] = 1; e->hi[d] = nmax[d]; e->st[d] = 1; }
+	e->every = f_step;
+	e->nv = OUT_NFIELDS;
+	for( l = 0; l < OUT_NFIELDS; l++ ) e->var[l] = l;
+
+	strcpy( line, text );
+	if( ( tok = strtok_r( line, " \t", &save1 ) ) == NULL || strchr( tok, '=' ) != NULL || strlen( tok ) >= sizeof(e->name) ) {
+		if( 0 == myid ) fprintf( stderr, "extract \"%s\": the name must come first.\n", text );
+		return 1;
+	}
+	strcpy( e->name, tok );
+
+	while( ( tok = strtok_r( NULL, " \t", &save1 ) ) != NULL ) {
+		if( ( val = strchr( tok, '=' ) ) == NULL ) goto bad;
+		*val++ = '\0';
+		if( strcmp( tok, "every" ) == 0 ) {
+			if( ( e->every = atoi( val ) ) < 1 ) goto bad;
+		}
+		else if( strlen( tok ) == 1 && ( d = tok[0] - 'i' ) >= 0 && d < 3 ) {
+			if( parseRange( val, nmax[d], &e->lo[d], &e->hi[d], &e->st[d] ) ) goto bad;
+		}
+		else if( strcmp( tok, "vars" ) == 0 ) {
+			if( strcmp( val, "all" ) == 0 ) continue;
+			e->nv = 0;
+			for( name = strtok_r( val, ",", &save2 ); name != NULL; name = strtok_r( NULL, ",", &save2 ) ) {
+				for( l = 0; l < OUT_NFIELDS && strcmp( name, OutputFieldNames[l] ) != 0; l++ );
+				if( l == OUT_NFIELDS || e->nv == OUT_NFIELDS ) goto bad;
+				e->var[e->nv++] = l;
+			}
+		}
+		else goto bad;
+	}
+	for( d = 0; d < 3; d++ ) e->n[d] = ( e->hi[d] - e->lo[d] ) / e->st[d] + 1;
+
+	return 0;
+
+bad:
+	if( 0 == myid ) fprintf( stderr, "extract \"%s\": bad \"%s\".\n", text, tok );
+	return 1;
+} /* end parseExtract() */
+
+
+void ExtractInit( int myid )
+{
+int numprocs, n, nErr = 0;
+
+	MPI_Comm_size( MPI_COMM_WORLD, &numprocs );
+
+	// every process parses the same broadcast text
+	for( n = 0; n < config.extract.n; n++ )
+		nErr += parseExtract( config.extract.item[n], &ex[n], numprocs, myid );
+	if( nErr ) MPI_Abort( MPI_COMM_WORLD, 1 );
+	nEx = config.extract.n;
+
+} /* end ExtractInit() */
+
+
+/*
+* writeXdmf - Describes the extract as a uniform grid of its sample points.
+*/
+static void writeXdmf( const Extract *e, const char *datafile )
+{
+FILE *pF;
+char filename[64];
+long size = (long)e->n[0] * e->n[1] * e->n[2] * sizeof(float);
+int l;
+
+	snprintf( filename, sizeof(filename), "%.31s-%d.xmf", e->name, step );
+	if( ( pF = fopen( filename, "w" ) ) == NULL ) {
+		fprintf( stderr, "can't open \"%s\".\n", filename );
+		return;
+	}
+	fprintf( pF, "<?xml version=\"1.0\" ?>\n" );
+	fprintf( pF, "<Xdmf Version=\"2.0\">\n <Domain>\n" );
+	fprintf( pF, "  <Grid Name=\"%s\" GridType=\"Uniform\">\n", e->name );
+	fprintf( pF, "   <Time Value=\"%g\"/>\n", totalTime );
+	if( GridStretched( ) ) {
+		int lo[3], a;
+		for( a = 0; a < 3; a++ ) lo[a] = e->lo[a] - 1;
+		GridXdmf( pF, 3, 1, lo, e->st, e->n );
+	}
+	else {
+		fprintf( pF, "   <Topology TopologyType=\"3DCoRectMesh\" Dimensions=\"%d %d %d\"/>\n", e->n[2], e->n[1], e->n[0] );
+		fprintf( pF, "   <Geometry GeometryType=\"ORIGIN_DXDYDZ\">\n" );
+		fprintf( pF, "    <DataItem Format=\"XML\" Dimensions=\"3\">%g %g %g</DataItem>\n",
+		         ( e->lo[2] - 0.5 ) * deltaZ, ( e->lo[1] - 0.5 ) * deltaY, ( e->lo[0] - 0.5 ) * deltaX );
+		fprintf( pF, "    <DataItem Format=\"XML\" Dimensions=\"3\">%g %g %g</DataItem>\n",
+		         e->st[2] * deltaZ, e->st[1] * deltaY, e->st[0] * deltaX );
+		fprintf( pF, "   </Geometry>\n" );
+	}
+	for( l = 0; l < e->nv; l++ ) {
+		fprintf( pF, "   <Attribute Name=\"%s\" AttributeType=\"Scalar\" Center=\"Node\">\n", OutputVarNames[e->var[l]+3] );
+		fprintf( pF, "    <DataItem Format=\"Binary\" NumberType=\"Float\" Precision=\"4\" Endian=\"Native\"" );
+		fprintf( pF, " Seek=\"%ld\" Dimensions=\"%d %d %d\">%s</DataItem>\n", l*size, e->n[2], e->n[1], e->n[0], datafile );
+		fprintf( pF, "   </Attribute>\n" );
+	}
+	fprintf( pF, "  </Grid>\n </Domain>\n</Xdmf>\n" );
+	fclose( pF );
+
+} /* end writeXdmf() */
+
+
+/*
+* writeExtract - Stages the part of _this_ process and writes the extract collectively.
+*/
+static void writeExtract( const Extract *e, const Frame *f, int myid )
+{
+char filename[64];
+MPI_File fh;
+MPI_Datatype part = MPI_FLOAT;
+int sizes[4], subsizes[4], starts[4];
+int g0, g1, first, nx, a, b, c, l;
+size_t np, m = 0;
+real v[OUT_NVARS];
+
+	//--- samples of the x-range falling into cells myid*LEN+1 .. myid*LEN+LEN
+	g0 = myid * LEN + 1; g1 = g0 + LEN - 1;
+	first = ( g0 > e->lo[0] ) ? ( g0 - e->lo[0] + e->st[0] - 1 ) / e->st[0] : 0;
+	nx = 0;
+	if( first < e->n[0] && e->lo[0] + first * e->st[0] <= g1 )
+		nx = ( ( g1 < e->hi[0] ? g1 : e->hi[0] ) - ( e->lo[0] + first * e->st[0] ) ) / e->st[0] + 1;
+
+	np = (size_t)nx * e->n[1] * e->n[2];
+	if( np * e->nv > exBufSize ) {
+		free( exBuf );
+		if( ( exBuf = (float *)malloc( np * e->nv * sizeof(float) ) ) == NULL ) {
+			fprintf( stderr, "mpi_layer2: can't allocate memory for extract \"%s\".\n", e->name );
+			MPI_Abort( MPI_COMM_WORLD, 1 );
+		}
+		exBufSize = np * e->nv;
+	}
+	for( c = 0; c < e->n[2]; c++ ) {
+		for( b = 0; b < e->n[1]; b++ ) {
+			for( a = 0; a < nx; a++ ) {
+				CellValues( f, e->lo[0] + ( first + a ) * e->st[0] - g0 + 1,
+				               e->lo[1] + b * e->st[1], e->lo[2] + c * e->st[2], myid, v );
+				for( l = 0; l < e->nv; l++ ) exBuf[l * np + m] = v[e->var[l] + 3];
+				m++;
+			}
+		}
+	}
+
+	//--- the part of _this_ process in every field of the file
+	if( nx > 0 ) {
+		sizes[0] = e->nv;   subsizes[0] = e->nv;   starts[0] = 0;
+		sizes[1] = e->n[2]; subsizes[1] = e->n[2]; starts[1] = 0;
+		sizes[2] = e->n[1]; subsizes[2] = e->n[1]; starts[2] = 0;
+		sizes[3] = e->n[0]; subsizes[3] = nx;      starts[3] = first;
+		MPI_Type_create_subarray( 4, sizes, subsizes, starts, MPI_ORDER_C, MPI_FLOAT, &part );
+		MPI_Type_commit( &part );
+	}
+
+	snprintf( filename, sizeof(filename), "%.31s-%d.snap", e->name, step );
+	MPI_File_open( MPI_COMM_WORLD, filename, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fh );
+	MPI_File_set_size( fh, 0 );
+	MPI_File_set_view( fh, 0, MPI_FLOAT, part, "native", MPI_INFO_NULL );
+	MPI_File_write_at_all( fh, 0, exBuf, (int)( np * e->nv ), MPI_FLOAT, MPI_STATUS_IGNORE );
+	MPI_File_close( &fh );
+
+	if( nx > 0 ) MPI_Type_free( &part );
+	if( 0 == myid ) writeXdmf( e, filename );
+
+} /* end writeExtract() */
+
+
+/*************
+*  EXTRACTS  *   Writes the extracts due at the current step
+*************/
+void Extracts( int myid )
+{
+Frame now;
+int n;
+
+	CurrentFrame( &now );
+	for( n = 0; n < nEx; n++ )
+		if( step % ex[n].every == 0 ) writeExtract( &ex[n], &now, myid );
+
+} /* end Extracts() */
@@ -0,0 +1,14 @@
+#ifndef EXTRACT_H
+#define EXTRACT_H
+
+/*
+* ExtractInit - Parses the "extract" keys of the configuration; a malformed one stops the run.
+*/
+void ExtractInit( int myid );
+
+/*
+* Extracts - Writes the extracts due at the current step.
+*/
+void Extracts( int myid );
+
+#endif
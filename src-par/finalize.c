@@ -9,15 +9,48 @@
 #include "def.h"      /* Definitions, parameters */
 #include "global.h"   /* global variables */
 
+#include "config.h"
+#include "output.h"   /* OutputFlush() */
+#include "h5output.h"
+#include "checkpoint.h"
+#include "probes.h"   /* ProbesFlush() */
+#include "diagnostics.h" /* DiagnosticsFlush() */
+#include "events.h"      /* EventsFlush() */
+#include "convergence.h" /* ConvergenceFlush() */
+#include "inflow.h"      /* InflowFlush() */
 #include "finalize.h"
 
-void Finalize(int myid)
+/*
+* Backup - Saves solution arrays of _this_ process to the "backup.myid" file
+*/
+void Backup(int myid)
 {
 float buf;
 char filename[30];
 MPI_File fh;
 MPI_Status status;
 
+	//--- frames still staged are written first, the writer thread is idle then
+	OutputFlush();
+	//--- probe records, thicknesses and events up to this step as well
+	ProbesFlush();
+	DiagnosticsFlush();
+	EventsFlush();
+	ConvergenceFlush();
+	InflowFlush();
+
+	//--- single HDF5 file shared by all processes
+	if (config.b_format == 1) {
+		BackupHDF5(myid);
+		return;
+	}
+
+	//--- single checkpoint file, independent of the decomposition
+	if (config.b_format == 2) {
+		WriteCheckpoint(myid);
+		return;
+	}
+
 
 	//--- open/create "backup.myid" file in binary mode
 	sprintf(filename, "backup.%d", myid);
@@ -45,7 +78,15 @@ MPI_Status status;
 	//--- close "backup.myid" file
 	MPI_File_close(&fh);
 
-	//--- close file "probes.dat" here
-	fclose(pFprobes);
+} // end Backup()
+
+
+void Finalize(int myid)
+{
+	//--- backup the solution
+	Backup(myid);
+
+	//--- write the rest of the probe records and close the probe files
+	ProbesFinalize(myid);
 
 } // end Finalize()
\ No newline at end of file
@@ -1 +1,2 @@
+void Backup( int myid );
 void Finalize( int myid );
\ No newline at end of file
@@ -45,7 +45,9 @@ void Fluxes( int myid, int numprocs )
 	/* strain rate tensor components */
 	S12, S13, S23,
 	/* invariant of strain rate tensor */
-	_S_;
+	_S_,
+	/* Cs * delta * delta at the interface, of the local spacing */
+	csdd;
 
 
     /* Calculate the SGS viscosity for a given type fo SGS model (Smagorinsky, Dynamic Smagorinsky, Vreman, Wale) */
@@ -170,13 +172,13 @@ void Fluxes( int myid, int numprocs )
 				kw =    U4_[i  ][j_ ][k  ] * RU;
 				   /* derivatives of velocities */
 					  /* x */
-				du_dx = ( U_ - _U ) * _deltaX;
-				dv_dx = ( V_ - _V ) * _deltaX;
-				dw_dx = ( W_ - _W ) * _deltaX;
+				du_dx = ( U_ - _U ) * _dX[i];
+				dv_dx = ( V_ - _V ) * _dX[i];
+				dw_dx = ( W_ - _W ) * _dX[i];
 					  /* y */
-				du_dy = ( Uj + uj - jU - ju ) * _4deltaY;
-				dv_dy = ( Vj + vj - jV - jv ) * _4deltaY;
-				dw_dy = ( Wj + wj - jW - jw ) * _4deltaY;
+				du_dy = ( Uj + uj - jU - ju ) * _4dY[j_];
+				dv_dy = ( Vj + vj - jV - jv ) * _4dY[j_];
+				dw_dy = ( Wj + wj - jW - jw ) * _4dY[j_];
 					  /* z */
 				du_dz = ( Uk + uk - kU - ku ) * _4deltaZ;
 				dv_dz = ( Vk + vk - kV - kv ) * _4deltaZ;
@@ -200,7 +202,8 @@ void Fluxes( int myid, int numprocs )
 					S23 = 0.5 * (dv_dz + dw_dy);
                     _S_ = sqrt( 2 * ( du_dx * du_dx + dv_dy * dv_dy + dw_dz * dw_dz 
                                       + 2 * ( S12   * S12   + S13   * S13   + S23   * S23 ) ) );
-					mu_T = rr * CsDD * _S_;                     /* mu_T = r * Cs * delta * delta * | S |  */
+					csdd = Cs * 0.5 * ( DDxy[i][j_] + DDxy[i_][j_] ); /* of the face */
+					mu_T = rr * csdd * _S_;                     /* mu_T = r * Cs * delta * delta * | S |  */
 
 			    }
 
@@ -210,7 +213,7 @@ void Fluxes( int myid, int numprocs )
 				sigma_xz = mu_E * ( du_dz + dw_dx );
 				   /* heat flux */
 				lambda_E = lambda_L + mu_T * cp_Pr_T;
-				q_x = - lambda_E * ( T_ - _T ) * _deltaX;
+				q_x = - lambda_E * ( T_ - _T ) * _dX[i];
 				   /* summary X-fluxes evaluation */
 				Fx1[i][j][k] = RU = R * U;
 				Fx2[i][j][k] = RU * U + P - sigma_xx;
@@ -339,13 +342,13 @@ void Fluxes( int myid, int numprocs )
 				iw =    U4_[i  ][j  ][k_ ] * RU;
 				/* derivatives of velocities */
 					  /* x */
-				du_dx = ( Ui + ui - iU - iu ) * _4deltaX;
-				dv_dx = ( Vi + vi - iV - iv ) * _4deltaX;
-				dw_dx = ( Wi + wi - iW - iw ) * _4deltaX;
+				du_dx = ( Ui + ui - iU - iu ) * _4dX[i_];
+				dv_dx = ( Vi + vi - iV - iv ) * _4dX[i_];
+				dw_dx = ( Wi + wi - iW - iw ) * _4dX[i_];
 					  /* y */
-				du_dy = ( U_ - _U ) * _deltaY;
-				dv_dy = ( V_ - _V ) * _deltaY;
-				dw_dy = ( W_ - _W ) * _deltaY;
+				du_dy = ( U_ - _U ) * _dY[j];
+				dv_dy = ( V_ - _V ) * _dY[j];
+				dw_dy = ( W_ - _W ) * _dY[j];
 					  /* z */
 				du_dz = ( Uk + uk - kU - ku ) * _4deltaZ;
 				dv_dz = ( Vk + vk - kV - kv ) * _4deltaZ;
@@ -369,7 +372,8 @@ void Fluxes( int myid, int numprocs )
 					S23 = 0.5 * (dv_dz + dw_dy);
                     _S_ = sqrt( 2 * ( du_dx * du_dx + dv_dy * dv_dy + dw_dz * dw_dz 
                                       + 2 * ( S12   * S12   + S13   * S13   + S23   * S23 ) ) );
-					mu_T = rr * CsDD * _S_;                     /* mu_T = r * Cs * delta * delta * | S |  */
+					csdd = Cs * 0.5 * ( DDxy[i_][j] + DDxy[i_][j_] ); /* of the face */
+					mu_T = rr * csdd * _S_;                     /* mu_T = r * Cs * delta * delta * | S |  */
 
 			    }
 
@@ -380,7 +384,7 @@ void Fluxes( int myid, int numprocs )
 
 				/* heat flux */
 				lambda_E = lambda_L + mu_T * cp_Pr_T;
-				q_y = - lambda_E * ( T_ - _T ) * _deltaY;
+				q_y = - lambda_E * ( T_ - _T ) * _dY[j];
 
 				   /* summary Y-fluxes evaluation */
 				Fy1[i][j][k] = RU = R * V;
@@ -510,13 +514,13 @@ void Fluxes( int myid, int numprocs )
 				jw =    U4_[i_ ][j  ][k  ] * RU;
 				   /* derivatives of velocities */
 					  /* x */
-				du_dx = ( Ui + ui - iU - iu ) * _4deltaX;
-				dv_dx = ( Vi + vi - iV - iv ) * _4deltaX;
-				dw_dx = ( Wi + wi - iW - iw ) * _4deltaX;
+				du_dx = ( Ui + ui - iU - iu ) * _4dX[i_];
+				dv_dx = ( Vi + vi - iV - iv ) * _4dX[i_];
+				dw_dx = ( Wi + wi - iW - iw ) * _4dX[i_];
 					  /* y */
-				du_dy = ( Uj + uj - jU - ju ) * _4deltaY;
-				dv_dy = ( Vj + vj - jV - jv ) * _4deltaY;
-				dw_dy = ( Wj + wj - jW - jw ) * _4deltaY;
+				du_dy = ( Uj + uj - jU - ju ) * _4dY[j_];
+				dv_dy = ( Vj + vj - jV - jv ) * _4dY[j_];
+				dw_dy = ( Wj + wj - jW - jw ) * _4dY[j_];
 					  /* z */
 				du_dz = ( U_ - _U ) * _deltaZ;
 				dv_dz = ( V_ - _V ) * _deltaZ;
@@ -540,7 +544,8 @@ void Fluxes( int myid, int numprocs )
 					S23 = 0.5 * (dv_dz + dw_dy);
                     _S_ = sqrt( 2 * ( du_dx * du_dx + dv_dy * dv_dy + dw_dz * dw_dz 
                                       + 2 * ( S12   * S12   + S13   * S13   + S23   * S23 ) ) );
-					mu_T = rr * CsDD * _S_;                     /* mu_T = r * Cs * delta * delta * | S |  */
+					csdd = Cs * DDxy[i_][j_];
+					mu_T = rr * csdd * _S_;                     /* mu_T = r * Cs * delta * delta * | S |  */
 
 			    }
 
@@ -28,9 +28,18 @@ extern real
 	deltaT_X, deltaT_Y, deltaT_Z, /* convenient ratios */
 	_deltaX, _deltaY, _deltaZ,
 	_2deltaX, _2deltaY, _2deltaZ,
-	_4deltaX, _4deltaY, _4deltaZ,
-	// array of probes
-	*probes;
+	_4deltaX, _4deltaY, _4deltaZ;
+
+/* spacing of the stretched grid by the cell index, ghosts included (grid.c) */
+extern real
+	*dX, *dY,       /* widths of the cells */
+	*_dX, *_dY,     /* 1 / distance of the centres across face i (between cells i and i+1) */
+	*_2dX, *_2dY,   /* 1 / distance of the centres of the neighbours of cell i */
+	*_4dX, *_4dY,   /* half of it */
+	*dtX, *dtY,     /* deltaT / widths */
+	*fX, *bX,       /* forward and backward differences to the width of cell i */
+	*fY, *bY,
+	**DDxy;         /* filter width squared of the cells */
 
 
 extern real ***mu_SGS;
@@ -47,6 +56,7 @@ extern real
 	Cs, CsDD, DD;
 
 extern real maxCoNum;  /* maximum Courant number */
+extern real totalTime; /* simulation time */
 extern int nStages; /* number of stages of Runge-Kutta algorithm */
 
 /* MPI Buffer */
@@ -73,9 +83,6 @@ extern char
    Stage,    /* indicator of the current stage */
    str[80];  /* buffer string */
 
-//--- handles of "probes.myid" files
-extern FILE *pFprobes;
-
 //-- for randomized disturbing blocks	
 extern int 
     j_base, j_base_max,
@@ -0,0 +1,358 @@
+/*
+*  GRID
+*
+*  Stretched Cartesian grid. The cells may grow geometrically downstream and
+*  cluster about the centre of the layer in y; z stays uniform:
+*
+*      dx(I) = deltaX * g_x^I                                     I = 0..NX-1
+*      y(J)  = H/2 ( 1 + sinh( g_y (2J/HIG - 1) ) / sinh( g_y ) )  J = 0..HIG, H = HIG*deltaY
+*
+*  so deltaX is the width of the first column and deltaY the mean height of the
+*  cells; g_x = 1 and g_y = 0 give the uniform grid. The solver reads the spacing
+*  of _this_ process from the arrays of global.h, indexed like the cells (ghosts
+*  included): the widths, the inverse distances of the centres across a face (_dX)
+*  and across a cell (_2dX, _4dX = _2dX/2), deltaT over the widths (dtX) and the
+*  factors scaling the forward and backward differences to the width of the cell
+*  (fX, bX) for the reconstruction; DDxy is the filter width squared of the cells.
+*  On the uniform grid they hold exactly the values of the scalar complexes.
+*  The ghost rows in y mirror the first and last ones, like the slip walls.
+*
+*  The rows may later be laid out anew about the face HIG/2 (GridBandY): in each
+*  half the first nf rows share the band of width w next to it equally, the rest
+*  grow geometrically by the ratio that fills the half. GridRemapY carries a
+*  column of cell averages over to the new rows conservatively.
+*
+*/
+#include "mpi.h"
+#include <stdio.h>     /* printf() etc.*/
+#include <stdlib.h>    /* malloc()     */
+#include <math.h>      /* pow(), sinh() */
+
+#include "type.h"
+#include "def.h"      /* Definitions, parameters */
+#include "global.h"   /* global variables */
+#include "helpers.h"  /* Array2D() */
+#include "config.h"
+
+#include "grid.h"
+
+static int NX, stretched = 0;
+static double *xf = NULL, *yf = NULL;   /* global faces [NX+1], [HIG+1] */
+static double band[2];                  /* half-widths of the band below and above, GridBandY() */
+static int bandFine = 0;                /* rows of each half in the band, 0-not banded */
+static double *slope = NULL;            /* [HIG], GridRemapY() */
+
+
+/*
+* xFace - Face I of the columns, any I (the ghosts continue the progression).
+*/
+static double xFace( int I )
+{
+double g = config.g_x;
+
+	if( g == 1. ) return I * (double)deltaX;
+	return deltaX * ( pow( g, I ) - 1. ) / ( g - 1. );
+}
+
+static double yFace( int J )
+{
+double b = config.g_y, H = HIG * (double)deltaY;
+
+	if( b == 0. ) return J * (double)deltaY;
+	return 0.5 * H * ( 1. + sinh( b * ( 2. * J / HIG - 1. ) ) / sinh( b ) );
+}
+
+/* widths of the global cells, the rows mirrored past the walls; exact on the uniform grid */
+static double wx( int I )
+{
+	if( config.g_x == 1. ) return deltaX;
+	return xFace( I + 1 ) - xFace( I );
+}
+
+static double wy( int J )
+{
+	if( config.g_y == 0. && !bandFine ) return deltaY;
+	if( J < 0 ) J = -1 - J;
+	if( J > (int)HIG - 1 ) J = 2 * HIG - 1 - J;
+	return yf[J+1] - yf[J];
+}
+
+
+/*
+* rows - Spacing arrays of the rows of the faces yf.
+*/
+static void rows( void )
+{
+unsigned j;
+int J;
+double a, b, c;
+
+	for( j = 0; j <= HIGG; j++ ) {
+		J = j - 1;
+		a = wy( J - 1 ); b = wy( J ); c = wy( J + 1 );
+		dY[j]   = b;
+		_dY[j]  = 1. / ( 0.5 * b + 0.5 * c );
+		_2dY[j] = 1. / ( 0.5 * a + b + 0.5 * c );
+		_4dY[j] = 0.5 * _2dY[j];
+		fY[j]   = 2. * b / ( b + c );
+		bY[j]   = 2. * b / ( a + b );
+	}
+
+} /* end rows() */
+
+
+/*
+* filterWidths - Filter width squared of the Smagorinsky model, of the cells.
+*/
+static void filterWidths( void )
+{
+unsigned i, j;
+
+	for( i = 0; i <= LENN; i++ )
+		for( j = 0; j <= HIGG; j++ )
+			DDxy[i][j] = pow( dX[i] * dY[j] * deltaZ, twoThirds );
+
+} /* end filterWidths() */
+
+
+/*
+* alloc - A spacing array of n elements.
+*/
+static real *alloc( unsigned n )
+{
+real *a;
+
+	if( ( a = (real *)malloc( n * sizeof(real) ) ) == NULL ) {
+		fprintf( stderr, "mpi_layer2: can't allocate memory for the grid.\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	return a;
+}
+
+
+void GridInit( int myid )
+{
+int numprocs, I;
+unsigned i;
+double a, b, c;
+
+	MPI_Comm_size( MPI_COMM_WORLD, &numprocs );
+	NX = LEN * numprocs;
+	stretched = ( config.g_x != 1. || config.g_y != 0. );
+
+	xf = (double *)malloc( ( NX + 1 ) * sizeof(double) );
+	yf = (double *)malloc( ( HIG + 1 ) * sizeof(double) );
+	slope = (double *)malloc( HIG * sizeof(double) );
+	if( xf == NULL || yf == NULL || slope == NULL ) {
+		fprintf( stderr, "mpi_layer2: can't allocate memory for the grid.\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	for( I = 0; I <= NX; I++ ) xf[I] = xFace( I );
+	for( I = 0; I <= (int)HIG; I++ ) yf[I] = yFace( I );
+
+	//--- x, columns of _this_ process and their ghosts
+	dX  = alloc( LEN + 2 ); _dX  = alloc( LEN + 2 ); _2dX = alloc( LEN + 2 ); _4dX = alloc( LEN + 2 );
+	dtX = alloc( LEN + 2 );  fX  = alloc( LEN + 2 );  bX  = alloc( LEN + 2 );
+	for( i = 0; i <= LENN; i++ ) {
+		I = myid * LEN + i - 1;
+		a = wx( I - 1 ); b = wx( I ); c = wx( I + 1 );
+		dX[i]   = b;
+		_dX[i]  = 1. / ( 0.5 * b + 0.5 * c );
+		_2dX[i] = 1. / ( 0.5 * a + b + 0.5 * c );
+		_4dX[i] = 0.5 * _2dX[i];
+		fX[i]   = 2. * b / ( b + c );
+		bX[i]   = 2. * b / ( a + b );
+	}
+
+	//--- y, rows and the ghosts
+	dY  = alloc( HIG + 2 ); _dY  = alloc( HIG + 2 ); _2dY = alloc( HIG + 2 ); _4dY = alloc( HIG + 2 );
+	dtY = alloc( HIG + 2 );  fY  = alloc( HIG + 2 );  bY  = alloc( HIG + 2 );
+	rows( );
+
+	//--- filter width squared of the Smagorinsky model
+	DDxy = Array2D( LEN + 2, HIG + 2 );
+	filterWidths( );
+
+	GridDeltaT( );
+
+	if( 0 == myid && stretched )
+		fprintf( stdout, "Grid: %g x %g m, dx %g..%g m, dy %g..%g m.\n",
+		         xf[NX], yf[HIG], wx( 0 ), wx( NX - 1 ), wy( HIG / 2 ), wy( 0 ) );
+
+} /* end GridInit() */
+
+
+void GridDeltaT( void )
+{
+unsigned i, j;
+
+	deltaT_X = deltaT / deltaX;
+	deltaT_Y = deltaT / deltaY;
+	deltaT_Z = deltaT / deltaZ;
+	for( i = 0; i <= LENN; i++ ) dtX[i] = deltaT / dX[i];
+	for( j = 0; j <= HIGG; j++ ) dtY[j] = deltaT / dY[j];
+
+} /* end GridDeltaT() */
+
+
+int GridStretched( void )
+{
+	return stretched;
+}
+
+
+int GridCells( int axis )
+{
+	return axis == 0 ? NX : axis == 1 ? (int)HIG : (int)DEP;
+}
+
+
+double GridFace( int axis, int I )
+{
+int N = GridCells( axis );
+
+	if( I < 0 ) I = 0;
+	if( I > N ) I = N;
+	return axis == 0 ? xf[I] : axis == 1 ? yf[I] : I * (double)deltaZ;
+}
+
+
+double GridCentre( int axis, int I )
+{
+	return 0.5 * ( GridFace( axis, I ) + GridFace( axis, I + 1 ) );
+}
+
+
+int GridCell( int axis, double x )
+{
+int lo = 0, hi = GridCells( axis ), mid;
+
+	while( hi - lo > 1 ) {
+		mid = ( lo + hi ) / 2;
+		if( GridFace( axis, mid ) <= x ) lo = mid;
+		else hi = mid;
+	}
+	return lo;
+
+} /* end GridCell() */
+
+
+void GridXdmf( FILE *pF, int dims, int centres, const int lo[3], const int st[3], const int n[3] )
+{
+int a, m, I;
+
+	if( dims == 3 )
+		fprintf( pF, "   <Topology TopologyType=\"3DRectMesh\" Dimensions=\"%d %d %d\"/>\n", n[2], n[1], n[0] );
+	else
+		fprintf( pF, "   <Topology TopologyType=\"2DRectMesh\" Dimensions=\"%d %d\"/>\n", n[1], n[0] );
+	fprintf( pF, "   <Geometry GeometryType=\"%s\">\n", dims == 3 ? "VXVYVZ" : "VXVY" );
+	for( a = 0; a < dims; a++ ) {
+		fprintf( pF, "    <DataItem Format=\"XML\" Dimensions=\"%d\">", n[a] );
+		for( m = 0; m < n[a]; m++ ) {
+			I = lo[a] + m * st[a];
+			fprintf( pF, m ? " %.9g" : "%.9g", centres ? GridCentre( a, I ) : GridFace( a, I ) );
+		}
+		fprintf( pF, "</DataItem>\n" );
+	}
+	fprintf( pF, "   </Geometry>\n" );
+
+} /* end GridXdmf() */
+
+
+/*
+* halfFaces - Faces f[0..n] of the n rows of a half of length L, from the centre: nf rows
+* of w/nf, then rows growing by the ratio r that fills it, h (r + r^2 + ... + r^(n-nf)) = L - w.
+*/
+static void halfFaces( double w, int nf, int n, double L, double *f )
+{
+double h = w / nf, r = 1., lo = 1., hi = 10., s;
+int m = n - nf, q;
+
+	if( m > 0 && h * m < L - w ) {
+		for( q = 0; q < 100; q++ ) {
+			r = 0.5 * ( lo + hi );
+			s = h * r * ( pow( r, m ) - 1. ) / ( r - 1. );
+			if( s < L - w ) lo = r;
+			else hi = r;
+		}
+	}
+	f[0] = 0.;
+	for( q = 1; q <= n; q++ ) f[q] = f[q-1] + ( q <= nf ? h : h * pow( r, q - nf ) );
+	f[n] = L;
+
+} /* end halfFaces() */
+
+
+void GridBandY( const double w[2], int nf )
+{
+int n = HIG / 2, J, q;
+double L = 0.5 * HIG * (double)deltaY, yc = L, *f;
+
+	if( ( f = (double *)malloc( ( n + 1 ) * sizeof(double) ) ) == NULL ) {
+		fprintf( stderr, "mpi_layer2: can't allocate memory for the grid.\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	if( nf < 1 ) nf = 1;
+	if( nf > n ) nf = n;
+	for( J = 0; J < 2; J++ ) {
+		band[J] = w[J] < L * nf / n ? w[J] : L * nf / n;   /* the rows do not shrink towards the wall */
+		halfFaces( band[J], nf, n, L, f );
+		for( q = 0; q <= n; q++ ) {
+			if( J == 0 ) yf[n - q] = yc - f[q];
+			else         yf[n + q] = yc + f[q];
+		}
+	}
+	free( f );
+	bandFine = nf;
+	stretched = 1;
+
+	rows( );
+	filterWidths( );
+	GridDeltaT( );
+
+} /* end GridBandY() */
+
+
+int GridBand( double w[2] )
+{
+	w[0] = bandFine ? band[0] : 0.;
+	w[1] = bandFine ? band[1] : 0.;
+	return bandFine;
+}
+
+
+/*
+* minmod - The smaller of two slopes of the same sign, else 0.
+*/
+static double minmod( double a, double b )
+{
+	if( a * b <= 0. ) return 0.;
+	return fabs( a ) < fabs( b ) ? a : b;
+}
+
+
+void GridRemapY( const double *from, const double *q, double *out )
+{
+int J, m, o, n = HIG;
+double a, b, x0, x1, sum;
+
+	//--- limited linear profile in the old rows, flat next to the walls
+	for( J = 0; J < n; J++ ) {
+		if( J == 0 || J == n - 1 ) { slope[J] = 0.; continue; }
+		slope[J] = minmod( ( q[J] - q[J-1] ) / ( 0.5 * ( from[J+1] - from[J-1] ) ),
+		                   ( q[J+1] - q[J] ) / ( 0.5 * ( from[J+2] - from[J] ) ) );
+	}
+
+	//--- averages of the profile over the new rows
+	for( J = 0, o = 0; o < n; o++ ) {
+		a = yf[o]; b = yf[o+1];
+		while( J < n - 1 && from[J+1] <= a ) J++;
+		for( sum = 0., m = J; m < n && from[m] < b; m++ ) {
+			x0 = from[m] > a ? from[m] : a;
+			x1 = from[m+1] < b ? from[m+1] : b;
+			if( x1 > x0 ) sum += ( x1 - x0 ) * ( q[m] + slope[m] * ( 0.5 * ( x0 + x1 ) - 0.5 * ( from[m] + from[m+1] ) ) );
+		}
+		out[o] = sum / ( b - a );
+	}
+
+} /* end GridRemapY() */
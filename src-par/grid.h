@@ -0,0 +1,56 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include <stdio.h> // FILE
+
+/*
+* GridInit - Face coordinates in x (g_x) and y (g_y) and the spacing arrays of _this_
+* process (global.h). Called by Initialize() once LEN, HIG, DEP and the deltas are set.
+*/
+void GridInit( int myid );
+
+/*
+* GridDeltaT - deltaT_X, deltaT_Y, deltaT_Z and the arrays dtX, dtY after deltaT has changed.
+*/
+void GridDeltaT( void );
+
+/*
+* GridStretched - 1 if the spacing varies in x or y.
+*/
+int GridStretched( void );
+
+/*
+* Global cells along the axis 0-x, 1-y, 2-z (0-based): their number, the coordinate of
+* face I (0..GridCells()), of the centre of cell I, and the cell holding x (clamped).
+*/
+int    GridCells( int axis );
+double GridFace( int axis, int I );
+double GridCentre( int axis, int I );
+int    GridCell( int axis, double x );
+
+/*
+* GridXdmf - Writes the rectilinear XDMF topology and geometry of a stretched grid: points
+* at the faces lo + m*st (centres = 0) or at the centres of cells lo + m*st (centres = 1),
+* m < n, along x, y and, if dims = 3, z.
+*/
+void GridXdmf( FILE *pF, int dims, int centres, const int lo[3], const int st[3], const int n[3] );
+
+/*
+* GridBandY - Lays the rows out anew about the face HIG/2: in each half nf rows share the
+* band of half-width w[0] below, w[1] above it, the rest grow towards the wall. The spacing
+* arrays follow; the solution is not touched (GridRemapY).
+*/
+void GridBandY( const double w[2], int nf );
+
+/*
+* GridBand - The half-widths of the band and the rows in it (returned), 0 if not banded.
+*/
+int GridBand( double w[2] );
+
+/*
+* GridRemapY - Averages q[HIG] of the rows between the faces from[HIG+1] over the current
+* rows into out[HIG], conservatively (limited linear profile).
+*/
+void GridRemapY( const double *from, const double *q, double *out );
+
+#endif
@@ -0,0 +1,354 @@
+/*
+*  H5OUTPUT
+*
+*  Optional HDF5 backend for the flowfield frames (f_format = 2) and for the
+*  backup (b_format = 1). Compiled in only when the Makefile finds an HDF5
+*  library (USE_HDF5).
+*
+*  Every field is a float dataset [DEP][HIG][LEN*numprocs] (x running fastest,
+*  as in "<step>.snap"), chunked so that one chunk is exactly the x-slab of one
+*  process and compressed with the shuffle + deflate filters. Step, time, time
+*  step, grid spacings and model constants are stored as attributes of the root
+*  group, so a post-processing tool may read only the planes it needs.
+*
+*  With a parallel HDF5 library all processes write collectively through the
+*  MPI-IO driver. With a serial library the processes write their slabs in turn.
+*
+*/
+#include "mpi.h"
+#include <stdio.h>     /* printf() etc.*/
+#include <stdlib.h>    /* malloc()     */
+
+#include "type.h"
+#include "def.h"      /* Definitions, parameters */
+#include "global.h"   /* global variables */
+#include "config.h"
+#include "output.h"   /* CellValues() */
+
+#include "h5output.h"
+
+#ifdef USE_HDF5
+
+#include <hdf5.h>
+
+/* dataset names of the backup fields */
+static const char *backupNames[5] = { "U1", "U2", "U3", "U4", "U5" };
+
+/* staging buffer, field-major then k, j, i */
+static float *h5Buf = NULL;
+static unsigned h5BufFields = 0;
+
+
+static float *stagingBuffer( unsigned nf )
+{
+	if( nf > h5BufFields ) {
+		free( h5Buf );
+		if( ( h5Buf = (float *)malloc( (size_t)nf * LEN * HIG * DEP * sizeof(float) ) ) == NULL ) {
+			fprintf( stderr, "mpi_layer2: can't allocate memory for HDF5 output.\n" );
+			MPI_Abort( MPI_COMM_WORLD, 1 );
+		}
+		h5BufFields = nf;
+	}
+	return h5Buf;
+} /* end stagingBuffer() */
+
+
+static void attrInt( hid_t loc, const char *name, int v )
+{
+hid_t sp = H5Screate( H5S_SCALAR );
+hid_t at = H5Acreate2( loc, name, H5T_NATIVE_INT, sp, H5P_DEFAULT, H5P_DEFAULT );
+	H5Awrite( at, H5T_NATIVE_INT, &v );
+	H5Aclose( at ); H5Sclose( sp );
+}
+
+static void attrDouble( hid_t loc, const char *name, double v )
+{
+hid_t sp = H5Screate( H5S_SCALAR );
+hid_t at = H5Acreate2( loc, name, H5T_NATIVE_DOUBLE, sp, H5P_DEFAULT, H5P_DEFAULT );
+	H5Awrite( at, H5T_NATIVE_DOUBLE, &v );
+	H5Aclose( at ); H5Sclose( sp );
+}
+
+/*
+* missing - Aborts the restart from "backup.h5" that lacks the attribute or dataset name.
+*/
+static void missing( const char *what, const char *name )
+{
+int myid;
+
+	MPI_Comm_rank( MPI_COMM_WORLD, &myid );
+	if( 0 == myid ) fprintf( stderr, "mpi_layer2: can't read the %s \"%s\" of \"backup.h5\".\n", what, name );
+	MPI_Abort( MPI_COMM_WORLD, 1 );
+}
+
+static int readAttrInt( hid_t loc, const char *name )
+{
+int v = 0;
+hid_t at = H5Aopen( loc, name, H5P_DEFAULT );
+	if( at < 0 || H5Aread( at, H5T_NATIVE_INT, &v ) < 0 ) missing( "attribute", name );
+	H5Aclose( at );
+	return v;
+}
+
+static double readAttrDouble( hid_t loc, const char *name )
+{
+double v = 0.;
+hid_t at = H5Aopen( loc, name, H5P_DEFAULT );
+	if( at < 0 || H5Aread( at, H5T_NATIVE_DOUBLE, &v ) < 0 ) missing( "attribute", name );
+	H5Aclose( at );
+	return v;
+}
+
+
+/*
+* writeAttributes - Metadata of the run, the same on every process.
+*/
+static void writeAttributes( hid_t file, const Frame *f, int numprocs )
+{
+	attrInt( file, "step", f->step );
+	attrDouble( file, "time", f->time );
+	attrDouble( file, "deltaT", f->deltaT );
+	attrDouble( file, "deltaX", deltaX );
+	attrDouble( file, "deltaY", deltaY );
+	attrDouble( file, "deltaZ", deltaZ );
+	attrInt( file, "LEN", LEN * numprocs );
+	attrInt( file, "HIG", HIG );
+	attrInt( file, "DEP", DEP );
+	attrInt( file, "numprocs", numprocs );
+	attrDouble( file, "mu_L", mu_L );
+	attrDouble( file, "Pr_L", Pr_L );
+	attrDouble( file, "Pr_T", Pr_T );
+	attrDouble( file, "Cs", Cs );
+	attrDouble( file, "maxCoNum", maxCoNum );
+	attrInt( file, "nStages", nStages );
+	attrDouble( file, "X", f->X );
+} /* end writeAttributes() */
+
+
+/*
+* slabSpaces - File and memory dataspaces of the x-slab of _this_ process.
+*/
+static void slabSpaces( int myid, int numprocs, hid_t *fspace, hid_t *mspace )
+{
+hsize_t dims[3], count[3], start[3];
+
+	dims[0]  = DEP; dims[1]  = HIG; dims[2]  = (hsize_t)LEN * numprocs;
+	count[0] = DEP; count[1] = HIG; count[2] = LEN;
+	start[0] = 0;   start[1] = 0;   start[2] = (hsize_t)LEN * myid;
+
+	*fspace = H5Screate_simple( 3, dims, NULL );
+	H5Sselect_hyperslab( *fspace, H5S_SELECT_SET, start, NULL, count, NULL );
+	*mspace = H5Screate_simple( 3, count, NULL );
+} /* end slabSpaces() */
+
+
+/*
+* writeFields - Writes nf staged fields of every process into the new file "filename".
+*/
+static void writeFields( const char *filename, const Frame *f, int myid, int numprocs,
+                         unsigned nf, const char **names, const float *buf )
+{
+hid_t file, dcpl, dset, fspace, mspace, dxpl;
+hsize_t chunk[3];
+unsigned l;
+size_t n = (size_t)LEN * HIG * DEP;
+
+	//--- chunk = slab of one process (under the 4 GB limit of HDF5), shuffle + deflate
+	chunk[0] = DEP; chunk[1] = HIG; chunk[2] = LEN;
+	while( chunk[0] > 1 && chunk[0] * chunk[1] * chunk[2] * sizeof(float) > ( 1u << 30 ) )
+		chunk[0] = ( chunk[0] + 1 ) / 2;
+	dcpl = H5Pcreate( H5P_DATASET_CREATE );
+	H5Pset_chunk( dcpl, 3, chunk );
+	if( config.h5_deflate > 0 && H5Zfilter_avail( H5Z_FILTER_DEFLATE ) ) {
+		H5Pset_shuffle( dcpl );
+		H5Pset_deflate( dcpl, config.h5_deflate );
+	}
+	slabSpaces( myid, numprocs, &fspace, &mspace );
+
+#ifdef H5_HAVE_PARALLEL
+	{
+	hid_t fapl = H5Pcreate( H5P_FILE_ACCESS );
+		H5Pset_fapl_mpio( fapl, OutputComm, MPI_INFO_NULL );
+		file = H5Fcreate( filename, H5F_ACC_TRUNC, H5P_DEFAULT, fapl );
+		H5Pclose( fapl );
+	}
+	dxpl = H5Pcreate( H5P_DATASET_XFER );
+	H5Pset_dxpl_mpio( dxpl, H5FD_MPIO_COLLECTIVE );
+
+	writeAttributes( file, f, numprocs );
+	for( l = 0; l < nf; l++ ) {
+		dset = H5Dcreate2( file, names[l], H5T_NATIVE_FLOAT, fspace, H5P_DEFAULT, dcpl, H5P_DEFAULT );
+		H5Dwrite( dset, H5T_NATIVE_FLOAT, mspace, fspace, dxpl, buf + l * n );
+		H5Dclose( dset );
+	}
+	H5Fclose( file );
+#else
+	//--- serial library: the processes take turns, root creates the file
+	{
+	int r;
+	dxpl = H5Pcreate( H5P_DATASET_XFER );
+	for( r = 0; r < numprocs; r++ ) {
+		if( r == myid ) {
+			if( 0 == myid ) {
+				file = H5Fcreate( filename, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT );
+				writeAttributes( file, f, numprocs );
+			}
+			else file = H5Fopen( filename, H5F_ACC_RDWR, H5P_DEFAULT );
+			for( l = 0; l < nf; l++ ) {
+				if( 0 == myid )
+					dset = H5Dcreate2( file, names[l], H5T_NATIVE_FLOAT, fspace, H5P_DEFAULT, dcpl, H5P_DEFAULT );
+				else
+					dset = H5Dopen2( file, names[l], H5P_DEFAULT );
+				H5Dwrite( dset, H5T_NATIVE_FLOAT, mspace, fspace, dxpl, buf + l * n );
+				H5Dclose( dset );
+			}
+			H5Fclose( file );
+		}
+		MPI_Barrier( OutputComm );
+	}
+	}
+#endif
+
+	H5Pclose( dxpl );
+	H5Pclose( dcpl );
+	H5Sclose( mspace );
+	H5Sclose( fspace );
+
+} /* end writeFields() */
+
+
+void OutputHDF5( const Frame *f, int myid )
+{
+char filename[30];
+int numprocs;
+unsigned i, j, k, l;
+size_t n = (size_t)LEN * HIG * DEP;
+float *buf;
+real v[OUT_NVARS];
+
+	MPI_Comm_size( OutputComm, &numprocs );
+
+	buf = stagingBuffer( OUT_NFIELDS );
+	for( k = 1; k < DEPP; k++ ) {
+		for( j = 1; j < HIGG; j++ ) {
+			for( i = 1; i < LENN; i++ ) {
+				CellValues( f, i, j, k, myid, v );
+				for( l = 0; l < OUT_NFIELDS; l++ )
+					buf[l*n + ((k-1)*HIG + (j-1))*LEN + (i-1)] = v[l+3];
+			}
+		}
+	}
+
+	sprintf( filename, "%d.h5", f->step );
+	writeFields( filename, f, myid, numprocs, OUT_NFIELDS, OutputFieldNames, buf );
+
+	if( 0 == myid ) WriteXdmf( f, filename, LEN*numprocs, 1 );
+
+} /* end OutputHDF5() */
+
+
+void BackupHDF5( int myid )
+{
+Frame now;
+int numprocs;
+unsigned i, j, k;
+size_t n = (size_t)LEN * HIG * DEP, m;
+float *buf;
+
+	MPI_Comm_size( MPI_COMM_WORLD, &numprocs );
+
+	// the random seed evolves on root only
+	MPI_Bcast( &X, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD );
+
+	buf = stagingBuffer( 5 );
+	for( k = 1; k < DEPP; k++ ) {
+		for( j = 1; j < HIGG; j++ ) {
+			for( i = 1; i < LENN; i++ ) {
+				m = ((k-1)*HIG + (j-1))*LEN + (i-1);
+				buf[      m] = U1[i][j][k];
+				buf[  n + m] = U2[i][j][k];
+				buf[2*n + m] = U3[i][j][k];
+				buf[3*n + m] = U4[i][j][k];
+				buf[4*n + m] = U5[i][j][k];
+			}
+		}
+	}
+
+	// only the time-stepping state is taken from the frame
+	now.step = step; now.time = totalTime; now.deltaT = deltaT; now.X = X;
+	writeFields( "backup.h5", &now, myid, numprocs, 5, backupNames, buf );
+
+} /* end BackupHDF5() */
+
+
+void RestoreHDF5( int myid )
+{
+hid_t file, dset, fspace, mspace, fapl;
+int numprocs;
+unsigned i, j, k, l;
+size_t n = (size_t)LEN * HIG * DEP, m;
+float *buf;
+
+	MPI_Comm_size( MPI_COMM_WORLD, &numprocs );
+
+	fapl = H5Pcreate( H5P_FILE_ACCESS );
+#ifdef H5_HAVE_PARALLEL
+	H5Pset_fapl_mpio( fapl, MPI_COMM_WORLD, MPI_INFO_NULL );
+#endif
+	if( ( file = H5Fopen( "backup.h5", H5F_ACC_RDONLY, fapl ) ) < 0 ) {
+		fprintf( stderr, "mpi_layer2: can't open \"backup.h5\".\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	H5Pclose( fapl );
+
+	if( readAttrInt( file, "LEN" ) != (int)(LEN * numprocs) ||
+	    readAttrInt( file, "HIG" ) != (int)HIG || readAttrInt( file, "DEP" ) != (int)DEP ) {
+		if( 0 == myid )
+			fprintf( stderr, "mpi_layer2: \"backup.h5\" holds a %dx%dx%d grid, not %dx%dx%d.\n",
+			         readAttrInt( file, "LEN" ), readAttrInt( file, "HIG" ), readAttrInt( file, "DEP" ),
+			         LEN * numprocs, HIG, DEP );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+
+	buf = stagingBuffer( 5 );
+	slabSpaces( myid, numprocs, &fspace, &mspace );
+	for( l = 0; l < 5; l++ ) {
+		if( ( dset = H5Dopen2( file, backupNames[l], H5P_DEFAULT ) ) < 0 ||
+		    H5Dread( dset, H5T_NATIVE_FLOAT, mspace, fspace, H5P_DEFAULT, buf + l * n ) < 0 )
+			missing( "dataset", backupNames[l] );
+		H5Dclose( dset );
+	}
+	H5Sclose( mspace );
+	H5Sclose( fspace );
+
+	step      = readAttrInt( file, "step" );
+	totalTime = readAttrDouble( file, "time" );
+	deltaT    = readAttrDouble( file, "deltaT" );
+	X         = readAttrDouble( file, "X" );
+	H5Fclose( file );
+
+	for( k = 1; k < DEPP; k++ ) {
+		for( j = 1; j < HIGG; j++ ) {
+			for( i = 1; i < LENN; i++ ) {
+				m = ((k-1)*HIG + (j-1))*LEN + (i-1);
+				U1[i][j][k] = buf[      m];
+				U2[i][j][k] = buf[  n + m];
+				U3[i][j][k] = buf[2*n + m];
+				U4[i][j][k] = buf[3*n + m];
+				U5[i][j][k] = buf[4*n + m];
+			}
+		}
+	}
+
+	if( 0 == myid ) fprintf( stdout, "Restored step %d, time %f sec. from \"backup.h5\".\n", step, totalTime );
+
+} /* end RestoreHDF5() */
+
+#else /* !USE_HDF5 */
+
+/* config validation keeps these from being reached */
+void OutputHDF5( const Frame *f, int myid ) { }
+void BackupHDF5( int myid )  { }
+void RestoreHDF5( int myid ) { }
+
+#endif /* USE_HDF5 */
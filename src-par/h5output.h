@@ -0,0 +1,21 @@
+#ifndef H5OUTPUT_H
+#define H5OUTPUT_H
+
+#include "output.h" /* Frame */
+
+/*
+* OutputHDF5 - Writes the frame into "<step>.h5" (and "<step>.xmf" describing it).
+*/
+void OutputHDF5( const Frame *f, int myid );
+
+/*
+* BackupHDF5 - Saves conservative variables and time-stepping state to "backup.h5".
+*/
+void BackupHDF5( int myid );
+
+/*
+* RestoreHDF5 - Reads the slab of _this_ process and the time-stepping state from "backup.h5".
+*/
+void RestoreHDF5( int myid );
+
+#endif
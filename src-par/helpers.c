@@ -1,10 +1,13 @@
 #include "mpi.h"
 #include <stdlib.h>    /* atoi()       */
 #include <stdio.h>     /* printf() etc.*/
+#include <math.h>      /* fabs()       */
 #include "type.h"
 #include "def.h"
 #include "global.h"
 #include "helpers.h"
+#include "grid.h"
+#include "amr.h"
 
 /*
 * Random - Generator of the pseudo-random "doubles"
@@ -31,15 +34,21 @@ void checkCoNum( int myid ){
     for (j = 1; j < HIGG; j++) {
       for (i = 1; i < LENN; i++) {
 
-        //  We will just check velocity in X-axis (streamwise) direction
+        //  We will just check velocity in X-axis (streamwise) direction, and in y where the cells
+        //  of a stretched grid are the thinnest, each of the local width
         R = U1[i][j][k];
         U = U2[i][j][k]/R;
-        maxCo = ( (CoNum = U*deltaT_X) > maxCo ) ? CoNum : maxCo;
+        V = U3[i][j][k]/R;
+        maxCo = ( (CoNum = U*dtX[i]) > maxCo ) ? CoNum : maxCo;
+        maxCo = ( (CoNum = fabs(V)*dtY[j]) > maxCo ) ? CoNum : maxCo;
         
       }
     }
   }
 
+  // and the refined cells of the blocks
+  maxCo = ( (CoNum = AmrCoNum()) > maxCo ) ? CoNum : maxCo;
+
   // Allreduce maximum for maxCo
   MPI_Allreduce( &maxCo, &gloMaxCo, 1, MPI_FLOAT, MPI_MAX, MPI_COMM_WORLD );
 
@@ -53,7 +62,7 @@ void checkCoNum( int myid ){
   if (myid == 0) fprintf(stdout, "New time-step size:  %f\n", deltaT );
 
   // other adjustments as well:
-  deltaT_X = deltaT / deltaX;     deltaT_Y = deltaT / deltaY;     deltaT_Z = deltaT / deltaZ;
+  GridDeltaT();
 
 } /* end checkCoNum() */
 
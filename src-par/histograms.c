@@ -0,0 +1,305 @@
+/*
+*  HISTOGRAMS
+*
+*  Histograms and joint PDFs of flow quantities, accumulated in-situ every h_every
+*  steps. Every "histogram" key of the configuration file defines one of them:
+*
+*      histogram = vort  var=vorticity bins=64 range=0:2000
+*      histogram = sgs   var=muT_ratio bins=50 range=0:20   i=100:400
+*      histogram = quad  var=u',v'     bins=40,40 range=-60:60,-40:40 j=30:50
+*
+*  "var" takes one or two OutputFieldNames[], a name ending in ' being the
+*  fluctuation about the z-mean of its line at that step (so u',v' gives the
+*  quadrants of the Reynolds shear stress). "bins" and "range" give the bins of
+*  every variable, lo:hi; i, j, k restrict the region as in extract.c. Each cell
+*  of the region is one sample; samples out of the range are only counted.
+*
+*  The counters of a process are merged with those of the others by a single
+*  reduction when written, every h_write steps (default f_step) and at the end:
+*  root rewrites "<name>.hist" with the bin centres, counts and the PDF (over all
+*  samples, so it integrates to the fraction within the range). The counters are
+*  kept in memory only, so a continued run starts them afresh.
+*
+*/
+#include "mpi.h"
+#include <stdio.h>     /* printf() etc.*/
+#include <stdlib.h>    /* strtol()     */
+#include <string.h>    /* strtok_r()   */
+#include <math.h>      /* floor()      */
+
+#include "type.h"
+#include "def.h"      /* Definitions, parameters */
+#include "global.h"   /* global variables */
+#include "config.h"
+#include "output.h"   /* CellValues() */
+
+#include "histograms.h"
+
+typedef struct {
+	char name[32];
+	int  nd;                   /* 1-histogram, 2-joint PDF */
+	int  var[2], prime[2];     /* indices into OutputFieldNames[], 1-fluctuation */
+	int  nb[2];                /* bins */
+	double lo[2], hi[2];       /* range */
+	int  rlo[3], rhi[3];       /* region, global cells first..last (from 1) */
+	size_t off;                /* counters at cnt + off: the bins, then the samples out of range */
+} Histogram;
+
+static Histogram hs[CFG_LIST_MAX];
+static int on = 0, nHs = 0, hWrite, written = -1;
+static long long *cnt = NULL, *glob = NULL;
+static size_t nCnt = 0;
+static double *line = NULL;    /* values of a z-line, [DEP][2] */
+
+
+/*
+* parseRange - "a" or "a:b" within 1..nmax; returns 0 on success.
+*/
+static int parseRange( const char *s, int nmax, int *lo, int *hi )
+{
+char *end;
+
+	*lo = strtol( s, &end, 10 ); *hi = *lo;
+	if( *end == ':' ) *hi = strtol( end + 1, &end, 10 );
+	if( *end != '\0' || *lo < 1 || *hi < *lo || *hi > nmax ) return 1;
+	return 0;
+} /* end parseRange() */
+
+
+/*
+* parseHistogram - Fills h from the text of a "histogram" key; returns 0 on success.
+*/
+static int parseHistogram( const char *text, Histogram *h, int numprocs, int myid )
+{
+char buf[CFG_LIST_LEN], *tok, *val, *item, *end, *save1, *save2;
+int d, l, n, nb = 0, nr = 0, nmax[3];
+size_t len;
+
+	nmax[0] = LEN * numprocs; nmax[1] = HIG; nmax[2] = DEP;
+	for( d = 0; d < 3; d++ ) { h->rlo[d] = 1; h->rhi[d] = nmax[d]; }
+	h->nd = 0;
+	h->nb[0] = h->nb[1] = 64;
+
+	strcpy( buf, text );
+	if( ( tok = strtok_r( buf, " \t", &save1 ) ) == NULL || strchr( tok, '=' ) != NULL || strlen( tok ) >= sizeof(h->name) ) {
+		if( 0 == myid ) fprintf( stderr, "histogram \"%s\": the name must come first.\n", text );
+		return 1;
+	}
+	strcpy( h->name, tok );
+
+	while( ( tok = strtok_r( NULL, " \t", &save1 ) ) != NULL ) {
+		if( ( val = strchr( tok, '=' ) ) == NULL ) goto bad;
+		*val++ = '\0';
+		if( strcmp( tok, "var" ) == 0 ) {
+			for( item = strtok_r( val, ",", &save2 ); item != NULL; item = strtok_r( NULL, ",", &save2 ) ) {
+				if( h->nd == 2 ) goto bad;
+				len = strlen( item );
+				if( ( h->prime[h->nd] = ( len > 1 && item[len-1] == '\'' ) ) ) item[len-1] = '\0';
+				for( l = 0; l < OUT_NFIELDS && strcmp( item, OutputFieldNames[l] ) != 0; l++ );
+				if( l == OUT_NFIELDS ) goto bad;
+				h->var[h->nd++] = l;
+			}
+		}
+		else if( strcmp( tok, "bins" ) == 0 ) {
+			for( item = strtok_r( val, ",", &save2 ); item != NULL; item = strtok_r( NULL, ",", &save2 ) ) {
+				if( nb == 2 || ( n = strtol( item, &end, 10 ) ) < 1 || n > 100000 || *end != '\0' ) goto bad;
+				h->nb[nb++] = n;
+			}
+		}
+		else if( strcmp( tok, "range" ) == 0 ) {
+			for( item = strtok_r( val, ",", &save2 ); item != NULL; item = strtok_r( NULL, ",", &save2 ) ) {
+				if( nr == 2 ) goto bad;
+				h->lo[nr] = strtod( item, &end );
+				if( *end != ':' ) goto bad;
+				h->hi[nr] = strtod( end + 1, &end );
+				if( *end != '\0' || h->hi[nr] <= h->lo[nr] ) goto bad;
+				nr++;
+			}
+		}
+		else if( strlen( tok ) == 1 && ( d = tok[0] - 'i' ) >= 0 && d < 3 ) {
+			if( parseRange( val, nmax[d], &h->rlo[d], &h->rhi[d] ) ) goto bad;
+		}
+		else goto bad;
+	}
+	if( h->nd == 0 || nr != h->nd || ( nb != 0 && nb != h->nd ) ) {
+		if( 0 == myid ) fprintf( stderr, "histogram \"%s\": needs var and a range for each of its variables.\n", text );
+		return 1;
+	}
+	return 0;
+
+bad:
+	if( 0 == myid ) fprintf( stderr, "histogram \"%s\": bad \"%s\".\n", text, tok );
+	return 1;
+} /* end parseHistogram() */
+
+
+void HistogramsInit( int myid )
+{
+int numprocs, n, nErr = 0;
+
+	on = ( config.h_every > 0 && config.histogram.n > 0 );
+	if( !on ) return;
+
+	MPI_Comm_size( MPI_COMM_WORLD, &numprocs );
+
+	// every process parses the same broadcast text
+	for( n = 0; n < config.histogram.n; n++ )
+		nErr += parseHistogram( config.histogram.item[n], &hs[n], numprocs, myid );
+	if( nErr ) MPI_Abort( MPI_COMM_WORLD, 1 );
+	nHs = config.histogram.n;
+
+	//--- all counters in one array, for one reduction
+	for( nCnt = 0, n = 0; n < nHs; n++ ) {
+		hs[n].off = nCnt;
+		nCnt += (size_t)hs[n].nb[0] * ( hs[n].nd == 2 ? hs[n].nb[1] : 1 ) + 1;
+	}
+	cnt  = (long long *)calloc( nCnt, sizeof(long long) );
+	glob = (long long *)malloc( ( 0 == myid ? nCnt : 1 ) * sizeof(long long) );
+	line = (double *)malloc( 2 * DEP * sizeof(double) );
+	if( cnt == NULL || glob == NULL || line == NULL ) {
+		fprintf( stderr, "mpi_layer2: can't allocate memory for histograms.\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	hWrite = config.h_write > 0 ? config.h_write : f_step;
+
+	if( 0 == myid )
+		fprintf( stdout, "Histograms: %d, %lu counters, sampled every %d steps, written every %d steps.\n",
+		         nHs, (unsigned long)nCnt, config.h_every, hWrite );
+
+} /* end HistogramsInit() */
+
+
+/*
+* bin - Bin of x among nb over lo..hi, -1 out of the range.
+*/
+static int bin( double x, double lo, double hi, int nb )
+{
+double b = floor( ( x - lo ) / ( hi - lo ) * nb );
+
+	return ( b >= 0. && b < nb ) ? (int)b : -1;
+} /* end bin() */
+
+
+/*
+* addSamples - Counts the cells of the region of h on _this_ process.
+*/
+static void addSamples( const Histogram *h, const Frame *f, int myid )
+{
+long long *c = cnt + h->off;
+size_t nBins = (size_t)h->nb[0] * ( h->nd == 2 ? h->nb[1] : 1 );
+real v[OUT_NVARS];
+double avg[2];
+int i0, i1, i, j, k, d, b0, b1;
+
+	i0 = h->rlo[0] - myid * (int)LEN; if( i0 < 1 ) i0 = 1;
+	i1 = h->rhi[0] - myid * (int)LEN; if( i1 > (int)LEN ) i1 = LEN;
+
+	for( i = i0; i <= i1; i++ ) {
+		for( j = h->rlo[1]; j <= h->rhi[1]; j++ ) {
+
+			// the whole z-line, for the z-means of the fluctuations
+			avg[0] = avg[1] = 0.;
+			for( k = 1; k < (int)DEPP; k++ ) {
+				CellValues( f, i, j, k, myid, v );
+				for( d = 0; d < h->nd; d++ ) {
+					line[2*(k-1)+d] = v[h->var[d]+3];
+					avg[d] += v[h->var[d]+3];
+				}
+			}
+			for( d = 0; d < h->nd; d++ ) avg[d] = h->prime[d] ? avg[d] / DEP : 0.;
+
+			for( k = h->rlo[2]; k <= h->rhi[2]; k++ ) {
+				b0 = bin( line[2*(k-1)] - avg[0], h->lo[0], h->hi[0], h->nb[0] );
+				b1 = h->nd == 2 ? bin( line[2*(k-1)+1] - avg[1], h->lo[1], h->hi[1], h->nb[1] ) : 0;
+				if( b0 < 0 || b1 < 0 ) c[nBins]++;
+				else c[(size_t)b1 * h->nb[0] + b0]++;
+			}
+		}
+	}
+
+} /* end addSamples() */
+
+
+/*
+* writeHistogram - Root rewrites "<name>.hist" from the merged counters.
+*/
+static void writeHistogram( const Histogram *h )
+{
+const long long *c = glob + h->off;
+size_t nBins = (size_t)h->nb[0] * ( h->nd == 2 ? h->nb[1] : 1 ), b;
+long long total = 0;
+double w0 = ( h->hi[0] - h->lo[0] ) / h->nb[0], w1 = h->nd == 2 ? ( h->hi[1] - h->lo[1] ) / h->nb[1] : 1., pdf;
+char filename[64];
+FILE *pF;
+int d, b0, b1;
+
+	for( b = 0; b <= nBins; b++ ) total += c[b];
+
+	snprintf( filename, sizeof(filename), "%.31s.hist", h->name );
+	if( ( pF = fopen( filename, "w" ) ) == NULL ) {
+		fprintf( stderr, "can't open \"%s\".\n", filename );
+		return;
+	}
+	fprintf( pF, "# %s at step %d, time %g: %lld samples, %lld out of the range\n# ",
+	         h->name, step, totalTime, total, c[nBins] );
+	for( d = 0; d < h->nd; d++ ) fprintf( pF, "%s%s ", OutputFieldNames[h->var[d]], h->prime[d] ? "'" : "" );
+	fprintf( pF, "count pdf\n" );
+
+	for( b1 = 0; b1 < ( h->nd == 2 ? h->nb[1] : 1 ); b1++ ) {
+		if( h->nd == 2 ) fprintf( pF, "\n" );   /* blocks of constant second variable */
+		for( b0 = 0; b0 < h->nb[0]; b0++ ) {
+			b = (size_t)b1 * h->nb[0] + b0;
+			pdf = total > 0 ? c[b] / ( total * w0 * w1 ) : 0.;
+			fprintf( pF, "%.6g ", h->lo[0] + ( b0 + 0.5 ) * w0 );
+			if( h->nd == 2 ) fprintf( pF, "%.6g ", h->lo[1] + ( b1 + 0.5 ) * w1 );
+			fprintf( pF, "%lld %.6e\n", c[b], pdf );
+		}
+	}
+	fclose( pF );
+
+} /* end writeHistogram() */
+
+
+/*
+* writeAll - Merges the counters of all processes at root with one reduction and writes them.
+*/
+static void writeAll( int myid )
+{
+int n;
+
+	MPI_Reduce( cnt, glob, (int)nCnt, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD );
+	written = step;
+	if( 0 == myid )
+		for( n = 0; n < nHs; n++ ) writeHistogram( &hs[n] );
+
+} /* end writeAll() */
+
+
+/***************
+*  HISTOGRAMS  *   Samples every h_every steps, writes every h_write steps
+***************/
+void Histograms( int myid )
+{
+Frame now;
+int n;
+
+	if( !on ) return;
+
+	if( step % config.h_every == 0 ) {
+		CurrentFrame( &now );
+		for( n = 0; n < nHs; n++ ) addSamples( &hs[n], &now, myid );
+	}
+	if( step % hWrite == 0 ) writeAll( myid );
+
+} /* end Histograms() */
+
+
+void HistogramsFinalize( int myid )
+{
+	if( !on ) return;
+
+	if( written != (int)step ) writeAll( myid );
+	free( cnt ); free( glob ); free( line );
+	cnt = glob = NULL; line = NULL;
+
+} /* end HistogramsFinalize() */
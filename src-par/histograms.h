@@ -0,0 +1,19 @@
+#ifndef HISTOGRAMS_H
+#define HISTOGRAMS_H
+
+/*
+* HistogramsInit - Parses the "histogram" keys (h_every > 0) and allocates their counters.
+*/
+void HistogramsInit( int myid );
+
+/*
+* Histograms - Counts the samples every h_every steps, root writes "<name>.hist" every h_write.
+*/
+void Histograms( int myid );
+
+/*
+* HistogramsFinalize - Writes the last counts if not yet written and frees the counters.
+*/
+void HistogramsFinalize( int myid );
+
+#endif
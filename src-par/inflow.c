@@ -0,0 +1,330 @@
+/*
+*  INFLOW
+*
+*  Time-dependent inflow from the y-z planes of a precursor run. A run with
+*  i_record = x [m] records the conservative variables of the cells at x every
+*  i_rec_every steps into "precursor.bin"; a run with i_mode = 1 takes them, in
+*  place of the two streams with the random block, as the inflow of root:
+*
+*      header  PlaneHeader, 64 bytes
+*      record  double time, float U1..U5 [5][HIG][DEP]
+*
+*  Root streams the records through a reader thread filling a ring of i_prefetch
+*  planes ahead of the solver; at every step the inflow is interpolated linearly
+*  in time between the two planes around totalTime + i_offset. The solver reads
+*  only the planes the thread is done with, so the file is read while it goes on
+*  and waits only if the thread falls behind (counted and reported at the end).
+*  Past the last record the planes are replayed periodically (i_loop = 1) or the
+*  last one is held. HIG and DEP of the precursor must be those of this run.
+*
+*/
+#include "mpi.h"
+#include <stdio.h>     /* printf() etc.*/
+#include <stdlib.h>    /* malloc()     */
+#include <string.h>    /* memcmp()     */
+#include <math.h>      /* floor()      */
+#include <unistd.h>    /* ftruncate()  */
+#include <pthread.h>   /* the reader runs on a thread of its own */
+
+#include "type.h"
+#include "def.h"      /* Definitions, parameters */
+#include "global.h"   /* global variables */
+#include "config.h"
+#include "grid.h"     /* GridCell(), GridCentre() */
+
+#include "inflow.h"
+
+#define IN_MAGIC   "FSLPLANE"
+#define IN_VERSION 1
+#define IN_NVARS   5
+
+typedef struct {
+	char   magic[8];
+	int    version, hig, dep, nvars;
+	double deltaY, deltaZ, x;
+	char   pad[16];
+} PlaneHeader;
+
+static size_t planeN, recSize;     /* floats of a plane, bytes of a record */
+
+/* replay, root only */
+static FILE *pIn = NULL;
+static long nRec, nextRec;
+static double tFirst, period;
+static int wraps = 0;
+static float *slots = NULL, *plane = NULL;
+static double *slotTime = NULL;
+static int nSlots, head = 0, count = 0, eof = 0, stop = 0;
+static long waits = 0;
+static pthread_t reader;
+static pthread_mutex_t ringLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ringCond = PTHREAD_COND_INITIALIZER;
+
+/* recording, the process owning the plane */
+static FILE *pRec = NULL;
+static unsigned recI = 0;
+static float *recBuf = NULL;
+
+
+/*
+* recordTime - Time of record r of the file.
+*/
+static double recordTime( FILE *pF, long r )
+{
+double t = 0.;
+
+	fseek( pF, (long)sizeof(PlaneHeader) + r * (long)recSize, SEEK_SET );
+	if( fread( &t, sizeof(double), 1, pF ) != 1 ) t = HUGE_VAL;
+	return t;
+} /* end recordTime() */
+
+
+/*
+* readerThread - Fills the free slots of the ring with the next records.
+*/
+static void *readerThread( void *arg )
+{
+int s, ok;
+double t;
+
+	(void)arg;
+	for( ;; ) {
+		pthread_mutex_lock( &ringLock );
+		while( count == nSlots && !stop ) pthread_cond_wait( &ringCond, &ringLock );
+		if( stop ) { pthread_mutex_unlock( &ringLock ); break; }
+		s = ( head + count ) % nSlots;
+		pthread_mutex_unlock( &ringLock );
+
+		if( nextRec == nRec && config.i_loop ) { nextRec = 0; wraps++; }
+		ok = nextRec < nRec;
+		if( ok ) {
+			t = recordTime( pIn, nextRec );
+			ok = ( t != HUGE_VAL && fread( slots + s * planeN, sizeof(float), planeN, pIn ) == planeN );
+		}
+
+		//--- the slot is handed over, or the end of the planes
+		pthread_mutex_lock( &ringLock );
+		if( ok ) {
+			slotTime[s] = t + wraps * period;
+			nextRec++;
+			count++;
+		}
+		else eof = 1;
+		pthread_cond_broadcast( &ringCond );
+		pthread_mutex_unlock( &ringLock );
+		if( !ok ) break;
+	}
+	return NULL;
+
+} /* end readerThread() */
+
+
+/*
+* openRecord - The owner of the recorded plane opens "precursor.bin"; a continued run
+* drops the records past the time it starts from.
+*/
+static void openRecord( int numprocs, int myid )
+{
+PlaneHeader h;
+int I = GridCell( 0, config.i_record );
+long r, n;
+
+	if( I / (int)LEN != myid ) return;
+	recI = I - myid * LEN + 1;
+
+	if( ( recBuf = (float *)malloc( planeN * sizeof(float) ) ) == NULL ) {
+		fprintf( stderr, "mpi_layer2: can't allocate memory for the inflow planes.\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	if( Answer && ( pRec = fopen( "precursor.bin", "r+b" ) ) != NULL ) {
+		if( fread( &h, sizeof(h), 1, pRec ) == 1 && memcmp( h.magic, IN_MAGIC, 8 ) == 0 &&
+		    h.hig == (int)HIG && h.dep == (int)DEP ) {
+			fseek( pRec, 0, SEEK_END );
+			n = ( ftell( pRec ) - (long)sizeof(h) ) / (long)recSize;
+			for( r = 0; r < n && recordTime( pRec, r ) <= totalTime; r++ );
+			fflush( pRec );
+			if( ftruncate( fileno( pRec ), (long)sizeof(h) + r * (long)recSize ) != 0 )
+				fprintf( stderr, "can't truncate \"precursor.bin\".\n" );
+			fseek( pRec, 0, SEEK_END );
+			return;
+		}
+		fclose( pRec );
+	}
+	if( ( pRec = fopen( "precursor.bin", "wb" ) ) == NULL ) {
+		fprintf( stderr, "mpi_layer2: can't open \"precursor.bin\".\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	memset( &h, 0, sizeof(h) );
+	memcpy( h.magic, IN_MAGIC, 8 );
+	h.version = IN_VERSION; h.hig = HIG; h.dep = DEP; h.nvars = IN_NVARS;
+	h.deltaY = deltaY; h.deltaZ = deltaZ; h.x = GridCentre( 0, I );
+	fwrite( &h, sizeof(h), 1, pRec );
+
+} /* end openRecord() */
+
+
+/*
+* openReplay - Root opens "precursor.bin", finds the record to start from and starts the reader.
+*/
+static void openReplay( void )
+{
+PlaneHeader h;
+long lo, hi, mid;
+double t, tLast;
+
+	if( ( pIn = fopen( "precursor.bin", "rb" ) ) == NULL || fread( &h, sizeof(h), 1, pIn ) != 1 ||
+	    memcmp( h.magic, IN_MAGIC, 8 ) != 0 || h.version != IN_VERSION || h.nvars != IN_NVARS ) {
+		fprintf( stderr, "mpi_layer2: can't read the planes of \"precursor.bin\".\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	if( h.hig != (int)HIG || h.dep != (int)DEP ) {
+		fprintf( stderr, "mpi_layer2: \"precursor.bin\" has planes of %d x %d cells, not %d x %d.\n", h.hig, h.dep, HIG, DEP );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	fseek( pIn, 0, SEEK_END );
+	if( ( nRec = ( ftell( pIn ) - (long)sizeof(h) ) / (long)recSize ) < 1 ) {
+		fprintf( stderr, "mpi_layer2: no planes in \"precursor.bin\".\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	tFirst = recordTime( pIn, 0 );
+	tLast  = recordTime( pIn, nRec - 1 );
+	period = nRec > 1 ? tLast - tFirst + ( tLast - recordTime( pIn, nRec - 2 ) ) : 0.;
+
+	//--- the last record not after the start, on the right lap of a periodic replay
+	t = totalTime + config.i_offset;
+	if( config.i_loop && period > 0. && t > tFirst ) {
+		wraps = (int)floor( ( t - tFirst ) / period );
+		t -= wraps * period;
+	}
+	for( lo = 0, hi = nRec - 1; lo < hi; ) {
+		mid = ( lo + hi + 1 ) / 2;
+		if( recordTime( pIn, mid ) <= t ) lo = mid; else hi = mid - 1;
+	}
+	nextRec = lo;
+
+	nSlots   = config.i_prefetch;
+	slots    = (float *)malloc( (size_t)nSlots * planeN * sizeof(float) );
+	slotTime = (double *)malloc( nSlots * sizeof(double) );
+	plane    = (float *)malloc( planeN * sizeof(float) );
+	if( slots == NULL || slotTime == NULL || plane == NULL ) {
+		fprintf( stderr, "mpi_layer2: can't allocate memory for the inflow planes.\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	if( pthread_create( &reader, NULL, readerThread, NULL ) != 0 ) {
+		fprintf( stderr, "mpi_layer2: can't start the reader of the inflow planes.\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	fprintf( stdout, "Inflow: %ld planes of \"precursor.bin\" (x = %g m of the precursor), %s, %d prefetched.\n",
+	         nRec, h.x, config.i_loop ? "replayed periodically" : "the last one held", nSlots );
+
+} /* end openReplay() */
+
+
+void InflowInit( int myid )
+{
+int numprocs;
+
+	MPI_Comm_size( MPI_COMM_WORLD, &numprocs );
+	planeN  = (size_t)IN_NVARS * HIG * DEP;
+	recSize = sizeof(double) + planeN * sizeof(float);
+
+	if( config.i_mode == 1 && config.i_record >= 0. ) {
+		if( 0 == myid ) fprintf( stderr, "mpi_layer2: i_mode = 1 replays \"precursor.bin\", it can't be recorded in the same run.\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	if( config.i_record >= 0. ) openRecord( numprocs, myid );
+	if( config.i_mode == 1 && 0 == myid ) openReplay( );
+
+} /* end InflowInit() */
+
+
+/***********
+*  INFLOW  *   Root interpolates the inflow plane of the step
+***********/
+void Inflow( int myid )
+{
+double t = totalTime + config.i_offset, w = 0., ta, tb;
+float *a, *b;
+size_t n;
+
+	if( config.i_mode != 1 || 0 != myid ) return;
+
+	//--- drop the planes behind, wait only for those not read yet
+	pthread_mutex_lock( &ringLock );
+	for( ;; ) {
+		if( count >= 2 && slotTime[( head + 1 ) % nSlots] <= t ) {
+			head = ( head + 1 ) % nSlots; count--;
+			pthread_cond_broadcast( &ringCond );
+			continue;
+		}
+		if( count >= 2 || ( eof && count >= 1 ) ) break;
+		waits++;
+		pthread_cond_wait( &ringCond, &ringLock );
+	}
+	a = slots + head * planeN; ta = slotTime[head];
+	b = a; tb = ta;
+	if( count >= 2 ) { b = slots + ( ( head + 1 ) % nSlots ) * planeN; tb = slotTime[( head + 1 ) % nSlots]; }
+	pthread_mutex_unlock( &ringLock );
+
+	// the two slots stay out of the reach of the reader until dropped
+	if( tb > ta ) w = t <= ta ? 0. : ( t - ta ) / ( tb - ta );
+	for( n = 0; n < planeN; n++ ) plane[n] = (float)( ( 1. - w ) * a[n] + w * b[n] );
+
+} /* end Inflow() */
+
+
+const float *InflowPlane( void )
+{
+	return config.i_mode == 1 ? plane : NULL;
+}
+
+
+/*
+* InflowRecord - The owner of the recorded plane appends it every i_rec_every steps.
+*/
+void InflowRecord( void )
+{
+real ***U[IN_NVARS];
+unsigned j, k;
+int v;
+double t = totalTime;
+
+	if( pRec == NULL || step % config.i_rec_every ) return;
+
+	U[0] = U1; U[1] = U2; U[2] = U3; U[3] = U4; U[4] = U5;
+	for( v = 0; v < IN_NVARS; v++ )
+		for( j = 1; j < HIGG; j++ )
+			for( k = 1; k < DEPP; k++ )
+				recBuf[( (size_t)v * HIG + j - 1 ) * DEP + k - 1] = U[v][recI][j][k];
+	fwrite( &t, sizeof(double), 1, pRec );
+	fwrite( recBuf, sizeof(float), planeN, pRec );
+
+} /* end InflowRecord() */
+
+
+void InflowFlush( void )
+{
+	if( pRec != NULL ) fflush( pRec );
+}
+
+
+void InflowFinalize( int myid )
+{
+	if( pRec != NULL ) fclose( pRec );
+	pRec = NULL;
+	free( recBuf ); recBuf = NULL;
+
+	if( pIn == NULL ) return;
+	pthread_mutex_lock( &ringLock );
+	stop = 1;
+	pthread_cond_broadcast( &ringCond );
+	pthread_mutex_unlock( &ringLock );
+	pthread_join( reader, NULL );
+	fclose( pIn );
+	pIn = NULL;
+	if( waits > 0 ) fprintf( stdout, "Inflow: the solver waited %ld times for the reader of the planes.\n", waits );
+	free( slots ); free( slotTime ); free( plane );
+	slots = plane = NULL; slotTime = NULL;
+	(void)myid;
+
+} /* end InflowFinalize() */
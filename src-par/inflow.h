@@ -0,0 +1,32 @@
+#ifndef INFLOW_H
+#define INFLOW_H
+
+/*
+* InflowInit - Opens "precursor.bin" for recording (i_record >= 0) on the owner of the plane,
+* or for replay (i_mode = 1) on root, starting its reader thread.
+*/
+void InflowInit( int myid );
+
+/*
+* Inflow - Called every step after the time is advanced: root interpolates the inflow plane.
+*/
+void Inflow( int myid );
+
+/*
+* InflowPlane - The conservative variables of the inflow [5][HIG][DEP], NULL for the built-in streams.
+*/
+const float *InflowPlane( void );
+
+/*
+* InflowRecord - Appends the recorded plane every i_rec_every steps.
+*/
+void InflowRecord( void );
+
+/*
+* InflowFlush - Writes out the recorded planes still buffered.
+*/
+void InflowFlush( void );
+
+void InflowFinalize( int myid );
+
+#endif
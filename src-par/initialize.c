@@ -7,6 +7,10 @@
 #include "def.h"      /* Definitions, parameters */
 #include "global.h"   /* global variables */
 #include "helpers.h"  /* helper functions */
+#include "config.h"
+#include "h5output.h"
+#include "checkpoint.h"
+#include "grid.h"
 #include "initialize.h"
 
 /***************
@@ -23,66 +27,35 @@ MPI_File fh;
 MPI_Status status;
 float buf;
 
-	//--- root process (node w/rank 0) reads data from file "mpi_layer2.bin"
-	//    and broadcasts it to others
-	if(0 == myid) {
-		// open the file...
-		MPI_File_open(MPI_COMM_SELF, "mpi_layer2.bin", MPI_MODE_CREATE | MPI_MODE_RDWR, MPI_INFO_NULL, &fh);
-		MPI_File_set_view(fh, 0, MPI_FLOAT, MPI_FLOAT, "native", MPI_INFO_NULL);
-	}
-
-	//--- ... and reads/broadcast data (if myid == 0), otherwise receives it
-	i = 0;
-	do{
-
-		// syncronization
-		MPI_Barrier(MPI_COMM_WORLD);
-
-		// root reads the next data item
-		if (0 == myid)
-		    MPI_File_read(fh, &buf, 1, MPI_FLOAT, &status);
-
-		// root process broadcasts the next data item
-		MPI_Bcast(&buf, 1, MPI_FLOAT, 0, MPI_COMM_WORLD);
-
-		// For debugging. May cause a lot of lines in stdout for larger no. of processes...
-		// fprintf(stdout, "%d process: after broadcast %dth data item = %f\n",
-		// 			myid+1, i, buf);
-
-		// dispatch to specific parameters
-		switch (i) {
-			case  0: fprintf(stdout, "LEN    = %d\n", LEN    = buf); break;
-			case  1: fprintf(stdout, "HIG    = %d\n", HIG    = buf); break;
-			case  2: fprintf(stdout, "DEP    = %d\n", DEP    = buf); break;
-			case  3: fprintf(stdout, "deltaX = %f\n", deltaX = buf); break;
-			case  4: fprintf(stdout, "deltaY = %f\n", deltaY = buf); break;
-			case  5: fprintf(stdout, "deltaZ = %f\n", deltaZ = buf); break;
-			case  6: fprintf(stdout, "deltaT = %f\n", deltaT = buf); break;
-			case  7: fprintf(stdout, "Answer = %d\n", Answer = buf); break;
-			case  8: fprintf(stdout, "numstep= %d\n", numstep= buf); break;
-			case  9: fprintf(stdout, "mu_L   = %f\n", mu_L   = buf); break;
-			case 10: fprintf(stdout, "Pr_L   = %f\n", Pr_L   = buf); break;
-			case 11: fprintf(stdout, "Pr_T   = %f\n", Pr_T   = buf); break;
-			case 12: fprintf(stdout, "Cs     = %f\n", Cs     = buf); break;
-			case 13: fprintf(stdout, "bl_hig = %d\n", BL_HIG = buf); break;
-			case 14: fprintf(stdout, "Ua     = %f\n", Ua     = buf); break;						
-			case 15: fprintf(stdout, "Va     = %f\n", Va     = buf); break;
-			case 16: fprintf(stdout, "Wa     = %f\n", Wa     = buf); break;
-			case 17: fprintf(stdout, "Ns_min = %d\n", Ns_min = buf); break;
-			case 18: fprintf(stdout, "Nst    = %d\n", Nst    = buf); break;
-			case 19: fprintf(stdout, "f_step = %d\n", f_step = buf); break;
-			case 20: fprintf(stdout, "nStages = %d\n", nStages = buf); break;
-			case 21: fprintf(stdout, "maxCoNum = %f\n", maxCoNum = buf); break;	
-			default: break;
-		} // end switch
-
-		i++;
-
-	} while (i < 22);
-
-	//--- close file
-	if (0 == myid)
-	    MPI_File_close(&fh);
+	//--- root process (node w/rank 0) reads "mpi_layer2.ini" and broadcasts it to others
+	ReadConfig("mpi_layer2.ini", myid);
+
+	LEN      = config.LEN;
+	HIG      = config.HIG;
+	DEP      = config.DEP;
+	deltaX   = config.deltaX;
+	deltaY   = config.deltaY;
+	deltaZ   = config.deltaZ;
+	deltaT   = config.deltaT;
+	Answer   = config.Answer;
+	numstep  = config.numstep;
+	mu_L     = config.mu_L;
+	Pr_L     = config.Pr_L;
+	Pr_T     = config.Pr_T;
+	Cs       = config.Cs;
+	BL_HIG   = config.BL_HIG;
+	Ua       = config.Ua;
+	Va       = config.Va;
+	Wa       = config.Wa;
+	Ns_min   = config.Ns_min;
+	Nst      = config.Nst;
+	f_step   = config.f_step;
+	nStages  = config.nStages;
+	maxCoNum = config.maxCoNum;
+
+	//--- a checkpoint may have been written by another number of processes
+	if (1 == Answer && config.b_format == 2)
+		CheckpointGrid(myid);
 
 	//--- other initializatons
 	// complexes with deltas
@@ -109,6 +82,8 @@ float buf;
 	/* complex Cd * delta * delta in Smagorinsky model */
 	DD = pow( deltaX * deltaY * deltaZ, twoThirds ); // Filter width squared.
 	CsDD = Cs * DD;
+	// spacing by the cell index, stretched or not
+	GridInit(myid);
 
 	//--- dynamic allocation of memory
 	// total amount of memory required, for gas dynamics 5
@@ -175,12 +150,6 @@ float buf;
 	// 	MPI_Abort(MPI_COMM_WORLD, 1);
 	// }
 
-		/* array of probes */
-	if((probes=(float *)malloc(sizeof(float) * HIG)) == NULL) {
-		fprintf(stderr, "mpi_layer2: can't allocate memory for probes.\n");
-		MPI_Abort(MPI_COMM_WORLD, 1);
-	}
-
 	//--- Initial conditions
 	// start new simulation
 	if(0 == Answer) {
@@ -213,6 +182,16 @@ float buf;
 		step = 0;  /* null step number at the beginning */
 	}
 
+	// continue from the HDF5 backup
+	else if (config.b_format == 1) {
+		RestoreHDF5(myid);
+	}
+
+	// continue from the checkpoint
+	else if (config.b_format == 2) {
+		ReadCheckpoint(myid);
+	}
+
 	// continue previously saved simulation
 	else {
 		//
@@ -240,11 +219,6 @@ float buf;
 		MPI_File_close(&fh);
 	}
 
-	// create/open "probes.muid" file in binary mode
-	sprintf(filename, "probes.%d", myid);
-	if ((pFprobes = fopen(filename, "ab")) == NULL)
-		fprintf(stdout, "can't open \"%s\".\n", filename);
-
 	// first stage
 	Stage = 1;
 	U1_ = U1;
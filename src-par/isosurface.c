@@ -0,0 +1,441 @@
+/*
+*  ISOSURFACE
+*
+*  In-situ isosurfaces of the frame fields (Q, vorticity, ...) coloured by the
+*  pressure, written as small triangle meshes instead of the whole volume.
+*  Every "iso" key of the configuration file defines one of them:
+*
+*      iso = q5   every=10 field=Q         value=5
+*      iso = vort every=50 field=vorticity value=60
+*
+*  "every" defaults to f_step. The surface is taken through the cell centres by
+*  marching tetrahedra: each cube of eight neighbouring centres is cut into six
+*  tetrahedra along its main diagonal, which needs no ambiguity tables and leaves
+*  no holes between cubes. Vertices on a shared edge are stored once. z being
+*  periodic, the last layer of cubes joins the last centres to the first ones,
+*  placed a period on (z = Lz + deltaZ/2), so the surface is closed across z = Lz.
+*
+*  Each process meshes the cubes of its slab and those between its last cell and
+*  the first cell of the next process, whose values it receives. Vertices on that
+*  plane are made by both neighbours, so the mesh is not welded across the seams
+*  between processes (ParaView "Clean" merges them). The mesh goes to
+*  "<name>-<step>.iso": vertex coordinates float[nv][3], pressure float[nv] and
+*  triangles int[nt][3] (vertices counted over all processes), written by all
+*  processes in a single collective call per section, and "<name>-<step>.xmf"
+*  describes it.
+*
+*/
+#include "mpi.h"
+#include <stdio.h>     /* printf() etc.*/
+#include <stdlib.h>    /* malloc()     */
+#include <string.h>    /* strtok_r()   */
+
+#include "type.h"
+#include "def.h"      /* Definitions, parameters */
+#include "global.h"   /* global variables */
+#include "config.h"
+#include "output.h"   /* CellValues() */
+#include "grid.h"     /* GridCentre() */
+
+#include "isosurface.h"
+
+#define ISO_P 4       /* pressure in OutputFieldNames[] */
+
+typedef struct {
+	char name[32];
+	int  every;
+	int  field;       /* index into OutputFieldNames[] */
+	real value;
+} Iso;
+
+static Iso iso[CFG_LIST_MAX];
+static int nIso = 0;
+
+/* cell values of the fields in use, [LEN+1][HIG][DEP] (the extra plane comes from the next process) */
+static float *cellVal[OUT_NFIELDS];
+
+/* mesh of _this_ process */
+static float *vx = NULL, *vp = NULL;   /* vertex coordinates [nv][3] and pressure */
+static int *tri = NULL;                /* triangles [nt][3], local vertex numbers */
+static size_t nv, nt, vCap, tCap;
+
+/* edge -> vertex hash (open addressing), edges by their end points, 0 - empty slot */
+static unsigned long long *hA = NULL, *hB = NULL;
+static int *hVal = NULL;
+static size_t hCap = 0, hUsed;
+
+
+static int parseIso( const char *text, Iso *e, int myid )
+{
+char line[CFG_LIST_LEN], *tok, *val, *save;
+int l, hasValue = 0;
+
+	e->every = f_step;
+	e->field = -1;
+	strcpy( line, text );
+	if( ( tok = strtok_r( line, " \t", &save ) ) == NULL || strchr( tok, '=' ) != NULL || strlen( tok ) >= sizeof(e->name) ) {
+		if( 0 == myid ) fprintf( stderr, "iso \"%s\": the name must come first.\n", text );
+		return 1;
+	}
+	strcpy( e->name, tok );
+
+	while( ( tok = strtok_r( NULL, " \t", &save ) ) != NULL ) {
+		if( ( val = strchr( tok, '=' ) ) == NULL ) goto bad;
+		*val++ = '\0';
+		if( strcmp( tok, "every" ) == 0 ) {
+			if( ( e->every = atoi( val ) ) < 1 ) goto bad;
+		}
+		else if( strcmp( tok, "field" ) == 0 ) {
+			for( l = 0; l < OUT_NFIELDS && strcmp( val, OutputFieldNames[l] ) != 0; l++ );
+			if( l == OUT_NFIELDS ) goto bad;
+			e->field = l;
+		}
+		else if( strcmp( tok, "value" ) == 0 ) {
+			char *end;
+			e->value = strtod( val, &end );
+			if( *end != '\0' ) goto bad;
+			hasValue = 1;
+		}
+		else goto bad;
+	}
+	if( e->field < 0 || !hasValue ) {
+		if( 0 == myid ) fprintf( stderr, "iso \"%s\": needs field= and value=.\n", text );
+		return 1;
+	}
+	return 0;
+
+bad:
+	if( 0 == myid ) fprintf( stderr, "iso \"%s\": bad \"%s\".\n", text, tok );
+	return 1;
+} /* end parseIso() */
+
+
+void IsoInit( int myid )
+{
+int n, nErr = 0;
+
+	for( n = 0; n < config.iso.n; n++ )
+		nErr += parseIso( config.iso.item[n], &iso[n], myid );
+	if( nErr ) MPI_Abort( MPI_COMM_WORLD, 1 );
+	nIso = config.iso.n;
+
+} /* end IsoInit() */
+
+
+static void *grow( void *p, size_t n, size_t size )
+{
+	if( ( p = realloc( p, n * size ) ) == NULL ) {
+		fprintf( stderr, "mpi_layer2: can't allocate memory for isosurface.\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	return p;
+}
+
+
+static size_t hashSlot( unsigned long long a, unsigned long long b )
+{
+unsigned long long h = a * 0x9E3779B97F4A7C15ull + b * 0xC2B2AE3D27D4EB4Full;
+size_t m;
+
+	for( m = ( h ^ ( h >> 31 ) ) & ( hCap - 1 ); hA[m] != 0; m = ( m + 1 ) & ( hCap - 1 ) )
+		if( hA[m] == a && hB[m] == b ) break;
+	return m;
+}
+
+
+/*
+* hashReset - Empties the edge table, or doubles it keeping the entries (keep != 0).
+*/
+static void hashReset( size_t cap, int keep )
+{
+unsigned long long *oA = hA, *oB = hB;
+int *oV = hVal;
+size_t oCap = hCap, m, h;
+
+	hCap = cap;
+	hA   = (unsigned long long *)calloc( hCap, sizeof(unsigned long long) );
+	hB   = (unsigned long long *)malloc( hCap * sizeof(unsigned long long) );
+	hVal = (int *)malloc( hCap * sizeof(int) );
+	if( hA == NULL || hB == NULL || hVal == NULL ) {
+		fprintf( stderr, "mpi_layer2: can't allocate memory for isosurface.\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	hUsed = 0;
+	if( keep ) {
+		for( m = 0; m < oCap; m++ ) {
+			if( oA[m] == 0 ) continue;
+			h = hashSlot( oA[m], oB[m] );
+			hA[h] = oA[m]; hB[h] = oB[m]; hVal[h] = oV[m];
+			hUsed++;
+		}
+	}
+	free( oA ); free( oB ); free( oV );
+
+} /* end hashReset() */
+
+
+/*
+* edgeVertex - Vertex where the surface cuts the edge between the cell centres
+* a and b (global point numbers); made once, found again through the edge table.
+*/
+static int edgeVertex( unsigned long long a, unsigned long long b, const float *pa, const float *pb,
+                       float sa, float sb, float qa, float qb, real value )
+{
+unsigned long long t64;
+size_t h, m;
+float t;
+
+	// numbers from 1, 0 marks an empty slot
+	a++; b++;
+	if( a > b ) {
+		t64 = a; a = b; b = t64;
+		{ const float *tp = pa; pa = pb; pb = tp; }
+		t = sa; sa = sb; sb = t;
+		t = qa; qa = qb; qb = t;
+	}
+	if( 2 * ( hUsed + 1 ) > hCap ) hashReset( 2 * hCap, 1 );
+	h = hashSlot( a, b );
+	if( hA[h] != 0 ) return hVal[h];
+
+	//--- new vertex
+	if( nv == vCap ) {
+		vCap = vCap ? 2 * vCap : 4096;
+		vx = (float *)grow( vx, 3 * vCap, sizeof(float) );
+		vp = (float *)grow( vp, vCap, sizeof(float) );
+	}
+	t = ( value - sa ) / ( sb - sa );
+	for( m = 0; m < 3; m++ ) vx[3*nv + m] = pa[m] + t * ( pb[m] - pa[m] );
+	vp[nv] = qa + t * ( qb - qa );
+	hA[h] = a; hB[h] = b; hVal[h] = nv;
+	hUsed++;
+
+	return nv++;
+} /* end edgeVertex() */
+
+
+/*
+* addTriangle - Stores the triangle facing away from the side where the field exceeds the value.
+*/
+static void addTriangle( int v0, int v1, int v2, const float in[3] )
+{
+float e1[3], e2[3], nrm[3], d = 0.;
+int m, t;
+
+	if( v0 == v1 || v1 == v2 || v0 == v2 ) return;    /* degenerate: the surface passes a corner */
+	for( m = 0; m < 3; m++ ) {
+		e1[m] = vx[3*v1 + m] - vx[3*v0 + m];
+		e2[m] = vx[3*v2 + m] - vx[3*v0 + m];
+	}
+	nrm[0] = e1[1]*e2[2] - e1[2]*e2[1];
+	nrm[1] = e1[2]*e2[0] - e1[0]*e2[2];
+	nrm[2] = e1[0]*e2[1] - e1[1]*e2[0];
+	for( m = 0; m < 3; m++ ) d += nrm[m] * in[m];
+	if( d > 0. ) { t = v1; v1 = v2; v2 = t; }
+
+	if( nt == tCap ) {
+		tCap = tCap ? 2 * tCap : 4096;
+		tri = (int *)grow( tri, 3 * tCap, sizeof(int) );
+	}
+	tri[3*nt] = v0; tri[3*nt + 1] = v1; tri[3*nt + 2] = v2;
+	nt++;
+} /* end addTriangle() */
+
+
+/* the six tetrahedra of a cube around its diagonal 0-7, corner c at (c&1, c>>1&1, c>>2&1) */
+static const int cubeTets[6][4] = {
+	{ 0, 1, 3, 7 }, { 0, 3, 2, 7 }, { 0, 2, 6, 7 }, { 0, 6, 4, 7 }, { 0, 4, 5, 7 }, { 0, 5, 1, 7 }
+};
+
+
+/*
+* meshSlab - Isosurface of the cubes between the nxl planes of cell centres of _this_ process,
+* around z periodically.
+*/
+static void meshSlab( const Iso *e, int myid, int numprocs, unsigned nxl )
+{
+const float *s = cellVal[e->field], *q = cellVal[ISO_P];
+unsigned long long gid[8], NX = (unsigned long long)LEN * numprocs;
+float pos[8][3], sv[8], qv[8], dir[3];
+size_t idx;
+unsigned i, j, k, nk = DEP > 1 ? DEP : 0;
+int c, t, n, m, in, nIn, lone, ids[4], o[3], vv[4];
+
+	nv = nt = 0;
+	hashReset( hCap ? hCap : 1 << 16, 0 );
+
+	for( i = 0; i + 1 < nxl; i++ ) {
+		for( j = 0; j + 1 < HIG; j++ ) {
+			for( k = 0; k < nk; k++ ) {
+
+				//--- corners; cubes with nan or not cut are skipped
+				for( nIn = 0, c = 0; c < 8; c++ ) {
+					unsigned di = c & 1, dj = ( c >> 1 ) & 1, dk = ( c >> 2 ) & 1;
+					idx = ( (size_t)( i + di ) * HIG + j + dj ) * DEP + ( k + dk ) % DEP;
+					sv[c] = s[idx];
+					if( sv[c] != sv[c] ) break;
+					if( sv[c] > e->value ) nIn++;
+				}
+				if( c < 8 || nIn == 0 || nIn == 8 ) continue;
+
+				for( c = 0; c < 8; c++ ) {
+					unsigned di = c & 1, dj = ( c >> 1 ) & 1, dk = ( c >> 2 ) & 1;
+					idx = ( (size_t)( i + di ) * HIG + j + dj ) * DEP + ( k + dk ) % DEP;
+					qv[c] = q[idx];
+					pos[c][0] = GridCentre( 0, myid * LEN + i + di );
+					pos[c][1] = GridCentre( 1, j + dj );
+					pos[c][2] = ( k + dk + 0.5 ) * deltaZ;
+					// the first centres a period on are points of their own, k + dk = DEP
+					gid[c] = ( (unsigned long long)( k + dk ) * HIG + j + dj ) * NX + myid * LEN + i + di;
+				}
+
+				for( t = 0; t < 6; t++ ) {
+					for( in = 0, nIn = 0, n = 0; n < 4; n++ ) {
+						ids[n] = cubeTets[t][n];
+						if( sv[ids[n]] > e->value ) { in |= 1 << n; nIn++; }
+					}
+					if( nIn == 0 || nIn == 4 ) continue;
+
+					//--- direction from the outer to the inner vertices
+					for( m = 0; m < 3; m++ ) {
+						dir[m] = 0.;
+						for( n = 0; n < 4; n++ )
+							dir[m] += ( ( in >> n ) & 1 ? 1.f / nIn : -1.f / ( 4 - nIn ) ) * pos[ids[n]][m];
+					}
+
+					#define EV( A, B ) edgeVertex( gid[A], gid[B], pos[A], pos[B], sv[A], sv[B], qv[A], qv[B], e->value )
+					if( nIn == 1 || nIn == 3 ) {
+						// one vertex on its own side: a triangle around it
+						for( lone = 0; lone < 4; lone++ )
+							if( ( ( in >> lone ) & 1 ) == ( nIn == 1 ) ) break;
+						for( m = 0, n = 0; n < 4; n++ ) if( n != lone ) o[m++] = ids[n];
+						vv[0] = EV( ids[lone], o[0] );
+						vv[1] = EV( ids[lone], o[1] );
+						vv[2] = EV( ids[lone], o[2] );
+						addTriangle( vv[0], vv[1], vv[2], dir );
+					}
+					else {
+						// two and two: a quadrilateral A-C, A-D, B-D, B-C
+						int A = -1, B = -1, C = -1, D = -1;
+						for( n = 0; n < 4; n++ ) {
+							if( ( in >> n ) & 1 ) { if( A < 0 ) A = ids[n]; else B = ids[n]; }
+							else                  { if( C < 0 ) C = ids[n]; else D = ids[n]; }
+						}
+						vv[0] = EV( A, C ); vv[1] = EV( A, D );
+						vv[2] = EV( B, D ); vv[3] = EV( B, C );
+						addTriangle( vv[0], vv[1], vv[2], dir );
+						addTriangle( vv[0], vv[2], vv[3], dir );
+					}
+					#undef EV
+				}
+			}
+		}
+	}
+} /* end meshSlab() */
+
+
+/*
+* writeMesh - All processes write their meshes into "<name>-<step>.iso", root describes it.
+*/
+static void writeMesh( const Iso *e, int myid )
+{
+char filename[64];
+FILE *pF;
+MPI_File fh;
+long long cnt[2], first[2] = { 0, 0 }, total[2];
+size_t m;
+
+	cnt[0] = nv; cnt[1] = nt;
+	MPI_Exscan( cnt, first, 2, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD );
+	if( 0 == myid ) first[0] = first[1] = 0;
+	MPI_Allreduce( cnt, total, 2, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD );
+
+	// vertex numbers over all processes
+	for( m = 0; m < 3 * nt; m++ ) tri[m] += (int)first[0];
+
+	snprintf( filename, sizeof(filename), "%.31s-%d.iso", e->name, step );
+	MPI_File_open( MPI_COMM_WORLD, filename, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fh );
+	MPI_File_set_size( fh, 0 );
+	MPI_File_write_at_all( fh, 12 * first[0], vx, 3 * nv, MPI_FLOAT, MPI_STATUS_IGNORE );
+	MPI_File_write_at_all( fh, 12 * total[0] + 4 * first[0], vp, nv, MPI_FLOAT, MPI_STATUS_IGNORE );
+	MPI_File_write_at_all( fh, 16 * total[0] + 12 * first[1], tri, 3 * nt, MPI_INT, MPI_STATUS_IGNORE );
+	MPI_File_close( &fh );
+
+	if( 0 != myid ) return;
+
+	fprintf( stdout, "Isosurface %s = %g of \"%s\": %lld triangles.\n", OutputFieldNames[e->field], e->value, e->name, total[1] );
+
+	snprintf( filename, sizeof(filename), "%.31s-%d.xmf", e->name, step );
+	if( ( pF = fopen( filename, "w" ) ) == NULL ) {
+		fprintf( stderr, "can't open \"%s\".\n", filename );
+		return;
+	}
+	filename[strlen( filename ) - 3] = '\0';
+	fprintf( pF, "<?xml version=\"1.0\" ?>\n" );
+	fprintf( pF, "<Xdmf Version=\"2.0\">\n <Domain>\n" );
+	fprintf( pF, "  <Grid Name=\"%s\" GridType=\"Uniform\">\n", e->name );
+	fprintf( pF, "   <Time Value=\"%g\"/>\n", totalTime );
+	fprintf( pF, "   <Topology TopologyType=\"Triangle\" NumberOfElements=\"%lld\">\n", total[1] );
+	fprintf( pF, "    <DataItem Format=\"Binary\" NumberType=\"Int\" Precision=\"4\" Endian=\"Native\"" );
+	fprintf( pF, " Seek=\"%lld\" Dimensions=\"%lld 3\">%siso</DataItem>\n", 16 * total[0], total[1], filename );
+	fprintf( pF, "   </Topology>\n" );
+	fprintf( pF, "   <Geometry GeometryType=\"XYZ\">\n" );
+	fprintf( pF, "    <DataItem Format=\"Binary\" NumberType=\"Float\" Precision=\"4\" Endian=\"Native\"" );
+	fprintf( pF, " Seek=\"0\" Dimensions=\"%lld 3\">%siso</DataItem>\n", total[0], filename );
+	fprintf( pF, "   </Geometry>\n" );
+	fprintf( pF, "   <Attribute Name=\"p\" AttributeType=\"Scalar\" Center=\"Node\">\n" );
+	fprintf( pF, "    <DataItem Format=\"Binary\" NumberType=\"Float\" Precision=\"4\" Endian=\"Native\"" );
+	fprintf( pF, " Seek=\"%lld\" Dimensions=\"%lld\">%siso</DataItem>\n", 12 * total[0], total[0], filename );
+	fprintf( pF, "   </Attribute>\n" );
+	fprintf( pF, "  </Grid>\n </Domain>\n</Xdmf>\n" );
+	fclose( pF );
+
+} /* end writeMesh() */
+
+
+/****************
+*  ISOSURFACES  *   Extracts and writes the isosurfaces due at the current step
+****************/
+void Isosurfaces( int myid, int numprocs )
+{
+Frame now;
+unsigned i, j, k, l, nxl;
+int n, due = 0, use[OUT_NFIELDS];
+size_t plane = (size_t)HIG * DEP, idx;
+real v[OUT_NVARS];
+
+	memset( use, 0, sizeof(use) );
+	for( n = 0; n < nIso; n++ )
+		if( step % iso[n].every == 0 ) { due = 1; use[iso[n].field] = use[ISO_P] = 1; }
+	if( !due ) return;
+
+	//--- values at the cell centres of the fields needed, plane i-1 for cell i
+	for( l = 0; l < OUT_NFIELDS; l++ )
+		if( use[l] && cellVal[l] == NULL ) cellVal[l] = (float *)grow( NULL, ( LEN + 1 ) * plane, sizeof(float) );
+	CurrentFrame( &now );
+	for( i = 1; i < LENN; i++ ) {
+		for( j = 1; j < HIGG; j++ ) {
+			for( k = 1; k < DEPP; k++ ) {
+				CellValues( &now, i, j, k, myid, v );
+				idx = ( (size_t)( i - 1 ) * HIG + j - 1 ) * DEP + k - 1;
+				for( l = 0; l < OUT_NFIELDS; l++ )
+					if( use[l] ) cellVal[l][idx] = v[l + 3];
+			}
+		}
+	}
+
+	//--- first plane of the next process closes the gap between the slabs
+	for( l = 0; l < OUT_NFIELDS; l++ ) {
+		if( !use[l] ) continue;
+		MPI_Sendrecv( cellVal[l], plane, MPI_FLOAT, myid > 0 ? myid - 1 : MPI_PROC_NULL, 31,
+		              cellVal[l] + LEN * plane, plane, MPI_FLOAT, myid < numprocs - 1 ? myid + 1 : MPI_PROC_NULL, 31,
+		              MPI_COMM_WORLD, MPI_STATUS_IGNORE );
+	}
+	nxl = ( myid < numprocs - 1 ) ? LEN + 1 : LEN;
+
+	for( n = 0; n < nIso; n++ ) {
+		if( step % iso[n].every ) continue;
+		meshSlab( &iso[n], myid, numprocs, nxl );
+		writeMesh( &iso[n], myid );
+	}
+
+} /* end Isosurfaces() */
@@ -0,0 +1,14 @@
+#ifndef ISOSURFACE_H
+#define ISOSURFACE_H
+
+/*
+* IsoInit - Parses the "iso" keys of the configuration; a malformed one stops the run.
+*/
+void IsoInit( int myid );
+
+/*
+* Isosurfaces - Extracts and writes the isosurfaces due at the current step.
+*/
+void Isosurfaces( int myid, int numprocs );
+
+#endif
@@ -13,7 +13,6 @@
 #include <stdio.h>     /* printf() etc.*/
 #include <math.h>      /* sqrt()       */
 #include <stdlib.h>    /* atoi()       */
-#include <signal.h>    /* sigint function to stop the program execution */
 
 #include "type.h"
 #include "def.h"      /* Definitions, parameters */
@@ -28,7 +27,22 @@
 #include "evolution.h"
 #include "output.h"
 #include "probes.h"
+#include "statistics.h"
+#include "diagnostics.h"
+#include "spectra.h"
+#include "histograms.h"
+#include "events.h"
+#include "convergence.h"
+#include "inflow.h"
+#include "outflow.h"
+#include "adapt.h"
+#include "amr.h"
 #include "finalize.h"
+#include "control.h"
+#include "extract.h"
+#include "isosurface.h"
+#include "render.h"
+#include "checkpoint.h"
 
 
 
@@ -60,9 +74,11 @@ real
 	deltaT_X, deltaT_Y, deltaT_Z, /* convenient ratios */
 	_deltaX, _deltaY, _deltaZ,
 	_2deltaX, _2deltaY, _2deltaZ,
-	_4deltaX, _4deltaY, _4deltaZ,
-	// array of probes
-	*probes;
+	_4deltaX, _4deltaY, _4deltaZ;
+
+real /* spacing of the stretched grid by the cell index */
+	*dX, *dY, *_dX, *_dY, *_2dX, *_2dY, *_4dX, *_4dY,
+	*dtX, *dtY, *fX, *bX, *fY, *bY, **DDxy;
 
 real/* transport coefficients */
 	/* molecular */
@@ -75,6 +91,7 @@ real/* transport coefficients */
 	Cs, CsDD, DD;
 
 real maxCoNum;  /* maximum Courant number */
+real totalTime;  /* simulation time */
 int nStages;    /* number of stages of Runge-Kutta algorithm */
 
 /* MPI Buffer */
@@ -101,9 +118,6 @@ char
    Stage,    /* indicator of the current stage */
    str[80];  /* buffer string */
 
-//--- handles of "probes.myid" files
-FILE *pFprobes;
-
 //-- for randomized disturbing blocks	
 int 
     j_base, j_base_max = 6,
@@ -116,19 +130,13 @@ int BL_HIG,           /* height of the disturbing block            */
 real Ud, Vd, Wd,     /* curent disturbed velocities           */
 	 Ua, Va, Wa;     /* their amplitude values                */
 int Ns_min, Nst;     /* minimal period of existence of this disturbing block and its max-min */
+int counter = 0;     /* steps left to the current disturbing block */
 
 int continFlag;
 double X;
 	 
 
 
-void termHandler( int sigType )
-{
-   if( continFlag-- ); /* 1 -> 0 */
-   puts( "User break, terminating..." );
-}
-
-
 /*********
 *  MAIN  *   Main function
 *********/
@@ -138,19 +146,18 @@ int numprocs; // number of processes
 int myid;     // identifier of _this_ process
 
 // char processor_name[MPI_MAX_PROCESSOR_NAME];
-char a;
-
-int counter = 0;
-float totalTime = 0.;
+int cmd;      // run-control commands
+int event;    // 1-frame triggered by an event
+int framed;   // 1-the frame of this step is written
+int provided; // thread support of the MPI library
 
-continFlag = 1; /* continuation flag (to be changed by SIGINT handler) */
 
-MPI_File fh;
-MPI_Status status;
+continFlag = 1; /* continuation flag (to be changed by run control) */
 
 
     //-- MPI Initialization block
-    MPI_Init(&argc, &argv);
+    //-- the frame writer thread (f_async) makes MPI calls of its own
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
     MPI_Comm_size(MPI_COMM_WORLD, &numprocs);
     MPI_Comm_rank(MPI_COMM_WORLD, &myid);
 
@@ -160,45 +167,52 @@ MPI_Status status;
     //-- Initializations for numerical scheme
     Initialize(myid);
 
+    //-- Probes resolved to their processes, probe files opened
+    ProbesInit(myid);
+
+    //-- Running statistics (restored with the solution when continued)
+    StatisticsInit(myid);
+    DiagnosticsInit(myid);
+    SpectraInit(myid);
+    HistogramsInit(myid);
+    EventsInit(myid);
+    ConvergenceInit(myid);
+    InflowInit(myid);
+    OutflowInit(myid);
+    AdaptInit(myid);
+    AmrInit(myid);
+
+    //-- Frame writers (and the writer thread if f_async)
+    OutputInit(myid);
+    ExtractInit(myid);
+    IsoInit(myid);
+    RenderInit(myid);
+
+    //-- Periodic checkpoints (and their drain thread)
+    CheckpointInit(myid);
+
+    //-- Signals and "stopfile" watch on root, first broadcast of commands
+    RunControlInit(myid);
+
     /*--- time stepping ---*/
     while (1) {
 
-    	//-- Broadcast step from the process with the rank "root" to others
-    	MPI_Bcast(&step, 1, MPI_INT, 0, MPI_COMM_WORLD);
-
-	    // Only root process checks single-byte record in "stopfile": 'g' or 's'
-		if(0 == myid) {
-		    MPI_File_open(MPI_COMM_SELF, "stopfile",
-				    MPI_MODE_CREATE | MPI_MODE_RDWR, MPI_INFO_NULL, &fh);
-		    MPI_File_set_view(fh, 0, MPI_CHAR, MPI_CHAR, "native", MPI_INFO_NULL);
-		    MPI_File_read(fh, &a, 1, MPI_CHAR, &status);
-		    MPI_File_close(&fh);
-		    //
-		    if (a == 's') {
-			a = 'g';
-			continFlag = 0;
-			MPI_File_open(MPI_COMM_SELF, "stopfile",
-					MPI_MODE_CREATE | MPI_MODE_RDWR,
-					MPI_INFO_NULL, &fh);
-					MPI_File_set_view(fh, 0, MPI_CHAR, MPI_CHAR,
-					"native", MPI_INFO_NULL);
-			MPI_File_write(fh, &a, 1, MPI_CHAR, &status);
-			MPI_File_close(&fh);
-		    }
-		}
-
-		//-- Broadcast continFlag from the process with the rank "root" to others
-		MPI_Bcast(&continFlag, 1, MPI_INT, 0, MPI_COMM_WORLD);
-
 		//-- Every process may check exit conditions
 		if(step == numstep || !continFlag) break;
 
 	    /* Check Courant number at every timestep */
 		checkCoNum( myid );
 
+		//-- every process advances the step counter
+		step++;
+		totalTime += deltaT;
+
+		//-- root takes the inflow plane of this time from the precursor
+		Inflow(myid);
+
 		//-- root process prints current step and defines disturbances
 		if(0 == myid) {
-	        fprintf(stdout, "Timestep no.: %d, total time: %f sec.\n", ++step, (totalTime+=deltaT));
+	        fprintf(stdout, "Timestep no.: %d, total time: %f sec.\n", step, totalTime);
 		    if (counter > 0) counter--;
 		    else {
 				counter = (int)( Ns_min + Nst * ( X = Random( X ) ) );
@@ -223,24 +237,79 @@ MPI_Status status;
 			BounCondOnInterfaces( myid, numprocs );
 			/*--- Fluxes ---*/
 			Fluxes( myid, numprocs );
+			/*--- Refined blocks through the stage, their fluxes into the slab's ---*/
+			AmrStage( myid, numprocs );
 			/*--- Evolution ---*/
 			Evolution( nStages, Stage );
 
 		}
 
+		//-- Base cells under the blocks restricted, the blocks refined anew about the layer
+		Amr(myid);
+
+		//-- Sponge zone and the characteristic outflow of the next step
+		Outflow(myid);
+
+		//-- Rows laid out anew about the layer, the solution remapped
+		Adapt(myid);
+
 		//-- Probes output
 		Probes(myid);
+		InflowRecord();
+
+		//-- Running statistics over time and z
+		Statistics(myid, numprocs);
 
-		//-- Take frame
-		if (step%f_step == 0 && step!=0) Output(myid);
+		//-- Thicknesses of the layer at the stations
+		Diagnostics(myid);
+		Spectra(myid);
+		Histograms(myid);
+
+		//-- Take frame, periodic or triggered by an event
+		event = Events(myid);
+		framed = ((step%f_step == 0 && step!=0) || event);
+		if (framed) Output(myid);
+
+		//-- Planes, boxes, coarsened volumes
+		Extracts(myid);
+		Isosurfaces(myid, numprocs);
+		Renders(myid, numprocs);
+
+		//-- Commands decided one step ago: dump, checkpoint, stop
+		cmd = RunControlComplete(myid);
+		if ((cmd & CTRL_DUMP) && !framed) Output(myid);
+		if (cmd & CTRL_CHECKPOINT) Backup(myid);
+
+		//-- Statistics converged: stop, the end of the run checkpoints
+		if (Convergence(myid)) continFlag = 0;
+
+		//-- In-memory copies and their drain to disk, when due
+		CheckpointPeriodic(myid, numprocs);
 
     } // end while(1)
 
+    //-- Complete the broadcast still in flight
+    RunControlFinalize(myid);
+
 	/*--- Output the flowfield ---*/
-	Output();
+	Output(myid);
 
-    //-- Finalize: backup the solution and close probes.* files
+    //-- Finalize: backup the solution (after the frames still staged) and close the probe files
     Finalize(myid);
+    StatisticsFinalize(myid);
+    DiagnosticsFinalize(myid);
+    SpectraFinalize(myid);
+    HistogramsFinalize(myid);
+    EventsFinalize(myid);
+    ConvergenceFinalize(myid);
+    InflowFinalize(myid);
+    OutflowFinalize(myid);
+    AdaptFinalize(myid);
+    AmrFinalize(myid);
+
+    //-- Stop the writer threads
+    OutputFinalize(myid);
+    CheckpointFinalize(myid);
 
     //---
     fprintf(stdout, "%d/%d process stopped!\n", myid+1, numprocs);
@@ -0,0 +1,96 @@
+/*
+*  NUMFMT
+*
+*  Fast replacement of sprintf( "%g" ) for the ASCII frames. The value is scaled
+*  to six significant digits in double arithmetic, which is exact enough to round
+*  correctly unless the value lies within a hair of a rounding tie; those rare
+*  cases (and nan, inf) are left to sprintf(), so the text is always the same.
+*
+*/
+#include <stdio.h>     /* sprintf()    */
+#include <math.h>      /* frexp()      */
+
+#include "numfmt.h"
+
+#define FMTG_DIGITS 6      /* default precision of %g */
+#define FMTG_TIE    1e-6   /* distance from a tie below which sprintf() decides */
+
+/* 10^n; values of the frames never need |n| above 330 */
+static double pow10i( int n )
+{
+static const double p[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+                            1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15 };
+double r = 1.;
+int m = n < 0 ? -n : n;
+
+	while( m >= 15 ) { r *= 1e15; m -= 15; }
+	r *= p[m];
+	return n < 0 ? 1. / r : r;
+}
+
+
+int FormatG( char *s, double v )
+{
+char d[FMTG_DIGITS], *p = s;
+double a, scaled, frac;
+long r;
+int X, e2, nd, n, ex;
+
+	if( v != v || v - v != 0. ) return sprintf( s, "%g", v );   /* nan, inf */
+
+	a = v < 0. ? -v : v;
+	if( v < 0. || ( v == 0. && signbit( v ) ) ) *p++ = '-';
+	if( a == 0. ) {
+		*p++ = '0'; *p = '\0';
+		return p - s;
+	}
+
+	//--- decimal exponent X: 10^5 <= a * 10^(5-X) < 10^6
+	frexp( a, &e2 );
+	X = (int)floor( ( e2 - 1 ) * 0.30102999566398120 );
+	scaled = a * pow10i( FMTG_DIGITS - 1 - X );
+	if( scaled >= 1e6 ) { X++; scaled = a * pow10i( FMTG_DIGITS - 1 - X ); }
+	else if( scaled < 1e5 ) { X--; scaled = a * pow10i( FMTG_DIGITS - 1 - X ); }
+
+	//--- round to six digits, too close to a tie goes to sprintf()
+	r = (long)scaled;
+	frac = scaled - r;
+	if( fabs( frac - 0.5 ) < FMTG_TIE ) return sprintf( s, "%g", v );
+	if( frac > 0.5 ) r++;
+	if( r >= 1000000 ) { r = 100000; X++; }
+
+	for( n = FMTG_DIGITS - 1; n >= 0; n-- ) { d[n] = '0' + r % 10; r /= 10; }
+	for( nd = FMTG_DIGITS; nd > 1 && d[nd-1] == '0'; nd-- );
+
+	if( X < -4 || X >= FMTG_DIGITS ) {
+		//--- d.ddddde+XX
+		*p++ = d[0];
+		if( nd > 1 ) {
+			*p++ = '.';
+			for( n = 1; n < nd; n++ ) *p++ = d[n];
+		}
+		*p++ = 'e';
+		*p++ = X < 0 ? '-' : '+';
+		ex = X < 0 ? -X : X;
+		if( ex >= 100 ) { *p++ = '0' + ex / 100; ex %= 100; }
+		*p++ = '0' + ex / 10;
+		*p++ = '0' + ex % 10;
+	}
+	else if( X >= 0 ) {
+		//--- ddd.ddd
+		for( n = 0; n <= X; n++ ) *p++ = d[n];
+		if( nd > X + 1 ) {
+			*p++ = '.';
+			for( ; n < nd; n++ ) *p++ = d[n];
+		}
+	}
+	else {
+		//--- 0.000ddd
+		*p++ = '0'; *p++ = '.';
+		for( n = X + 1; n < 0; n++ ) *p++ = '0';
+		for( n = 0; n < nd; n++ ) *p++ = d[n];
+	}
+	*p = '\0';
+
+	return p - s;
+} /* end FormatG() */
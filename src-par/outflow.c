@@ -0,0 +1,284 @@
+/*
+*  OUTFLOW
+*
+*  Non-reflecting outflow and sponge zone. With o_mode = 1 the state outside the
+*  last face is no longer the interior with the pressure fixed at 100000 Pa, which
+*  reflects every pressure wave back into the domain, but evolves by the locally
+*  one-dimensional inviscid (LODI) relations of the characteristic waves:
+*
+*      L5 = (u+c) (dp/dx + rho c du/dx)     acoustic, leaving
+*      L2 =   u   (c^2 drho/dx - dp/dx)     entropy,  leaving
+*      L3 =   u   dv/dx,  L4 = u dw/dx      vorticity, leaving
+*      L1 = K (p - o_pinf),  K = o_sigma (1 - M^2) c / Lx    acoustic, entering
+*
+*  the leaving waves taken from the interior (one-sided over half a cell), the
+*  entering one only relaxing the pressure towards o_pinf over the domain length
+*  Lx (o_sigma = 0 - perfectly non-reflecting, but the mean pressure may drift).
+*  The state is advanced once per step after the stages and used by both boundary
+*  routines through OutflowPlane().
+*
+*  With o_sponge > 0 the last o_sponge metres of the domain relax, implicitly, to
+*  a running time average of the solution over o_tavg:
+*
+*      dU/dt = - sigma(x) ( U - <U> ),  sigma = o_damp c / o_sponge ((x - xs) / o_sponge)^2
+*
+*  so that o_damp counts the e-foldings a sound wave gets in the crossings of the
+*  sponge. Neither the outflow state nor the average is kept in the backup: a
+*  continued run starts them from the solution it reads.
+*
+*/
+#include "mpi.h"
+#include <stdio.h>     /* printf() etc.*/
+#include <stdlib.h>    /* malloc()     */
+#include <math.h>      /* sqrt()       */
+
+#include "type.h"
+#include "def.h"      /* Definitions, parameters */
+#include "global.h"   /* global variables */
+#include "config.h"
+#include "grid.h"     /* GridFace(), GridCentre(), GridRemapY() */
+
+#include "outflow.h"
+
+#define OF_NVARS 5
+
+static int last = 0;               /* _this_ is the last process */
+static double lenX;                /* length of the domain */
+static double *ob = NULL;          /* outflow state rho, u, v, w, p [5][HIG][DEP] */
+static float *plane = NULL;        /* the same, conservative */
+
+static unsigned iSp = 0;           /* first column of the sponge on _this_ process, 0-none */
+static double xSp, tAvg;           /* start of the sponge, time scale of its target */
+static real *avg = NULL;           /* running average [5][LEN-iSp+1][HIG][DEP] */
+
+
+/*
+* toPlane - Conservative variables of the outflow state.
+*/
+static void toPlane( void )
+{
+size_t n, N = (size_t)HIG * DEP;
+double *s;
+
+	for( n = 0; n < N; n++ ) {
+		s = ob + n;
+		plane[n]         = (float)s[0];
+		plane[N + n]     = (float)( s[0] * s[N] );
+		plane[2 * N + n] = (float)( s[0] * s[2 * N] );
+		plane[3 * N + n] = (float)( s[0] * s[3 * N] );
+		plane[4 * N + n] = (float)( s[4 * N] / K_1
+		                 + 0.5 * s[0] * ( s[N] * s[N] + s[2 * N] * s[2 * N] + s[3 * N] * s[3 * N] ) );
+	}
+
+} /* end toPlane() */
+
+
+/*
+* primitive - Density, velocities and pressure of cell i, j, k.
+*/
+static void primitive( unsigned i, unsigned j, unsigned k, double *q )
+{
+	q[0] = U1[i][j][k];
+	q[1] = U2[i][j][k] / q[0];
+	q[2] = U3[i][j][k] / q[0];
+	q[3] = U4[i][j][k] / q[0];
+	q[4] = K_1 * ( U5[i][j][k] - 0.5 * q[0] * ( q[1] * q[1] + q[2] * q[2] + q[3] * q[3] ) );
+
+} /* end primitive() */
+
+
+void OutflowInit( int myid )
+{
+int numprocs;
+size_t n, N = (size_t)HIG * DEP, M;
+unsigned i, j, k;
+double x, q[2], g[2], b[OF_NVARS];
+real ***U[OF_NVARS];
+
+	MPI_Comm_size( MPI_COMM_WORLD, &numprocs );
+	last = ( myid == numprocs - 1 );
+	lenX = GridFace( 0, LEN * numprocs );
+
+	//--- characteristic outflow, from the last column
+	if( config.o_mode == 1 && last ) {
+		if( ( ob = (double *)malloc( OF_NVARS * N * sizeof(double) ) ) == NULL
+		 || ( plane = (float *)malloc( OF_NVARS * N * sizeof(float) ) ) == NULL ) {
+			fprintf( stderr, "mpi_layer2: can't allocate memory for the outflow.\n" );
+			MPI_Abort( MPI_COMM_WORLD, 1 );
+		}
+		for( j = 1; j < HIGG; j++ )
+			for( k = 1; k < DEPP; k++ ) {
+				primitive( LEN, j, k, b );
+				for( n = 0; n < OF_NVARS; n++ ) ob[n * N + ( j - 1 ) * DEP + k - 1] = b[n];
+			}
+		toPlane( );
+	}
+
+	if( config.o_sponge <= 0. ) return;
+
+	//--- sponge zone: columns whose centres lie past xSp
+	if( config.o_sponge >= lenX ) {
+		if( 0 == myid ) fprintf( stderr, "mpi_layer2: o_sponge = %g m, the domain is %g m long.\n", config.o_sponge, lenX );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	xSp = lenX - config.o_sponge;
+	for( i = 1; i < LENN && iSp == 0; i++ )
+		if( GridCentre( 0, myid * LEN + i - 1 ) > xSp ) iSp = i;
+
+	q[0] = q[1] = 0.;
+	if( iSp ) {
+		M = (size_t)( LEN - iSp + 1 ) * N;
+		if( ( avg = (real *)malloc( OF_NVARS * M * sizeof(real) ) ) == NULL ) {
+			fprintf( stderr, "mpi_layer2: can't allocate memory for the sponge zone.\n" );
+			MPI_Abort( MPI_COMM_WORLD, 1 );
+		}
+		U[0] = U1; U[1] = U2; U[2] = U3; U[3] = U4; U[4] = U5;
+		for( n = 0; n < OF_NVARS; n++ )
+			for( i = iSp; i < LENN; i++ )
+				for( j = 1; j < HIGG; j++ )
+					for( k = 1; k < DEPP; k++ )
+						avg[n * M + ( ( i - iSp ) * HIG + j - 1 ) * DEP + k - 1] = U[n][i][j][k];
+		for( i = iSp; i < LENN; i++ )
+			for( j = 1; j < HIGG; j++ )
+				for( k = 1; k < DEPP; k++ ) { q[0] += U2[i][j][k] / U1[i][j][k]; q[1] += 1.; }
+	}
+
+	//--- the average follows the flow over 20 passages of the sponge unless o_tavg is set
+	tAvg = config.o_tavg;
+	MPI_Allreduce( q, g, 2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD );
+	if( tAvg <= 0. ) {
+		x = g[1] > 0. ? fabs( g[0] / g[1] ) : 0.;
+		tAvg = x > small ? 20. * config.o_sponge / x : 1.;
+	}
+	if( 0 == myid )
+		fprintf( stdout, "Sponge: last %g m of the domain, o_damp = %g, target averaged over %g sec.\n",
+		         config.o_sponge, config.o_damp, tAvg );
+
+} /* end OutflowInit() */
+
+
+void OutflowRegrid( const double *from )
+{
+size_t N = (size_t)HIG * DEP, M = (size_t)( LEN - iSp + 1 ) * N;
+unsigned i, j, k;
+int n;
+double *q, *r;
+
+	if( ob == NULL && avg == NULL ) return;
+	q = (double *)malloc( 2 * HIG * sizeof(double) );
+	if( q == NULL ) {
+		fprintf( stderr, "mpi_layer2: can't allocate memory for the outflow.\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	r = q + HIG;
+
+	for( n = 0; n < OF_NVARS; n++ )
+		for( k = 0; k < DEP; k++ ) {
+			if( ob != NULL ) {
+				for( j = 0; j < HIG; j++ ) q[j] = ob[n * N + j * DEP + k];
+				GridRemapY( from, q, r );
+				for( j = 0; j < HIG; j++ ) ob[n * N + j * DEP + k] = r[j];
+			}
+			if( avg != NULL )
+				for( i = 0; i <= LEN - iSp; i++ ) {
+					for( j = 0; j < HIG; j++ ) q[j] = avg[n * M + ( i * HIG + j ) * DEP + k];
+					GridRemapY( from, q, r );
+					for( j = 0; j < HIG; j++ ) avg[n * M + ( i * HIG + j ) * DEP + k] = r[j];
+				}
+		}
+	free( q );
+	if( ob != NULL ) toPlane( );
+
+} /* end OutflowRegrid() */
+
+
+/*
+* sponge - Implicit relaxation of the sponge columns to their running average.
+*/
+static void sponge( int myid )
+{
+size_t N = (size_t)HIG * DEP, M = (size_t)( LEN - iSp + 1 ) * N, m;
+unsigned i, j, k;
+int n;
+double x, sg, s, w = deltaT / ( tAvg + deltaT ), r, u, v, ww, p;
+real ***U[OF_NVARS], *a;
+
+	U[0] = U1; U[1] = U2; U[2] = U3; U[3] = U4; U[4] = U5;
+	for( i = iSp; i < LENN; i++ ) {
+		x = ( GridCentre( 0, myid * LEN + i - 1 ) - xSp ) / config.o_sponge;
+		sg = config.o_damp / config.o_sponge * x * x;
+		for( j = 1; j < HIGG; j++ )
+			for( k = 1; k < DEPP; k++ ) {
+				m = ( ( i - iSp ) * HIG + j - 1 ) * DEP + k - 1;
+				r = U1[i][j][k]; u = U2[i][j][k] / r; v = U3[i][j][k] / r; ww = U4[i][j][k] / r;
+				p = K_1 * ( U5[i][j][k] - 0.5 * r * ( u * u + v * v + ww * ww ) );
+				s = sg * sqrt( K * p / r ) * deltaT;
+				for( n = 0; n < OF_NVARS; n++ ) {
+					a = avg + n * M + m;
+					U[n][i][j][k] = ( U[n][i][j][k] + s * *a ) / ( 1. + s );
+					*a += w * ( U[n][i][j][k] - *a );
+				}
+			}
+	}
+
+} /* end sponge() */
+
+
+/************
+*  OUTFLOW  *   Sponge zone, then the LODI outflow state of the next step
+************/
+void Outflow( int myid )
+{
+size_t N = (size_t)HIG * DEP, m;
+unsigned j, k;
+double q[OF_NVARS], b[OF_NVARS], d[OF_NVARS], L1, L2, L3, L4, L5, c, Ma, h = 2. / dX[LEN];
+int n;
+
+	if( iSp ) sponge( myid );
+	if( config.o_mode != 1 || !last ) return;
+
+	for( j = 1; j < HIGG; j++ )
+		for( k = 1; k < DEPP; k++ ) {
+			m = ( j - 1 ) * DEP + k - 1;
+			primitive( LEN, j, k, q );
+			for( n = 0; n < OF_NVARS; n++ ) {
+				b[n] = ob[n * N + m];
+				d[n] = ( b[n] - q[n] ) * h;   /* d/dx over the half cell */
+			}
+			c = sqrt( K * b[4] / b[0] );
+			Ma = b[1] / c;
+
+			//--- leaving waves from the interior, none enters with the flow reversed
+			L5 = b[1] + c > 0. ? ( b[1] + c ) * ( d[4] + b[0] * c * d[1] ) : 0.;
+			L2 = b[1] > 0. ? b[1] * ( c * c * d[0] - d[4] ) : 0.;
+			L3 = b[1] > 0. ? b[1] * d[2] : 0.;
+			L4 = b[1] > 0. ? b[1] * d[3] : 0.;
+			//--- the entering one relaxes the pressure, unless supersonic
+			if( Ma < 1. ) L1 = config.o_sigma * ( 1. - Ma * Ma ) * c / lenX * ( b[4] - config.o_pinf );
+			else L1 = ( b[1] - c ) * ( d[4] - b[0] * c * d[1] );
+
+			ob[m]         = b[0] - deltaT * ( L2 + 0.5 * ( L5 + L1 ) ) / ( c * c );
+			ob[N + m]     = b[1] - deltaT * ( L5 - L1 ) / ( 2. * b[0] * c );
+			ob[2 * N + m] = b[2] - deltaT * L3;
+			ob[3 * N + m] = b[3] - deltaT * L4;
+			ob[4 * N + m] = b[4] - deltaT * 0.5 * ( L5 + L1 );
+		}
+	toPlane( );
+
+} /* end Outflow() */
+
+
+const float *OutflowPlane( void )
+{
+	return config.o_mode == 1 ? plane : NULL;
+}
+
+
+void OutflowFinalize( int myid )
+{
+	free( ob ); free( plane ); free( avg );
+	ob = NULL; plane = NULL; avg = NULL;
+	iSp = 0;
+	(void)myid;
+
+} /* end OutflowFinalize() */
@@ -0,0 +1,29 @@
+#ifndef OUTFLOW_H
+#define OUTFLOW_H
+
+/*
+* OutflowInit - Sets the characteristic outflow state (o_mode = 1) on the last process
+* and the sponge zone (o_sponge > 0) from the initial or continued solution.
+*/
+void OutflowInit( int myid );
+
+/*
+* Outflow - Called every step after the stages: damps the sponge zone, then the last
+* process advances the outflow state by the LODI relations.
+*/
+void Outflow( int myid );
+
+/*
+* OutflowPlane - The conservative variables at the outflow [5][HIG][DEP], NULL for the fixed pressure.
+*/
+const float *OutflowPlane( void );
+
+/*
+* OutflowRegrid - Remaps the outflow state and the sponge average from the rows between
+* the faces from[HIG+1] onto the current ones.
+*/
+void OutflowRegrid( const double *from );
+
+void OutflowFinalize( int myid );
+
+#endif
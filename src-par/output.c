@@ -4,29 +4,43 @@
 #include <math.h>      /* sqrt()       */
 #include <stdlib.h>    /* atoi()       */
 #include <string.h>    /* strlen()     */ 
+#include <pthread.h>   /* writer thread */
 
 #include "type.h"
 #include "def.h"      /* Definitions, parameters */
 #include "global.h"   /* global variables */
 #include "turbulence.h" /* Q Criteria */ 
+#include "config.h"
+#include "helpers.h"  /* Array3D() */
+#include "tecplot.h"
+#include "numfmt.h"    /* FormatG() */
+#include "zcomp.h"     /* ZCompress() */
+#include "grid.h"      /* GridCentre() */
 
 #include "output.h"
+#include "h5output.h"
+#include "amr.h"
 
-/***********
-*  OUTPUT  *   Outputs flowfield to separate files, each for a specific process.
-***********/
-void Output(int myid)
-{
-// float buf;
-char filename[30];
-MPI_File fh;
-MPI_Status status;
+/* names of the variables of a frame, in the order of CellValues() */
+const char *OutputVarNames[OUT_NVARS] = {
+	"x", "y", "z", "rho", "u", "v", "w", "p", "T", "Vort. mag.", "Q-criteria.", "muSgs-muT-ratio"
+};
+
+/* short names of the fields (no coordinates), used as dataset names in binary frames */
+const char *OutputFieldNames[OUT_NFIELDS] = {
+	"rho", "u", "v", "w", "p", "T", "vorticity", "Q", "muT_ratio"
+};
 
-unsigned int i, j, k;
-char str[120];
-real xc, yc, zc;
-real R, U, V, W, P, T;
-real omegax, omegay, omegaz, S12, S13, S23, Omega, Strain, Q, muT;
+
+/*
+* CellValues - Coordinates, primitive variables and derived quantities of the cell (i,j,k):
+* x, y, z, rho, u, v, w, p, T, vorticity magnitude, Q-criterion and muT/mu_L ratio.
+*/
+void CellValues(const Frame *f, unsigned i, unsigned j, unsigned k, int myid, real v[OUT_NVARS])
+{
+real ***U1 = f->U1, ***U2 = f->U2, ***U3 = f->U3, ***U4 = f->U4, ***U5 = f->U5;
+real R, U, V, W, P;
+real omegax, omegay, omegaz, S12, S13, S23, Omega, Strain;
 
 /* matrix of velocity derivatives */
 real 
@@ -35,129 +49,682 @@ dv_dx, dw_dx,
 du_dy, dw_dy,
 du_dz, dv_dz;
 
+	// Add x-axis offset to deal with your process' domain
+	v[0] = GridCentre(0, myid*LEN + i-1);
+	v[1] = GridCentre(1, j-1);
+	v[2] = (k-1)*deltaZ + 0.5*deltaZ;
 
-	// //--- create file
-	// sprintf(filename, "%d.%d", step, myid);
-	// MPI_File_open(MPI_COMM_SELF, filename, MPI_MODE_CREATE | MPI_MODE_RDWR,
-	// 				  MPI_INFO_NULL, &fh );
-	// MPI_File_set_view(fh, 0, MPI_FLOAT, MPI_FLOAT, "native", MPI_INFO_NULL);
-
-	// //--- write header
-	// buf = (float)LEN;    MPI_File_write(fh, &buf, 1, MPI_FLOAT, &status);
-	// buf = (float)HIG;    MPI_File_write(fh, &buf, 1, MPI_FLOAT, &status);
-	// buf = (float)deltaX; MPI_File_write(fh, &buf, 1, MPI_FLOAT, &status);
-	// buf = (float)deltaY; MPI_File_write(fh, &buf, 1, MPI_FLOAT, &status);
-
-	// //--- central z-plane
-	// k = k_c;
-
-	// //--- write data
-	// for (j = 1; j < HIGG; j++) {
-	// 	for (i = 1; i < LENN; i++) {
-	// 		// vorticity plot
-	// 		dv_dx = ( U3[i+1][j][k]/U1[i+1][j][k] - U3[i-1][j][k]/U1[i-1][j][k] ) * _2deltaX;
-	// 		dw_dx = ( U4[i+1][j][k]/U1[i+1][j][k] - U4[i-1][j][k]/U1[i-1][j][k] ) * _2deltaX;
-	// 		du_dy = ( U2[i][j+1][k]/U1[i][j+1][k] - U2[i][j-1][k]/U1[i][j-1][k] ) * _2deltaY;
-	// 		dw_dy = ( U4[i][j+1][k]/U1[i][j+1][k] - U4[i][j-1][k]/U1[i][j-1][k] ) * _2deltaY;
-	// 		du_dz = ( U2[i][j][k+1]/U1[i][j][k+1] - U2[i][j][k-1]/U1[i][j][k-1] ) * _2deltaZ;
-	// 		dv_dz = ( U3[i][j][k+1]/U1[i][j][k+1] - U3[i][j][k-1]/U1[i][j][k-1] ) * _2deltaZ;
-	// 		U = 0.5 * (dw_dy - dv_dz);
-	// 		V = 0.5 * (du_dz - dw_dx);
-	// 		W = 0.5 * (dv_dx - du_dy);
-	// 		buf = sqrt(U*U + V*V + W*W);
-	// 		MPI_File_write(fh, &buf, 1, MPI_FLOAT, &status);
-	// 	}
-	// }
-
-	// //--- close file
-	// MPI_File_close(&fh);
+	R = U1[i][j][k];
+	U = U2[i][j][k]/R;
+	V = U3[i][j][k]/R;
+	W = U4[i][j][k]/R;
+	P = ( U5[i][j][k] - 0.5 * R * ( U * U + V * V + W * W ) ) * K_1;
+	v[3] = R; v[4] = U; v[5] = V; v[6] = W; v[7] = P;
+	v[8] = P / ( R_VOZD * R );
+
+	// Velocity gradient
+	du_dx = ( U2[i+1][j][k]/U1[i+1][j][k] - U2[i-1][j][k]/U1[i-1][j][k] ) * _2dX[i];
+	du_dy = ( U2[i][j+1][k]/U1[i][j+1][k] - U2[i][j-1][k]/U1[i][j-1][k] ) * _2dY[j];
+	du_dz = ( U2[i][j][k+1]/U1[i][j][k+1] - U2[i][j][k-1]/U1[i][j][k-1] ) * _2deltaZ;
+
+	dv_dx = ( U3[i+1][j][k]/U1[i+1][j][k] - U3[i-1][j][k]/U1[i-1][j][k] ) * _2dX[i];
+	dv_dy = ( U3[i][j+1][k]/U1[i][j+1][k] - U3[i][j-1][k]/U1[i][j-1][k] ) * _2dY[j]; 
+	dv_dz = ( U3[i][j][k+1]/U1[i][j][k+1] - U3[i][j][k-1]/U1[i][j][k-1] ) * _2deltaZ;
+
+	dw_dx = ( U4[i+1][j][k]/U1[i+1][j][k] - U4[i-1][j][k]/U1[i-1][j][k] ) * _2dX[i];
+	dw_dy = ( U4[i][j+1][k]/U1[i][j+1][k] - U4[i][j-1][k]/U1[i][j-1][k] ) * _2dY[j];
+	dw_dz = ( U4[i][j][k+1]/U1[i][j][k+1] - U4[i][j][k-1]/U1[i][j][k-1] ) * _2deltaZ;
+
+	omegax = ( dw_dy - dv_dz );
+	omegay = ( du_dz - dw_dx );
+	omegaz = ( dv_dx - du_dy );
+
+	Omega = sqrt(  omegax * omegax + omegay * omegay + omegaz * omegaz );
+
+	S12 = 0.5 * (du_dy + dv_dx);
+	S13 = 0.5 * (du_dz + dw_dx);
+	S23 = 0.5 * (dv_dz + dw_dy);
+
+	Strain = sqrt( 2 * ( du_dx * du_dx + dv_dy * dv_dy + dw_dz * dw_dz 
+	                      + 2 * ( S12   * S12   + S13   * S13   + S23   * S23 ) ) );
+
+	v[9]  = Omega;
+	v[10] = 0.5 * ( Omega*Omega - Strain*Strain); // Q
+
+	if (DynamicSmagorinskySGS) { 
+		v[11] = f->mu_SGS[i][j][k];
+	}else{	
+		v[11] = R * ( Cs * DDxy[i][j] ) * Strain/mu_L;	
+	}
+
+} // end CellValues()
+
+
+/* size of the text buffer of the ASCII frames */
+#define OUT_TXTBUF (4 << 20)
+
+/*
+* OutputTecplot - Outputs flowfield to separate ASCII Tecplot files, each for a specific process.
+*/
+static void OutputTecplot(const Frame *f, int myid)
+{
+char filename[30];
+MPI_File fh;
+MPI_Status status;
+
+static char *txt = NULL;
+size_t len;
+unsigned int i, j, k, l;
+real v[OUT_NVARS];
 
 
 	/*-- Open and write results in tecplot file --*/
 
-	sprintf( filename, "%d-proc%d.plt", step, myid);
+	sprintf( filename, "%d-proc%d.plt", f->step, myid);
 	MPI_File_open(MPI_COMM_SELF, filename, MPI_MODE_CREATE | MPI_MODE_WRONLY,
 					  MPI_INFO_NULL, &fh );
 	MPI_File_set_view(fh, 0, MPI_CHAR, MPI_CHAR, "native", MPI_INFO_NULL);
 
 
-	sprintf(str, "title     = \" 3-D compressible case \"\n");     MPI_File_write(fh, str, strlen(str), MPI_CHAR, &status);
-	sprintf(str, "variables = \" x \"\n");                         MPI_File_write(fh, str, strlen(str), MPI_CHAR, &status);
-	sprintf(str, "\"y\"\n");                                       MPI_File_write(fh, str, strlen(str), MPI_CHAR, &status);
-	sprintf(str, "\"z\"\n");                                       MPI_File_write(fh, str, strlen(str), MPI_CHAR, &status);
-	sprintf(str, "\"rho\"\n");                                     MPI_File_write(fh, str, strlen(str), MPI_CHAR, &status);
-	sprintf(str, "\"u\"\n");                                       MPI_File_write(fh, str, strlen(str), MPI_CHAR, &status);
-	sprintf(str, "\"v\"\n");                                       MPI_File_write(fh, str, strlen(str), MPI_CHAR, &status);
-	sprintf(str, "\"w\"\n");                                       MPI_File_write(fh, str, strlen(str), MPI_CHAR, &status);
-	sprintf(str, "\"p\"\n");                                       MPI_File_write(fh, str, strlen(str), MPI_CHAR, &status);
-	sprintf(str, "\"T\"\n");                                       MPI_File_write(fh, str, strlen(str), MPI_CHAR, &status);
-	sprintf(str, "\"Vort. mag.\"\n");                              MPI_File_write(fh, str, strlen(str), MPI_CHAR, &status);
-	sprintf(str, "\"Q-criteria.\"\n");                             MPI_File_write(fh, str, strlen(str), MPI_CHAR, &status);
-	sprintf(str, "\"muSgs-muT-ratio\"\n");                         MPI_File_write(fh, str, strlen(str), MPI_CHAR, &status);
-	sprintf(str, "zone t=\" \"\n");                                MPI_File_write(fh, str, strlen(str), MPI_CHAR, &status);
-	sprintf(str, "i=%d, j=%d, k=%d, f=point\n", LEN, HIG, DEP);    MPI_File_write(fh, str, strlen(str), MPI_CHAR, &status);
+	//--- text is gathered in a large buffer and written in a few pieces
+	if (txt == NULL && (txt = (char *)malloc(OUT_TXTBUF)) == NULL) {
+		fprintf(stderr, "mpi_layer2: can't allocate memory for Tecplot output.\n");
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+	len = 0;
+	len += sprintf(txt + len, "title     = \" 3-D compressible case \"\n");
+	len += sprintf(txt + len, "variables = \" x \"\n");
+	for (l = 1; l < OUT_NVARS; l++)
+		len += sprintf(txt + len, "\"%s\"\n", OutputVarNames[l]);
+	len += sprintf(txt + len, "zone t=\" \"\n");
+	len += sprintf(txt + len, "i=%d, j=%d, k=%d, f=point\n", LEN, HIG, DEP);
 
 	for (k = 1; k < DEPP; k++) {
 		for (j = 1; j < HIGG; j++) {
 			for (i = 1; i < LENN; i++) {
 
-            // Add x-axis offset to deal with your process' domain
-			xc = myid*deltaX*LEN + (i-1)*deltaX + 0.5*deltaX;
-			yc = (j-1)*deltaY + 0.5*deltaY;
-			zc = (k-1)*deltaZ + 0.5*deltaZ;
+			CellValues(f, i, j, k, myid, v);
 
-			R = U1[i][j][k];
-			U = U2[i][j][k]/R;
-			V = U3[i][j][k]/R;
-			W = U4[i][j][k]/R;
-			P = ( U5[i][j][k] - 0.5 * R * ( U * U + V * V + W * W ) ) * K_1;
-			T = P / ( R_VOZD * R );
+			// the same text as sprintf("%g %g ... %g\n")
+			for (l = 0; l < OUT_NVARS; l++) {
+				len += FormatG(txt + len, v[l]);
+				txt[len++] = (l < OUT_NVARS-1) ? ' ' : '\n';
+			}
+			if (len > OUT_TXTBUF - OUT_NVARS * FMTG_MAXLEN) {
+				MPI_File_write(fh, txt, len, MPI_CHAR, &status);
+				len = 0;
+			}
 
+			}
+		}
+	}
+	MPI_File_write(fh, txt, len, MPI_CHAR, &status);
+
+	//--- close file
+	MPI_File_close(&fh);
 
-			// Velocity gradient
-			du_dx = ( U2[i+1][j][k]/U1[i+1][j][k] - U2[i-1][j][k]/U1[i-1][j][k] ) * _2deltaX;
-			du_dy = ( U2[i][j+1][k]/U1[i][j+1][k] - U2[i][j-1][k]/U1[i][j-1][k] ) * _2deltaY;
-			du_dz = ( U2[i][j][k+1]/U1[i][j][k+1] - U2[i][j][k-1]/U1[i][j][k-1] ) * _2deltaZ;
 
-			dv_dx = ( U3[i+1][j][k]/U1[i+1][j][k] - U3[i-1][j][k]/U1[i-1][j][k] ) * _2deltaX;
-			dv_dy = ( U3[i][j+1][k]/U1[i][j+1][k] - U3[i][j-1][k]/U1[i][j-1][k] ) * _2deltaY; 
-			dv_dz = ( U3[i][j][k+1]/U1[i][j][k+1] - U3[i][j][k-1]/U1[i][j][k-1] ) * _2deltaZ;
+} // end OutputTecplot()
 
-			dw_dx = ( U4[i+1][j][k]/U1[i+1][j][k] - U4[i-1][j][k]/U1[i-1][j][k] ) * _2deltaX;
-			dw_dy = ( U4[i][j+1][k]/U1[i][j+1][k] - U4[i][j-1][k]/U1[i][j-1][k] ) * _2deltaY;
-			dw_dz = ( U4[i][j][k+1]/U1[i][j][k+1] - U4[i][j][k-1]/U1[i][j][k-1] ) * _2deltaZ;
 
+/*
+* OutputTecplotBinary - All processes write the frame into one binary Tecplot file "<step>.plt"
+* holding a single ordered zone of LEN*numprocs x HIG x DEP points (the cell centres).
+* Root writes the header; every variable, coordinates included, is then one float array
+* in BLOCK order, and every process fills its x-slab of all of them with one collective call.
+*/
+static void OutputTecplotBinary(const Frame *f, int myid)
+{
+static float *buf = NULL;
+char filename[30], *head;
+MPI_File fh;
+MPI_Datatype slab;
+int numprocs, sizes[4], subsizes[4], starts[4];
+unsigned i, j, k, l, n, m;
+size_t hsize, zsize;
+double vmin[OUT_NVARS], vmax[OUT_NVARS];
+real v[OUT_NVARS];
+
+	MPI_Comm_size(OutputComm, &numprocs);
+
+	//--- staging buffer: variable-major, then k, j, i
+	n = LEN * HIG * DEP;
+	if (buf == NULL && (buf = (float *)malloc(OUT_NVARS * n * sizeof(float))) == NULL) {
+		fprintf(stderr, "mpi_layer2: can't allocate memory for Tecplot output.\n");
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+	for (l = 0; l < OUT_NVARS; l++) {
+		vmin[l] =  HUGE_VAL;
+		vmax[l] = -HUGE_VAL;
+	}
+	for (k = 1; k < DEPP; k++) {
+		for (j = 1; j < HIGG; j++) {
+			for (i = 1; i < LENN; i++) {
+				CellValues(f, i, j, k, myid, v);
+				m = ((k-1)*HIG + (j-1))*LEN + (i-1);
+				for (l = 0; l < OUT_NVARS; l++) {
+					buf[l*n + m] = v[l];
+					if (v[l] < vmin[l]) vmin[l] = v[l];
+					if (v[l] > vmax[l]) vmax[l] = v[l];
+				}
+			}
+		}
+	}
+	//--- the zone header carries the ranges of the whole domain
+	MPI_Allreduce(MPI_IN_PLACE, vmin, OUT_NVARS, MPI_DOUBLE, MPI_MIN, OutputComm);
+	MPI_Allreduce(MPI_IN_PLACE, vmax, OUT_NVARS, MPI_DOUBLE, MPI_MAX, OutputComm);
+
+	hsize = TecplotHeader(NULL, "3-D compressible case", OUT_NVARS, OutputVarNames,
+	                      LEN*numprocs, HIG, DEP, f->time);
+	zsize = TecplotZoneHeader(NULL, OUT_NVARS, vmin, vmax);
+
+	sprintf(filename, "%d.plt", f->step);
+	MPI_File_open(OutputComm, filename, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+					  MPI_INFO_NULL, &fh);
+	MPI_File_set_size(fh, 0);
+
+	if (0 == myid) {
+		if ((head = (char *)malloc(hsize + zsize)) == NULL) {
+			fprintf(stderr, "mpi_layer2: can't allocate memory for Tecplot output.\n");
+			MPI_Abort(MPI_COMM_WORLD, 1);
+		}
+		TecplotHeader(head, "3-D compressible case", OUT_NVARS, OutputVarNames,
+		              LEN*numprocs, HIG, DEP, f->time);
+		TecplotZoneHeader(head + hsize, OUT_NVARS, vmin, vmax);
+		MPI_File_write_at(fh, 0, head, hsize + zsize, MPI_BYTE, MPI_STATUS_IGNORE);
+		free(head);
+	}
 
-			omegax = ( dw_dy - dv_dz );
-			omegay = ( du_dz - dw_dx );
-			omegaz = ( dv_dx - du_dy );
+	//--- x-slab of _this_ process in every variable of the zone
+	sizes[0] = OUT_NVARS;    subsizes[0] = OUT_NVARS;   starts[0] = 0;
+	sizes[1] = DEP;          subsizes[1] = DEP;         starts[1] = 0;
+	sizes[2] = HIG;          subsizes[2] = HIG;         starts[2] = 0;
+	sizes[3] = LEN*numprocs; subsizes[3] = LEN;         starts[3] = myid*LEN;
+	MPI_Type_create_subarray(4, sizes, subsizes, starts, MPI_ORDER_C, MPI_FLOAT, &slab);
+	MPI_Type_commit(&slab);
 
-			Omega = sqrt(  omegax * omegax + omegay * omegay + omegaz * omegaz );
+	MPI_File_set_view(fh, hsize + zsize, MPI_FLOAT, slab, "native", MPI_INFO_NULL);
+	MPI_File_write_at_all(fh, 0, buf, OUT_NVARS * n, MPI_FLOAT, MPI_STATUS_IGNORE);
+	MPI_File_close(&fh);
 
-			S12 = 0.5 * (du_dy + dv_dx);
-			S13 = 0.5 * (du_dz + dw_dx);
-			S23 = 0.5 * (dv_dz + dw_dy);
+	MPI_Type_free(&slab);
 
-			Strain = sqrt( 2 * ( du_dx * du_dx + dv_dy * dv_dy + dw_dz * dw_dz 
-			                      + 2 * ( S12   * S12   + S13   * S13   + S23   * S23 ) ) );
+} // end OutputTecplotBinary()
 
-			Q = 0.5 * ( Omega*Omega - Strain*Strain);
 
-			if (DynamicSmagorinskySGS) { 
-				muT = mu_SGS[i][j][k];
-			}else{	
-				muT = R * CsDD * Strain/mu_L;	
+/*
+* OutputSnapshot - All processes write the frame into one shared binary file "<step>.snap"
+* with a single collective call, and root describes it in "<step>.xmf" for ParaView/VisIt.
+*
+* The file holds OUT_NVARS-3 variables (rho ... muT ratio, no coordinates) one after
+* another, each as a float array [DEP][HIG][LEN*numprocs] with x running fastest.
+* Every process sees only its x-slab of each array through the file view.
+*/
+static void OutputSnapshot(const Frame *f, int myid)
+{
+static float *buf = NULL;
+char filename[30];
+MPI_File fh;
+MPI_Datatype slab;
+int numprocs, sizes[4], subsizes[4], starts[4];
+unsigned i, j, k, l, n;
+real v[OUT_NVARS];
+
+	MPI_Comm_size(OutputComm, &numprocs);
+
+	//--- staging buffer: variable-major, then k, j, i
+	n = LEN * HIG * DEP;
+	if (buf == NULL && (buf = (float *)malloc(OUT_NFIELDS * n * sizeof(float))) == NULL) {
+		fprintf(stderr, "mpi_layer2: can't allocate memory for snapshot.\n");
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+	for (k = 1; k < DEPP; k++) {
+		for (j = 1; j < HIGG; j++) {
+			for (i = 1; i < LENN; i++) {
+				CellValues(f, i, j, k, myid, v);
+				for (l = 0; l < OUT_NFIELDS; l++)
+					buf[l*n + ((k-1)*HIG + (j-1))*LEN + (i-1)] = v[l+3];
 			}
+		}
+	}
+
+	//--- x-slab of _this_ process in every variable of the file
+	sizes[0] = OUT_NFIELDS; subsizes[0] = OUT_NFIELDS;  starts[0] = 0;
+	sizes[1] = DEP;         subsizes[1] = DEP;          starts[1] = 0;
+	sizes[2] = HIG;         subsizes[2] = HIG;          starts[2] = 0;
+	sizes[3] = LEN*numprocs; subsizes[3] = LEN;         starts[3] = myid*LEN;
+	MPI_Type_create_subarray(4, sizes, subsizes, starts, MPI_ORDER_C, MPI_FLOAT, &slab);
+	MPI_Type_commit(&slab);
+
+	sprintf(filename, "%d.snap", f->step);
+	MPI_File_open(OutputComm, filename, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+					  MPI_INFO_NULL, &fh);
+	MPI_File_set_size(fh, 0);
+	MPI_File_set_view(fh, 0, MPI_FLOAT, slab, "native", MPI_INFO_NULL);
+	MPI_File_write_at_all(fh, 0, buf, OUT_NFIELDS * n, MPI_FLOAT, MPI_STATUS_IGNORE);
+	MPI_File_close(&fh);
+
+	MPI_Type_free(&slab);
+
+	if (0 == myid) WriteXdmf(f, filename, LEN*numprocs, 0);
+
+} // end OutputSnapshot()
 
 
-			sprintf(str, "%g %g %g %g %g %g %g %g %g %g %g %g\n", xc, yc, zc, R, U, V, W, P, T, Omega, Q, muT); 			
-			MPI_File_write(fh, str, strlen(str), MPI_CHAR, &status);
+/* error bounds of the compressed frames, per field */
+static double zBound[OUT_NFIELDS];
+static int zRelative[OUT_NFIELDS];
 
+/*
+* parseBounds - Error bounds of the compressed frames from the "z_bound" keys,
+* "<field|all> <abs|rel> <value>", later ones overriding earlier ones. A relative
+* bound is taken of the range of the field over the whole domain.
+*/
+static int parseBounds(int myid)
+{
+char field[32], kind[8];
+double value;
+int n, l, nErr = 0;
+
+	for (l = 0; l < OUT_NFIELDS; l++) {
+		zBound[l] = 1e-3;
+		zRelative[l] = 1;
+	}
+	for (n = 0; n < config.z_bound.n; n++) {
+		if (sscanf(config.z_bound.item[n], "%31s %7s %lf", field, kind, &value) != 3 || value < 0. ||
+		    (strcmp(kind, "abs") != 0 && strcmp(kind, "rel") != 0)) {
+			if (0 == myid) fprintf(stderr, "z_bound \"%s\": expected \"<field|all> <abs|rel> <value>\".\n", config.z_bound.item[n]);
+			nErr++;
+			continue;
+		}
+		for (l = 0; l < OUT_NFIELDS; l++) {
+			if (strcmp(field, "all") == 0 || strcmp(field, OutputFieldNames[l]) == 0) {
+				zBound[l] = value;
+				zRelative[l] = (kind[0] == 'r');
+				if (strcmp(field, "all") != 0) break;
 			}
 		}
+		if (l == OUT_NFIELDS && strcmp(field, "all") != 0) {
+			if (0 == myid) fprintf(stderr, "z_bound \"%s\": unknown field \"%s\".\n", config.z_bound.item[n], field);
+			nErr++;
+		}
 	}
-	//--- close file
+	return nErr;
+} // end parseBounds()
+
+
+/*
+* OutputCompressed - Frame of error-bounded compressed fields "<step>.zsnap" (see zcomp.c).
+*
+* Every process compresses each field of its x-slab on its own; the blocks of all
+* processes are written with one collective call after a header holding the grid,
+* the absolute bound of every field and the table of block sizes [numprocs][fields].
+* "zsnap" restores "<step>.snap", described by the "<step>.xmf" written here.
+*/
+static void OutputCompressed(const Frame *f, int myid)
+{
+static float *buf = NULL;
+static unsigned char *blob = NULL;
+char filename[30], head[64];
+MPI_File fh;
+MPI_Offset offset;
+int numprocs, r, hdr[7];
+unsigned i, j, k, l, n;
+unsigned long long *sizes, mySize = 0, total;
+double lo[OUT_NFIELDS], hi[OUT_NFIELDS], eb[OUT_NFIELDS], err[OUT_NFIELDS];
+real v[OUT_NVARS];
+
+	MPI_Comm_size(OutputComm, &numprocs);
+
+	//--- staging buffer: variable-major, then k, j, i
+	n = LEN * HIG * DEP;
+	if (buf == NULL) {
+		buf  = (float *)malloc(OUT_NFIELDS * n * sizeof(float));
+		blob = (unsigned char *)malloc(OUT_NFIELDS * ZCompressBound(n));
+		if (buf == NULL || blob == NULL) {
+			fprintf(stderr, "mpi_layer2: can't allocate memory for compressed frame.\n");
+			MPI_Abort(MPI_COMM_WORLD, 1);
+		}
+	}
+	for (l = 0; l < OUT_NFIELDS; l++) {
+		lo[l] =  HUGE_VAL;
+		hi[l] = -HUGE_VAL;
+	}
+	for (k = 1; k < DEPP; k++) {
+		for (j = 1; j < HIGG; j++) {
+			for (i = 1; i < LENN; i++) {
+				CellValues(f, i, j, k, myid, v);
+				for (l = 0; l < OUT_NFIELDS; l++) {
+					buf[l*n + ((k-1)*HIG + (j-1))*LEN + (i-1)] = v[l+3];
+					if (v[l+3] < lo[l]) lo[l] = v[l+3];
+					if (v[l+3] > hi[l]) hi[l] = v[l+3];
+				}
+			}
+		}
+	}
+
+	//--- absolute bounds, the same on every process
+	MPI_Allreduce(MPI_IN_PLACE, lo, OUT_NFIELDS, MPI_DOUBLE, MPI_MIN, OutputComm);
+	MPI_Allreduce(MPI_IN_PLACE, hi, OUT_NFIELDS, MPI_DOUBLE, MPI_MAX, OutputComm);
+	for (l = 0; l < OUT_NFIELDS; l++)
+		eb[l] = zRelative[l] ? zBound[l] * (hi[l] > lo[l] ? hi[l] - lo[l] : 0.) : zBound[l];
+
+	//--- blocks of _this_ process, one after another
+	if ((sizes = (unsigned long long *)malloc(numprocs * OUT_NFIELDS * sizeof(unsigned long long))) == NULL) {
+		fprintf(stderr, "mpi_layer2: can't allocate memory for compressed frame.\n");
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+	for (l = 0; l < OUT_NFIELDS; l++) {
+		sizes[myid*OUT_NFIELDS + l] = ZCompress(buf + l*n, LEN, HIG, DEP, eb[l], blob + mySize, &err[l]);
+		mySize += sizes[myid*OUT_NFIELDS + l];
+	}
+	MPI_Allgather(MPI_IN_PLACE, OUT_NFIELDS, MPI_UNSIGNED_LONG_LONG,
+	              sizes, OUT_NFIELDS, MPI_UNSIGNED_LONG_LONG, OutputComm);
+	MPI_Allreduce(MPI_IN_PLACE, err, OUT_NFIELDS, MPI_DOUBLE, MPI_MAX, OutputComm);
+
+	//--- header: magic, nx, ny, nz, numprocs, fields, step, LEN, time, bounds, block sizes
+	memset(head, 0, sizeof(head));
+	memcpy(head, "LAYER2Z1", 8);
+	hdr[0] = LEN*numprocs; hdr[1] = HIG; hdr[2] = DEP; hdr[3] = numprocs;
+	hdr[4] = OUT_NFIELDS;  hdr[5] = f->step; hdr[6] = LEN;
+	memcpy(head + 8, hdr, sizeof(hdr));
+	{ double t = f->time; memcpy(head + 8 + sizeof(hdr), &t, sizeof(t)); }
+	offset = 8 + sizeof(hdr) + sizeof(double) + sizeof(eb) + numprocs * OUT_NFIELDS * sizeof(unsigned long long);
+	for (r = 0; r < myid; r++)
+		for (l = 0; l < OUT_NFIELDS; l++) offset += sizes[r*OUT_NFIELDS + l];
+
+	sprintf(filename, "%d.zsnap", f->step);
+	MPI_File_open(OutputComm, filename, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fh);
+	MPI_File_set_size(fh, 0);
+	if (0 == myid) {
+		MPI_File_write_at(fh, 0, head, 8 + sizeof(hdr) + sizeof(double), MPI_BYTE, MPI_STATUS_IGNORE);
+		MPI_File_write_at(fh, 8 + sizeof(hdr) + sizeof(double), eb, OUT_NFIELDS, MPI_DOUBLE, MPI_STATUS_IGNORE);
+		MPI_File_write_at(fh, 8 + sizeof(hdr) + sizeof(double) + sizeof(eb), sizes,
+		                  numprocs * OUT_NFIELDS, MPI_UNSIGNED_LONG_LONG, MPI_STATUS_IGNORE);
+	}
+	MPI_File_write_at_all(fh, offset, blob, (int)mySize, MPI_BYTE, MPI_STATUS_IGNORE);
 	MPI_File_close(&fh);
 
+	//--- report
+	if (0 == myid) {
+		sprintf(filename, "%d.snap", f->step);
+		WriteXdmf(f, filename, LEN*numprocs, 0);
+		for (l = 0; l < OUT_NFIELDS; l++) {
+			for (total = 0, r = 0; r < numprocs; r++) total += sizes[r*OUT_NFIELDS + l];
+			fprintf(stdout, "Frame %d: %-9s ratio %6.2f, max error %g (bound %g)\n", f->step,
+			        OutputFieldNames[l], (double)n * numprocs * sizeof(float) / total, err[l], eb[l]);
+		}
+	}
+	free(sizes);
+
+} // end OutputCompressed()
+
+
+/*
+* WriteXdmf - Describes a frame of OUT_NFIELDS cell-centred float arrays [DEP][HIG][nx]
+* ("<step>.xmf" is written). They are either stored one after another in the raw
+* "datafile", or as datasets OutputFieldNames[] of the HDF5 "datafile" (hdf != 0).
+*/
+void WriteXdmf(const Frame *f, const char *datafile, unsigned nx, int hdf)
+{
+FILE *pF;
+char filename[30];
+unsigned l;
+long size = (long)nx * HIG * DEP * sizeof(float);
+
+	sprintf(filename, "%d.xmf", f->step);
+	if ((pF = fopen(filename, "w")) == NULL) {
+		fprintf(stderr, "can't open \"%s\".\n", filename);
+		return;
+	}
+	fprintf(pF, "<?xml version=\"1.0\" ?>\n");
+	fprintf(pF, "<Xdmf Version=\"2.0\">\n <Domain>\n");
+	fprintf(pF, "  <Grid Name=\"layer2\" GridType=\"Uniform\">\n");
+	fprintf(pF, "   <Time Value=\"%g\"/>\n", f->time);
+	if (GridStretched()) {
+		int lo[3] = { 0, 0, 0 }, st[3] = { 1, 1, 1 }, n[3];
+		n[0] = nx+1; n[1] = HIG+1; n[2] = DEP+1;
+		GridXdmf(pF, 3, 0, lo, st, n);
+	}
+	else {
+		fprintf(pF, "   <Topology TopologyType=\"3DCoRectMesh\" Dimensions=\"%d %d %d\"/>\n", DEP+1, HIG+1, nx+1);
+		fprintf(pF, "   <Geometry GeometryType=\"ORIGIN_DXDYDZ\">\n");
+		fprintf(pF, "    <DataItem Format=\"XML\" Dimensions=\"3\">0 0 0</DataItem>\n");
+		fprintf(pF, "    <DataItem Format=\"XML\" Dimensions=\"3\">%g %g %g</DataItem>\n", deltaZ, deltaY, deltaX);
+		fprintf(pF, "   </Geometry>\n");
+	}
+	for (l = 0; l < OUT_NFIELDS; l++) {
+		fprintf(pF, "   <Attribute Name=\"%s\" AttributeType=\"Scalar\" Center=\"Cell\">\n", OutputVarNames[l+3]);
+		if (hdf) {
+			fprintf(pF, "    <DataItem Format=\"HDF\" NumberType=\"Float\" Precision=\"4\"");
+			fprintf(pF, " Dimensions=\"%d %d %d\">%s:/%s</DataItem>\n", DEP, HIG, nx, datafile, OutputFieldNames[l]);
+		}
+		else {
+			fprintf(pF, "    <DataItem Format=\"Binary\" NumberType=\"Float\" Precision=\"4\" Endian=\"Native\"");
+			fprintf(pF, " Seek=\"%ld\" Dimensions=\"%d %d %d\">%s</DataItem>\n", l*size, DEP, HIG, nx, datafile);
+		}
+		fprintf(pF, "   </Attribute>\n");
+	}
+	fprintf(pF, "  </Grid>\n </Domain>\n</Xdmf>\n");
+	fclose(pF);
+
+} // end WriteXdmf()
+
+
+/*
+* writeFrame - Writes the frame in the format chosen by "f_format".
+*/
+static void writeFrame(const Frame *f, int myid)
+{
+	switch (config.f_format) {
+		case 1:  OutputSnapshot(f, myid); break;
+		case 2:  OutputHDF5(f, myid);     break;
+		case 3:  OutputTecplotBinary(f, myid); break;
+		case 4:  OutputCompressed(f, myid);    break;
+		default: OutputTecplot(f, myid);  break;
+	}
+} // end writeFrame()
+
+
+void CurrentFrame(Frame *f)
+{
+	f->U1 = U1; f->U2 = U2; f->U3 = U3; f->U4 = U4; f->U5 = U5;
+	f->mu_SGS = mu_SGS;
+	f->step = step;
+	f->time = totalTime;
+	f->deltaT = deltaT;
+	f->X = X;
+} // end CurrentFrame()
+
+
+/*
+*  Asynchronous output (f_async = 1).
+*
+*  The solver only copies the conservative variables (ghost cells included) into
+*  one of "f_buffers" staging frames and goes on with the next step; a writer
+*  thread of the same process computes the derived quantities and writes the
+*  frames in the order they were taken. When every staging frame is still waiting
+*  to be written the solver blocks until the writer frees one (back-pressure),
+*  so memory stays bounded by f_buffers copies of the five fields.
+*
+*  The writers of all processes meet in the collectives of "OutputComm", a
+*  duplicate of MPI_COMM_WORLD, so their traffic never mixes with that of the
+*  solver. This needs MPI_THREAD_MULTIPLE; without it output stays synchronous.
+*/
+MPI_Comm OutputComm = MPI_COMM_NULL;
+
+static int asyncOn = 0;
+static Frame *frames = NULL;          /* ring of staging frames */
+static unsigned nFrames, head, count; /* oldest frame and number of frames queued */
+static int writerStop = 0;
+static pthread_t writer;
+static pthread_mutex_t frameLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  frameCond = PTHREAD_COND_INITIALIZER;
+static int writerId;
+
+
+static void *writerThread(void *arg)
+{
+Frame *f;
+
+	while (1) {
+		pthread_mutex_lock(&frameLock);
+		while (count == 0 && !writerStop) pthread_cond_wait(&frameCond, &frameLock);
+		if (count == 0) {
+			pthread_mutex_unlock(&frameLock);
+			break;
+		}
+		f = &frames[head];
+		pthread_mutex_unlock(&frameLock);
+
+		writeFrame(f, writerId);
+
+		//--- the frame is free for the solver again
+		pthread_mutex_lock(&frameLock);
+		head = (head + 1) % nFrames;
+		count--;
+		pthread_cond_broadcast(&frameCond);
+		pthread_mutex_unlock(&frameLock);
+	}
+	return NULL;
+
+} // end writerThread()
+
+
+/*
+* copyField - Copies a whole 3-D array, ghost cells included.
+*/
+static void copyField(real ***dst, real ***src)
+{
+unsigned i, j;
+
+	for (i = 0; i < LEN+2; i++)
+		for (j = 0; j < HIG+2; j++)
+			memcpy(dst[i][j], src[i][j], (DEP+2) * sizeof(real));
+} // end copyField()
+
+
+void OutputInit(int myid)
+{
+int provided;
+unsigned n;
+
+	MPI_Comm_dup(MPI_COMM_WORLD, &OutputComm);
+	if (parseBounds(myid)) MPI_Abort(MPI_COMM_WORLD, 1);
+	if (!config.f_async) return;
+
+	MPI_Query_thread(&provided);
+	if (provided < MPI_THREAD_MULTIPLE) {
+		if (0 == myid)
+			fprintf(stdout, "Output: MPI library gives no MPI_THREAD_MULTIPLE, frames are written synchronously.\n");
+		return;
+	}
+
+	nFrames = config.f_buffers;
+	if ((frames = (Frame *)calloc(nFrames, sizeof(Frame))) == NULL) {
+		fprintf(stderr, "mpi_layer2: can't allocate memory for output frames.\n");
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+	for (n = 0; n < nFrames; n++) {
+		frames[n].U1 = Array3D(LEN+2, HIG+2, DEP+2);
+		frames[n].U2 = Array3D(LEN+2, HIG+2, DEP+2);
+		frames[n].U3 = Array3D(LEN+2, HIG+2, DEP+2);
+		frames[n].U4 = Array3D(LEN+2, HIG+2, DEP+2);
+		frames[n].U5 = Array3D(LEN+2, HIG+2, DEP+2);
+		frames[n].mu_SGS = DynamicSmagorinskySGS ? Array3D(LEN+2, HIG+2, DEP+2) : NULL;
+	}
+	head = count = 0;
+	writerStop = 0;
+	writerId = myid;
+	if (pthread_create(&writer, NULL, writerThread, NULL) != 0) {
+		fprintf(stderr, "mpi_layer2: can't start the output thread.\n");
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+	asyncOn = 1;
+
+} // end OutputInit()
+
+
+void OutputFlush(void)
+{
+	if (!asyncOn) return;
+
+	pthread_mutex_lock(&frameLock);
+	while (count > 0) pthread_cond_wait(&frameCond, &frameLock);
+	pthread_mutex_unlock(&frameLock);
+
+} // end OutputFlush()
+
+
+void OutputFinalize(int myid)
+{
+unsigned n;
+
+	if (asyncOn) {
+		pthread_mutex_lock(&frameLock);
+		writerStop = 1;
+		pthread_cond_broadcast(&frameCond);
+		pthread_mutex_unlock(&frameLock);
+		pthread_join(writer, NULL);
+		asyncOn = 0;
+
+		for (n = 0; n < nFrames; n++) {
+			free3D(frames[n].U1, LEN+2, HIG+2);
+			free3D(frames[n].U2, LEN+2, HIG+2);
+			free3D(frames[n].U3, LEN+2, HIG+2);
+			free3D(frames[n].U4, LEN+2, HIG+2);
+			free3D(frames[n].U5, LEN+2, HIG+2);
+			if (frames[n].mu_SGS != NULL) free3D(frames[n].mu_SGS, LEN+2, HIG+2);
+		}
+		free(frames);
+		frames = NULL;
+	}
+	MPI_Comm_free(&OutputComm);
+
+} // end OutputFinalize()
+
+
+/***********
+*  OUTPUT  *   Outputs flowfield in the format chosen by "f_format"
+***********/
+void Output(int myid)
+{
+Frame *f;
+
+	//--- the refined blocks are written at once, they are not staged
+	AmrOutput(myid);
+
+	if (!asyncOn) {
+		Frame now;
+		CurrentFrame(&now);
+		writeFrame(&now, myid);
+		return;
+	}
 
-} // end Output()
\ No newline at end of file
+	//--- wait for a free staging frame
+	pthread_mutex_lock(&frameLock);
+	if (count == nFrames && 0 == myid)
+		fprintf(stdout, "Output: all %u frame buffers busy, step %d waits for the writer.\n", nFrames, step);
+	while (count == nFrames) pthread_cond_wait(&frameCond, &frameLock);
+	f = &frames[(head + count) % nFrames];
+	pthread_mutex_unlock(&frameLock);
+
+	//--- the writer never touches a frame outside the queue
+	copyField(f->U1, U1);
+	copyField(f->U2, U2);
+	copyField(f->U3, U3);
+	copyField(f->U4, U4);
+	copyField(f->U5, U5);
+	if (f->mu_SGS != NULL) copyField(f->mu_SGS, mu_SGS);
+	f->step = step;
+	f->time = totalTime;
+	f->deltaT = deltaT;
+	f->X = X;
+
+	//--- hand it over
+	pthread_mutex_lock(&frameLock);
+	count++;
+	pthread_cond_broadcast(&frameCond);
+	pthread_mutex_unlock(&frameLock);
+
+} // end Output()
@@ -1 +1,52 @@
-void Output( );
\ No newline at end of file
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#define OUT_NVARS   12 /* x, y, z, rho, u, v, w, p, T, vort. mag., Q, muT ratio */
+#define OUT_NFIELDS  9 /* the same without coordinates */
+
+/*
+* Frame - Conservative variables (ghost cells included) and time of one flowfield
+* frame. Points either to the solver arrays or to a staged copy of them.
+*/
+typedef struct {
+	real ***U1, ***U2, ***U3, ***U4, ***U5, ***mu_SGS;
+	unsigned step;
+	real time, deltaT;
+	double X;
+} Frame;
+
+extern const char *OutputVarNames[OUT_NVARS];
+extern const char *OutputFieldNames[OUT_NFIELDS];
+
+/* communicator of the frame writers, a duplicate of MPI_COMM_WORLD */
+extern MPI_Comm OutputComm;
+
+/*
+* CurrentFrame - The frame made of the solver arrays themselves, at the current step.
+*/
+void CurrentFrame( Frame *f );
+
+void CellValues( const Frame *f, unsigned i, unsigned j, unsigned k, int myid, real v[OUT_NVARS] );
+void WriteXdmf( const Frame *f, const char *datafile, unsigned nx, int hdf );
+
+/*
+* OutputInit - Sets up the writers; with f_async = 1 starts the writer thread.
+*/
+void OutputInit( int myid );
+
+/*
+* Output - Takes a frame at the current step: writes it, or stages it for the writer thread.
+*/
+void Output( int myid );
+
+/*
+* OutputFlush - Waits until every staged frame is written.
+*/
+void OutputFlush( void );
+
+/*
+* OutputFinalize - Writes the frames still staged, stops the writer thread and frees OutputComm.
+*/
+void OutputFinalize( int myid );
+
+#endif
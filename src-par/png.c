@@ -0,0 +1,238 @@
+/*
+*  PNG
+*
+*  Minimal PNG writer for the images rendered during the run: 8-bit palette
+*  images, no row filters, one deflate block with the fixed Huffman codes. The
+*  LZ77 search (hash chains over a 32 KB window) finds the long runs and repeated
+*  rows of colour-mapped slices, which is where nearly all of the compression
+*  comes from, so no zlib is needed.
+*
+*/
+#include <stdio.h>     /* fopen() etc. */
+#include <stdlib.h>    /* malloc()     */
+#include <string.h>    /* memcpy()     */
+
+#include "png.h"
+
+#define LZ_WINDOW  32768
+#define LZ_HASH    ( 1 << 15 )
+#define LZ_CHAIN   64          /* candidates looked at per position */
+#define LZ_MAXLEN  258
+
+typedef struct {
+	unsigned char *buf;
+	size_t n, cap;
+	unsigned long bits;
+	int nbits;
+} BitOut;
+
+static const unsigned short lenBase[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const unsigned char lenExtra[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const unsigned short distBase[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+	1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const unsigned char distExtra[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+
+static void putByte( BitOut *b, unsigned char c )
+{
+	if( b->n == b->cap ) {
+		b->cap = b->cap ? 2 * b->cap : 1 << 16;
+		b->buf = (unsigned char *)realloc( b->buf, b->cap );
+		if( b->buf == NULL ) { fprintf( stderr, "can't allocate memory for PNG.\n" ); exit( -1 ); }
+	}
+	b->buf[b->n++] = c;
+}
+
+/* deflate packs bits from the least significant one */
+static void putBits( BitOut *b, unsigned v, int n )
+{
+	b->bits |= (unsigned long)v << b->nbits;
+	b->nbits += n;
+	while( b->nbits >= 8 ) {
+		putByte( b, b->bits & 0xFF );
+		b->bits >>= 8;
+		b->nbits -= 8;
+	}
+}
+
+/* ... but Huffman codes from the most significant one */
+static void putCode( BitOut *b, unsigned code, int n )
+{
+unsigned r = 0;
+int l;
+
+	for( l = 0; l < n; l++ ) r |= ( ( code >> l ) & 1 ) << ( n - 1 - l );
+	putBits( b, r, n );
+}
+
+static void putLiteral( BitOut *b, unsigned v )
+{
+	if( v < 144 )      putCode( b, 0x30 + v, 8 );
+	else if( v < 256 ) putCode( b, 0x190 + v - 144, 9 );
+	else if( v < 280 ) putCode( b, v - 256, 7 );
+	else               putCode( b, 0xC0 + v - 280, 8 );
+}
+
+static void putMatch( BitOut *b, unsigned len, unsigned dist )
+{
+int c;
+
+	for( c = 28; lenBase[c] > len; c-- );
+	putLiteral( b, 257 + c );
+	putBits( b, len - lenBase[c], lenExtra[c] );
+	for( c = 29; distBase[c] > dist; c-- );
+	putCode( b, c, 5 );
+	putBits( b, dist - distBase[c], distExtra[c] );
+}
+
+
+/*
+* lzDeflate - Compresses n bytes into a zlib stream appended to b.
+*/
+static void lzDeflate( BitOut *b, const unsigned char *d, size_t n )
+{
+int *head, *prev;
+size_t p, q, best, bestDist, l;
+unsigned long s1 = 1, s2 = 0;
+unsigned h;
+int chain;
+
+	head = (int *)malloc( LZ_HASH * sizeof(int) );
+	prev = (int *)malloc( LZ_WINDOW * sizeof(int) );
+	if( head == NULL || prev == NULL ) { fprintf( stderr, "can't allocate memory for PNG.\n" ); exit( -1 ); }
+	memset( head, -1, LZ_HASH * sizeof(int) );
+
+	putByte( b, 0x78 ); putByte( b, 0x01 );     /* zlib header: deflate, 32 KB window */
+	putBits( b, 1, 1 ); putBits( b, 1, 2 );      /* final block, fixed codes */
+
+	#define HASH( i ) ( ( ( d[i] << 10 ) ^ ( d[(i)+1] << 5 ) ^ d[(i)+2] ) & ( LZ_HASH - 1 ) )
+	#define INSERT( i ) if( (i) + 2 < n ) { h = HASH( i ); prev[(i) % LZ_WINDOW] = head[h]; head[h] = (int)(i); }
+
+	for( p = 0; p < n; ) {
+		best = 0; bestDist = 0;
+		if( p + 2 < n ) {
+			h = HASH( p );
+			for( q = head[h], chain = 0; head[h] >= 0 && chain < LZ_CHAIN && p - q <= LZ_WINDOW - 1; chain++ ) {
+				for( l = 0; l < LZ_MAXLEN && p + l < n && d[q + l] == d[p + l]; l++ );
+				if( l > best ) { best = l; bestDist = p - q; if( l == LZ_MAXLEN ) break; }
+				if( prev[q % LZ_WINDOW] < 0 || (size_t)prev[q % LZ_WINDOW] >= q ) break;
+				q = prev[q % LZ_WINDOW];
+			}
+		}
+		if( best >= 3 ) {
+			putMatch( b, best, bestDist );
+			for( l = 0; l < best; l++, p++ ) { INSERT( p ); }
+		}
+		else {
+			putLiteral( b, d[p] );
+			INSERT( p );
+			p++;
+		}
+	}
+	#undef INSERT
+	#undef HASH
+
+	putLiteral( b, 256 );                        /* end of block */
+	if( b->nbits ) putBits( b, 0, 8 - b->nbits );
+
+	for( p = 0; p < n; p++ ) {
+		s1 = ( s1 + d[p] ) % 65521;
+		s2 = ( s2 + s1 ) % 65521;
+	}
+	for( l = 0; l < 4; l++ ) putByte( b, ( ( s2 << 16 | s1 ) >> ( 24 - 8 * l ) ) & 0xFF );
+
+	free( head ); free( prev );
+
+} /* end lzDeflate() */
+
+
+static unsigned long crcPNG( unsigned long crc, const unsigned char *d, size_t n )
+{
+static unsigned long table[256];
+unsigned long c;
+size_t p;
+int m, l;
+
+	if( table[1] == 0 ) {
+		for( m = 0; m < 256; m++ ) {
+			for( c = m, l = 0; l < 8; l++ ) c = ( c & 1 ) ? 0xEDB88320UL ^ ( c >> 1 ) : c >> 1;
+			table[m] = c;
+		}
+	}
+	crc ^= 0xFFFFFFFFUL;
+	for( p = 0; p < n; p++ ) crc = table[( crc ^ d[p] ) & 0xFF] ^ ( crc >> 8 );
+	return crc ^ 0xFFFFFFFFUL;
+}
+
+static void putU32( unsigned char *p, unsigned long v )
+{
+	p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v;
+}
+
+/*
+* writeChunk - Length, type, data and CRC of a PNG chunk.
+*/
+static void writeChunk( FILE *pF, const char *type, const unsigned char *data, size_t n )
+{
+unsigned char a[4];
+unsigned long crc;
+
+	putU32( a, n );
+	fwrite( a, 1, 4, pF );
+	fwrite( type, 1, 4, pF );
+	if( n ) fwrite( data, 1, n, pF );
+	crc = crcPNG( crcPNG( 0, (const unsigned char *)type, 4 ), data, n );
+	putU32( a, crc );
+	fwrite( a, 1, 4, pF );
+}
+
+
+int WritePNG( const char *filename, const unsigned char *pix, unsigned w, unsigned h,
+              const unsigned char palette[256][3] )
+{
+static const unsigned char signature[8] = { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+unsigned char ihdr[13], *raw;
+BitOut z = { NULL, 0, 0, 0, 0 };
+FILE *pF;
+unsigned r;
+int rc;
+
+	//--- every row starts with its filter type, 0 - none
+	if( ( raw = (unsigned char *)malloc( (size_t)( w + 1 ) * h ) ) == NULL ) {
+		fprintf( stderr, "can't allocate memory for PNG.\n" );
+		exit( -1 );
+	}
+	for( r = 0; r < h; r++ ) {
+		raw[(size_t)r * ( w + 1 )] = 0;
+		memcpy( raw + (size_t)r * ( w + 1 ) + 1, pix + (size_t)r * w, w );
+	}
+	lzDeflate( &z, raw, (size_t)( w + 1 ) * h );
+	free( raw );
+
+	if( ( pF = fopen( filename, "wb" ) ) == NULL ) {
+		fprintf( stderr, "can't open \"%s\".\n", filename );
+		free( z.buf );
+		return -1;
+	}
+	putU32( ihdr, w );
+	putU32( ihdr + 4, h );
+	ihdr[8] = 8;      /* bits per index */
+	ihdr[9] = 3;      /* palette colours */
+	ihdr[10] = ihdr[11] = ihdr[12] = 0;
+
+	fwrite( signature, 1, 8, pF );
+	writeChunk( pF, "IHDR", ihdr, 13 );
+	writeChunk( pF, "PLTE", &palette[0][0], 256 * 3 );
+	writeChunk( pF, "IDAT", z.buf, z.n );
+	writeChunk( pF, "IEND", NULL, 0 );
+	rc = ferror( pF ) ? -1 : 0;
+	fclose( pF );
+	free( z.buf );
+
+	return rc;
+} /* end WritePNG() */
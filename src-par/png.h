@@ -0,0 +1,12 @@
+#ifndef PNG_H
+#define PNG_H
+
+/*
+* WritePNG - Writes a w x h image of palette indices (rows from the top, one byte
+* per pixel) with its 256-colour palette (r, g, b) as "filename". Returns 0 on
+* success, -1 if the file can't be written.
+*/
+int WritePNG( const char *filename, const unsigned char *pix, unsigned w, unsigned h,
+              const unsigned char palette[256][3] );
+
+#endif
@@ -1,35 +1,665 @@
-/***********
-*  PROBES  *  Writes readings of arrays of probes to the file "probes.dat"
-***********/
-
+/*
+*  PROBES
+*
+*  Registry of probes: points, lines and planes in global coordinates [m], each
+*  given by a "probe" key of the configuration file:
+*
+*      probe = centre x=41.7 y=40   z=26.25              vars=rho,u,p
+*      probe = line1  x=20.8        z=26.25              vars=rho,rhou
+*      probe = rake   x=10:70:13 y=40 z=26.25 interp=linear
+*      probe = plane  x=41.7                 vars=u,v,w
+*
+*  x, y, z take "a", "a:b" or "a:b:n": one point, or n points from a to b (by
+*  default one per cell of the span); a direction left out gives the cell centres
+*  across the domain. "vars" is a comma-separated list of rho, u, v, w, p, T, rhou,
+*  rhov, rhow (default rho,u,v,w,p), "interp" is cell (the value of the cell holding
+*  the point, default) or linear (trilinear between the eight nearest centres).
+*  Without any probe key three vertical lines of rho and rhou at a quarter, half
+*  and three quarters of the length, at mid depth, are taken.
+*
+*  Every point is resolved once to the process owning it and to its cells. A point
+*  interpolated between the last cells of a process and the first of the next one
+*  gets those values by a small exchange with the neighbour. Samples are taken every
+*  p_every steps into a buffer of p_buffer records and written when it is full, at
+*  checkpoints and at the end of the run:
+*
+*      p_gather = 1   all processes write "probes.bin" in one collective call,
+*      p_gather = 0   each process writes the points it owns to "probes.<id>.bin".
+*
+*  A probe file (probefile.h) is self-describing: a header (the probes, then for
+*  every point its probe, index and coordinates) and fixed-size records: time
+*  (double), step (int), 4 spare bytes and the float values, point after point.
+*  A continued run (Answer = 1) drops the records after the step it starts from.
+*
+*/
+#include "mpi.h"
 #include <stdio.h>     /* printf() etc.*/
-#include <stdlib.h>    /* atoi()       */
+#include <stdlib.h>    /* malloc()     */
+#include <string.h>    /* strtok_r()   */
+#include <math.h>      /* floor()      */
+#include <unistd.h>    /* ftruncate()  */
 
 #include "type.h"
+#include "def.h"      /* Definitions, parameters */
 #include "global.h"   /* global variables */
+#include "config.h"
+#include "grid.h"     /* GridCell(), GridCentre() */
 
+#include "probefile.h"
 #include "probes.h"
 
-int Probes(int myid)
-{
-	//--- probes are positioned on line formed by intersection of
-	//    cenral x-, z-planes
-	i = LEN/2+1;
-	k = DEP/2+1;
-
-	//--- output to "probes.myid"
-	// step
-	fwrite(&step, sizeof(step), 1, pFprobes);
-	// HIG-sized blocks of current R and RU
-		//
-	for (j = 1; j < HIGG; j++)
-		probes[j-1] = U1[i][j][k];
-	fwrite(probes, sizeof(probes[0]) * HIG, 1, pFprobes);
-		//
-	for (j = 1; j < HIGG; j++)
-		probes[j-1] = U2[i][j][k];
-	fwrite(probes, sizeof(probes[0]) * HIG, 1, pFprobes);
-
-	//---
+const char *ProbeVarNames[PRB_NVARS] = { "rho", "u", "v", "w", "p", "T", "rhou", "rhov", "rhow" };
+
+typedef struct {
+	char   name[32];
+	int    nv, var[PRB_NVARS];
+	int    linear;            /* trilinear interpolation */
+	int    n[3];              /* points in x, y, z */
+	double lo[3], hi[3];      /* first and last point */
+	int    first, col;        /* first point and first value of the probe over all probes */
+} Probe;
+
+typedef struct {
+	int      probe, index;    /* probe and point within it */
+	int      col;             /* first value in the record of "probes.bin" */
+	float    x[3];
+	unsigned c[3];            /* local cell (lower corner if linear) */
+	float    w[3];            /* weights of the upper corners */
+	int      remote;          /* upper x-corners on the next process: first of four in remote[] */
+} Sample;
+
+static Probe prb[CFG_LIST_MAX];
+static int nPrb = 0;
+
+static Sample *smp = NULL;     /* points of _this_ process */
+static int nSmp = 0, nVal = 0; /* their number and the number of their values */
+static int nPoints = 0, nValues = 0;
+
+/* corners wanted from the next process ([j][k] of its first plane), and given to the previous one */
+static int nWant = 0, nGive = 0, *want = NULL, *give = NULL;
+static float *remote = NULL, *giveBuf = NULL;
+
+/* buffer of records */
+static unsigned char *recBuf = NULL;
+static int recBytes, nRec = 0;
+static long long fileRec = 0;  /* records already in the file */
+static int recordSize, headerSize, hasHead;
+
+static MPI_File fh;
+static FILE *pF = NULL;
+
+
+/*
+* parseAxis - "a", "a:b" or "a:b:n" within [0, len]; returns 0 on success.
+*/
+static int parseAxis( const char *s, double len, double d, double *lo, double *hi, int *n )
+{
+char *end;
+
+	*lo = *hi = strtod( s, &end );
+	*n = 1;
+	if( *end == ':' ) {
+		*hi = strtod( end + 1, &end );
+		*n = (int)( fabs( *hi - *lo ) / d + 0.5 ) + 1;
+		if( *n < 2 ) *n = 2;
+		if( *end == ':' ) *n = strtol( end + 1, &end, 10 );
+	}
+	if( *end != '\0' || *n < 1 || *lo < 0. || *lo > len || *hi < 0. || *hi > len ) return 1;
+	return 0;
+} /* end parseAxis() */
+
+
+/*
+* parseProbe - Fills e from the text of a "probe" key; returns 0 on success.
+*/
+static int parseProbe( const char *text, Probe *e, int numprocs, int myid )
+{
+char line[CFG_LIST_LEN], *tok, *val, *name, *save1, *save2;
+double len[3], d[3];
+int a, l, N[3];
+
+	N[0] = LEN * numprocs; N[1] = HIG; N[2] = DEP;
+	d[0] = deltaX; d[1] = deltaY; d[2] = deltaZ;
+	for( a = 0; a < 3; a++ ) {
+		len[a] = GridFace( a, N[a] );
+		e->lo[a] = GridCentre( a, 0 ); e->hi[a] = GridCentre( a, N[a] - 1 ); e->n[a] = N[a];
+	}
+	e->nv = 5;
+	for( l = 0; l < 5; l++ ) e->var[l] = l;
+	e->linear = 0;
+
+	strcpy( line, text );
+	if( ( tok = strtok_r( line, " \t", &save1 ) ) == NULL || strchr( tok, '=' ) != NULL || strlen( tok ) >= sizeof(e->name) ) {
+		if( 0 == myid ) fprintf( stderr, "probe \"%s\": the name must come first.\n", text );
+		return 1;
+	}
+	strcpy( e->name, tok );
+
+	while( ( tok = strtok_r( NULL, " \t", &save1 ) ) != NULL ) {
+		if( ( val = strchr( tok, '=' ) ) == NULL ) goto bad;
+		*val++ = '\0';
+		if( strlen( tok ) == 1 && ( a = tok[0] - 'x' ) >= 0 && a < 3 ) {
+			if( parseAxis( val, len[a], d[a], &e->lo[a], &e->hi[a], &e->n[a] ) ) goto bad;
+		}
+		else if( strcmp( tok, "vars" ) == 0 ) {
+			e->nv = 0;
+			for( name = strtok_r( val, ",", &save2 ); name != NULL; name = strtok_r( NULL, ",", &save2 ) ) {
+				for( l = 0; l < PRB_NVARS && strcmp( name, ProbeVarNames[l] ) != 0; l++ );
+				if( l == PRB_NVARS || e->nv == PRB_NVARS ) goto bad;
+				e->var[e->nv++] = l;
+			}
+			if( e->nv == 0 ) goto bad;
+		}
+		else if( strcmp( tok, "interp" ) == 0 ) {
+			if( strcmp( val, "cell" ) == 0 )        e->linear = 0;
+			else if( strcmp( val, "linear" ) == 0 ) e->linear = 1;
+			else goto bad;
+		}
+		else goto bad;
+	}
+	return 0;
+
+bad:
+	if( 0 == myid ) fprintf( stderr, "probe \"%s\": bad \"%s\".\n", text, tok );
 	return 1;
-} // end Probes()
\ No newline at end of file
+} /* end parseProbe() */
+
+
+/*
+* locate - Global cell of coordinate x along the axis a of N cells: the cell holding
+* it, or the lower of the two centres around it and the weight of the upper one.
+*/
+static int locate( double x, int a, int N, int linear, float *w )
+{
+double lo, hi;
+int c;
+
+	*w = 0.;
+	c = GridCell( a, x );
+	if( !linear ) return c;
+	if( N == 1 ) return 0;
+	if( x < GridCentre( a, c ) ) c--;
+	if( c < 0 )     return 0;
+	if( c > N - 2 ) { *w = 1.; return N - 2; }
+	lo = GridCentre( a, c ); hi = GridCentre( a, c + 1 );
+	*w = (float)( ( x - lo ) / ( hi - lo ) );
+	return c;
+} /* end locate() */
+
+
+/*
+* cellVar - Variable of the cell whose conservative variables are q.
+*/
+static real cellVar( int var, const real q[5] )
+{
+real p;
+
+	switch( var ) {
+		case 0: return q[0];
+		case 1: return q[1] / q[0];
+		case 2: return q[2] / q[0];
+		case 3: return q[3] / q[0];
+		case 6: return q[1];
+		case 7: return q[2];
+		case 8: return q[3];
+	}
+	p = ( q[4] - 0.5 * ( q[1]*q[1] + q[2]*q[2] + q[3]*q[3] ) / q[0] ) * K_1;
+	return var == 4 ? p : p / ( R_VOZD * q[0] );
+
+} /* end cellVar() */
+
+
+static void cellState( unsigned i, unsigned j, unsigned k, real q[5] )
+{
+	q[0] = U1[i][j][k]; q[1] = U2[i][j][k]; q[2] = U3[i][j][k]; q[3] = U4[i][j][k]; q[4] = U5[i][j][k];
+}
+
+
+/*
+* resolve - Enumerates the points of all probes, keeps those of _this_ process.
+*/
+static void resolve( int myid, int numprocs )
+{
+int p, a, ix, iy, iz, n, idx, N[3], g[3], owner, prevProc, nextProc;
+double x[3];
+float w[3];
+
+	N[0] = LEN * numprocs; N[1] = HIG; N[2] = DEP;
+
+	nPoints = nValues = 0;
+	for( p = 0; p < nPrb; p++ ) {
+		prb[p].first = nPoints;
+		prb[p].col = nValues;
+		n = prb[p].n[0] * prb[p].n[1] * prb[p].n[2];
+		nPoints += n;
+		nValues += n * prb[p].nv;
+	}
+	if( ( smp = (Sample *)malloc( ( nPoints + 1 ) * sizeof(Sample) ) ) == NULL ||
+	    ( want = (int *)malloc( ( 4 * nPoints + 1 ) * sizeof(int) ) ) == NULL ) {
+		fprintf( stderr, "mpi_layer2: can't allocate memory for probes.\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+
+	nSmp = nVal = 0;
+	for( p = 0; p < nPrb; p++ ) {
+		for( idx = 0, iz = 0; iz < prb[p].n[2]; iz++ )
+		for( iy = 0; iy < prb[p].n[1]; iy++ )
+		for( ix = 0; ix < prb[p].n[0]; ix++, idx++ ) {
+			int it[3] = { ix, iy, iz };
+			for( a = 0; a < 3; a++ ) {
+				x[a] = prb[p].n[a] == 1 ? prb[p].lo[a]
+				     : prb[p].lo[a] + ( prb[p].hi[a] - prb[p].lo[a] ) * it[a] / ( prb[p].n[a] - 1 );
+				g[a] = locate( x[a], a, N[a], prb[p].linear, &w[a] );
+			}
+			owner = g[0] / LEN;
+			if( owner != myid ) continue;
+
+			Sample *s = &smp[nSmp++];
+			s->probe = p; s->index = idx;
+			s->col = prb[p].col + idx * prb[p].nv;
+			for( a = 0; a < 3; a++ ) { s->x[a] = x[a]; s->w[a] = w[a]; }
+			s->c[0] = g[0] - myid * LEN + 1; s->c[1] = g[1] + 1; s->c[2] = g[2] + 1;
+			s->remote = -1;
+			nVal += prb[p].nv;
+
+			//--- upper x-corners in the first plane of the next process
+			if( prb[p].linear && s->c[0] == LEN && N[0] > 1 ) {
+				int jk[4], m;
+				jk[0] = g[1] * DEP + g[2];
+				jk[1] = ( g[1] + ( HIG > 1 ) ) * DEP + g[2];
+				jk[2] = g[1] * DEP + g[2] + ( DEP > 1 );
+				jk[3] = ( g[1] + ( HIG > 1 ) ) * DEP + g[2] + ( DEP > 1 );
+				s->remote = nWant;
+				for( m = 0; m < 4; m++ ) want[nWant++] = jk[m];
+			}
+		}
+	}
+
+	//--- tell the next process which corners to send every sample
+	prevProc = myid > 0 ? myid - 1 : MPI_PROC_NULL;
+	nextProc = myid < numprocs - 1 ? myid + 1 : MPI_PROC_NULL;
+	MPI_Sendrecv( &nWant, 1, MPI_INT, nextProc, 51, &nGive, 1, MPI_INT, prevProc, 51, MPI_COMM_WORLD, MPI_STATUS_IGNORE );
+	give    = (int *)malloc( ( nGive + 1 ) * sizeof(int) );
+	giveBuf = (float *)malloc( ( 5 * nGive + 1 ) * sizeof(float) );
+	remote  = (float *)malloc( ( 5 * nWant + 1 ) * sizeof(float) );
+	if( give == NULL || giveBuf == NULL || remote == NULL ) {
+		fprintf( stderr, "mpi_layer2: can't allocate memory for probes.\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	MPI_Sendrecv( want, nWant, MPI_INT, nextProc, 52, give, nGive, MPI_INT, prevProc, 52, MPI_COMM_WORLD, MPI_STATUS_IGNORE );
+
+} /* end resolve() */
+
+
+/*
+* buildHeader - Header of a probe file holding the points s[0..n-1]; returns its size.
+*/
+static size_t buildHeader( unsigned char **out, const Sample *s, int n, int nv, int numprocs )
+{
+ProbeFileHeader h;
+ProbeFileProbe fp;
+ProbeFilePoint pt;
+size_t size, pos;
+int p, l;
+
+	size = sizeof(h) + nPrb * sizeof(fp) + n * sizeof(pt);
+	size = ( size + 7 ) & ~(size_t)7;
+	if( ( *out = (unsigned char *)calloc( size, 1 ) ) == NULL ) {
+		fprintf( stderr, "mpi_layer2: can't allocate memory for probes.\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+
+	memset( &h, 0, sizeof(h) );
+	memcpy( h.magic, PRB_MAGIC, 8 );
+	h.version = PRB_VERSION;
+	h.headerSize = size;
+	h.recordSize = PRB_RECHEAD + nv * sizeof(float);
+	h.nProbes = nPrb; h.nPoints = n; h.nValues = nv;
+	h.NX = LEN * numprocs; h.HIG = HIG; h.DEP = DEP;
+	h.deltaX = deltaX; h.deltaY = deltaY; h.deltaZ = deltaZ;
+	memcpy( *out, &h, sizeof(h) );
+	pos = sizeof(h);
+
+	for( p = 0; p < nPrb; p++ ) {
+		memset( &fp, 0, sizeof(fp) );
+		strcpy( fp.name, prb[p].name );
+		fp.nv = prb[p].nv; fp.linear = prb[p].linear;
+		for( l = 0; l < 3; l++ ) fp.n[l] = prb[p].n[l];
+		for( l = 0; l < prb[p].nv; l++ ) strcpy( fp.var[l], ProbeVarNames[prb[p].var[l]] );
+		memcpy( *out + pos, &fp, sizeof(fp) );
+		pos += sizeof(fp);
+	}
+	for( l = 0; l < n; l++ ) {
+		pt.probe = s[l].probe; pt.index = s[l].index;
+		memcpy( pt.x, s[l].x, sizeof(pt.x) );
+		memcpy( *out + pos, &pt, sizeof(pt) );
+		pos += sizeof(pt);
+	}
+	return size;
+} /* end buildHeader() */
+
+
+/*
+* keptRecords - Records of an existing file, with the same header, up to the current step.
+*/
+static long long keptRecords( long long size, long long (*readStep)( long long ) )
+{
+long long lo = 0, hi, mid;
+
+	if( size < headerSize ) return 0;
+	hi = ( size - headerSize ) / recordSize;
+	// steps grow along the file: the first record past the current step
+	while( lo < hi ) {
+		mid = ( lo + hi ) / 2;
+		if( readStep( mid ) <= (long long)step ) lo = mid + 1;
+		else hi = mid;
+	}
+	return lo;
+} /* end keptRecords() */
+
+static long long stepAtMPI( long long r )
+{
+int s = 0;
+	MPI_File_read_at( fh, headerSize + r * recordSize + 8, &s, 1, MPI_INT, MPI_STATUS_IGNORE );
+	return s;
+}
+
+static long long stepAtStdio( long long r )
+{
+int s = 0;
+	fseek( pF, headerSize + r * recordSize + 8, SEEK_SET );
+	if( fread( &s, sizeof(s), 1, pF ) != 1 ) return 0x7FFFFFFF;
+	return s;
+}
+
+
+/*
+* openGathered - Opens "probes.bin" for all processes; root writes or checks the header.
+*/
+static void openGathered( int myid, int numprocs )
+{
+unsigned char *head, *old;
+MPI_Offset size;
+Sample *all;
+int p, idx, n, keep = 0;
+
+	// root describes all points, in the order of their values
+	if( 0 == myid ) {
+		all = (Sample *)malloc( ( nPoints + 1 ) * sizeof(Sample) );
+		if( all == NULL ) { fprintf( stderr, "mpi_layer2: can't allocate memory for probes.\n" ); MPI_Abort( MPI_COMM_WORLD, 1 ); }
+		for( n = 0, p = 0; p < nPrb; p++ ) {
+			int ix, iy, iz, a;
+			for( idx = 0, iz = 0; iz < prb[p].n[2]; iz++ )
+			for( iy = 0; iy < prb[p].n[1]; iy++ )
+			for( ix = 0; ix < prb[p].n[0]; ix++, idx++, n++ ) {
+				int it[3] = { ix, iy, iz };
+				all[n].probe = p; all[n].index = idx;
+				for( a = 0; a < 3; a++ )
+					all[n].x[a] = prb[p].n[a] == 1 ? prb[p].lo[a]
+					            : prb[p].lo[a] + ( prb[p].hi[a] - prb[p].lo[a] ) * it[a] / ( prb[p].n[a] - 1 );
+			}
+		}
+		headerSize = buildHeader( &head, all, nPoints, nValues, numprocs );
+		free( all );
+	}
+	MPI_Bcast( &headerSize, 1, MPI_INT, 0, MPI_COMM_WORLD );
+	recordSize = PRB_RECHEAD + nValues * sizeof(float);
+
+	MPI_File_open( MPI_COMM_WORLD, "probes.bin", MPI_MODE_CREATE | MPI_MODE_RDWR, MPI_INFO_NULL, &fh );
+	if( 0 == myid ) {
+		MPI_File_get_size( fh, &size );
+		if( Answer && size >= headerSize ) {
+			old = (unsigned char *)malloc( headerSize );
+			MPI_File_read_at( fh, 0, old, headerSize, MPI_BYTE, MPI_STATUS_IGNORE );
+			keep = ( memcmp( old, head, headerSize ) == 0 );
+			free( old );
+		}
+		fileRec = keep ? keptRecords( size, stepAtMPI ) : 0;
+		if( Answer && !keep )
+			fprintf( stdout, "Probes: \"probes.bin\" holds other probes, it is started anew.\n" );
+	}
+	MPI_Bcast( &fileRec, 1, MPI_LONG_LONG, 0, MPI_COMM_WORLD );
+	MPI_File_set_size( fh, headerSize + fileRec * recordSize );
+	if( 0 == myid ) {
+		if( fileRec == 0 ) MPI_File_write_at( fh, 0, head, headerSize, MPI_BYTE, MPI_STATUS_IGNORE );
+		free( head );
+	}
+
+} /* end openGathered() */
+
+
+/*
+* openOwn - Opens "probes.<id>.bin" with the points of _this_ process.
+*/
+static void openOwn( int myid, int numprocs )
+{
+unsigned char *head, *old;
+char filename[32];
+long size;
+int keep = 0;
+
+	if( nSmp == 0 ) return;
+	headerSize = buildHeader( &head, smp, nSmp, nVal, numprocs );
+	recordSize = PRB_RECHEAD + nVal * sizeof(float);
+
+	sprintf( filename, "probes.%d.bin", myid );
+	if( Answer && ( pF = fopen( filename, "r+b" ) ) != NULL ) {
+		fseek( pF, 0, SEEK_END );
+		size = ftell( pF );
+		if( size >= headerSize ) {
+			old = (unsigned char *)malloc( headerSize );
+			rewind( pF );
+			keep = ( fread( old, 1, headerSize, pF ) == (size_t)headerSize && memcmp( old, head, headerSize ) == 0 );
+			free( old );
+		}
+		if( keep ) {
+			fileRec = keptRecords( size, stepAtStdio );
+			fflush( pF );
+			if( ftruncate( fileno( pF ), headerSize + fileRec * recordSize ) != 0 )
+				fprintf( stderr, "can't truncate \"%s\".\n", filename );
+			fseek( pF, 0, SEEK_END );
+		}
+		else {
+			fclose( pF );
+			pF = NULL;
+		}
+	}
+	if( !keep ) {
+		if( ( pF = fopen( filename, "wb" ) ) == NULL ) {
+			fprintf( stderr, "mpi_layer2: can't open \"%s\".\n", filename );
+			MPI_Abort( MPI_COMM_WORLD, 1 );
+		}
+		fwrite( head, 1, headerSize, pF );
+		fileRec = 0;
+	}
+	free( head );
+
+} /* end openOwn() */
+
+
+void ProbesInit( int myid )
+{
+int numprocs, n, nErr = 0;
+char text[CFG_LIST_LEN];
+
+	MPI_Comm_size( MPI_COMM_WORLD, &numprocs );
+
+	if( config.probe.n > 0 ) {
+		for( n = 0; n < config.probe.n; n++ )
+			nErr += parseProbe( config.probe.item[n], &prb[n], numprocs, myid );
+		if( nErr ) MPI_Abort( MPI_COMM_WORLD, 1 );
+		nPrb = config.probe.n;
+	}
+	else {
+		// three vertical lines of rho and rhou along the length, at mid depth
+		for( n = 0; n < 3; n++ ) {
+			sprintf( text, "line%d x=%g z=%g vars=rho,rhou", n + 1,
+			         ( n + 1 ) * 0.25 * GridFace( 0, LEN * numprocs ), 0.5 * DEP * deltaZ );
+			parseProbe( text, &prb[n], numprocs, myid );
+		}
+		nPrb = 3;
+	}
+
+	resolve( myid, numprocs );
+
+	if( config.p_gather ) openGathered( myid, numprocs );
+	else                  openOwn( myid, numprocs );
+
+	//--- record of _this_ process: time and step (if it writes them), then its values
+	hasHead  = !config.p_gather || 0 == myid;
+	recBytes = ( hasHead ? PRB_RECHEAD : 0 ) + nVal * sizeof(float);
+	if( ( recBuf = (unsigned char *)malloc( (size_t)config.p_buffer * recBytes + 1 ) ) == NULL ) {
+		fprintf( stderr, "mpi_layer2: can't allocate memory for probes.\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	nRec = 0;
+
+	if( 0 == myid )
+		fprintf( stdout, "Probes: %d probes, %d points, %d values every %d steps to %s.\n", nPrb, nPoints, nValues,
+		         config.p_every, config.p_gather ? "\"probes.bin\"" : "\"probes.<id>.bin\"" );
+
+} /* end ProbesInit() */
+
+
+void ProbesRegrid( int myid )
+{
+int numprocs;
+
+	if( nPrb == 0 ) return;
+	MPI_Comm_size( MPI_COMM_WORLD, &numprocs );
+
+	//--- the points stay on their processes, only their cells and weights change
+	free( smp ); free( want ); free( give ); free( giveBuf ); free( remote );
+	smp = NULL; want = give = NULL; giveBuf = remote = NULL;
+	nWant = nGive = 0;
+	resolve( myid, numprocs );
+
+} /* end ProbesRegrid() */
+
+
+/*
+* writeGathered - The buffered records of all processes go to "probes.bin" in one collective call.
+*/
+static void writeGathered( void )
+{
+MPI_Datatype rec, filetype;
+int *len, n, m, a;
+MPI_Aint *disp;
+
+	//--- _this_ process's pieces of a record, neighbouring ones merged
+	len  = (int *)malloc( ( nSmp + 2 ) * sizeof(int) );
+	disp = (MPI_Aint *)malloc( ( nSmp + 2 ) * sizeof(MPI_Aint) );
+	n = 0;
+	if( hasHead ) { disp[0] = 0; len[0] = PRB_RECHEAD; n = 1; }
+	for( m = 0; m < nSmp; m++ ) {
+		MPI_Aint d = PRB_RECHEAD + (MPI_Aint)smp[m].col * sizeof(float);
+		a = prb[smp[m].probe].nv * sizeof(float);
+		if( n > 0 && disp[n-1] + len[n-1] == d ) len[n-1] += a;
+		else { disp[n] = d; len[n] = a; n++; }
+	}
+	MPI_Type_create_hindexed( n, len, disp, MPI_BYTE, &rec );
+	MPI_Type_create_resized( rec, 0, recordSize, &filetype );
+	MPI_Type_commit( &filetype );
+	MPI_File_set_view( fh, headerSize + fileRec * recordSize, MPI_BYTE, filetype, "native", MPI_INFO_NULL );
+	MPI_File_write_all( fh, recBuf, nRec * recBytes, MPI_BYTE, MPI_STATUS_IGNORE );
+	MPI_Type_free( &filetype );
+	MPI_Type_free( &rec );
+	free( len ); free( disp );
+
+} /* end writeGathered() */
+
+
+void ProbesFlush( void )
+{
+	if( config.p_gather ) writeGathered( );
+	else if( pF != NULL && nRec > 0 ) {
+		fwrite( recBuf, recBytes, nRec, pF );
+		fflush( pF );
+	}
+	fileRec += nRec;
+	nRec = 0;
+
+} /* end ProbesFlush() */
+
+
+/************
+*  PROBES   *   Samples all probes into the buffer of records, writes it when full
+************/
+void Probes( int myid )
+{
+int m, l, c, numprocs;
+unsigned char *r;
+float *v;
+real q[8][5], val;
+double t = totalTime;
+int st = step, spare = 0;
+
+	if( step % config.p_every ) return;
+
+	//--- corners wanted by the previous process, from the first plane of _this_ one
+	MPI_Comm_size( MPI_COMM_WORLD, &numprocs );
+	for( m = 0; m < nGive; m++ ) {
+		real *g = (real *)&giveBuf[5*m];
+		cellState( 1, give[m] / DEP + 1, give[m] % DEP + 1, g );
+	}
+	MPI_Sendrecv( giveBuf, 5 * nGive, MPI_FLOAT, myid > 0 ? myid - 1 : MPI_PROC_NULL, 53,
+	              remote, 5 * nWant, MPI_FLOAT, myid < numprocs - 1 ? myid + 1 : MPI_PROC_NULL, 53,
+	              MPI_COMM_WORLD, MPI_STATUS_IGNORE );
+
+	r = recBuf + (size_t)nRec * recBytes;
+	if( hasHead ) {
+		memcpy( r, &t, 8 ); memcpy( r + 8, &st, 4 ); memcpy( r + 12, &spare, 4 );
+		r += PRB_RECHEAD;
+	}
+	v = (float *)r;
+
+	for( m = 0; m < nSmp; m++ ) {
+		const Sample *s = &smp[m];
+		const Probe *p = &prb[s->probe];
+		unsigned i = s->c[0], j = s->c[1], k = s->c[2];
+
+		if( !p->linear ) {
+			cellState( i, j, k, q[0] );
+			for( l = 0; l < p->nv; l++ ) *v++ = cellVar( p->var[l], q[0] );
+			continue;
+		}
+
+		//--- eight corners, c = dx + 2 dy + 4 dz; a direction of one cell has no upper corner
+		{
+			unsigned jj = j + ( HIG > 1 ), kk = k + ( DEP > 1 );
+			for( c = 0; c < 8; c++ ) {
+				unsigned cj = ( c & 2 ) ? jj : j, ck = ( c & 4 ) ? kk : k;
+				if( ( c & 1 ) && s->remote >= 0 ) {
+					const float *rq = &remote[5 * ( s->remote + ( ( c >> 1 ) & 1 ) + 2 * ( ( c >> 2 ) & 1 ) )];
+					memcpy( q[c], rq, 5 * sizeof(real) );
+				}
+				else cellState( ( c & 1 ) ? i + ( LEN * numprocs > 1 ) : i, cj, ck, q[c] );
+			}
+		}
+		for( l = 0; l < p->nv; l++ ) {
+			for( val = 0., c = 0; c < 8; c++ )
+				val += ( ( c & 1 ) ? s->w[0] : 1. - s->w[0] ) * ( ( c & 2 ) ? s->w[1] : 1. - s->w[1] )
+				     * ( ( c & 4 ) ? s->w[2] : 1. - s->w[2] ) * cellVar( p->var[l], q[c] );
+			*v++ = val;
+		}
+	}
+
+	if( ++nRec == config.p_buffer ) ProbesFlush( );
+
+} /* end Probes() */
+
+
+void ProbesFinalize( int myid )
+{
+	ProbesFlush( );
+	if( config.p_gather ) MPI_File_close( &fh );
+	else if( pF != NULL ) fclose( pF );
+	pF = NULL;
+
+	if( 0 == myid )
+		fprintf( stdout, "Probes: %lld records in %s.\n", fileRec, config.p_gather ? "\"probes.bin\"" : "\"probes.<id>.bin\"" );
+
+	free( smp ); free( want ); free( give ); free( giveBuf ); free( remote ); free( recBuf );
+	smp = NULL; want = give = NULL; giveBuf = remote = NULL; recBuf = NULL;
+
+} /* end ProbesFinalize() */
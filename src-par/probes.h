@@ -1,6 +1,30 @@
 #ifndef PROBES_H
 #define PROBES_H
 
-int Probes( int myid );
+/*
+* ProbesInit - Resolves the probes of the configuration file to their processes and cells,
+* opens "probes.bin" (or "probes.<id>.bin").
+*/
+void ProbesInit( int myid );
 
-#endif
\ No newline at end of file
+/*
+* Probes - Samples the probes every p_every steps, writes the buffered records when it is full.
+*/
+void Probes( int myid );
+
+/*
+* ProbesRegrid - Locates the points again after the rows have been laid out anew.
+*/
+void ProbesRegrid( int myid );
+
+/*
+* ProbesFlush - Writes the buffered records (all processes if p_gather = 1).
+*/
+void ProbesFlush( void );
+
+/*
+* ProbesFinalize - Writes the rest of the records and closes the probe files.
+*/
+void ProbesFinalize( int myid );
+
+#endif
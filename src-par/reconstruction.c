@@ -2,6 +2,7 @@
 *  RECONSTRUCTION  
 *  
 *  Piecewise-parabolic reconstruction of the cell parameters with 2..3 order in space
+*  (2nd on a stretched grid, the differences scaled to the width of the cell)
 *
 */
 #include <math.h>      /* sqrt()       */
@@ -127,6 +128,9 @@ real
 				W3 =  -W*w1 				+   w4     ;
 				W4 = S41*w1 + S42*w2 +   k2 +   k3 + kk;
 				W5 = S51*w1 + S52*w2 +   k2 +   k3 + kk;
+				/* differences scaled to the width of the cell (stretched grid) */
+				M1 *= fX[i]; M2 *= fX[i]; M3 *= fX[i]; M4 *= fX[i]; M5 *= fX[i];
+				W1 *= bX[i]; W2 *= bX[i]; W3 *= bX[i]; W4 *= bX[i]; W5 *= bX[i];
 				/* modified characteristic differences _W */
 				_M1 = minmod( M1, W1 ); /* the best way */
 				_M2 = minmod( M2, W2 );
@@ -213,6 +217,9 @@ real
 				W3 =  -U*w1 				+   w4     ;  /* -U*m1 ! */
 				W4 = S41*w1 + S42*w2 +   k2 +   k3 + kk;
 				W5 = S51*w1 + S52*w2 +   k2 +   k3 + kk;
+				/* differences scaled to the height of the cell */
+				M1 *= fY[j]; M2 *= fY[j]; M3 *= fY[j]; M4 *= fY[j]; M5 *= fY[j];
+				W1 *= bY[j]; W2 *= bY[j]; W3 *= bY[j]; W4 *= bY[j]; W5 *= bY[j];
 				/* modified characteristic differences _W */
 				_M1 = minmod( M1, W1 );
 				_M2 = minmod( M2, W2 );
@@ -0,0 +1,307 @@
+/*
+*  RENDER
+*
+*  Colour-mapped images of a field on a plane of cells, rendered while the run
+*  goes on, to watch it without writing and opening whole frames. Every "image"
+*  key of the configuration file defines one of them:
+*
+*      image = vortz every=10 field=vorticity k=18 map=viridis range=0:200 scale=4
+*      image = ux    every=50 field=u k=18 map=coolwarm
+*      image = xcut  every=50 field=T i=200 format=ppm
+*
+*  Exactly one of i, j, k picks the plane (global cell index from 1); planes of
+*  constant k or i are drawn with y upwards, planes of constant j with z upwards.
+*  "map" is gray, jet, coolwarm or viridis (default), "range=lo:hi" fixes the
+*  colour range (default: min and max over the plane at every image), "scale"
+*  replicates each cell into scale x scale pixels, "every" defaults to f_step.
+*  Cells holding nan are drawn magenta.
+*
+*  Every process maps its cells to palette indices, the root process gathers the
+*  columns and writes "<name>-<step>.png" (8-bit palette, see png.c) or
+*  "<name>-<step>.ppm".
+*
+*/
+#include "mpi.h"
+#include <stdio.h>     /* printf() etc.*/
+#include <stdlib.h>    /* malloc()     */
+#include <string.h>    /* strtok_r()   */
+
+#include "type.h"
+#include "def.h"      /* Definitions, parameters */
+#include "global.h"   /* global variables */
+#include "config.h"
+#include "output.h"   /* CellValues() */
+#include "png.h"
+
+#include "render.h"
+
+#define RND_COLOURS 255    /* palette entries of the colour map, the last one marks nan */
+
+typedef struct {
+	const char *name;
+	int   n;
+	float pt[6][4];        /* position in the map, r, g, b */
+} ColourMap;
+
+static const ColourMap colourMaps[] = {
+	{ "gray",     2, { { 0.,    0.,    0.,    0.    }, { 1.,    1.,    1.,    1.    } } },
+	{ "jet",      6, { { 0.,    0.,    0.,    0.5   }, { 0.125, 0.,    0.,    1.    }, { 0.375, 0.,    1.,    1.    },
+	                   { 0.625, 1.,    1.,    0.    }, { 0.875, 1.,    0.,    0.    }, { 1.,    0.5,   0.,    0.    } } },
+	{ "coolwarm", 3, { { 0.,    0.230, 0.299, 0.754 }, { 0.5,   0.865, 0.865, 0.865 }, { 1.,    0.706, 0.016, 0.150 } } },
+	{ "viridis",  5, { { 0.,    0.267, 0.005, 0.329 }, { 0.25,  0.229, 0.322, 0.546 }, { 0.5,   0.128, 0.567, 0.551 },
+	                   { 0.75,  0.369, 0.789, 0.383 }, { 1.,    0.993, 0.906, 0.144 } } },
+	{ NULL }
+};
+
+typedef struct {
+	char name[32];
+	int  every;
+	int  field;            /* index into OutputFieldNames[] */
+	int  axis, cut;        /* plane: direction normal to it (0-x, 1-y, 2-z) and local cell 0..n-1 */
+	int  hor, ver;         /* directions across and up the image */
+	int  autoRange;
+	real lo, hi;
+	int  scale, png;
+	unsigned char palette[256][3];
+} Image;
+
+static Image img[CFG_LIST_MAX];
+static int nImg = 0;
+
+
+/*
+* makePalette - Samples the colour map into the palette, entry RND_COLOURS is nan.
+*/
+static void makePalette( const ColourMap *m, unsigned char pal[256][3] )
+{
+int c, p, l;
+float t, w;
+
+	for( c = 0; c < RND_COLOURS; c++ ) {
+		t = (float)c / ( RND_COLOURS - 1 );
+		for( p = 1; p < m->n - 1 && m->pt[p][0] < t; p++ );
+		w = ( t - m->pt[p-1][0] ) / ( m->pt[p][0] - m->pt[p-1][0] );
+		for( l = 0; l < 3; l++ )
+			pal[c][l] = (unsigned char)( 255. * ( m->pt[p-1][l+1] + w * ( m->pt[p][l+1] - m->pt[p-1][l+1] ) ) + 0.5 );
+	}
+	pal[RND_COLOURS][0] = 255; pal[RND_COLOURS][1] = 0; pal[RND_COLOURS][2] = 255;
+
+} /* end makePalette() */
+
+
+/*
+* parseImage - Fills e from the text of an "image" key; returns 0 on success.
+*/
+static int parseImage( const char *text, Image *e, int numprocs, int myid )
+{
+char line[CFG_LIST_LEN], *tok, *val, *end, *save;
+const ColourMap *map = &colourMaps[3];
+int d, l, nmax[3];
+
+	nmax[0] = LEN * numprocs; nmax[1] = HIG; nmax[2] = DEP;
+	e->every = f_step;
+	e->field = -1;
+	e->axis = -1;
+	e->autoRange = 1;
+	e->scale = 1;
+	e->png = 1;
+
+	strcpy( line, text );
+	if( ( tok = strtok_r( line, " \t", &save ) ) == NULL || strchr( tok, '=' ) != NULL || strlen( tok ) >= sizeof(e->name) ) {
+		if( 0 == myid ) fprintf( stderr, "image \"%s\": the name must come first.\n", text );
+		return 1;
+	}
+	strcpy( e->name, tok );
+
+	while( ( tok = strtok_r( NULL, " \t", &save ) ) != NULL ) {
+		if( ( val = strchr( tok, '=' ) ) == NULL ) goto bad;
+		*val++ = '\0';
+		if( strcmp( tok, "every" ) == 0 ) {
+			if( ( e->every = atoi( val ) ) < 1 ) goto bad;
+		}
+		else if( strlen( tok ) == 1 && ( d = tok[0] - 'i' ) >= 0 && d < 3 ) {
+			if( e->axis >= 0 ) goto bad;
+			e->axis = d;
+			e->cut = strtol( val, &end, 10 ) - 1;
+			if( *end != '\0' || e->cut < 0 || e->cut >= nmax[d] ) goto bad;
+		}
+		else if( strcmp( tok, "field" ) == 0 ) {
+			for( l = 0; l < OUT_NFIELDS && strcmp( val, OutputFieldNames[l] ) != 0; l++ );
+			if( l == OUT_NFIELDS ) goto bad;
+			e->field = l;
+		}
+		else if( strcmp( tok, "map" ) == 0 ) {
+			for( map = colourMaps; map->name != NULL && strcmp( val, map->name ) != 0; map++ );
+			if( map->name == NULL ) goto bad;
+		}
+		else if( strcmp( tok, "range" ) == 0 ) {
+			e->lo = strtod( val, &end );
+			if( *end != ':' ) goto bad;
+			e->hi = strtod( end + 1, &end );
+			if( *end != '\0' || !( e->hi > e->lo ) ) goto bad;
+			e->autoRange = 0;
+		}
+		else if( strcmp( tok, "scale" ) == 0 ) {
+			if( ( e->scale = atoi( val ) ) < 1 || e->scale > 16 ) goto bad;
+		}
+		else if( strcmp( tok, "format" ) == 0 ) {
+			if( strcmp( val, "png" ) == 0 )      e->png = 1;
+			else if( strcmp( val, "ppm" ) == 0 ) e->png = 0;
+			else goto bad;
+		}
+		else goto bad;
+	}
+	if( e->field < 0 || e->axis < 0 ) {
+		if( 0 == myid ) fprintf( stderr, "image \"%s\": needs field= and one of i=, j=, k=.\n", text );
+		return 1;
+	}
+	e->hor = ( e->axis == 0 ) ? 2 : 0;
+	e->ver = ( e->axis == 1 ) ? 2 : 1;
+	makePalette( map, e->palette );
+
+	return 0;
+
+bad:
+	if( 0 == myid ) fprintf( stderr, "image \"%s\": bad \"%s\".\n", text, tok );
+	return 1;
+} /* end parseImage() */
+
+
+void RenderInit( int myid )
+{
+int numprocs, n, nErr = 0;
+
+	MPI_Comm_size( MPI_COMM_WORLD, &numprocs );
+
+	for( n = 0; n < config.image.n; n++ )
+		nErr += parseImage( config.image.item[n], &img[n], numprocs, myid );
+	if( nErr ) MPI_Abort( MPI_COMM_WORLD, 1 );
+	nImg = config.image.n;
+
+} /* end RenderInit() */
+
+
+/*
+* writePPM - Binary PPM of the palette image.
+*/
+static void writePPM( const char *filename, const unsigned char *pix, unsigned w, unsigned h,
+                      const unsigned char pal[256][3] )
+{
+FILE *pF;
+size_t p;
+
+	if( ( pF = fopen( filename, "wb" ) ) == NULL ) {
+		fprintf( stderr, "can't open \"%s\".\n", filename );
+		return;
+	}
+	fprintf( pF, "P6\n%u %u\n255\n", w, h );
+	for( p = 0; p < (size_t)w * h; p++ ) fwrite( pal[pix[p]], 1, 3, pF );
+	fclose( pF );
+
+} /* end writePPM() */
+
+
+/*
+* renderImage - Colours the cells of _this_ process on the plane, root assembles and writes the image.
+*/
+static void renderImage( const Image *e, const Frame *f, int myid, int numprocs )
+{
+int n[3], cell[3], ncol, nrow, a, b, s, r, col, *counts = NULL, *displs = NULL;
+float *val;
+unsigned char *idx, *all = NULL, *pix = NULL;
+real v[OUT_NVARS];
+double range[2], lim[2];
+char filename[64];
+
+	n[0] = LEN * numprocs; n[1] = HIG; n[2] = DEP;
+	nrow = n[e->ver];
+
+	//--- columns of _this_ process: all of them, a part of x, or none if the plane misses the slab
+	if( e->hor == 0 )       ncol = LEN;
+	else if( e->axis == 0 ) ncol = ( e->cut / (int)LEN == myid ) ? n[e->hor] : 0;
+	else                    ncol = n[e->hor];
+
+	val = (float *)malloc( ( (size_t)ncol * nrow + 1 ) * sizeof(float) );
+	idx = (unsigned char *)malloc( (size_t)ncol * nrow + 1 );
+	if( val == NULL || idx == NULL ) {
+		fprintf( stderr, "mpi_layer2: can't allocate memory for images.\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+
+	range[0] = 1e30; range[1] = -1e30;
+	for( a = 0; a < ncol; a++ ) {
+		for( b = 0; b < nrow; b++ ) {
+			// local cell, x counted within the slab
+			cell[e->axis] = e->cut;
+			cell[e->hor] = a;
+			cell[e->ver] = b;
+			if( e->hor != 0 ) cell[0] -= myid * LEN;
+			CellValues( f, cell[0] + 1, cell[1] + 1, cell[2] + 1, myid, v );
+			val[(size_t)a * nrow + b] = v[e->field + 3];
+			if( v[e->field + 3] < range[0] ) range[0] = v[e->field + 3];
+			if( v[e->field + 3] > range[1] ) range[1] = v[e->field + 3];
+		}
+	}
+
+	if( e->autoRange ) {
+		range[0] = -range[0];
+		MPI_Allreduce( range, lim, 2, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD );
+		lim[0] = -lim[0];
+	}
+	else { lim[0] = e->lo; lim[1] = e->hi; }
+
+	for( s = 0; s < ncol * nrow; s++ ) {
+		float t = ( val[s] - lim[0] ) / ( lim[1] > lim[0] ? lim[1] - lim[0] : 1. );
+		if( val[s] != val[s] ) idx[s] = RND_COLOURS;
+		else idx[s] = ( t <= 0. ) ? 0 : ( t >= 1. ) ? RND_COLOURS - 1 : (unsigned char)( t * ( RND_COLOURS - 1 ) + 0.5 );
+	}
+
+	//--- columns in process order make the whole plane at root
+	if( 0 == myid ) {
+		counts = (int *)malloc( 2 * numprocs * sizeof(int) );
+		displs = counts + numprocs;
+		all = (unsigned char *)malloc( (size_t)n[e->hor] * nrow );
+		pix = (unsigned char *)malloc( (size_t)n[e->hor] * nrow * e->scale * e->scale );
+		if( counts == NULL || all == NULL || pix == NULL ) {
+			fprintf( stderr, "mpi_layer2: can't allocate memory for images.\n" );
+			MPI_Abort( MPI_COMM_WORLD, 1 );
+		}
+	}
+	s = ncol * nrow;
+	MPI_Gather( &s, 1, MPI_INT, counts, 1, MPI_INT, 0, MPI_COMM_WORLD );
+	if( 0 == myid )
+		for( displs[0] = 0, r = 1; r < numprocs; r++ ) displs[r] = displs[r-1] + counts[r-1];
+	MPI_Gatherv( idx, s, MPI_UNSIGNED_CHAR, all, counts, displs, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD );
+	free( val ); free( idx );
+
+	if( 0 != myid ) return;
+
+	//--- rows from the top, each cell scale x scale pixels
+	{
+		unsigned w = n[e->hor] * e->scale, h = nrow * e->scale;
+		for( r = 0; r < (int)h; r++ ) {
+			b = nrow - 1 - r / e->scale;
+			for( col = 0; col < (int)w; col++ ) pix[(size_t)r * w + col] = all[(size_t)( col / e->scale ) * nrow + b];
+		}
+		snprintf( filename, sizeof(filename), "%.31s-%d.%s", e->name, step, e->png ? "png" : "ppm" );
+		if( e->png ) WritePNG( filename, pix, w, h, e->palette );
+		else         writePPM( filename, pix, w, h, e->palette );
+	}
+	free( counts ); free( all ); free( pix );
+
+} /* end renderImage() */
+
+
+/************
+*  RENDERS  *   Renders the images due at the current step
+************/
+void Renders( int myid, int numprocs )
+{
+Frame now;
+int n;
+
+	CurrentFrame( &now );
+	for( n = 0; n < nImg; n++ )
+		if( step % img[n].every == 0 ) renderImage( &img[n], &now, myid, numprocs );
+
+} /* end Renders() */
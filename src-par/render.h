@@ -0,0 +1,14 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+/*
+* RenderInit - Parses the "image" keys of the configuration; a malformed one stops the run.
+*/
+void RenderInit( int myid );
+
+/*
+* Renders - Renders the images due at the current step.
+*/
+void Renders( int myid, int numprocs );
+
+#endif
@@ -0,0 +1,272 @@
+/*
+*  SPECTRA
+*
+*  Spanwise energy spectra of u', v', w' and p' along z-lines, averaged in time. The
+*  z-direction is periodic and never split, so the process owning a line transforms
+*  it on its own. Each "spectrum" key of the configuration file gives one line, the
+*  cells holding x and y [m]:
+*
+*      spectrum = centre x=41.7 y=40
+*
+*  (by default one line at mid-length, mid-height). Every sp_every steps the line
+*  is transformed with the FFT below (mixed radix, any DEP) and the spectra of the
+*  fluctuations about the z-mean are added to their running means. Every sp_write
+*  steps (default f_step) and at the end root rewrites "spectra.dat": for every line
+*  a block of rows m, kappa = 2 pi m / Lz and the one-sided densities Euu Evv Eww
+*  Epp, normalized so that their sum times dkappa is the variance along the line.
+*
+*/
+#include "mpi.h"
+#include <stdio.h>     /* printf() etc.*/
+#include <stdlib.h>    /* malloc()     */
+#include <string.h>    /* strtok_r()   */
+#include <math.h>      /* cos(), sin() */
+
+#include "type.h"
+#include "def.h"      /* Definitions, parameters */
+#include "global.h"   /* global variables */
+#include "config.h"
+#include "grid.h"     /* GridCell(), GridFace() */
+
+#include "spectra.h"
+
+#define SP_NVARS 4      /* u, v, w, p */
+
+typedef struct {
+	char   name[32];
+	double x, y;
+	unsigned i, j;      /* local cell, i = 0 if the line is not here */
+} Line;
+
+static Line ln[CFG_LIST_MAX];
+static int on = 0, nLn = 0, nModes, sWrite, samples = 0, written = -1;
+static double *mean = NULL, *glob = NULL;  /* running means [nLn][SP_NVARS][nModes] */
+static double *tw = NULL;                  /* exp(-2 pi i n/DEP), re and im */
+static double *q, *zi, *fr, *fi, *sc;      /* work arrays of DEP */
+
+
+/*
+* fft - Discrete Fourier transform of the n values at stride s of (xr, xi) into
+* (yr, yi), recursively decimated in time by the smallest prime factor p of n.
+* n divides DEP and s = DEP/n, so the twiddles are those of DEP.
+*/
+static void fft( const double *xr, const double *xi, double *yr, double *yi, int n, int s )
+{
+int p, m, r, a, c, t;
+double sr, si;
+
+	if( n == 1 ) { yr[0] = xr[0]; yi[0] = xi[0]; return; }
+	for( p = 2; p * p <= n && n % p; p++ );
+	if( n % p ) p = n;
+	m = n / p;
+
+	// p transforms of the decimated sequences, one after another in y
+	for( r = 0; r < p; r++ ) fft( xr + r * s, xi + r * s, yr + r * m, yi + r * m, m, s * p );
+
+	// butterflies of radix p: Y[c + a m] = sum_r W_n^(r (c + a m)) Y_r[c]
+	for( c = 0; c < m; c++ ) {
+		for( r = 0; r < p; r++ ) { sc[2*r] = yr[r * m + c]; sc[2*r+1] = yi[r * m + c]; }
+		for( a = 0; a < p; a++ ) {
+			sr = si = 0.;
+			for( r = 0; r < p; r++ ) {
+				t = (int)( (long)r * ( c + a * m ) % n ) * s;
+				sr += sc[2*r] * tw[2*t]   - sc[2*r+1] * tw[2*t+1];
+				si += sc[2*r] * tw[2*t+1] + sc[2*r+1] * tw[2*t];
+			}
+			yr[a * m + c] = sr; yi[a * m + c] = si;
+		}
+	}
+
+} /* end fft() */
+
+
+/*
+* parseLine - Fills e from the text of a "spectrum" key; returns 0 on success.
+*/
+static int parseLine( const char *text, Line *e, int numprocs, int myid )
+{
+char line[CFG_LIST_LEN], *tok, *val, *end, *save;
+int have = 0;
+
+	strcpy( line, text );
+	if( ( tok = strtok_r( line, " \t", &save ) ) == NULL || strchr( tok, '=' ) != NULL || strlen( tok ) >= sizeof(e->name) ) {
+		if( 0 == myid ) fprintf( stderr, "spectrum \"%s\": the name must come first.\n", text );
+		return 1;
+	}
+	strcpy( e->name, tok );
+	while( ( tok = strtok_r( NULL, " \t", &save ) ) != NULL ) {
+		if( ( val = strchr( tok, '=' ) ) == NULL ) goto bad;
+		*val++ = '\0';
+		if( strcmp( tok, "x" ) == 0 )      { e->x = strtod( val, &end ); have |= 1; }
+		else if( strcmp( tok, "y" ) == 0 ) { e->y = strtod( val, &end ); have |= 2; }
+		else goto bad;
+		if( *end != '\0' ) goto bad;
+	}
+	if( have != 3 || e->x < 0. || e->x > GridFace( 0, LEN * numprocs ) || e->y < 0. || e->y > GridFace( 1, HIG ) ) {
+		if( 0 == myid ) fprintf( stderr, "spectrum \"%s\": needs x and y within the domain.\n", text );
+		return 1;
+	}
+	return 0;
+
+bad:
+	if( 0 == myid ) fprintf( stderr, "spectrum \"%s\": bad \"%s\".\n", text, tok );
+	return 1;
+} /* end parseLine() */
+
+
+void SpectraInit( int myid )
+{
+int numprocs, n, I, J, nErr = 0;
+char text[CFG_LIST_LEN];
+
+	on = ( config.sp_every > 0 );
+	if( !on ) return;
+
+	MPI_Comm_size( MPI_COMM_WORLD, &numprocs );
+	if( config.spectrum.n > 0 ) {
+		for( n = 0; n < config.spectrum.n; n++ )
+			nErr += parseLine( config.spectrum.item[n], &ln[n], numprocs, myid );
+		if( nErr ) MPI_Abort( MPI_COMM_WORLD, 1 );
+		nLn = config.spectrum.n;
+	}
+	else {
+		sprintf( text, "centre x=%g y=%g", 0.5 * GridFace( 0, LEN * numprocs ), 0.5 * GridFace( 1, HIG ) );
+		parseLine( text, &ln[0], numprocs, myid );
+		nLn = 1;
+	}
+
+	//--- cells of the lines on _this_ process
+	for( n = 0; n < nLn; n++ ) {
+		I = GridCell( 0, ln[n].x );
+		J = GridCell( 1, ln[n].y );
+		ln[n].i = ( I / (int)LEN == myid ) ? I - myid * LEN + 1 : 0;
+		ln[n].j = J + 1;
+	}
+
+	nModes = DEP / 2 + 1;
+	sWrite = config.sp_write > 0 ? config.sp_write : f_step;
+	mean = (double *)calloc( nLn * SP_NVARS * nModes, sizeof(double) );
+	glob = (double *)malloc( nLn * SP_NVARS * nModes * sizeof(double) );
+	tw   = (double *)malloc( 2 * DEP * sizeof(double) );
+	q    = (double *)calloc( 6 * DEP, sizeof(double) );
+	if( mean == NULL || glob == NULL || tw == NULL || q == NULL ) {
+		fprintf( stderr, "mpi_layer2: can't allocate memory for spectra.\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	zi = q + DEP; fr = zi + DEP; fi = fr + DEP; sc = fi + DEP;
+	for( n = 0; n < (int)DEP; n++ ) {
+		tw[2*n]   =  cos( 2. * M_PI * n / DEP );
+		tw[2*n+1] = -sin( 2. * M_PI * n / DEP );
+	}
+
+	if( 0 == myid )
+		fprintf( stdout, "Spectra: %d z-lines every %d steps, written every %d steps to \"spectra.dat\".\n",
+		         nLn, config.sp_every, sWrite );
+
+} /* end SpectraInit() */
+
+
+void SpectraRegrid( void )
+{
+int n;
+
+	if( !on ) return;
+	for( n = 0; n < nLn; n++ ) ln[n].j = GridCell( 1, ln[n].y ) + 1;
+
+} /* end SpectraRegrid() */
+
+
+/*
+* addLine - Spectra of the z-line of local cell (i, j) into the running means e[SP_NVARS][nModes].
+*/
+static void addLine( unsigned i, unsigned j, double *e )
+{
+double avg, E, dk = 2. * M_PI / ( DEP * deltaZ );
+real R, U, V, W;
+unsigned k;
+int v, m;
+
+	for( v = 0; v < SP_NVARS; v++ ) {
+		for( k = 1; k < DEPP; k++ ) {
+			R = U1[i][j][k];
+			U = U2[i][j][k] / R; V = U3[i][j][k] / R; W = U4[i][j][k] / R;
+			q[k-1] = v == 0 ? U : v == 1 ? V : v == 2 ? W
+			       : ( U5[i][j][k] - 0.5 * R * ( U * U + V * V + W * W ) ) * K_1;
+		}
+		// fluctuation about the z-mean
+		for( avg = 0., k = 0; k < DEP; k++ ) avg += q[k];
+		for( avg /= DEP, k = 0; k < DEP; k++ ) q[k] -= avg;
+
+		fft( q, zi, fr, fi, DEP, 1 );
+
+		// one-sided, the Nyquist mode of an even DEP counted once
+		for( m = 1; m < nModes; m++ ) {
+			E = ( fr[m] * fr[m] + fi[m] * fi[m] ) / ( (double)DEP * DEP );
+			if( 2 * m != (int)DEP ) E *= 2.;
+			e[v * nModes + m] += ( E / dk - e[v * nModes + m] ) / ( samples + 1 );
+		}
+	}
+
+} /* end addLine() */
+
+
+/*
+* writeSpectra - Root rewrites "spectra.dat" with the means of all lines.
+*/
+static void writeSpectra( int myid )
+{
+FILE *pF;
+double dk = 2. * M_PI / ( DEP * deltaZ ), *e;
+int n, m, v;
+
+	MPI_Reduce( mean, glob, nLn * SP_NVARS * nModes, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD );
+	written = step;
+	if( 0 != myid ) return;
+
+	if( ( pF = fopen( "spectra.dat", "w" ) ) == NULL ) {
+		fprintf( stderr, "can't open \"spectra.dat\".\n" );
+		return;
+	}
+	fprintf( pF, "# spanwise spectra at step %d, %d samples, Lz = %g m\n", step, samples, DEP * deltaZ );
+	for( n = 0; n < nLn; n++ ) {
+		e = glob + n * SP_NVARS * nModes;
+		fprintf( pF, "\n# %s x=%g y=%g\n# m kappa[1/m] Euu Evv Eww Epp\n", ln[n].name, ln[n].x, ln[n].y );
+		for( m = 1; m < nModes; m++ ) {
+			fprintf( pF, "%d %.6g", m, m * dk );
+			for( v = 0; v < SP_NVARS; v++ ) fprintf( pF, " %.6e", e[v * nModes + m] );
+			fprintf( pF, "\n" );
+		}
+	}
+	fclose( pF );
+
+} /* end writeSpectra() */
+
+
+/************
+*  SPECTRA  *   Samples the lines every sp_every steps, writes every sp_write steps
+************/
+void Spectra( int myid )
+{
+int n;
+
+	if( !on ) return;
+
+	if( step % config.sp_every == 0 ) {
+		for( n = 0; n < nLn; n++ )
+			if( ln[n].i ) addLine( ln[n].i, ln[n].j, mean + n * SP_NVARS * nModes );
+		samples++;
+	}
+	if( step % sWrite == 0 && samples > 0 ) writeSpectra( myid );
+
+} /* end Spectra() */
+
+
+void SpectraFinalize( int myid )
+{
+	if( !on ) return;
+
+	if( samples > 0 && written != (int)step ) writeSpectra( myid );
+	free( mean ); free( glob ); free( tw ); free( q );
+	mean = glob = tw = q = NULL;
+
+} /* end SpectraFinalize() */
@@ -0,0 +1,24 @@
+#ifndef SPECTRA_H
+#define SPECTRA_H
+
+/*
+* SpectraInit - Resolves the z-lines of the spectra (sp_every > 0) and the FFT twiddles.
+*/
+void SpectraInit( int myid );
+
+/*
+* Spectra - Adds the spanwise spectra of the lines every sp_every steps, root writes "spectra.dat" every sp_write.
+*/
+void Spectra( int myid );
+
+/*
+* SpectraRegrid - Locates the lines again after the rows have been laid out anew.
+*/
+void SpectraRegrid( void );
+
+/*
+* SpectraFinalize - Writes the last means if not yet written and frees the buffers.
+*/
+void SpectraFinalize( int myid );
+
+#endif
@@ -0,0 +1,486 @@
+/*
+*  STATISTICS
+*
+*  Running statistics of the flow, accumulated in the solver over time and over the
+*  homogeneous z-direction: every s_every steps from step s_start on, each cell of
+*  the x-y plane takes the DEP cells of its z-line as DEP more samples. The moments
+*  are updated one sample at a time after Welford: means and co-moments about the
+*  running means, so no sums of squares ever cancel. Favre (density-weighted) means
+*  and co-moments use the weighted form of the same update, and the third moments
+*  of the turbulent transport the update of Pebay.
+*
+*  Every s_write steps (default f_step) and at the end the statistics are written as
+*  "stats-<step>.snap", float arrays [HIG][NX] one after another with x running
+*  fastest, described by "stats-<step>.xmf":
+*
+*      rho u v w p T                 Reynolds means
+*      rho_rms p_rms T_rms           r.m.s. of the fluctuations
+*      uu vv ww uv uw vw             Reynolds stresses <u'_i u'_j>
+*      u_f v_f w_f T_f               Favre means
+*      Ruu Rvv Rww Ruv Ruw Rvw       Favre stresses <rho u"_i u"_j>/<rho>
+*      k                             turbulent kinetic energy, Ruu+Rvv+Rww over 2
+*
+*  and the terms of its budget [W/m^3], z-derivatives being zero:
+*
+*      production        -<rho u"_i u"_j> d(u_f_i)/dx_j
+*      dissipation       mu_L <du'_i/dx_j du'_i/dx_j> (pseudo-dissipation)
+*      turb_transport    -d/dx_j <rho u"_i u"_i u"_j>/2
+*      press_diffusion   -d/dx_j <p' u'_j>
+*      press_dilatation  <p' du'_i/dx_i>
+*      mass_flux         -<u"_i> d<p>/dx_i
+*      visc_diffusion    mu_L d^2 k/dx_j^2 (constant viscosity approximation)
+*
+*  The accumulators go into "backup.chk" with the solution, so a continued run
+*  (Answer = 1) goes on with them.
+*
+*/
+#include "mpi.h"
+#include <stdio.h>     /* printf() etc.*/
+#include <stdlib.h>    /* malloc()     */
+#include <string.h>    /* memcpy()     */
+#include <math.h>      /* sqrt()       */
+
+#include "type.h"
+#include "def.h"      /* Definitions, parameters */
+#include "global.h"   /* global variables */
+#include "config.h"
+#include "checkpoint.h"
+#include "grid.h"     /* spacing, GridXdmf() */
+
+#include "statistics.h"
+
+/* a sample: rho, u, v, w, p, T and the velocity gradient du_a/dx_b at 6 + 3a + b */
+#define ST_NX 15
+
+/* accumulators of a cell of the x-y plane */
+enum {
+	A_W     = 0,              /* sum of the weights rho */
+	A_MEAN  = 1,              /* means of the sample */
+	A_M2    = A_MEAN + ST_NX, /* co-moments of rho, p, T with themselves */
+	A_CUU   = A_M2 + 3,       /* of u_i, u_j */
+	A_CPU   = A_CUU + 6,      /* of p, u_j */
+	A_CPDIV = A_CPU + 3,      /* of p, du_i/dx_i */
+	A_M2G   = A_CPDIV + 1,    /* of du_a/dx_b with itself */
+	A_FMEAN = A_M2G + 9,      /* Favre means of u, v, w, T */
+	A_CF    = A_FMEAN + 4,    /* Favre co-moments of u_i, u_j */
+	A_K     = A_CF + 6,       /* Favre third moments u_i u_i u_j */
+	ST_NACC = A_K + 3
+};
+
+/* pairs i,j of the six symmetric co-moments, and back */
+static const int pa[6] = { 0, 1, 2, 0, 0, 1 }, pb[6] = { 0, 1, 2, 1, 2, 2 };
+static const int sym[3][3] = { { 0, 3, 4 }, { 3, 1, 5 }, { 4, 5, 2 } };
+
+#define ST_NOUT 33
+static const char *StatNames[ST_NOUT] = {
+	"rho", "u", "v", "w", "p", "T", "rho_rms", "p_rms", "T_rms",
+	"uu", "vv", "ww", "uv", "uw", "vw", "u_f", "v_f", "w_f", "T_f",
+	"Ruu", "Rvv", "Rww", "Ruv", "Ruw", "Rvw", "k",
+	"production", "dissipation", "turb_transport", "press_diffusion",
+	"press_dilatation", "mass_flux", "visc_diffusion" };
+
+static int on = 0, sWrite, samples = 0, written = -1;
+static double *acc = NULL;     /* [ST_NACC][LEN][HIG] */
+
+/* the fields of StatNames[] up to "k" depend on the accumulators of their own cell only */
+#define ST_NLOCAL 26
+
+
+int StatisticsCount( void )
+{
+	return on ? ST_NACC : 0;
+}
+
+int StatisticsPack( double *buf )
+{
+	memcpy( buf, acc, (size_t)ST_NACC * LEN * HIG * sizeof(double) );
+	return samples;
+}
+
+
+/*
+* localFields - Fields 0..ST_NLOCAL-1 of the cell whose accumulators start at s (stride LH).
+*/
+static void localFields( const double *s, size_t LH, double nS, double v[ST_NLOCAL] )
+{
+int a;
+
+	for( a = 0; a < 6; a++ ) v[a] = s[(A_MEAN+a)*LH];
+	for( a = 0; a < 3; a++ ) v[6+a] = sqrt( s[(A_M2+a)*LH] / nS );
+	for( a = 0; a < 6; a++ ) v[9+a] = s[(A_CUU+a)*LH] / nS;
+	for( a = 0; a < 4; a++ ) v[15+a] = s[(A_FMEAN+a)*LH];
+	for( a = 0; a < 6; a++ ) v[19+a] = s[(A_CF+a)*LH] / s[A_W*LH];
+	v[25] = 0.5 * ( v[19] + v[20] + v[21] );
+
+} /* end localFields() */
+
+
+int StatisticsField( const char *name, double *buf )
+{
+size_t LH = (size_t)LEN * HIG, c;
+double v[ST_NLOCAL];
+int f;
+
+	for( f = 0; f < ST_NLOCAL && strcmp( name, StatNames[f] ) != 0; f++ );
+	if( f == ST_NLOCAL ) return -1;
+	if( !on || samples == 0 ) return 0;
+
+	for( c = 0; c < LH; c++ ) {
+		localFields( acc + c, LH, (double)samples * DEP, v );
+		buf[c] = v[f];
+	}
+	return samples;
+
+} /* end StatisticsField() */
+
+
+void StatisticsInit( int myid )
+{
+size_t n = (size_t)ST_NACC * LEN * HIG;
+
+	on = ( config.s_every > 0 );
+	if( !on ) return;
+
+	if( ( acc = (double *)calloc( n, sizeof(double) ) ) == NULL ) {
+		fprintf( stderr, "mpi_layer2: can't allocate memory for statistics.\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	sWrite = config.s_write > 0 ? config.s_write : f_step;
+
+	//--- a continued run goes on with the statistics of its checkpoint
+	if( Answer == 1 && config.b_format == 2 ) {
+		samples = ReadCheckpointStatistics( myid, acc, ST_NACC );
+		if( samples == 0 ) memset( acc, 0, n * sizeof(double) );
+		if( 0 == myid ) {
+			if( samples > 0 ) fprintf( stdout, "Statistics: %d samples restored from the checkpoint.\n", samples );
+			else              fprintf( stdout, "Statistics: \"backup.chk\" holds none, they start anew.\n" );
+		}
+	}
+	else if( Answer == 1 && 0 == myid )
+		fprintf( stdout, "Statistics: only \"backup.chk\" (b_format = 2) keeps them, they start anew.\n" );
+
+	if( 0 == myid )
+		fprintf( stdout, "Statistics: every %d steps from step %d, written every %d steps.\n",
+		         config.s_every, config.s_start, sWrite );
+
+} /* end StatisticsInit() */
+
+
+/*
+* update - Adds sample x to the accumulators s of a cell holding n samples.
+*/
+static void update( double *s, const double x[ST_NX], double n )
+{
+double d[ST_NX], e[ST_NX], r = 1. / ( n + 1. );
+double y[4], fd[4], fe[4], w, W0, W, f, dd, dC, tr;
+int a, b, m;
+
+	//--- Reynolds: means and co-moments
+	for( a = 0; a < ST_NX; a++ ) {
+		d[a] = x[a] - s[A_MEAN+a];
+		s[A_MEAN+a] += r * d[a];
+		e[a] = x[a] - s[A_MEAN+a];
+	}
+	s[A_M2  ] += d[0] * e[0];
+	s[A_M2+1] += d[4] * e[4];
+	s[A_M2+2] += d[5] * e[5];
+	for( m = 0; m < 6; m++ ) s[A_CUU+m] += d[1+pa[m]] * e[1+pb[m]];
+	for( a = 0; a < 3; a++ ) s[A_CPU+a] += d[4] * e[1+a];
+	s[A_CPDIV] += d[4] * ( e[6] + e[10] + e[14] );
+	for( a = 0; a < 9; a++ ) s[A_M2G+a] += d[6+a] * e[6+a];
+
+	//--- Favre: the same weighted by rho
+	y[0] = x[1]; y[1] = x[2]; y[2] = x[3]; y[3] = x[5];
+	w = x[0]; W0 = s[A_W]; W = W0 + w;
+	for( a = 0; a < 4; a++ ) fd[a] = y[a] - s[A_FMEAN+a];
+
+	// third moments need the co-moments without this sample
+	f  = W0 * w * ( W0 - w ) / ( W * W );
+	dd = fd[0] * fd[0] + fd[1] * fd[1] + fd[2] * fd[2];
+	tr = s[A_CF] + s[A_CF+1] + s[A_CF+2];
+	for( b = 0; b < 3; b++ ) {
+		for( dC = 0., a = 0; a < 3; a++ ) dC += fd[a] * s[A_CF+sym[a][b]];
+		s[A_K+b] += dd * fd[b] * f - w / W * ( 2. * dC + fd[b] * tr );
+	}
+	for( a = 0; a < 4; a++ ) {
+		s[A_FMEAN+a] += w / W * fd[a];
+		fe[a] = y[a] - s[A_FMEAN+a];
+	}
+	for( m = 0; m < 6; m++ ) s[A_CF+m] += w * fd[pa[m]] * fe[pb[m]];
+	s[A_W] = W;
+
+} /* end update() */
+
+
+/*
+* sample - The z-lines of the current solution go into the statistics of their cells.
+*/
+static void sample( void )
+{
+unsigned i, j, k;
+size_t LH = (size_t)LEN * HIG, c;
+double s[ST_NACC], x[ST_NX], n;
+real R, U, V, W;
+int q;
+
+	for( i = 1; i < LENN; i++ ) {
+		for( j = 1; j < HIGG; j++ ) {
+			c = ( i - 1 ) * HIG + j - 1;
+			for( q = 0; q < ST_NACC; q++ ) s[q] = acc[q * LH + c];
+			n = (double)samples * DEP;
+
+			for( k = 1; k < DEPP; k++, n++ ) {
+				R = U1[i][j][k];
+				U = U2[i][j][k] / R;
+				V = U3[i][j][k] / R;
+				W = U4[i][j][k] / R;
+				x[0] = R; x[1] = U; x[2] = V; x[3] = W;
+				x[4] = ( U5[i][j][k] - 0.5 * R * ( U * U + V * V + W * W ) ) * K_1;
+				x[5] = x[4] / ( R_VOZD * R );
+
+				// velocity gradient, as for the frames
+				x[6]  = ( U2[i+1][j][k]/U1[i+1][j][k] - U2[i-1][j][k]/U1[i-1][j][k] ) * _2dX[i];
+				x[7]  = ( U2[i][j+1][k]/U1[i][j+1][k] - U2[i][j-1][k]/U1[i][j-1][k] ) * _2dY[j];
+				x[8]  = ( U2[i][j][k+1]/U1[i][j][k+1] - U2[i][j][k-1]/U1[i][j][k-1] ) * _2deltaZ;
+				x[9]  = ( U3[i+1][j][k]/U1[i+1][j][k] - U3[i-1][j][k]/U1[i-1][j][k] ) * _2dX[i];
+				x[10] = ( U3[i][j+1][k]/U1[i][j+1][k] - U3[i][j-1][k]/U1[i][j-1][k] ) * _2dY[j];
+				x[11] = ( U3[i][j][k+1]/U1[i][j][k+1] - U3[i][j][k-1]/U1[i][j][k-1] ) * _2deltaZ;
+				x[12] = ( U4[i+1][j][k]/U1[i+1][j][k] - U4[i-1][j][k]/U1[i-1][j][k] ) * _2dX[i];
+				x[13] = ( U4[i][j+1][k]/U1[i][j+1][k] - U4[i][j-1][k]/U1[i][j-1][k] ) * _2dY[j];
+				x[14] = ( U4[i][j][k+1]/U1[i][j][k+1] - U4[i][j][k-1]/U1[i][j][k-1] ) * _2deltaZ;
+
+				update( s, x, n );
+			}
+			for( q = 0; q < ST_NACC; q++ ) acc[q * LH + c] = s[q];
+		}
+	}
+	samples++;
+
+} /* end sample() */
+
+
+/*
+* Fields differentiated in x, held with a ghost column on either side: [G_N][LEN+2][HIG].
+*/
+enum { G_U, G_V, G_W, G_P, G_K, G_TX, G_PX, G_N };
+
+static double ddx( const double *f, int i, int j )
+{
+	return ( f[(i+1)*HIG+j] - f[(i-1)*HIG+j] ) * _2dX[i];
+}
+
+static double ddy( const double *f, int i, int j )
+{
+	if( HIG < 2 ) return 0.;
+	if( j == 0 )         return ( f[i*HIG+1] - f[i*HIG] ) * _dY[1];
+	if( j == (int)HIG-1 ) return ( f[i*HIG+j] - f[i*HIG+j-1] ) * _dY[j];
+	return ( f[i*HIG+j+1] - f[i*HIG+j-1] ) * _2dY[j+1];
+}
+
+static double d2( const double *f, int i, int j )
+{
+double fx, fy = 0.;
+int jc;
+
+	// rows of f are the rows j+1 of the spacing arrays
+	fx = ( ( f[(i+1)*HIG+j] - f[i*HIG+j] ) * _dX[i] - ( f[i*HIG+j] - f[(i-1)*HIG+j] ) * _dX[i-1] ) * 2. * _2dX[i];
+	if( HIG > 2 ) {
+		jc = j < 1 ? 1 : j > (int)HIG-2 ? (int)HIG-2 : j;
+		fy = ( ( f[i*HIG+jc+1] - f[i*HIG+jc] ) * _dY[jc+1] - ( f[i*HIG+jc] - f[i*HIG+jc-1] ) * _dY[jc] ) * 2. * _2dY[jc+1];
+	}
+	return fx + fy;
+}
+
+
+/*
+* writeXdmf - Describes "stats-<step>.snap" as an x-y grid of the cell centres.
+*/
+static void writeXdmf( const char *datafile, int NX )
+{
+FILE *pF;
+char filename[64];
+long size = (long)NX * HIG * sizeof(float);
+int l;
+
+	snprintf( filename, sizeof(filename), "stats-%d.xmf", step );
+	if( ( pF = fopen( filename, "w" ) ) == NULL ) {
+		fprintf( stderr, "can't open \"%s\".\n", filename );
+		return;
+	}
+	fprintf( pF, "<?xml version=\"1.0\" ?>\n" );
+	fprintf( pF, "<Xdmf Version=\"2.0\">\n <Domain>\n" );
+	fprintf( pF, "  <Grid Name=\"stats\" GridType=\"Uniform\">\n" );
+	fprintf( pF, "   <Time Value=\"%g\"/>\n", totalTime );
+	fprintf( pF, "   <Information Name=\"samples\" Value=\"%d\"/>\n", samples );
+	if( GridStretched( ) ) {
+		int lo[3] = { 0, 0, 0 }, st[3] = { 1, 1, 1 }, n[3];
+		n[0] = NX; n[1] = HIG; n[2] = 1;
+		GridXdmf( pF, 2, 1, lo, st, n );
+	}
+	else {
+		fprintf( pF, "   <Topology TopologyType=\"2DCoRectMesh\" Dimensions=\"%d %d\"/>\n", HIG, NX );
+		fprintf( pF, "   <Geometry GeometryType=\"ORIGIN_DXDY\">\n" );
+		fprintf( pF, "    <DataItem Format=\"XML\" Dimensions=\"2\">%g %g</DataItem>\n", 0.5 * deltaY, 0.5 * deltaX );
+		fprintf( pF, "    <DataItem Format=\"XML\" Dimensions=\"2\">%g %g</DataItem>\n", deltaY, deltaX );
+		fprintf( pF, "   </Geometry>\n" );
+	}
+	for( l = 0; l < ST_NOUT; l++ ) {
+		fprintf( pF, "   <Attribute Name=\"%s\" AttributeType=\"Scalar\" Center=\"Node\">\n", StatNames[l] );
+		fprintf( pF, "    <DataItem Format=\"Binary\" NumberType=\"Float\" Precision=\"4\" Endian=\"Native\"" );
+		fprintf( pF, " Seek=\"%ld\" Dimensions=\"%d %d\">%s</DataItem>\n", l*size, HIG, NX, datafile );
+		fprintf( pF, "   </Attribute>\n" );
+	}
+	fprintf( pF, "  </Grid>\n </Domain>\n</Xdmf>\n" );
+	fclose( pF );
+
+} /* end writeXdmf() */
+
+
+/*
+* writeStats - Derives the statistics and the budget, all processes write "stats-<step>.snap".
+*/
+static void writeStats( int myid, int numprocs )
+{
+size_t LH = (size_t)LEN * HIG, LG = (size_t)( LEN + 2 ) * HIG, c;
+double *g, *col, nS, rho, R[6], fl, dudx[3][2], v[ST_NLOCAL];
+float *out;
+char filename[64];
+MPI_File fh;
+MPI_Datatype part;
+int sizes[3], subsizes[3], starts[3], prevProc, nextProc, i, j, a, b, f;
+const double *s;
+
+	if( ( g = (double *)malloc( ( G_N * LG + 2 * G_N * HIG ) * sizeof(double) ) ) == NULL ||
+	    ( out = (float *)malloc( ST_NOUT * LH * sizeof(float) ) ) == NULL ) {
+		fprintf( stderr, "mpi_layer2: can't allocate memory for statistics.\n" );
+		MPI_Abort( MPI_COMM_WORLD, 1 );
+	}
+	col = g + G_N * LG;
+	nS = (double)samples * DEP;
+
+	//--- fields to differentiate in x, then their ghost columns from the neighbours
+	for( i = 0; i < (int)LEN; i++ ) {
+		for( j = 0; j < (int)HIG; j++ ) {
+			s = acc + (size_t)i * HIG + j;
+			c = (size_t)( i + 1 ) * HIG + j;
+			g[G_U*LG + c] = s[(A_FMEAN  )*LH];
+			g[G_V*LG + c] = s[(A_FMEAN+1)*LH];
+			g[G_W*LG + c] = s[(A_FMEAN+2)*LH];
+			g[G_P*LG + c] = s[(A_MEAN+4 )*LH];
+			g[G_K*LG + c] = 0.5 * ( s[(A_CF)*LH] + s[(A_CF+1)*LH] + s[(A_CF+2)*LH] ) / s[A_W*LH];
+			g[G_TX*LG + c] = 0.5 * s[(A_K)*LH] / nS;
+			g[G_PX*LG + c] = s[(A_CPU)*LH] / nS;
+		}
+	}
+	prevProc = myid > 0 ? myid - 1 : MPI_PROC_NULL;
+	nextProc = myid < numprocs - 1 ? myid + 1 : MPI_PROC_NULL;
+	for( f = 0; f < G_N; f++ ) memcpy( col + f * HIG, g + f * LG + (size_t)LEN * HIG, HIG * sizeof(double) );
+	MPI_Sendrecv( col, G_N * HIG, MPI_DOUBLE, nextProc, 61, col + G_N * HIG, G_N * HIG, MPI_DOUBLE, prevProc, 61,
+	              MPI_COMM_WORLD, MPI_STATUS_IGNORE );
+	if( prevProc != MPI_PROC_NULL )
+		for( f = 0; f < G_N; f++ ) memcpy( g + f * LG, col + ( G_N + f ) * HIG, HIG * sizeof(double) );
+	for( f = 0; f < G_N; f++ ) memcpy( col + f * HIG, g + f * LG + HIG, HIG * sizeof(double) );
+	MPI_Sendrecv( col, G_N * HIG, MPI_DOUBLE, prevProc, 62, col + G_N * HIG, G_N * HIG, MPI_DOUBLE, nextProc, 62,
+	              MPI_COMM_WORLD, MPI_STATUS_IGNORE );
+	if( nextProc != MPI_PROC_NULL )
+		for( f = 0; f < G_N; f++ ) memcpy( g + f * LG + (size_t)( LEN + 1 ) * HIG, col + ( G_N + f ) * HIG, HIG * sizeof(double) );
+
+	// at the inflow and outflow the ghost columns are extrapolated: one-sided differences
+	for( f = 0; f < G_N; f++ ) {
+		double *gf = g + f * LG;
+		for( j = 0; j < (int)HIG; j++ ) {
+			if( prevProc == MPI_PROC_NULL )
+				gf[j] = LEN > 1 ? 2. * gf[HIG+j] - gf[2*HIG+j] : gf[HIG+j];
+			if( nextProc == MPI_PROC_NULL )
+				gf[(LEN+1)*HIG+j] = LEN > 1 ? 2. * gf[LEN*HIG+j] - gf[(LEN-1)*HIG+j] : gf[LEN*HIG+j];
+		}
+	}
+
+	//--- the fields of the file, x running fastest
+	for( i = 0; i < (int)LEN; i++ ) {
+		for( j = 0; j < (int)HIG; j++ ) {
+			float *o = out + (size_t)j * LEN + i;
+			s = acc + (size_t)i * HIG + j;
+			localFields( s, LH, nS, v );
+			for( a = 0; a < ST_NLOCAL; a++ ) o[a*LH] = v[a];
+			for( a = 0; a < 6; a++ ) R[a] = v[19+a];
+			rho = v[0];
+
+			// budget of k
+			for( a = 0; a < 3; a++ ) {
+				dudx[a][0] = ddx( g + ( G_U + a ) * LG, i + 1, j );
+				dudx[a][1] = ddy( g + ( G_U + a ) * LG, i + 1, j );
+			}
+			for( fl = 0., a = 0; a < 3; a++ )
+				for( b = 0; b < 2; b++ ) fl += R[sym[a][b]] * dudx[a][b];
+			o[26*LH] = -rho * fl;
+
+			for( fl = 0., a = 0; a < 9; a++ ) fl += s[(A_M2G+a)*LH];
+			o[27*LH] = mu_L * fl / nS;
+
+			// y-fluxes are local: differenced along the column
+			for( b = 0; b < (int)HIG; b++ ) col[b] = 0.5 * acc[(A_K+1)*LH + (size_t)i * HIG + b] / nS;
+			fl = ddy( col, 0, j );
+			o[28*LH] = -( ddx( g + G_TX * LG, i + 1, j ) + fl );
+
+			for( b = 0; b < (int)HIG; b++ ) col[b] = acc[(A_CPU+1)*LH + (size_t)i * HIG + b] / nS;
+			fl = ddy( col, 0, j );
+			o[29*LH] = -( ddx( g + G_PX * LG, i + 1, j ) + fl );
+
+			o[30*LH] = s[A_CPDIV*LH] / nS;
+			o[31*LH] = -( ( s[(A_MEAN+1)*LH] - s[A_FMEAN*LH] ) * ddx( g + G_P * LG, i + 1, j )
+			            + ( s[(A_MEAN+2)*LH] - s[(A_FMEAN+1)*LH] ) * ddy( g + G_P * LG, i + 1, j ) );
+			o[32*LH] = mu_L * d2( g + G_K * LG, i + 1, j );
+		}
+	}
+
+	//--- the part of _this_ process in every field of the file
+	sizes[0] = ST_NOUT;    subsizes[0] = ST_NOUT; starts[0] = 0;
+	sizes[1] = HIG;        subsizes[1] = HIG;     starts[1] = 0;
+	sizes[2] = LEN * numprocs; subsizes[2] = LEN; starts[2] = myid * LEN;
+	MPI_Type_create_subarray( 3, sizes, subsizes, starts, MPI_ORDER_C, MPI_FLOAT, &part );
+	MPI_Type_commit( &part );
+
+	snprintf( filename, sizeof(filename), "stats-%d.snap", step );
+	MPI_File_open( MPI_COMM_WORLD, filename, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fh );
+	MPI_File_set_size( fh, 0 );
+	MPI_File_set_view( fh, 0, MPI_FLOAT, part, "native", MPI_INFO_NULL );
+	MPI_File_write_all( fh, out, (int)( ST_NOUT * LH ), MPI_FLOAT, MPI_STATUS_IGNORE );
+	MPI_File_close( &fh );
+	MPI_Type_free( &part );
+
+	if( 0 == myid ) {
+		writeXdmf( filename, LEN * numprocs );
+		fprintf( stdout, "Statistics of %d samples written to \"%s\".\n", samples, filename );
+	}
+	written = step;
+	free( g ); free( out );
+
+} /* end writeStats() */
+
+
+/***************
+*  STATISTICS  *   Takes a sample when due, writes the statistics when due
+***************/
+void Statistics( int myid, int numprocs )
+{
+	if( !on ) return;
+
+	if( (int)step >= config.s_start && ( step - config.s_start ) % config.s_every == 0 ) sample( );
+	if( step % sWrite == 0 && samples > 0 ) writeStats( myid, numprocs );
+
+} /* end Statistics() */
+
+
+void StatisticsFinalize( int myid )
+{
+int numprocs;
+
+	if( !on ) return;
+
+	MPI_Comm_size( MPI_COMM_WORLD, &numprocs );
+	if( samples > 0 && written != (int)step ) writeStats( myid, numprocs );
+	free( acc );
+	acc = NULL;
+
+} /* end StatisticsFinalize() */
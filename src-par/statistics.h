@@ -0,0 +1,36 @@
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+/*
+* StatisticsInit - Allocates the accumulators (s_every > 0); a continued run takes them from "backup.chk".
+*/
+void StatisticsInit( int myid );
+
+/*
+* Statistics - Called every step: adds the z-lines of the solution every s_every steps,
+* writes "stats-<step>.snap" every s_write steps.
+*/
+void Statistics( int myid, int numprocs );
+
+/*
+* StatisticsCount - Accumulators per cell of the x-y plane, 0 if no statistics are taken.
+*/
+int StatisticsCount( void );
+
+/*
+* StatisticsPack - Copies the accumulators [count][LEN][HIG] into buf; returns the samples they hold.
+*/
+int StatisticsPack( double *buf );
+
+/*
+* StatisticsField - Field "name" of StatNames[] up to "k" (the ones of a single cell) into buf [LEN][HIG];
+* returns the samples it is made of, 0 with no samples yet, -1 if there is no such field.
+*/
+int StatisticsField( const char *name, double *buf );
+
+/*
+* StatisticsFinalize - Writes the statistics of the end of the run and frees them.
+*/
+void StatisticsFinalize( int myid );
+
+#endif
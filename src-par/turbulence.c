@@ -274,17 +274,17 @@ void DynamicSmagorinsky ( real ***rho, real ***ru, real ***rv, real ***rw, real
 
 
                 // Strain tensor: Sij
-		        du_dx = ( u[i+1][j][k] - u[i-1][j][k] ) * _2deltaX;
-		        du_dy = ( u[i][j+1][k] - u[i][j-1][k] ) * _2deltaY;
+		        du_dx = ( u[i+1][j][k] - u[i-1][j][k] ) * _2dX[i];
+		        du_dy = ( u[i][j+1][k] - u[i][j-1][k] ) * _2dY[j];
 		        du_dz = ( u[i][j][k+1] - u[i][j][k-1] ) * _2deltaZ;
 
-		        dv_dx = ( v[i+1][j][k] - v[i-1][j][k] ) * _2deltaX; 
-		        dv_dy = ( v[i][j+1][k] - v[i][j-1][k] ) * _2deltaY;        
+		        dv_dx = ( v[i+1][j][k] - v[i-1][j][k] ) * _2dX[i]; 
+		        dv_dy = ( v[i][j+1][k] - v[i][j-1][k] ) * _2dY[j];        
 		        dv_dz = ( v[i][j][k+1] - v[i][j][k-1] ) * _2deltaZ;
 
 
-		        dw_dx = ( w[i+1][j][k] - w[i-1][j][k] ) * _2deltaX;
-		        dw_dy = ( w[i][j+1][k] - w[i][j-1][k] ) * _2deltaY;
+		        dw_dx = ( w[i+1][j][k] - w[i-1][j][k] ) * _2dX[i];
+		        dw_dy = ( w[i][j+1][k] - w[i][j-1][k] ) * _2dY[j];
 		        dw_dz = ( w[i][j][k+1] - w[i][j][k-1] ) * _2deltaZ;
 
                 S11 = du_dx;
@@ -317,17 +317,17 @@ void DynamicSmagorinsky ( real ***rho, real ***ru, real ***rv, real ***rw, real
                 //Filtered stress tensor components: 
                 // __
                 // Sij 
-		        du_dx = ( u_[i+1][j][k] - u_[i-1][j][k] ) * _2deltaX;
-		        du_dy = ( u_[i][j+1][k] - u_[i][j-1][k] ) * _2deltaY;
+		        du_dx = ( u_[i+1][j][k] - u_[i-1][j][k] ) * _2dX[i];
+		        du_dy = ( u_[i][j+1][k] - u_[i][j-1][k] ) * _2dY[j];
 		        du_dz = ( u_[i][j][k+1] - u_[i][j][k-1] ) * _2deltaZ;
 
-		        dv_dx = ( v_[i+1][j][k] - v_[i-1][j][k] ) * _2deltaX; 
-		        dv_dy = ( v_[i][j+1][k] - v_[i][j-1][k] ) * _2deltaY;        
+		        dv_dx = ( v_[i+1][j][k] - v_[i-1][j][k] ) * _2dX[i]; 
+		        dv_dy = ( v_[i][j+1][k] - v_[i][j-1][k] ) * _2dY[j];        
 		        dv_dz = ( v_[i][j][k+1] - v_[i][j][k-1] ) * _2deltaZ;
 
 
-		        dw_dx = ( w_[i+1][j][k] - w_[i-1][j][k] ) * _2deltaX;
-		        dw_dy = ( w_[i][j+1][k] - w_[i][j-1][k] ) * _2deltaY;
+		        dw_dx = ( w_[i+1][j][k] - w_[i-1][j][k] ) * _2dX[i];
+		        dw_dy = ( w_[i][j+1][k] - w_[i][j-1][k] ) * _2dY[j];
 		        dw_dz = ( w_[i][j][k+1] - w_[i][j][k-1] ) * _2deltaZ;
 
                 S11_ = du_dx;
@@ -406,17 +406,17 @@ void DynamicSmagorinsky ( real ***rho, real ***ru, real ***rv, real ***rw, real
                 // Mij = \hat{Delta}^2*Bij - Delta^2*\hat{Aij})
                 // hat{Delta} = 2*Delta => pow(Delta_,2.0) = 4*pow(Delta,2.0)
 
-                M11 = DD * ( 4*B11_[i][j][k] - A11_[i][j][k] );
-                M12 = DD * ( 4*B12_[i][j][k] - A12_[i][j][k] );
-                M13 = DD * ( 4*B13_[i][j][k] - A13_[i][j][k] );
+                M11 = DDxy[i][j] * ( 4*B11_[i][j][k] - A11_[i][j][k] );
+                M12 = DDxy[i][j] * ( 4*B12_[i][j][k] - A12_[i][j][k] );
+                M13 = DDxy[i][j] * ( 4*B13_[i][j][k] - A13_[i][j][k] );
 
-                M21 = DD * ( 4*B21_[i][j][k] - A21_[i][j][k] );
-                M22 = DD * ( 4*B22_[i][j][k] - A22_[i][j][k] );
-                M23 = DD * ( 4*B23_[i][j][k] - A23_[i][j][k] );
+                M21 = DDxy[i][j] * ( 4*B21_[i][j][k] - A21_[i][j][k] );
+                M22 = DDxy[i][j] * ( 4*B22_[i][j][k] - A22_[i][j][k] );
+                M23 = DDxy[i][j] * ( 4*B23_[i][j][k] - A23_[i][j][k] );
 
-                M31 = DD * ( 4*B31_[i][j][k] - A31_[i][j][k] );
-                M32 = DD * ( 4*B32_[i][j][k] - A32_[i][j][k] );
-                M33 = DD * ( 4*B33_[i][j][k] - A33_[i][j][k] );
+                M31 = DDxy[i][j] * ( 4*B31_[i][j][k] - A31_[i][j][k] );
+                M32 = DDxy[i][j] * ( 4*B32_[i][j][k] - A32_[i][j][k] );
+                M33 = DDxy[i][j] * ( 4*B33_[i][j][k] - A33_[i][j][k] );
 
                 // Deviatoric part of L_{ij}^{d} = L_{ij} - 1/3*L_{kk}
 				_trace13 =  -(1.0/3.0)*(L11[i][j][k] + L22[i][j][k] + L33[i][j][k]);
@@ -443,7 +443,7 @@ void DynamicSmagorinsky ( real ***rho, real ***ru, real ***rv, real ***rw, real
                 	Cd = 0.0;
                 } 
 
-                mu_SGS[i][j][k] = rho[i][j][k]*Cd*DD*magStrain[i][j][k];
+                mu_SGS[i][j][k] = rho[i][j][k]*Cd*DDxy[i][j]*magStrain[i][j][k];
             }
         }
     }
@@ -534,17 +534,17 @@ void CalculateQCriteria(real ***rho, real ***ru, real ***rv, real ***rw, real **
             for( k = 1; k < DEPP; k++ ) {
 
                 // Velocity gradient
-                du_dx = ( ru[i+1][j][k]/rho[i+1][j][k] - ru[i-1][j][k]/rho[i-1][j][k] ) * _2deltaX;
-                du_dy = ( ru[i][j+1][k]/rho[i][j+1][k] - ru[i][j-1][k]/rho[i][j-1][k] ) * _2deltaY;
+                du_dx = ( ru[i+1][j][k]/rho[i+1][j][k] - ru[i-1][j][k]/rho[i-1][j][k] ) * _2dX[i];
+                du_dy = ( ru[i][j+1][k]/rho[i][j+1][k] - ru[i][j-1][k]/rho[i][j-1][k] ) * _2dY[j];
                 du_dz = ( ru[i][j][k+1]/rho[i][j][k+1] - ru[i][j][k-1]/rho[i][j][k-1] ) * _2deltaZ;
 
-                dv_dx = ( rv[i+1][j][k]/rho[i+1][j][k] - rv[i-1][j][k]/rho[i-1][j][k] ) * _2deltaX; 
-                dv_dy = ( rv[i][j+1][k]/rho[i][j+1][k] - rv[i][j-1][k]/rho[i][j-1][k] ) * _2deltaY;        
+                dv_dx = ( rv[i+1][j][k]/rho[i+1][j][k] - rv[i-1][j][k]/rho[i-1][j][k] ) * _2dX[i]; 
+                dv_dy = ( rv[i][j+1][k]/rho[i][j+1][k] - rv[i][j-1][k]/rho[i][j-1][k] ) * _2dY[j];        
                 dv_dz = ( rv[i][j][k+1]/rho[i][j][k+1] - rv[i][j][k-1]/rho[i][j][k-1] ) * _2deltaZ;
 
 
-                dw_dx = ( rw[i+1][j][k]/rho[i+1][j][k] - rw[i-1][j][k]/rho[i-1][j][k] ) * _2deltaX;
-                dw_dy = ( rw[i][j+1][k]/rho[i][j+1][k] - rw[i][j-1][k]/rho[i][j-1][k] ) * _2deltaY;
+                dw_dx = ( rw[i+1][j][k]/rho[i+1][j][k] - rw[i-1][j][k]/rho[i-1][j][k] ) * _2dX[i];
+                dw_dy = ( rw[i][j+1][k]/rho[i][j+1][k] - rw[i][j-1][k]/rho[i][j-1][k] ) * _2dY[j];
                 dw_dz = ( rw[i][j][k+1]/rho[i][j][k+1] - rw[i][j][k-1]/rho[i][j][k-1] ) * _2deltaZ;
 
                 S12 = du_dy + dv_dx;
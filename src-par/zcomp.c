@@ -0,0 +1,351 @@
+/*
+*  ZCOMP
+*
+*  Error-bounded lossy compression of a 3-D float field, in the manner of SZ:
+*
+*   - every value is predicted from its seven already decoded neighbours
+*     (Lorenzo predictor), so smooth fields give residuals close to zero;
+*   - the residual is quantized to an integer number of bins of width 2*eb,
+*     which keeps the decoded value within eb of the original;
+*   - the bin numbers are Huffman coded; values that do not fit (too far from
+*     the prediction, nan, inf) are kept exactly as outliers.
+*
+*  A block that would not get smaller, or eb = 0, is stored raw (lossless).
+*
+*  Block layout (native byte order):
+*      mode (1 byte: 0-raw, 1-coded), n (uint32), eb (double), then
+*      raw:   n floats
+*      coded: nsym (uint32), nsym x { symbol (uint16), code length (uint8) },
+*             nbytes (uint64) of the bit stream, the bit stream,
+*             nout (uint32), nout outlier floats
+*
+*/
+#include <stdlib.h>    /* malloc()     */
+#include <string.h>    /* memcpy()     */
+#include <math.h>      /* fabs()       */
+
+#include "zcomp.h"
+
+#define Z_NSYM   65536          /* bins, symbol 0 marks an outlier */
+#define Z_RADIUS (Z_NSYM/2)     /* symbol of the zero residual     */
+#define Z_MAXLEN 24             /* longest Huffman code            */
+
+enum { Z_RAW = 0, Z_CODED = 1 };
+
+
+/*--- Little helpers for the byte stream ---*/
+
+static unsigned char *put( unsigned char *p, const void *v, size_t n )
+{
+	memcpy( p, v, n );
+	return p + n;
+}
+
+static const unsigned char *get( const unsigned char *p, void *v, size_t n )
+{
+	memcpy( v, p, n );
+	return p + n;
+}
+
+
+/*
+* lorenzo - Prediction of r[k][j][i] from the decoded neighbours (zero outside the block).
+*/
+static double lorenzo( const float *r, unsigned i, unsigned j, unsigned k, unsigned nx, unsigned ny )
+{
+size_t sx = 1, sy = nx, sz = (size_t)nx * ny, m = i + sy * j + sz * k;
+double p = 0.;
+
+	if( i )           p += r[m - sx];
+	if( j )           p += r[m - sy];
+	if( k )           p += r[m - sz];
+	if( i && j )      p -= r[m - sx - sy];
+	if( i && k )      p -= r[m - sx - sz];
+	if( j && k )      p -= r[m - sy - sz];
+	if( i && j && k ) p += r[m - sx - sy - sz];
+	return p;
+} /* end lorenzo() */
+
+
+/* weights seen by byWeight() */
+static const size_t *sortWeights;
+
+static int byWeight( const void *a, const void *b )
+{
+size_t wa = sortWeights[*(const int *)a], wb = sortWeights[*(const int *)b];
+	return ( wa > wb ) - ( wa < wb );
+}
+
+
+/*
+* huffLengths - Code lengths of the symbols with non-zero frequency, none longer
+* than Z_MAXLEN (frequencies are halved until the tree is shallow enough).
+*/
+static void huffLengths( const unsigned *freq, unsigned char *len )
+{
+unsigned nsym, *sym, n, a, it;
+size_t *w;
+int *parent, *node;
+
+	sym    = (unsigned *)malloc( Z_NSYM * sizeof(unsigned) );
+	w      = (size_t *)malloc( 2 * Z_NSYM * sizeof(size_t) );
+	parent = (int *)malloc( 2 * Z_NSYM * sizeof(int) );
+	node   = (int *)malloc( 2 * Z_NSYM * sizeof(int) );
+
+	for( nsym = 0, n = 0; n < Z_NSYM; n++ ) {
+		len[n] = 0;
+		if( freq[n] ) sym[nsym++] = n;
+	}
+	if( nsym == 1 ) len[sym[0]] = 1;
+
+	for( it = 0; nsym > 1; it++ ) {
+		unsigned nn = nsym, head = 0, qh = nsym, qt = nsym, maxl = 0;
+
+		//--- leaves sorted by weight, then merged with a second queue (linear Huffman)
+		for( n = 0; n < nsym; n++ ) {
+			size_t f = freq[sym[n]];
+			w[n] = it ? ( f >> it ) + 1 : f;
+			node[n] = n;
+		}
+		sortWeights = w;
+		qsort( node, nsym, sizeof(int), byWeight );
+		while( nn < 2 * nsym - 1 ) {
+			int x[2];
+			for( a = 0; a < 2; a++ ) {
+				if( head < nsym && ( qh == qt || w[node[head]] <= w[qh] ) ) x[a] = node[head++];
+				else x[a] = qh++;
+			}
+			w[nn] = w[x[0]] + w[x[1]];
+			parent[x[0]] = parent[x[1]] = nn;
+			nn++; qt++;
+		}
+		//--- depths
+		parent[nn - 1] = -1;
+		for( n = 0; n < nsym; n++ ) {
+			unsigned d = 0;
+			int p = n;
+			while( parent[p] >= 0 ) { p = parent[p]; d++; }
+			len[sym[n]] = d;
+			if( d > maxl ) maxl = d;
+		}
+		if( maxl <= Z_MAXLEN ) break;
+	}
+
+	free( sym ); free( w ); free( parent ); free( node );
+
+} /* end huffLengths() */
+
+
+/*
+* huffCodes - Canonical codes: shorter first, equal lengths by symbol.
+*/
+static void huffCodes( const unsigned char *len, unsigned *code )
+{
+unsigned count[Z_MAXLEN + 1], next[Z_MAXLEN + 2], n, l, c = 0;
+
+	memset( count, 0, sizeof(count) );
+	for( n = 0; n < Z_NSYM; n++ ) count[len[n]]++;
+	count[0] = 0;
+	for( l = 1; l <= Z_MAXLEN; l++ ) {
+		c = ( c + count[l - 1] ) << 1;
+		next[l] = c;
+	}
+	for( n = 0; n < Z_NSYM; n++ )
+		if( len[n] ) code[n] = next[len[n]]++;
+
+} /* end huffCodes() */
+
+
+size_t ZCompressBound( size_t n )
+{
+	/* raw block and its header; a coded block is only kept if it is smaller */
+	return 1 + 4 + 8 + n * sizeof(float);
+}
+
+
+size_t ZCompress( const float *in, unsigned nx, unsigned ny, unsigned nz, double eb,
+                  unsigned char *out, double *maxErr )
+{
+size_t n = (size_t)nx * ny * nz, m, nbytes, nout = 0, size;
+unsigned i, j, k, nsym, *freq, *code;
+unsigned short *q;
+unsigned char *len, *p, *bits, mode;
+unsigned long long acc = 0;
+int nacc = 0;
+float *r, *outl;
+unsigned n32 = (unsigned)n;
+double pred, d, e;
+
+	*maxErr = 0.;
+	if( eb <= 0. || n == 0 ) goto raw;
+
+	q    = (unsigned short *)malloc( n * sizeof(unsigned short) );
+	r    = (float *)malloc( n * sizeof(float) );
+	outl = (float *)malloc( n * sizeof(float) );
+	freq = (unsigned *)calloc( Z_NSYM, sizeof(unsigned) );
+	code = (unsigned *)malloc( Z_NSYM * sizeof(unsigned) );
+	len  = (unsigned char *)malloc( Z_NSYM );
+
+	//--- prediction and quantization, on decoded values as the decompressor sees them
+	for( k = 0, m = 0; k < nz; k++ ) {
+		for( j = 0; j < ny; j++ ) {
+			for( i = 0; i < nx; i++, m++ ) {
+				pred = lorenzo( r, i, j, k, nx, ny );
+				d = floor( ( in[m] - pred ) / ( 2. * eb ) + 0.5 );
+				if( d > -Z_RADIUS && d < Z_RADIUS ) {
+					r[m] = (float)( pred + 2. * eb * d );
+					e = fabs( (double)in[m] - r[m] );
+					if( e <= eb ) {
+						q[m] = (unsigned short)( d + Z_RADIUS );
+						freq[q[m]]++;
+						if( e > *maxErr ) *maxErr = e;
+						continue;
+					}
+				}
+				//--- outlier (also nan and inf): kept as it is
+				q[m] = 0;
+				freq[0]++;
+				r[m] = in[m];
+				outl[nout++] = in[m];
+			}
+		}
+	}
+
+	huffLengths( freq, len );
+	huffCodes( len, code );
+	for( nsym = 0, i = 0; i < Z_NSYM; i++ ) if( len[i] ) nsym++;
+
+	//--- estimate first: give up if the raw block is not larger
+	for( size = 0, i = 0; i < Z_NSYM; i++ ) size += (size_t)freq[i] * len[i];
+	nbytes = ( size + 7 ) / 8;
+	size = 1 + 4 + 8 + 4 + 3 * (size_t)nsym + 8 + nbytes + 4 + nout * sizeof(float);
+
+	if( size < ZCompressBound( n ) ) {
+		mode = Z_CODED;
+		p = put( out, &mode, 1 );
+		p = put( p, &n32, 4 );
+		p = put( p, &eb, 8 );
+		p = put( p, &nsym, 4 );
+		for( i = 0; i < Z_NSYM; i++ ) {
+			if( len[i] ) {
+				unsigned short s = i;
+				p = put( p, &s, 2 );
+				p = put( p, &len[i], 1 );
+			}
+		}
+		p = put( p, &nbytes, 8 );
+		bits = p;
+		for( m = 0; m < n; m++ ) {
+			acc = ( acc << len[q[m]] ) | code[q[m]];
+			nacc += len[q[m]];
+			while( nacc >= 8 ) {
+				nacc -= 8;
+				*p++ = (unsigned char)( acc >> nacc );
+			}
+		}
+		if( nacc > 0 ) *p++ = (unsigned char)( acc << ( 8 - nacc ) );
+		p = bits + nbytes;
+		n32 = (unsigned)nout;
+		p = put( p, &n32, 4 );
+		p = put( p, outl, nout * sizeof(float) );
+	}
+
+	free( q ); free( r ); free( outl ); free( freq ); free( code ); free( len );
+	if( size < ZCompressBound( n ) ) return size;
+	*maxErr = 0.;
+
+raw:
+	mode = Z_RAW;
+	p = put( out, &mode, 1 );
+	p = put( p, &n32, 4 );
+	p = put( p, &eb, 8 );
+	p = put( p, in, n * sizeof(float) );
+	return p - out;
+
+} /* end ZCompress() */
+
+
+int ZDecompress( const unsigned char *in, size_t len, unsigned nx, unsigned ny, unsigned nz, float *out )
+{
+const unsigned char *p = in, *end = in + len, *bits;
+size_t n = (size_t)nx * ny * nz, m, nbytes, bit = 0;
+unsigned char mode, *clen;
+unsigned n32, nsym, nout, s, l, i, j, k, o = 0;
+unsigned first[Z_MAXLEN + 2], count[Z_MAXLEN + 2], offset[Z_MAXLEN + 2];
+unsigned short *sorted;
+double eb, pred;
+const unsigned char *outl;
+
+	if( len < 13 ) return 1;
+	p = get( p, &mode, 1 );
+	p = get( p, &n32, 4 );
+	p = get( p, &eb, 8 );
+	if( n32 != n ) return 1;
+
+	if( mode == Z_RAW ) {
+		if( p + n * sizeof(float) > end ) return 1;
+		memcpy( out, p, n * sizeof(float) );
+		return 0;
+	}
+	if( mode != Z_CODED ) return 1;
+
+	//--- canonical code table: symbols sorted by (length, symbol)
+	p = get( p, &nsym, 4 );
+	if( nsym == 0 || nsym > Z_NSYM || p + 3 * (size_t)nsym + 8 > end ) return 1;
+	clen   = (unsigned char *)calloc( Z_NSYM, 1 );
+	sorted = (unsigned short *)malloc( nsym * sizeof(unsigned short) );
+	memset( count, 0, sizeof(count) );
+	for( i = 0; i < nsym; i++ ) {
+		unsigned short sy;
+		unsigned char ln;
+		p = get( p, &sy, 2 );
+		p = get( p, &ln, 1 );
+		if( ln == 0 || ln > Z_MAXLEN ) { free( clen ); free( sorted ); return 1; }
+		clen[sy] = ln;
+		count[ln]++;
+	}
+	for( l = 1, s = 0, k = 0; l <= Z_MAXLEN; l++ ) {
+		first[l] = s;              /* first canonical code of length l */
+		offset[l] = k;             /* its index in sorted[] */
+		s = ( s + count[l] ) << 1;
+		k += count[l];
+	}
+	for( l = 1, k = 0; l <= Z_MAXLEN; l++ )
+		for( i = 0; i < Z_NSYM; i++ )
+			if( clen[i] == l ) sorted[k++] = i;
+	free( clen );
+
+	p = get( p, &nbytes, 8 );
+	bits = p;
+	if( bits + nbytes + 4 > end ) { free( sorted ); return 1; }
+	p = get( bits + nbytes, &nout, 4 );
+	outl = p;
+	if( p + (size_t)nout * sizeof(float) > end ) { free( sorted ); return 1; }
+
+	//--- decode and reconstruct in the order of compression
+	for( k = 0, m = 0; k < nz; k++ ) {
+		for( j = 0; j < ny; j++ ) {
+			for( i = 0; i < nx; i++, m++ ) {
+				unsigned c = 0;
+				for( l = 1; ; l++ ) {
+					if( l > Z_MAXLEN || bit >= 8 * nbytes ) { free( sorted ); return 1; }
+					c = ( c << 1 ) | ( ( bits[bit >> 3] >> ( 7 - ( bit & 7 ) ) ) & 1 );
+					bit++;
+					if( c - first[l] < count[l] ) break;
+				}
+				s = sorted[offset[l] + c - first[l]];
+				if( s == 0 ) {
+					if( o == nout ) { free( sorted ); return 1; }
+					memcpy( &out[m], outl + sizeof(float) * o++, sizeof(float) );
+				}
+				else {
+					pred = lorenzo( out, i, j, k, nx, ny );
+					out[m] = (float)( pred + 2. * eb * ( (double)s - Z_RADIUS ) );
+				}
+			}
+		}
+	}
+	free( sorted );
+
+	return 0;
+} /* end ZDecompress() */
@@ -0,0 +1,25 @@
+#ifndef ZCOMP_H
+#define ZCOMP_H
+
+#include <stddef.h>    /* size_t */
+
+/*
+* ZCompressBound - Size of the buffer ZCompress() needs for n values in the worst case.
+*/
+size_t ZCompressBound( size_t n );
+
+/*
+* ZCompress - Compresses the float array in[nz][ny][nx] (x running fastest) so that
+* every value comes back within eb of the original (eb = 0: stored exactly). Returns
+* the compressed size in bytes; *maxErr gets the largest error actually made.
+*/
+size_t ZCompress( const float *in, unsigned nx, unsigned ny, unsigned nz, double eb,
+                  unsigned char *out, double *maxErr );
+
+/*
+* ZDecompress - Restores nx*ny*nz values from the len bytes written by ZCompress().
+* Returns 0 on success, 1 if the data is damaged.
+*/
+int ZDecompress( const unsigned char *in, size_t len, unsigned nx, unsigned ny, unsigned nz, float *out );
+
+#endif
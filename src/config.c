@@ -0,0 +1,187 @@
+/*
+*  CONFIG
+*
+*  Keyed configuration file reader. Every line holds one "key = value" pair,
+*  everything after '#' is a comment, keys are case-insensitive:
+*
+*      LEN    = 50       # Number of cells in length (per process)
+*      deltaX = 1.6666667
+*
+*  Unknown keys, repeated keys, malformed or out-of-range values and missing
+*  required keys are all reported (with the line number) and stop the run.
+*  Keys left out of the file take their default values.
+*
+*/
+#include <stdio.h>     /* printf() etc.*/
+#include <stdlib.h>    /* strtol(), strtod() */
+#include <stddef.h>    /* offsetof()   */
+#include <string.h>    /* strchr()     */
+#include <strings.h>   /* strcasecmp() */
+#include <ctype.h>     /* isspace()    */
+
+#include "type.h"
+#include "def.h"      /* Definitions, parameters */
+
+#include "config.h"
+
+Config config;
+
+typedef enum { CFG_INT, CFG_REAL } cfgType;
+
+typedef struct {
+	const char *key;
+	cfgType     type;
+	size_t      offset;   /* of the field within Config */
+	const char *def;      /* default value, NULL if the key is required */
+	double      min, max; /* admissible range */
+	const char *descr;
+} cfgEntry;
+
+#define CFG_FIELD(f) offsetof(Config, f)
+
+static const cfgEntry cfgTable[] = {
+	{ "LEN",      CFG_INT,  CFG_FIELD(LEN),      NULL,       1, 1e6, "Number of cells in length [-]" },
+	{ "HIG",      CFG_INT,  CFG_FIELD(HIG),      NULL,       2, 1e6, "Number of cells in height [-]" },
+	{ "DEP",      CFG_INT,  CFG_FIELD(DEP),      NULL,       1, 1e6, "Number of cells in depth [-]" },
+	{ "deltaX",   CFG_REAL, CFG_FIELD(deltaX),   NULL,   1e-12, 1e12, "X-step [m]" },
+	{ "deltaY",   CFG_REAL, CFG_FIELD(deltaY),   NULL,   1e-12, 1e12, "Y-step [m]" },
+	{ "deltaZ",   CFG_REAL, CFG_FIELD(deltaZ),   NULL,   1e-12, 1e12, "Z-step [m]" },
+	{ "deltaT",   CFG_REAL, CFG_FIELD(deltaT),   NULL,   1e-12, 1e12, "Time step [sec]" },
+	{ "Answer",   CFG_INT,  CFG_FIELD(Answer),   "0",        0,    1, "1-continue, 0-start new [boolean]" },
+	{ "numstep",  CFG_INT,  CFG_FIELD(numstep),  NULL,       0, 2e9, "Number of overall time steps [-]" },
+	{ "mu_L",     CFG_REAL, CFG_FIELD(mu_L),     NULL,       0, 1e12, "Dynamic mol. viscosity [Pa*sec]" },
+	{ "Pr_L",     CFG_REAL, CFG_FIELD(Pr_L),     "0.72",  1e-6, 1e6, "Mol. Prandtl number" },
+	{ "Pr_T",     CFG_REAL, CFG_FIELD(Pr_T),     "0.8",   1e-6, 1e6, "Turb. Prandtl number" },
+	{ "Cs",       CFG_REAL, CFG_FIELD(Cs),       "0.01",     0,    1, "Square of the Smagorinsky constant" },
+	{ "BL_HIG",   CFG_INT,  CFG_FIELD(BL_HIG),   "5",        0, 1e6, "Height of the random disturbing block" },
+	{ "Ua",       CFG_REAL, CFG_FIELD(Ua),       "35.",      0, 1e6, "Amplitude of disturbed U [m/sec]" },
+	{ "Va",       CFG_REAL, CFG_FIELD(Va),       "35.",      0, 1e6, "Amplitude of disturbed V [m/sec]" },
+	{ "Wa",       CFG_REAL, CFG_FIELD(Wa),       "35.",      0, 1e6, "Amplitude of disturbed W [m/sec]" },
+	{ "Ns_min",   CFG_INT,  CFG_FIELD(Ns_min),   "10",       0, 1e9, "Minimal period of disturbing block" },
+	{ "Nst",      CFG_INT,  CFG_FIELD(Nst),      "50",       0, 1e9, "Its max-min" },
+	{ "f_step",   CFG_INT,  CFG_FIELD(f_step),   "100",      1, 2e9, "Frame taking step" },
+	{ "f_format", CFG_INT,  CFG_FIELD(f_format), "0",        0,    1, "Frame format: 0-Tecplot ASCII, 1-binary Tecplot" },
+	{ "nStages",  CFG_INT,  CFG_FIELD(nStages),  "3",        2,    3, "Number of stages (2,3) of TVD Runge-Kutta algorithm" },
+	{ "maxCoNum", CFG_REAL, CFG_FIELD(maxCoNum), "0.1",   1e-6,    1, "Maximum Courant number for timestepping stability" },
+	{ NULL }
+};
+
+
+/*
+* cfgSet - Converts the text value and stores it in its field; returns 0 on success.
+*/
+static int cfgSet( const cfgEntry *e, const char *val, Config *c )
+{
+char *end;
+double v;
+
+	if( e->type == CFG_INT ) v = (double)strtol( val, &end, 10 );
+	else                     v = strtod( val, &end );
+
+	while( isspace( (unsigned char)*end ) ) end++;
+	if( end == val || *end != '\0' ) return 1;         /* not a number or trailing text */
+	if( v < e->min || v > e->max )   return 2;         /* out of range */
+
+	if( e->type == CFG_INT ) *(int  *)( (char *)c + e->offset ) = (int)v;
+	else                     *(real *)( (char *)c + e->offset ) = (real)v;
+
+	return 0;
+} /* end cfgSet() */
+
+
+/*
+* cfgParse - Reads the file into Config; returns the number of errors found.
+*/
+static int cfgParse( const char *filename, Config *c )
+{
+FILE *pF;
+char line[256], *key, *val, *p;
+char seen[sizeof(cfgTable)/sizeof(cfgTable[0])];
+const cfgEntry *e;
+int nLine = 0, nErr = 0, rc;
+
+	if( ( pF = fopen( filename, "r" ) ) == NULL ) {
+		fprintf( stderr, "can't open \"%s\".\n", filename );
+		return 1;
+	}
+	memset( seen, 0, sizeof(seen) );
+
+	while( fgets( line, sizeof(line), pF ) != NULL ) {
+		nLine++;
+		// strip comment and trailing blanks
+		if( ( p = strchr( line, '#' ) ) != NULL ) *p = '\0';
+		for( p = line + strlen( line ); p > line && isspace( (unsigned char)p[-1] ); ) *--p = '\0';
+		for( key = line; isspace( (unsigned char)*key ); key++ );
+		if( *key == '\0' ) continue;
+
+		// split "key = value" (the '=' is optional)
+		for( p = key; *p && *p != '=' && !isspace( (unsigned char)*p ); p++ );
+		val = p;
+		while( isspace( (unsigned char)*val ) ) val++;
+		if( *val == '=' ) val++;
+		while( isspace( (unsigned char)*val ) ) val++;
+		*p = '\0';
+
+		for( e = cfgTable; e->key != NULL; e++ )
+			if( strcasecmp( e->key, key ) == 0 ) break;
+
+		if( e->key == NULL ) {
+			fprintf( stderr, "%s:%d: unknown key \"%s\".\n", filename, nLine, key );
+			nErr++; continue;
+		}
+		if( seen[e - cfgTable]++ ) {
+			fprintf( stderr, "%s:%d: \"%s\" is given more than once.\n", filename, nLine, e->key );
+			nErr++; continue;
+		}
+		if( ( rc = cfgSet( e, val, c ) ) == 1 ) {
+			fprintf( stderr, "%s:%d: \"%s\" is not a valid %s for \"%s\".\n", filename, nLine,
+			         val, e->type == CFG_INT ? "integer" : "number", e->key );
+			nErr++;
+		}
+		else if( rc == 2 ) {
+			fprintf( stderr, "%s:%d: %s = %s is out of range [%g, %g].\n", filename, nLine,
+			         e->key, val, e->min, e->max );
+			nErr++;
+		}
+	}
+	fclose( pF );
+
+	// defaults for the keys left out
+	for( e = cfgTable; e->key != NULL; e++ ) {
+		if( seen[e - cfgTable] ) continue;
+		if( e->def == NULL ) {
+			fprintf( stderr, "%s: required key \"%s\" (%s) is missing.\n", filename, e->key, e->descr );
+			nErr++;
+		}
+		else cfgSet( e, e->def, c );
+	}
+
+	// checks involving several keys
+	if( nErr == 0 && c->BL_HIG > c->HIG/2 ) {
+		fprintf( stderr, "%s: BL_HIG = %d exceeds the upper half of the domain, HIG/2 = %d.\n",
+		         filename, c->BL_HIG, c->HIG/2 );
+		nErr++;
+	}
+
+	return nErr;
+} /* end cfgParse() */
+
+
+void ReadConfig( const char *filename )
+{
+const cfgEntry *e;
+
+	memset( &config, 0, sizeof(config) );
+	if( cfgParse( filename, &config ) != 0 ) {
+		fprintf( stderr, "layer2: errors in \"%s\", terminating.\n", filename );
+		exit( -1 );
+	}
+	// report what the run is going to use
+	for( e = cfgTable; e->key != NULL; e++ ) {
+		if( e->type == CFG_INT )
+			printf( "%-9s= %d\n", e->key, *(int *)( (char *)&config + e->offset ) );
+		else
+			printf( "%-9s= %g\n", e->key, *(real *)( (char *)&config + e->offset ) );
+	}
+
+} /* end ReadConfig() */
@@ -0,0 +1,32 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+/*
+* Config - All run parameters read from the keyed configuration file.
+* Plain data only, filled once at start-up.
+*/
+typedef struct {
+	int  LEN, HIG, DEP;             /* cell numbers in x-, y-, z-directions */
+	real deltaX, deltaY, deltaZ;    /* cell spacings */
+	real deltaT;                    /* initial time step */
+	int  Answer;                    /* 1-continue, 0-start new */
+	int  numstep;                   /* overall number of time steps */
+	real mu_L, Pr_L, Pr_T, Cs;      /* transport coefficients */
+	int  BL_HIG;                    /* height of the random disturbing block */
+	real Ua, Va, Wa;                /* amplitudes of disturbed velocities */
+	int  Ns_min, Nst;               /* minimal period of disturbing block and its max-min */
+	int  f_step;                    /* frame taking step */
+	int  f_format;                  /* frame format: 0-Tecplot ASCII, 1-binary Tecplot */
+	int  nStages;                   /* number of stages of Runge-Kutta algorithm */
+	real maxCoNum;                  /* maximum Courant number */
+} Config;
+
+extern Config config;
+
+/*
+* ReadConfig - Parses and validates the keyed configuration file into Config.
+* Any error terminates the program.
+*/
+void ReadConfig( const char *filename );
+
+#endif
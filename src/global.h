@@ -42,6 +42,7 @@ extern real
 	Cs, CsDD, DD;
 
 extern real maxCoNum;  /* maximum Courant number */
+extern real totalTime; /* simulation time */
 extern int nStages; /* number of stages of Runge-Kutta algorithm */
 
 extern unsigned
@@ -6,6 +6,7 @@
 #include "def.h"      /* Definitions, parameters */
 #include "global.h"   /* global variables */
 #include "helpers.h"  /* helper functions */
+#include "config.h"
 #include "initialize.h"
 
 /***************
@@ -14,50 +15,35 @@
 void Initialize( void )
 {
 
-	/*--- Loading data from "layer2.ini" file ---*/
 	FILE *pF;
-	if( ( pF = fopen( "layer2.ini", "r" ) ) == NULL ) {
-	   printf( "Cannot open \"layer2.ini\" file");
-	   exit( -1 );
-	}
 
-	int i = 0;
-	do{
-		if ( fgets( str, 79, pF ) != NULL ) {
-			switch( i ) {
-				case  0:  printf( "LEN    = %d\n",  LEN    = atoi( str ) ); break;
-				case  1:  printf( "HIG    = %d\n",  HIG    = atoi( str ) ); break;
-				case  2:  printf( "DEP    = %d\n",  DEP    = atoi( str ) ); break;
-				case  3:  printf( "deltaX = %f\n",  deltaX = atof( str ) ); break;
-				case  4:  printf( "deltaY = %f\n",  deltaY = atof( str ) ); break;
-				case  5:  printf( "deltaZ = %f\n",  deltaZ = atof( str ) ); break;
-				case  6:  printf( "deltaT = %f\n",  deltaT = atof( str ) ); break;
-				case  7:  printf( "Answer = %d\n",  Answer = atoi( str ) ); break;
-				case  8:  printf( "numstep= %d\n",  numstep= atoi( str ) ); break;
-				case  9:  printf( "mu_L   = %f\n",  mu_L   = atof( str ) ); break;
-				case 10:  printf( "Pr_L   = %f\n",  Pr_L   = atof( str ) ); break;
-				case 11:  printf( "Pr_T   = %f\n",  Pr_T   = atof( str ) ); break;
-				case 12:  printf( "Cs     = %f\n",  Cs     = atof( str ) ); break;
-				case 13:  printf( "BL_HIG = %d\n",  BL_HIG = atoi( str ) ); break;
-				case 14:  printf( "Ua     = %f\n",  Ua     = atof( str ) ); break;
-				case 15:  printf( "Va     = %f\n",  Va     = atof( str ) ); break;
-				case 16:  printf( "Wa     = %f\n",  Wa     = atof( str ) ); break;
-				case 17:  printf( "Ns_min = %d\n",  Ns_min = atoi( str ) ); break;
-				case 18:  printf( "Nst    = %d\n",  Nst    = atoi( str ) ); break;
-				case 19:  printf( "f_step = %d\n",  f_step = atoi( str ) ); break;
-				case 20:  printf( "nStages = %d\n", nStages  = atoi( str ) ); break;
-				case 21:  printf( "maxCoNum = %f\n",maxCoNum = atof( str ) ); break;
-				default: break;
-			} /* end switch */
-			i++;
-		} /* end if() */
-		else {
-		   puts( "Error while reading \"layer2.ini\" file" );
-		   exit( -1 );
-		}
-	} while( i < 22 );
-
-	fclose( pF );
+	/*--- Loading data from "layer2.ini" file ---*/
+	ReadConfig( "layer2.ini" );
+
+	LEN      = config.LEN;
+	HIG      = config.HIG;
+	DEP      = config.DEP;
+	deltaX   = config.deltaX;
+	deltaY   = config.deltaY;
+	deltaZ   = config.deltaZ;
+	deltaT   = config.deltaT;
+	Answer   = config.Answer;
+	numstep  = config.numstep;
+	mu_L     = config.mu_L;
+	Pr_L     = config.Pr_L;
+	Pr_T     = config.Pr_T;
+	Cs       = config.Cs;
+	BL_HIG   = config.BL_HIG;
+	Ua       = config.Ua;
+	Va       = config.Va;
+	Wa       = config.Wa;
+	Ns_min   = config.Ns_min;
+	Nst      = config.Nst;
+	f_step   = config.f_step;
+	nStages  = config.nStages;
+	maxCoNum = config.maxCoNum;
+
+	int i;
 
 	printf("Total number of cells in computational domain: %d\n", LEN*HIG*DEP );
 
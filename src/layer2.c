@@ -72,6 +72,7 @@ real/* transport coefficients */
 
 real maxCoNum;  /* maximum Courant number */
 int nStages;    /* number of stages of Runge-Kutta algorithm */
+real totalTime; /* simulation time */
 
 unsigned
    step,    /* current time step */
@@ -118,7 +119,6 @@ int main( void )
 {
 
 	int counter = 0;
-    float totalTime = 0.;
 
 	continFlag = 1; /* continuation flag (to be changed by SIGINT handler) */
 
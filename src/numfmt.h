@@ -0,0 +1,13 @@
+#ifndef NUMFMT_H
+#define NUMFMT_H
+
+/* longest text FormatG() may produce, terminating zero included */
+#define FMTG_MAXLEN 16
+
+/*
+* FormatG - Writes v into s exactly as sprintf( s, "%g", v ) does and returns
+* the number of characters written (the terminating zero is not counted).
+*/
+int FormatG( char *s, double v );
+
+#endif
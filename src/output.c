@@ -1,5 +1,5 @@
 /***********
-*  OUTPUT  *   Outputs some specified flowfield parameter to file "input.dat"
+*  OUTPUT  *   Outputs flowfield to the Tecplot file "<step>.plt"
 ***********/
 
 #include <stdio.h>     /* printf() etc.*/
@@ -10,17 +10,26 @@
 #include "def.h"      /* Definitions, parameters */
 #include "global.h"   /* global variables */
 #include "turbulence.h" /* Q Criteria */ 
+#include "config.h"
+#include "tecplot.h"
+#include "numfmt.h"    /* FormatG() */
 
 #include "output.h"
 
-void Output( void )
-{
+/* names of the variables of a frame, in the order of CellValues() */
+static const char *varNames[OUT_NVARS] = {
+  "x", "y", "z", "rho", "u", "v", "w", "p", "T", "Vort. mag.", "Q-criteria.", "muSgs-mu-ratio"
+};
 
-unsigned int i, j, k;
-char str[80];
-real xc, yc, zc;
-real R, U, V, W, P, T;
-real omegax, omegay, omegaz, S12, S13, S23, Omega, Strain, Q, muT;
+
+/*
+* CellValues - Coordinates, primitive variables and derived quantities of the cell (i,j,k):
+* x, y, z, rho, u, v, w, p, T, vorticity magnitude, Q-criterion and muT/mu_L ratio.
+*/
+void CellValues( unsigned i, unsigned j, unsigned k, real v[OUT_NVARS] )
+{
+real R, U, V, W, P;
+real omegax, omegay, omegaz, S12, S13, S23, Omega, Strain;
 
 /* matrix of velocity derivatives */
 real 
@@ -29,6 +38,67 @@ dv_dx, dw_dx,
 du_dy, dw_dy,
 du_dz, dv_dz;
 
+  v[0] = (i-1)*deltaX + 0.5*deltaX;
+  v[1] = (j-1)*deltaY + 0.5*deltaY;
+  v[2] = (k-1)*deltaZ + 0.5*deltaZ;
+
+  R = U1[i][j][k];
+  U = U2[i][j][k]/R;
+  V = U3[i][j][k]/R;
+  W = U4[i][j][k]/R;
+  P = ( U5[i][j][k] - 0.5 * R * ( U * U + V * V + W * W ) ) * K_1;
+  v[3] = R; v[4] = U; v[5] = V; v[6] = W; v[7] = P;
+  v[8] = P / ( R_VOZD * R );
+
+  // Velocity gradient
+  du_dx = ( U2[i+1][j][k]/U1[i+1][j][k] - U2[i-1][j][k]/U1[i-1][j][k] ) * _2deltaX;
+  du_dy = ( U2[i][j+1][k]/U1[i][j+1][k] - U2[i][j-1][k]/U1[i][j-1][k] ) * _2deltaY;
+  du_dz = ( U2[i][j][k+1]/U1[i][j][k+1] - U2[i][j][k-1]/U1[i][j][k-1] ) * _2deltaZ;
+
+  dv_dx = ( U3[i+1][j][k]/U1[i+1][j][k] - U3[i-1][j][k]/U1[i-1][j][k] ) * _2deltaX;
+  dv_dy = ( U3[i][j+1][k]/U1[i][j+1][k] - U3[i][j-1][k]/U1[i][j-1][k] ) * _2deltaY; 
+  dv_dz = ( U3[i][j][k+1]/U1[i][j][k+1] - U3[i][j][k-1]/U1[i][j][k-1] ) * _2deltaZ;
+
+  dw_dx = ( U4[i+1][j][k]/U1[i+1][j][k] - U4[i-1][j][k]/U1[i-1][j][k] ) * _2deltaX;
+  dw_dy = ( U4[i][j+1][k]/U1[i][j+1][k] - U4[i][j-1][k]/U1[i][j-1][k] ) * _2deltaY;
+  dw_dz = ( U4[i][j][k+1]/U1[i][j][k+1] - U4[i][j][k-1]/U1[i][j][k-1] ) * _2deltaZ;
+
+  omegax = ( dw_dy - dv_dz );
+  omegay = ( du_dz - dw_dx );
+  omegaz = ( dv_dx - du_dy );
+
+  Omega = sqrt(  omegax * omegax + omegay * omegay + omegaz * omegaz );
+
+  S12 = 0.5 * (du_dy + dv_dx);
+  S13 = 0.5 * (du_dz + dw_dx);
+  S23 = 0.5 * (dv_dz + dw_dy);
+
+  Strain = sqrt( 2 * ( du_dx * du_dx + dv_dy * dv_dy + dw_dz * dw_dz 
+                        + 2 * ( S12   * S12   + S13   * S13   + S23   * S23 ) ) );
+
+  v[9]  = Omega;
+  v[10] = 0.5 * ( Omega*Omega - Strain*Strain); // Q
+
+  // v[11] = mu_SGS[i][j][k];
+  v[11] = R * CsDD * Strain/mu_L;
+
+} /* end CellValues() */
+
+
+/* size of the text buffer of the ASCII frames */
+#define OUT_TXTBUF (4 << 20)
+
+/*
+* OutputTecplot - Tecplot ASCII file in POINT format.
+*/
+static void OutputTecplot( void )
+{
+static char *txt = NULL;
+size_t len = 0;
+unsigned int i, j, k, l;
+char str[80];
+real v[OUT_NVARS];
+
 FILE *pF;
 // FILE *pF1;
 
@@ -85,59 +155,98 @@ FILE *pF;
   fprintf(pF, "zone t=\" \"\n");
   fprintf(pF, "i=%d, j=%d, k=%d, f=point\n", LEN, HIG, DEP);
 
+  //--- text is gathered in a large buffer and written in a few pieces
+  if (txt == NULL && (txt = (char *)malloc(OUT_TXTBUF)) == NULL) {
+    fprintf(stderr, "layer2: can't allocate memory for Tecplot output.\n");
+    exit(-1);
+  }
+
   for (k = 1; k < DEPP; k++) {
     for (j = 1; j < HIGG; j++) {
       for (i = 1; i < LENN; i++) {
 
-        xc = (i-1)*deltaX + 0.5*deltaX;
-        yc = (j-1)*deltaY + 0.5*deltaY;
-        zc = (k-1)*deltaZ + 0.5*deltaZ;
-
-        R = U1[i][j][k];
-        U = U2[i][j][k]/R;
-        V = U3[i][j][k]/R;
-        W = U4[i][j][k]/R;
-        P = ( U5[i][j][k] - 0.5 * R * ( U * U + V * V + W * W ) ) * K_1;
-        T = P / ( R_VOZD * R );
-
-  
-        // Velocity gradient
-        du_dx = ( U2[i+1][j][k]/U1[i+1][j][k] - U2[i-1][j][k]/U1[i-1][j][k] ) * _2deltaX;
-        du_dy = ( U2[i][j+1][k]/U1[i][j+1][k] - U2[i][j-1][k]/U1[i][j-1][k] ) * _2deltaY;
-        du_dz = ( U2[i][j][k+1]/U1[i][j][k+1] - U2[i][j][k-1]/U1[i][j][k-1] ) * _2deltaZ;
-
-        dv_dx = ( U3[i+1][j][k]/U1[i+1][j][k] - U3[i-1][j][k]/U1[i-1][j][k] ) * _2deltaX;
-        dv_dy = ( U3[i][j+1][k]/U1[i][j+1][k] - U3[i][j-1][k]/U1[i][j-1][k] ) * _2deltaY; 
-        dv_dz = ( U3[i][j][k+1]/U1[i][j][k+1] - U3[i][j][k-1]/U1[i][j][k-1] ) * _2deltaZ;
- 
-        dw_dx = ( U4[i+1][j][k]/U1[i+1][j][k] - U4[i-1][j][k]/U1[i-1][j][k] ) * _2deltaX;
-        dw_dy = ( U4[i][j+1][k]/U1[i][j+1][k] - U4[i][j-1][k]/U1[i][j-1][k] ) * _2deltaY;
-        dw_dz = ( U4[i][j][k+1]/U1[i][j][k+1] - U4[i][j][k-1]/U1[i][j][k-1] ) * _2deltaZ;
-
-
-        omegax = ( dw_dy - dv_dz );
-        omegay = ( du_dz - dw_dx );
-        omegaz = ( dv_dx - du_dy );
-
-        Omega = sqrt(  omegax * omegax + omegay * omegay + omegaz * omegaz );
-
-        S12 = 0.5 * (du_dy + dv_dx);
-        S13 = 0.5 * (du_dz + dw_dx);
-        S23 = 0.5 * (dv_dz + dw_dy);
+        CellValues( i, j, k, v );
+
+        // the same text as fprintf("%g %g ... %g\n")
+        for (l = 0; l < OUT_NVARS; l++) {
+          len += FormatG(txt + len, v[l]);
+          txt[len++] = (l < OUT_NVARS-1) ? ' ' : '\n';
+        }
+        if (len > OUT_TXTBUF - OUT_NVARS * FMTG_MAXLEN) {
+          fwrite(txt, 1, len, pF);
+          len = 0;
+        }
+        
+      }
+    }
+  }
+  fwrite(txt, 1, len, pF);
+  fclose(pF);
 
-        Strain = sqrt( 2 * ( du_dx * du_dx + dv_dy * dv_dy + dw_dz * dw_dz 
-                              + 2 * ( S12   * S12   + S13   * S13   + S23   * S23 ) ) );
+} /* end OutputTecplot() */
 
-        Q = 0.5 * ( Omega*Omega - Strain*Strain);
 
-        // muT = mu_SGS[i][j][k];
-        muT = R * CsDD * Strain/mu_L;
+/*
+* OutputTecplotBinary - Binary Tecplot file, one ordered zone of the cell centres
+* in BLOCK order: every variable, coordinates included, is one float array.
+*/
+static void OutputTecplotBinary( void )
+{
+static float *buf = NULL;
+unsigned int i, j, k, l, n, m;
+char str[80], *head;
+size_t hsize, zsize;
+double vmin[OUT_NVARS], vmax[OUT_NVARS];
+real v[OUT_NVARS];
+FILE *pF;
 
-        fprintf(pF, "%g %g %g %g %g %g %g %g %g %g %g %g\n", xc, yc, zc, R, U, V, W, P, T, Omega, Q, muT);
-        
+  n = LEN * HIG * DEP;
+  if (buf == NULL && (buf = (float *)malloc(OUT_NVARS * n * sizeof(float))) == NULL) {
+    fprintf(stderr, "layer2: can't allocate memory for Tecplot output.\n");
+    exit(-1);
+  }
+  for (l = 0; l < OUT_NVARS; l++) {
+    vmin[l] =  HUGE_VAL;
+    vmax[l] = -HUGE_VAL;
+  }
+  for (k = 1; k < DEPP; k++) {
+    for (j = 1; j < HIGG; j++) {
+      for (i = 1; i < LENN; i++) {
+        CellValues( i, j, k, v );
+        m = ((k-1)*HIG + (j-1))*LEN + (i-1);
+        for (l = 0; l < OUT_NVARS; l++) {
+          buf[l*n + m] = v[l];
+          if (v[l] < vmin[l]) vmin[l] = v[l];
+          if (v[l] > vmax[l]) vmax[l] = v[l];
+        }
       }
     }
   }
+
+  hsize = TecplotHeader( NULL, "3-D compressible case", OUT_NVARS, varNames, LEN, HIG, DEP, totalTime );
+  zsize = TecplotZoneHeader( NULL, OUT_NVARS, vmin, vmax );
+  if ((head = (char *)malloc(hsize + zsize)) == NULL) {
+    fprintf(stderr, "layer2: can't allocate memory for Tecplot output.\n");
+    exit(-1);
+  }
+  TecplotHeader( head, "3-D compressible case", OUT_NVARS, varNames, LEN, HIG, DEP, totalTime );
+  TecplotZoneHeader( head + hsize, OUT_NVARS, vmin, vmax );
+
+  sprintf( str, "%d.plt", step );
+  if ((pF = fopen(str, "wb")) == NULL) {
+    fprintf(stderr, "cannot open file \"%s\"\n", str);
+    exit(-1);
+  }
+  fwrite(head, 1, hsize + zsize, pF);
+  fwrite(buf, sizeof(float), OUT_NVARS * n, pF);
   fclose(pF);
+  free(head);
+
+} /* end OutputTecplotBinary() */
 
+
+void Output( void )
+{
+  if (config.f_format == 1) OutputTecplotBinary();
+  else                      OutputTecplot();
 } /* end Output() */
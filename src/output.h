@@ -1 +1,13 @@
-void Output( );
\ No newline at end of file
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#define OUT_NVARS 12 /* x, y, z, rho, u, v, w, p, T, vort. mag., Q, muT ratio */
+
+void CellValues( unsigned i, unsigned j, unsigned k, real v[OUT_NVARS] );
+
+/*
+* Output - Writes the flowfield as Tecplot ASCII (f_format = 0) or binary (f_format = 1) file.
+*/
+void Output( void );
+
+#endif
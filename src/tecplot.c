@@ -0,0 +1,97 @@
+/*
+*  TECPLOT
+*
+*  Header and zone records of the binary Tecplot data format (#!TDV112), enough
+*  for one ordered zone of float variables in BLOCK order. Binary files are read
+*  by Tecplot and ParaView several times faster than the ASCII POINT files and are
+*  about a third of their size. Numbers are written in the native byte order, the
+*  leading integer 1 lets the reader detect it.
+*
+*/
+#include <string.h>    /* memcpy()     */
+
+#include "tecplot.h"
+
+#define TEC_ZONE_MARKER 299.0f
+#define TEC_EOH_MARKER  357.0f
+
+
+static size_t putInt( char *buf, size_t pos, int v )
+{
+	if( buf != NULL ) memcpy( buf + pos, &v, sizeof(v) );
+	return pos + sizeof(v);
+}
+
+static size_t putFloat( char *buf, size_t pos, float v )
+{
+	if( buf != NULL ) memcpy( buf + pos, &v, sizeof(v) );
+	return pos + sizeof(v);
+}
+
+static size_t putDouble( char *buf, size_t pos, double v )
+{
+	if( buf != NULL ) memcpy( buf + pos, &v, sizeof(v) );
+	return pos + sizeof(v);
+}
+
+/* strings are stored one 32-bit integer per character, zero terminated */
+static size_t putString( char *buf, size_t pos, const char *s )
+{
+	while( *s ) pos = putInt( buf, pos, (unsigned char)*s++ );
+	return putInt( buf, pos, 0 );
+}
+
+
+size_t TecplotHeader( char *buf, const char *title, int nvars, const char **names,
+                      int imax, int jmax, int kmax, double time )
+{
+size_t pos = 0;
+int l;
+
+	if( buf != NULL ) memcpy( buf, "#!TDV112", 8 );
+	pos = 8;
+	pos = putInt( buf, pos, 1 );              /* byte order */
+	pos = putInt( buf, pos, 0 );              /* full file: grid and solution */
+	pos = putString( buf, pos, title );
+	pos = putInt( buf, pos, nvars );
+	for( l = 0; l < nvars; l++ ) pos = putString( buf, pos, names[l] );
+
+	//--- the zone
+	pos = putFloat( buf, pos, TEC_ZONE_MARKER );
+	pos = putString( buf, pos, "layer2" );
+	pos = putInt( buf, pos, -1 );             /* no parent zone */
+	pos = putInt( buf, pos, -1 );             /* static strand */
+	pos = putDouble( buf, pos, time );        /* solution time */
+	pos = putInt( buf, pos, -1 );             /* not used */
+	pos = putInt( buf, pos, 0 );              /* ordered zone */
+	pos = putInt( buf, pos, 0 );              /* all variables at the nodes */
+	pos = putInt( buf, pos, 0 );              /* no face neighbours */
+	pos = putInt( buf, pos, 0 );              /* no user-defined face connections */
+	pos = putInt( buf, pos, imax );
+	pos = putInt( buf, pos, jmax );
+	pos = putInt( buf, pos, kmax );
+	pos = putInt( buf, pos, 0 );              /* no auxiliary data */
+
+	pos = putFloat( buf, pos, TEC_EOH_MARKER );
+
+	return pos;
+} /* end TecplotHeader() */
+
+
+size_t TecplotZoneHeader( char *buf, int nvars, const double *min, const double *max )
+{
+size_t pos = 0;
+int l;
+
+	pos = putFloat( buf, pos, TEC_ZONE_MARKER );
+	for( l = 0; l < nvars; l++ ) pos = putInt( buf, pos, 1 );   /* float */
+	pos = putInt( buf, pos, 0 );              /* no passive variables */
+	pos = putInt( buf, pos, 0 );              /* no variable sharing */
+	pos = putInt( buf, pos, -1 );             /* no connectivity sharing */
+	for( l = 0; l < nvars; l++ ) {
+		pos = putDouble( buf, pos, min[l] );
+		pos = putDouble( buf, pos, max[l] );
+	}
+
+	return pos;
+} /* end TecplotZoneHeader() */
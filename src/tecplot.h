@@ -0,0 +1,22 @@
+#ifndef TECPLOT_H
+#define TECPLOT_H
+
+#include <stddef.h>    /* size_t */
+
+/*
+* TecplotHeader - Header section of a binary Tecplot file (format 112) holding one
+* ordered zone of imax x jmax x kmax points. Returns its size in bytes; with
+* buf == NULL only the size is computed.
+*/
+size_t TecplotHeader( char *buf, const char *title, int nvars, const char **names,
+                      int imax, int jmax, int kmax, double time );
+
+/*
+* TecplotZoneHeader - Beginning of the data section of the zone (all variables are
+* floats, in BLOCK order) with the min/max pair of every variable. Returns its size.
+*/
+size_t TecplotZoneHeader( char *buf, int nvars, const double *min, const double *max );
+
+/* the zone data follows: nvars float arrays [kmax][jmax][imax], i running fastest */
+
+#endif
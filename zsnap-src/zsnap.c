@@ -0,0 +1,133 @@
+/* zsnap.c *********************\
+*                               *
+*  Decompressor of the frames   *
+*  "<step>.zsnap" of mpi-layer2 *
+*  (f_format = 4)               *
+*                               *
+\*******************************/
+
+/*
+*  Usage: zsnap <step>.zsnap ...
+*
+*  Every file is restored to "<step>.snap" (the fields one after another, each a
+*  float array [nz][ny][nx] with x running fastest), which the "<step>.xmf" written
+*  by the solver describes. The compression ratio and the error bound of every
+*  field are reported.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "zcomp.h"
+
+
+static void *AllocMem( size_t size )
+{
+void *x;
+
+   if( ( x = malloc( size ) ) == NULL ) {
+	  puts( "Cannot allocate memory" );
+	  exit( -1 );
+   }
+   return x;
+
+} /* end AllocMem() */
+
+
+/*
+* Restore - Decompresses one file; returns 0 on success.
+*/
+static int Restore( const char *name )
+{
+FILE *pF;
+char magic[8], outname[256], *dot;
+int hdr[7], nx, ny, nz, numprocs, nf, step, len, r, l;
+double time, *eb;
+unsigned long long *sizes, total = 0, max = 0;
+unsigned char *blob;
+float *field, *slab;
+size_t n, m, j;
+
+   if( ( pF = fopen( name, "rb" ) ) == NULL ) {
+      printf( "Cannot open file \"%s\"\n", name );
+      return 1;
+   }
+   if( fread( magic, 1, 8, pF ) != 8 || memcmp( magic, "LAYER2Z1", 8 ) != 0 ||
+       fread( hdr, sizeof(int), 7, pF ) != 7 || fread( &time, sizeof(double), 1, pF ) != 1 ) {
+      printf( "\"%s\" is not a compressed frame\n", name );
+      fclose( pF );
+      return 1;
+   }
+   nx = hdr[0]; ny = hdr[1]; nz = hdr[2]; numprocs = hdr[3]; nf = hdr[4]; step = hdr[5]; len = hdr[6];
+
+   eb    = (double *)AllocMem( nf * sizeof(double) );
+   sizes = (unsigned long long *)AllocMem( (size_t)numprocs * nf * sizeof(unsigned long long) );
+   if( fread( eb, sizeof(double), nf, pF ) != (size_t)nf ||
+       fread( sizes, sizeof(unsigned long long), (size_t)numprocs * nf, pF ) != (size_t)numprocs * nf ) {
+      printf( "\"%s\" is truncated\n", name );
+      fclose( pF );
+      return 1;
+   }
+   for( m = 0; m < (size_t)numprocs * nf; m++ ) if( sizes[m] > max ) max = sizes[m];
+
+   n = (size_t)nx * ny * nz;
+   field = (float *)AllocMem( (size_t)nf * n * sizeof(float) );
+   slab  = (float *)AllocMem( (size_t)len * ny * nz * sizeof(float) );
+   blob  = (unsigned char *)AllocMem( max );
+
+   //--- blocks are stored process by process, field by field
+   for( r = 0; r < numprocs; r++ ) {
+      for( l = 0; l < nf; l++ ) {
+         if( fread( blob, 1, sizes[r*nf + l], pF ) != sizes[r*nf + l] ||
+             ZDecompress( blob, sizes[r*nf + l], len, ny, nz, slab ) != 0 ) {
+            printf( "\"%s\": block %d of process %d is damaged\n", name, l, r );
+            fclose( pF );
+            return 1;
+         }
+         // slab [nz][ny][len] into the x-range of process r
+         for( j = 0; j < (size_t)ny * nz; j++ )
+            memcpy( field + l*n + j*nx + (size_t)r*len, slab + j*len, len * sizeof(float) );
+         total += sizes[r*nf + l];
+      }
+   }
+   fclose( pF );
+
+   //--- "<step>.snap" next to the compressed file
+   strncpy( outname, name, sizeof(outname) - 6 );
+   outname[sizeof(outname) - 6] = '\0';
+   if( ( dot = strrchr( outname, '.' ) ) != NULL ) *dot = '\0';
+   strcat( outname, ".snap" );
+   if( ( pF = fopen( outname, "wb" ) ) == NULL ) {
+      printf( "Cannot open file \"%s\"\n", outname );
+      return 1;
+   }
+   fwrite( field, sizeof(float), (size_t)nf * n, pF );
+   fclose( pF );
+
+   printf( "%s: step %d, time %g, %dx%dx%d, ratio %.2f -> %s\n", name, step, time, nx, ny, nz,
+           (double)nf * n * sizeof(float) / total, outname );
+   for( l = 0; l < nf; l++ ) {
+      unsigned long long s = 0;
+      for( r = 0; r < numprocs; r++ ) s += sizes[r*nf + l];
+      printf( "   field %d: ratio %6.2f, error bound %g\n", l, (double)n * sizeof(float) / s, eb[l] );
+   }
+
+   free( eb ); free( sizes ); free( field ); free( slab ); free( blob );
+   return 0;
+
+} /* end Restore() */
+
+
+int main( int argc, char *argv[] )
+{
+int i, nErr = 0;
+
+   if( argc < 2 ) {
+      puts( "Usage: zsnap <step>.zsnap ..." );
+      return 1;
+   }
+   for( i = 1; i < argc; i++ ) nErr += Restore( argv[i] );
+
+   return nErr ? 1 : 0;
+
+} /* end main() */